@@ -49,6 +49,15 @@
 //=============================================================================================================
 
 #include <QBrush>
+#include <QAbstractItemView>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
 
 
 //*************************************************************************************************************
@@ -258,31 +267,82 @@ void RawDelegate::createPlotPath(const QModelIndex &index, const QStyleOptionVie
     }
     }
 
-    double dValue;
     double dScaleY = option.rect.height()/(2*dMaxValue);
-
     double y_base = -path.currentPosition().y();
-    QPointF qSamplePosition;
 
-    path.moveTo(path.currentPosition().x(), -(y_base + ((*(listPairs[0].first) - channelMean)*dScaleY)));
+    const RawModel* t_rawModel = static_cast<const RawModel*>(index.model());
+
+    //Only the pixel columns which are visible in the viewport are plotted
+    int iFirstColumn = option.rect.left();
+    int iLastColumn = option.rect.right();
+
+    if(const QAbstractItemView* pView = qobject_cast<const QAbstractItemView*>(option.widget)) {
+        iFirstColumn = qMax(iFirstColumn, pView->viewport()->rect().left());
+        iLastColumn = qMin(iLastColumn, pView->viewport()->rect().right());
+    }
+
+    //A column is at least one pixel wide, at most two points (min/max) are plotted per column
+    double dColumnWidth = qMax(m_dDx, 1.0);
+    double dSamplesPerColumn = dColumnWidth/m_dDx;
+    int iNColumns = int((iLastColumn - iFirstColumn + 1)/dColumnWidth);
 
-    //plot all rows from list of pairs
-    for(qint8 i=0; i < listPairs.size(); ++i) {
-        //create lines from one to the next sample
-        for(qint32 j=0; j < listPairs[i].second; ++j)
-        {
-            double val = *(listPairs[i].first+j);
+    if(iNColumns <= 0 || listPairs.isEmpty())
+        return;
 
-            //subtract mean of the channel here (if wanted by the user)
-            dValue = (val - channelMean)*dScaleY;
+    //Samples relative to the first sample of the fiff file
+    double dFirstSample = (iFirstColumn - option.rect.x())/m_dDx;
+    qint32 iPreloadedFirst = t_rawModel->relFiffCursor();
+    qint32 iWindowSize = listPairs[0].second;
+    qint32 iNPreloaded = iWindowSize*(listPairs.size()-1) + listPairs.last().second;
 
-            double newY = y_base+dValue;
+    //Parts which are not preloaded yet (e.g. while scrolling fast) are plotted from the min/max pyramid
+    RowVectorXf vecPyramidMin, vecPyramidMax;
+    RawPyramid::ConstSPtr pRawPyramid = t_rawModel->rawPyramid();
+    bool bPyramid = false;
 
-            qSamplePosition.setY(-newY);
-            qSamplePosition.setX(path.currentPosition().x()+m_dDx);
+    if(pRawPyramid && (dFirstSample < iPreloadedFirst || dFirstSample + iNColumns*dSamplesPerColumn > iPreloadedFirst + iNPreloaded))
+        bPyramid = pRawPyramid->envelope(index.row(), dFirstSample, dSamplesPerColumn, iNColumns, vecPyramidMin, vecPyramidMax);
 
-            path.lineTo(qSamplePosition);
+    bool bPathStarted = false;
+
+    for(qint32 c = 0; c < iNColumns; ++c) {
+        qint32 iFrom = qint32(std::ceil(dFirstSample + c*dSamplesPerColumn)) - iPreloadedFirst;
+        qint32 iTo = qint32(std::ceil(dFirstSample + (c+1)*dSamplesPerColumn)) - iPreloadedFirst;
+        double dX = iFirstColumn + c*dColumnWidth;
+
+        double dMin, dMax;
+
+        if(iFrom >= 0 && iTo <= iNPreloaded && iTo > iFrom) {
+            dMin = dMax = *(listPairs[iFrom/iWindowSize].first + iFrom%iWindowSize);
+
+            for(qint32 j = iFrom+1; j < iTo; ++j) {
+                double val = *(listPairs[j/iWindowSize].first + j%iWindowSize);
+                dMin = qMin(dMin, val);
+                dMax = qMax(dMax, val);
+            }
+        }
+        else if(bPyramid && iTo > iFrom) {
+            dMin = vecPyramidMin[c];
+            dMax = vecPyramidMax[c];
         }
+        else {
+            bPathStarted = false;
+            continue;
+        }
+
+        //subtract mean of the channel here (if wanted by the user)
+        QPointF qMinPosition(dX, -(y_base + (dMin - channelMean)*dScaleY));
+        QPointF qMaxPosition(dX, -(y_base + (dMax - channelMean)*dScaleY));
+
+        if(bPathStarted)
+            path.lineTo(qMinPosition);
+        else
+            path.moveTo(qMinPosition);
+
+        if(dMax != dMin)
+            path.lineTo(qMaxPosition);
+
+        bPathStarted = true;
     }
 
 //    qDebug("Plot-PainterPath created!");
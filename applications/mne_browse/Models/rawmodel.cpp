@@ -97,6 +97,13 @@ RawModel::RawModel(QObject *parent)
         insertReloadedData(m_reloadFutureWatcher.future().result());
     });
 
+    //connect level of detail pyramid - this is built concurrently
+    connect(&m_pyramidFutureWatcher,&QFutureWatcher<RawPyramid::SPtr>::finished,[this](){
+        m_pRawPyramid = m_pyramidFutureWatcher.future().result();
+        emit rawPyramidLoaded();
+        emit dataChanged(createIndex(0,1),createIndex(m_chInfolist.size(),1));
+    });
+
     //connect filtering reloading - this is done after a new block has been loaded
     connect(this,&RawModel::dataReloaded,[this](){
         if(!m_assignedOperators.empty())
@@ -144,6 +151,13 @@ RawModel::RawModel(QFile &qFile, QObject *parent)
         insertReloadedData(m_reloadFutureWatcher.future().result());
     });
 
+    //connect level of detail pyramid - this is built concurrently
+    connect(&m_pyramidFutureWatcher,&QFutureWatcher<RawPyramid::SPtr>::finished,[this](){
+        m_pRawPyramid = m_pyramidFutureWatcher.future().result();
+        emit rawPyramidLoaded();
+        emit dataChanged(createIndex(0,1),createIndex(m_chInfolist.size(),1));
+    });
+
     connect(this,&RawModel::dataReloaded,[this](){
         if(!m_assignedOperators.empty())
             updateOperatorsConcurrently();
@@ -414,6 +428,9 @@ bool RawModel::loadFiffData(QFile* qFile)
 
     qFile->close();
 
+    //load or build the min/max pyramid in the background, setting a new future stops watching a previous one
+    m_pyramidFutureWatcher.setFuture(QtConcurrent::run(this,&RawModel::createRawPyramid,qFile->fileName()));
+
     emit fileLoaded(m_pFiffInfo);
     emit assignedOperatorsChanged(m_assignedOperators);
 
@@ -502,6 +519,7 @@ void RawModel::clearModel()
 
     //data model structure
     m_data.clear();
+    m_pRawPyramid.clear();
 
     //MNEOperators
     m_assignedOperators.clear();
@@ -637,6 +655,31 @@ QPair<MatrixXd,MatrixXd> RawModel::readSegment(fiff_int_t from, fiff_int_t to)
 }
 
 
+//*************************************************************************************************************
+
+RawPyramid::SPtr RawModel::createRawPyramid(const QString& sFileName) const
+{
+    RawPyramid::SPtr pRawPyramid(new RawPyramid());
+    bool bPersist = PYRAMID_PERSIST && !RawPyramid::cacheFileName(sFileName).isEmpty();
+
+    if(bPersist && pRawPyramid->load(sFileName)) {
+        qDebug() << "RawModel: Min/max pyramid loaded from" << RawPyramid::cacheFileName(sFileName);
+        return pRawPyramid;
+    }
+
+    if(!pRawPyramid->build(sFileName, m_iWindowSize)) {
+        qDebug() << "RawModel: Could not build min/max pyramid of" << sFileName;
+        return RawPyramid::SPtr();
+    }
+
+    if(bPersist && !pRawPyramid->save(sFileName)) {
+        qDebug() << "RawModel: Could not store min/max pyramid to" << RawPyramid::cacheFileName(sFileName);
+    }
+
+    return pRawPyramid;
+}
+
+
 //*************************************************************************************************************
 //public SLOTS
 void RawModel::updateScrollPos(int value)
@@ -75,6 +75,7 @@
 #include "../Utils/filteroperator.h"
 #include "../Utils/rawsettings.h"
 #include "../Utils/datapackage.h"
+#include "../Utils/rawpyramid.h"
 
 
 //*************************************************************************************************************
@@ -232,6 +233,15 @@ private:
     */
     QPair<MatrixXd,MatrixXd> readSegment(fiff_int_t from, fiff_int_t to);
 
+    //=========================================================================================================
+    /**
+    * createRawPyramid loads the stored min/max pyramid of a fiff file or builds (and stores) it. This is run in a background-thread.
+    *
+    * @param sFileName the fiff file
+    * @return the pyramid, empty if it could not be built
+    */
+    RawPyramid::SPtr createRawPyramid(const QString& sFileName) const;
+
     //VARIABLES
     //Reload control
     bool                                    m_bStartReached;            /**< signals, whether the start of the fiff data file is reached. */
@@ -242,6 +252,10 @@ private:
     QFutureWatcher<QPair<MatrixXd,MatrixXd> > m_reloadFutureWatcher;    /**< QFutureWatcher for watching process of reloading fiff data. */
     bool                                    m_bReloading;               /**< signals when the reloading is ongoing. */
 
+    //Concurrent level of detail pyramid
+    QFutureWatcher<RawPyramid::SPtr>        m_pyramidFutureWatcher;     /**< QFutureWatcher for watching process of building the min/max pyramid. */
+    RawPyramid::SPtr                        m_pRawPyramid;              /**< min/max pyramid of the whole fiff file, used to draw data that is not preloaded. */
+
     //Concurrent processing
 //    QFutureWatcher<QPair<int,RowVectorXd> > m_operatorFutureWatcher; /**< QFutureWatcher for watching process of applying Operators to reloaded fiff data. */
     QFutureWatcher<void>                    m_operatorFutureWatcher;    /**< QFutureWatcher for watching process of applying Operators to reloaded fiff data. */
@@ -273,6 +287,12 @@ signals:
     */
     void dataReloaded();
 
+    //=========================================================================================================
+    /**
+    * rawPyramidLoaded is emitted when the min/max pyramid of the fiff file is available
+    */
+    void rawPyramidLoaded();
+
     //=========================================================================================================
     /**
     * fileLoaded is emitted whenever a file was to be loaded
@@ -511,6 +531,14 @@ public:
     * @return the absolute cursor in the fiff file
     */
     inline qint32 absFiffCursor() const;
+
+    //=========================================================================================================
+    /**
+    * rawPyramid
+    *
+    * @return the min/max pyramid of the loaded Fiff file, null while it is being built
+    */
+    inline RawPyramid::ConstSPtr rawPyramid() const;
 };
 
 //*************************************************************************************************************
@@ -566,6 +594,13 @@ inline qint32 RawModel::absFiffCursor() const {
     return m_iAbsFiffCursor;
 }
 
+
+//*************************************************************************************************************
+
+inline RawPyramid::ConstSPtr RawModel::rawPyramid() const {
+    return m_pRawPyramid;
+}
+
 } // NAMESPACE
 
 #endif // RAWMODEL_H
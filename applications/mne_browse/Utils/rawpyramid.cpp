@@ -0,0 +1,365 @@
+//=============================================================================================================
+/**
+* @file     rawpyramid.cpp
+* @author   Lorenz Esch <lorenz.esch@tu-ilmenau.de>;
+*           Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Lorenz Esch and Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the implementation of the RawPyramid class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rawpyramid.h"
+
+#include <fiff/fiff_raw_data.h>
+
+#include <utils/ioutils.h>
+
+#include <cmath>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNEBROWSE;
+using namespace FIFFLIB;
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+#define PYRAMID_FILE_MAGIC 0x4d4e4550   //identifies a stored pyramid
+#define PYRAMID_FILE_VERSION 1          //version of the stored pyramid layout
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+RawPyramid::RawPyramid()
+: m_iNSamples(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+bool RawPyramid::build(const QString& sFiffFileName, qint32 iBlockSize)
+{
+    m_lMin.clear();
+    m_lMax.clear();
+    m_iNSamples = 0;
+
+    //Use an own file handle, the model reads from its own one at the same time
+    QFile t_File(sFiffFileName);
+    FiffRawData raw(t_File);
+
+    if(raw.info.nchan <= 0 || raw.last_samp < raw.first_samp) {
+        qDebug() << "RawPyramid::build - Could not read raw data from" << sFiffFileName;
+        return false;
+    }
+
+    qint64 iNSamples = raw.last_samp - raw.first_samp + 1;
+    qint64 iNBins = (iNSamples + PYRAMID_BASE_BIN - 1) / PYRAMID_BASE_BIN;
+
+    MatrixXf matMin(raw.info.nchan, iNBins);
+    MatrixXf matMax(raw.info.nchan, iNBins);
+
+    iBlockSize = qMax(iBlockSize - iBlockSize % PYRAMID_BASE_BIN, PYRAMID_BASE_BIN);
+
+    MatrixXd data, times;
+
+    for(qint64 iFrom = 0; iFrom < iNSamples; iFrom += iBlockSize) {
+        qint64 iTo = qMin(iFrom + iBlockSize, iNSamples) - 1;
+
+        if(!raw.read_raw_segment(data, times, raw.first_samp + iFrom, raw.first_samp + iTo)) {
+            qDebug() << "RawPyramid::build - Could not read samples" << iFrom << "to" << iTo;
+            return false;
+        }
+
+        //Blocks start at multiples of the bin size, so every bin lies within one block
+        qint64 iBin = iFrom / PYRAMID_BASE_BIN;
+
+        for(int s = 0; s < data.cols(); s += PYRAMID_BASE_BIN, ++iBin) {
+            int iLength = qMin(PYRAMID_BASE_BIN, int(data.cols()) - s);
+
+            matMin.col(iBin) = data.middleCols(s, iLength).rowwise().minCoeff().cast<float>();
+            matMax.col(iBin) = data.middleCols(s, iLength).rowwise().maxCoeff().cast<float>();
+        }
+    }
+
+    m_lMin.append(matMin);
+    m_lMax.append(matMax);
+    m_iNSamples = iNSamples;
+
+    buildLevels();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool RawPyramid::load(const QString& sFiffFileName)
+{
+    QString sCacheFileName = cacheFileName(sFiffFileName);
+
+    if(sCacheFileName.isEmpty()) {
+        return false;
+    }
+
+    QFile t_File(sCacheFileName);
+
+    if(!t_File.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QFileInfo fiffInfo(sFiffFileName);
+    QDataStream stream(&t_File);
+
+    quint32 iMagic;
+    qint32 iVersion, iBaseBin, iNLevels;
+    qint64 iFileSize, iModified, iNSamples;
+
+    stream >> iMagic >> iVersion >> iFileSize >> iModified >> iBaseBin >> iNSamples >> iNLevels;
+
+    //The pyramid is only valid for the same file and settings
+    if(iMagic != PYRAMID_FILE_MAGIC
+       || iVersion != PYRAMID_FILE_VERSION
+       || iFileSize != fiffInfo.size()
+       || iModified != fiffInfo.lastModified().toMSecsSinceEpoch()
+       || iBaseBin != PYRAMID_BASE_BIN
+       || iNLevels <= 0) {
+        return false;
+    }
+
+    QList<MatrixXf> lMin, lMax;
+
+    for(int i = 0; i < iNLevels; ++i) {
+        qint32 iRows, iCols;
+        stream >> iRows >> iCols;
+
+        if(stream.status() != QDataStream::Ok || iRows <= 0 || iCols <= 0) {
+            return false;
+        }
+
+        MatrixXf matMin(iRows, iCols);
+        MatrixXf matMax(iRows, iCols);
+        int iBytes = iRows * iCols * sizeof(float);
+
+        if(stream.readRawData(reinterpret_cast<char*>(matMin.data()), iBytes) != iBytes
+           || stream.readRawData(reinterpret_cast<char*>(matMax.data()), iBytes) != iBytes) {
+            return false;
+        }
+
+        lMin.append(matMin);
+        lMax.append(matMax);
+    }
+
+    m_lMin = lMin;
+    m_lMax = lMax;
+    m_iNSamples = iNSamples;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool RawPyramid::save(const QString& sFiffFileName) const
+{
+    QString sCacheFileName = cacheFileName(sFiffFileName);
+
+    if(isEmpty() || sCacheFileName.isEmpty()) {
+        return false;
+    }
+
+    //Older pyramids make room, a pyramid larger than the cache limit is not stored
+    QString sCacheDir = QFileInfo(sCacheFileName).absolutePath();
+    qint64 iReserve = 0;
+
+    for(int i = 0; i < m_lMin.size(); ++i) {
+        iReserve += 2 * qint64(m_lMin.at(i).size()) * sizeof(float);
+    }
+
+    if(!QDir().mkpath(sCacheDir) || !IOUtils::trim_cache_dir(sCacheDir, iReserve)) {
+        return false;
+    }
+
+    //Written to a temporary file first, an interrupted save leaves no partial pyramid behind
+    QSaveFile t_File(sCacheFileName);
+
+    if(!t_File.open(QIODevice::WriteOnly)) {
+        qDebug() << "RawPyramid::save - Could not open" << t_File.fileName();
+        return false;
+    }
+
+    QFileInfo fiffInfo(sFiffFileName);
+    QDataStream stream(&t_File);
+
+    stream << quint32(PYRAMID_FILE_MAGIC)
+           << qint32(PYRAMID_FILE_VERSION)
+           << qint64(fiffInfo.size())
+           << qint64(fiffInfo.lastModified().toMSecsSinceEpoch())
+           << qint32(PYRAMID_BASE_BIN)
+           << qint64(m_iNSamples)
+           << qint32(m_lMin.size());
+
+    for(int i = 0; i < m_lMin.size(); ++i) {
+        int iBytes = m_lMin.at(i).size() * sizeof(float);
+
+        stream << qint32(m_lMin.at(i).rows()) << qint32(m_lMin.at(i).cols());
+        stream.writeRawData(reinterpret_cast<const char*>(m_lMin.at(i).data()), iBytes);
+        stream.writeRawData(reinterpret_cast<const char*>(m_lMax.at(i).data()), iBytes);
+    }
+
+    if(stream.status() != QDataStream::Ok) {
+        t_File.cancelWriting();
+    }
+
+    return t_File.commit();
+}
+
+
+//*************************************************************************************************************
+
+QString RawPyramid::cacheFileName(const QString& sFiffFileName)
+{
+    QString sCacheDir = IOUtils::get_cache_dir("pyramid");
+
+    if(sCacheDir.isEmpty()) {
+        return QString();
+    }
+
+    //One pyramid per raw data file, the data directory itself may not be writable
+    QByteArray hash = QCryptographicHash::hash(QFileInfo(sFiffFileName).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+
+    return QString("%1/%2-pyramid.dat").arg(sCacheDir).arg(QString(hash.toHex()));
+}
+
+
+//*************************************************************************************************************
+
+bool RawPyramid::envelope(int iChannel,
+                          double dFirstSample,
+                          double dSamplesPerColumn,
+                          int iNColumns,
+                          RowVectorXf& vecMin,
+                          RowVectorXf& vecMax) const
+{
+    if(isEmpty() || iChannel < 0 || iChannel >= m_lMin.first().rows() || dSamplesPerColumn <= 0) {
+        return false;
+    }
+
+    vecMin = RowVectorXf::Zero(iNColumns);
+    vecMax = RowVectorXf::Zero(iNColumns);
+
+    //Coarsest level whose bins still fit into one column
+    int iLevel = 0;
+    double dBinSize = PYRAMID_BASE_BIN;
+
+    while(iLevel + 1 < m_lMin.size() && 2 * dBinSize <= dSamplesPerColumn) {
+        ++iLevel;
+        dBinSize *= 2;
+    }
+
+    const MatrixXf& matMin = m_lMin.at(iLevel);
+    const MatrixXf& matMax = m_lMax.at(iLevel);
+
+    for(int c = 0; c < iNColumns; ++c) {
+        double dFrom = dFirstSample + c * dSamplesPerColumn;
+        double dTo = dFrom + dSamplesPerColumn;
+
+        if(dTo <= 0 || dFrom >= m_iNSamples) {
+            continue;
+        }
+
+        qint64 iFirstBin = qMax(qint64(std::floor(dFrom / dBinSize)), qint64(0));
+        qint64 iLastBin = qMin(qint64(std::ceil(dTo / dBinSize)) - 1, qint64(matMin.cols()) - 1);
+        iLastBin = qMax(iLastBin, iFirstBin);
+
+        vecMin(c) = matMin.row(iChannel).segment(iFirstBin, iLastBin - iFirstBin + 1).minCoeff();
+        vecMax(c) = matMax.row(iChannel).segment(iFirstBin, iLastBin - iFirstBin + 1).maxCoeff();
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RawPyramid::buildLevels()
+{
+    while(m_lMin.last().cols() > 1) {
+        const MatrixXf& matMin = m_lMin.last();
+        const MatrixXf& matMax = m_lMax.last();
+
+        int iNBins = (matMin.cols() + 1) / 2;
+        MatrixXf matNewMin(matMin.rows(), iNBins);
+        MatrixXf matNewMax(matMax.rows(), iNBins);
+
+        for(int i = 0; i < iNBins; ++i) {
+            if(2 * i + 1 < matMin.cols()) {
+                matNewMin.col(i) = matMin.col(2 * i).cwiseMin(matMin.col(2 * i + 1));
+                matNewMax.col(i) = matMax.col(2 * i).cwiseMax(matMax.col(2 * i + 1));
+            } else {
+                matNewMin.col(i) = matMin.col(2 * i);
+                matNewMax.col(i) = matMax.col(2 * i);
+            }
+        }
+
+        m_lMin.append(matNewMin);
+        m_lMax.append(matNewMax);
+    }
+}
@@ -0,0 +1,212 @@
+//=============================================================================================================
+/**
+* @file     rawpyramid.h
+* @author   Lorenz Esch <lorenz.esch@tu-ilmenau.de>;
+*           Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Lorenz Esch and Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the declaration of the RawPyramid class.
+*
+*/
+
+#ifndef RAWPYRAMID_H
+#define RAWPYRAMID_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rawsettings.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE MNEBROWSE
+//=============================================================================================================
+
+namespace MNEBROWSE
+{
+
+
+//=============================================================================================================
+/**
+* Multi-resolution min/max decimation of a raw data file. Level 0 holds the minimum and maximum of each channel
+* over bins of PYRAMID_BASE_BIN samples, every following level merges two bins of the previous one. The pyramid
+* is built once from the calibrated raw data (without projectors, compensators and filters) and can be stored
+* next to the fiff file, so that zoomed out or not yet loaded parts of a recording can be drawn from it.
+*
+* @brief The RawPyramid class holds a min/max pyramid of a raw data file.
+*/
+class RawPyramid
+{
+public:
+    typedef QSharedPointer<RawPyramid> SPtr;            /**< Shared pointer type for RawPyramid. */
+    typedef QSharedPointer<const RawPyramid> ConstSPtr; /**< Const shared pointer type for RawPyramid. */
+
+    //=========================================================================================================
+    /**
+    * Constructs an empty RawPyramid.
+    */
+    RawPyramid();
+
+    //=========================================================================================================
+    /**
+    * Builds the pyramid by reading the whole raw data file block by block. The file is opened separately, so
+    * this can be run in a background thread while the file is browsed.
+    *
+    * @param sFiffFileName the raw data file.
+    * @param iBlockSize the number of samples read at once, rounded down to a multiple of PYRAMID_BASE_BIN.
+    * @return true if succeeded, false otherwise.
+    */
+    bool build(const QString& sFiffFileName, qint32 iBlockSize = MODEL_WINDOW_SIZE);
+
+    //=========================================================================================================
+    /**
+    * Loads the pyramid stored for a raw data file, if it is still valid (same file size and modification time).
+    *
+    * @param sFiffFileName the raw data file.
+    * @return true if succeeded, false otherwise.
+    */
+    bool load(const QString& sFiffFileName);
+
+    //=========================================================================================================
+    /**
+    * Stores the pyramid in the disk cache, see cacheFileName.
+    *
+    * @param sFiffFileName the raw data file.
+    * @return true if succeeded, false otherwise.
+    */
+    bool save(const QString& sFiffFileName) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the file name the pyramid of a raw data file is stored in. The file lies in the "pyramid" directory of
+    * the disk cache, see IOUtils::get_cache_dir.
+    *
+    * @param sFiffFileName the raw data file.
+    * @return the file name of the stored pyramid, empty if the disk caches are switched off (MNE_CPP_CACHE=0).
+    */
+    static QString cacheFileName(const QString& sFiffFileName);
+
+    //=========================================================================================================
+    /**
+    * Returns the minimum and maximum of a channel for consecutive columns of samples. The coarsest level whose
+    * bins are not larger than a column is used.
+    *
+    * @param iChannel the channel.
+    * @param dFirstSample the first sample of the first column, relative to the first sample of the file.
+    * @param dSamplesPerColumn the number of samples per column.
+    * @param iNColumns the number of columns.
+    * @param vecMin returns the minimum of each column.
+    * @param vecMax returns the maximum of each column.
+    * @return false if the pyramid is empty or the channel does not exist. Columns outside the file are zero.
+    */
+    bool envelope(int iChannel,
+                  double dFirstSample,
+                  double dSamplesPerColumn,
+                  int iNColumns,
+                  RowVectorXf& vecMin,
+                  RowVectorXf& vecMax) const;
+
+    //=========================================================================================================
+    /**
+    * Returns whether the pyramid is empty.
+    *
+    * @return true if no pyramid was built or loaded.
+    */
+    inline bool isEmpty() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of samples covered by the pyramid.
+    *
+    * @return the number of samples.
+    */
+    inline qint64 samples() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Creates the coarser levels from level 0.
+    */
+    void buildLevels();
+
+    QList<MatrixXf>     m_lMin;         /**< The minimum of each channel (rows) and bin (columns), one matrix per level. */
+    QList<MatrixXf>     m_lMax;         /**< The maximum of each channel (rows) and bin (columns), one matrix per level. */
+    qint64              m_iNSamples;    /**< The number of samples covered by the pyramid. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool RawPyramid::isEmpty() const
+{
+    return m_lMin.isEmpty();
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 RawPyramid::samples() const
+{
+    return m_iNSamples;
+}
+
+} // NAMESPACE MNEBROWSE
+
+#endif // RAWPYRAMID_H
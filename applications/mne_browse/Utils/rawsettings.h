@@ -83,6 +83,10 @@
 #define MODEL_NUM_FILTER_TAPS 80 //number of filter taps, required to take into account because of FFT convolution (zero padding)
 #define MODEL_MAX_NUM_FILTER_TAPS 0 //number of maximal filter taps
 
+//RawPyramid
+#define PYRAMID_BASE_BIN 64 //number of samples per min/max bin of the finest pyramid level
+#define PYRAMID_PERSIST true //store the pyramid in the disk cache (MNE_CPP_CACHE) and reuse it when the file is opened again
+
 //RawDelegate
 //Look
 #define DELEGATE_PLOT_HEIGHT 40 //height of a single plot (row)
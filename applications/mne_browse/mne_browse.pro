@@ -76,6 +76,7 @@ SOURCES += \
     main.cpp \
     Utils/datamarker.cpp \
     Utils/rawsettings.cpp \
+    Utils/rawpyramid.cpp \
     Utils/filteroperator.cpp \
     Utils/filterplotscene.cpp \
     Utils/butterflyscene.cpp \
@@ -101,6 +102,7 @@ SOURCES += \
 HEADERS += \
     Utils/datamarker.h \
     Utils/rawsettings.h \
+    Utils/rawpyramid.h \
     Utils/filteroperator.h \
     Utils/types.h \
     Utils/info.h \
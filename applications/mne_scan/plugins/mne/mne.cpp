@@ -509,6 +509,10 @@ void MNE::updateInvOp(const MNEInverseOperator& invOp)
 
     //Set up the inverse according to the parameters
     m_pMinimumNorm->doInverseSetup(m_iNumAverages,false);
+
+    const MNESourceSpace& t_sourceSpace = m_pMinimumNorm->getSourceSpace();
+    m_vecVertices.resize(t_sourceSpace[0].vertno.size() + t_sourceSpace[1].vertno.size());
+    m_vecVertices << t_sourceSpace[0].vertno, t_sourceSpace[1].vertno;
 }
 
 
@@ -563,6 +567,9 @@ void MNE::run()
 
     qint32 skip_count = 0;
 
+    //The source amplitudes, only reallocated if the block size changes
+    MatrixXd matSourceAmplitudes;
+
 //    //
 //    // TEMP INV LOADING START
 //    //
@@ -617,7 +624,10 @@ void MNE::run()
                 m_qMutex.lock();
 
                 //TODO: Add picking here. See evoked part as input.
-                MNESourceEstimate sourceEstimate = m_pMinimumNorm->calculateInverse(data, tmin, tstep);
+                MNESourceEstimate sourceEstimate;
+                if(m_pMinimumNorm->applyInverse(data, matSourceAmplitudes)) {
+                    sourceEstimate = MNESourceEstimate(matSourceAmplitudes, m_vecVertices, tmin, tstep);
+                }
 
                 m_qMutex.unlock();
 
@@ -652,7 +662,10 @@ void MNE::run()
 
                 t_fiffEvoked = t_fiffEvoked.pick_channels(m_invOp.noise_cov->names);
 
-                MNESourceEstimate sourceEstimate = m_pMinimumNorm->calculateInverse(t_fiffEvoked.data, tmin, tstep);
+                MNESourceEstimate sourceEstimate;
+                if(m_pMinimumNorm->applyInverse(t_fiffEvoked.data, matSourceAmplitudes)) {
+                    sourceEstimate = MNESourceEstimate(matSourceAmplitudes, m_vecVertices, tmin, tstep);
+                }
 
                 m_qMutex.unlock();
 
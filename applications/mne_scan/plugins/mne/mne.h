@@ -266,6 +266,8 @@ protected:
 
     MNELIB::MNEInverseOperator      m_invOp;                    /**< The inverse operator. */
 
+    Eigen::VectorXi                 m_vecVertices;              /**< The source vertices of both hemispheres of the inverse operator. */
+
 signals:
     //=========================================================================================================
     /**
@@ -66,6 +66,7 @@ NoiseReduction::NoiseReduction()
 , m_pNoiseReductionInput(NULL)
 , m_pNoiseReductionOutput(NULL)
 , m_pNoiseReductionBuffer(CircularMatrixBuffer<double>::SPtr())
+, m_iMaxFilterLength(0)
 , m_iMaxFilterTapSize(0)
 , m_bSpharaActive(false)
 , m_bFilterActivated(false)
@@ -483,12 +484,8 @@ void NoiseReduction::filterChanged(QList<FilterData> filterData)
 {
     m_filterData = filterData;
 
-    m_iMaxFilterLength = 1;
-    for(int i = 0; i < filterData.size(); ++i) {
-        if(m_iMaxFilterLength<filterData.at(i).m_iFilterOrder) {
-            m_iMaxFilterLength = filterData.at(i).m_iFilterOrder;
-        }
-    }
+    //Only the FIR filters delay the filtered channels, the unfiltered channels are delayed to match them
+    m_iMaxFilterLength = RtFilter::maxFirFilterLength(filterData);
 }
 
 
@@ -266,7 +266,7 @@ private:
 
     int                             m_iNBaseFctsFirst;                          /**< The number of grad/inner base functions to use for calculating the sphara opreator.*/
     int                             m_iNBaseFctsSecond;                         /**< The number of grad/outer base functions to use for calculating the sphara opreator.*/
-    int                             m_iMaxFilterLength;                         /**< Max order of the current filters */
+    int                             m_iMaxFilterLength;                         /**< Length of the longest FIR filter, the unfiltered channels are delayed by half of it */
     int                             m_iMaxFilterTapSize;                        /**< maximum number of allowed filter taps. This number depends on the size of the receiving blocks. */
 
     QString                         m_sCurrentSystem;                           /**< The current acquisition system (EEG, babyMEG, VectorView).*/
@@ -39,6 +39,8 @@
 #include "rtsssalgo.h"
 #include <QFuture>
 #include <QtConcurrent/QtConcurrentMap>
+#include <QThread>
+#include <QVector>
 #include <QFile>
 //#include "FormFiles/rtssssetupwidget.h"
 
@@ -50,6 +52,7 @@ RtSssAlgo::RtSssAlgo()
 , LOutRR(0)
 , LInOLS(0)
 , LOutOLS(0)
+, WarmStart(false)
 {
 
 }
@@ -145,6 +148,10 @@ MatrixXd RtSssAlgo::buildLinearEqn()
 
     EqnARR = CoilScale.asDiagonal() * EqnARR;
     EqnA = CoilScale.asDiagonal() * EqnA;
+
+//  The inverses depend on the geometry only, they are reused for all following data blocks
+    updateInverse();
+    WeightPrev.resize(0);
 //        std::cout << "pass 1" << std::endl;
 //        std::cout << "MEGData: " << MEGData.rows() << " x " << MEGData.cols() << std::endl;
 //    EqnB = CoilScale.asDiagonal() * MEGData;
@@ -816,19 +823,70 @@ void RtSssAlgo::getSphereToCartesianVector()
 
 //QList<MatrixXd> RtSssAlgo::getSSSRR(MatrixXd EqnIn, MatrixXd EqnOut, MatrixXd EqnARR, MatrixXd EqnA, MatrixXd EqnB)
 //QList<MatrixXd> RtSssAlgo::getSSSRR(MatrixXd EqnB)
-MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
+MatrixXd RtSssAlgo::getSSSRR(const MatrixXd& EqnB)
 {
-    //qDebug() << "getSSSRR START";
+    int NumExp;
+    MatrixXd SSSIn, Weight, SolOLS;
+    QVector<RtSssChunk> chunks;
+
+//  % initialization
+    NumExp = EqnB.cols();
+
+    SSSIn.setZero(EqnB.rows(),NumExp);
+    Weight.setZero(EqnB.rows(),NumExp);
+    if (NumExp == 0)
+        return SSSIn;
 
-    int NumBIn, NumBOut, NumCoil, NumExp;
-    MatrixXd EqnRRInv, EqnInv, SSSIn, SSSOut, Weight; //, ErrRel;
-    VectorXd ErrRel;
+//  % the inverses depend on the geometry only, they are computed by buildLinearEqn
+    if (EqnRRInv.rows() != EqnARR.cols() || EqnInv.rows() != EqnA.cols())
+        updateInverse();
+
+//  % solve OLS solution of all samples at once
+    SolOLS = EqnRRPinv * EqnB;
+
+//  % warm start from the weights of the last sample of the previous block
+    bool warm = WarmStart && WeightPrev.size() == EqnB.rows();
+
+//  % the samples are independent, solve them in parallel
+    int nThreads = qMax(1, qMin(QThread::idealThreadCount(), NumExp));
+    int nPerThread = (NumExp + nThreads - 1) / nThreads;
+    for(int first=0; first<NumExp; first+=nPerThread)
+    {
+        RtSssChunk chunk;
+        chunk.pAlgo = this;
+        chunk.pEqnB = &EqnB;
+        chunk.pSolOLS = &SolOLS;
+        chunk.pWeightInit = warm ? &WeightPrev : NULL;
+        chunk.pSSSIn = &SSSIn;
+        chunk.pWeight = &Weight;
+        chunk.iFirst = first;
+        chunk.iCount = qMin(nPerThread, NumExp-first);
+        chunks.append(chunk);
+    }
+
+    if (chunks.size() > 1)
+        QtConcurrent::blockingMap(chunks, &RtSssChunk::solve);
+    else
+        chunks[0].solve();
+
+    WeightPrev = Weight.col(NumExp-1);
+
+    return SSSIn;
+}
+
+void RtSssChunk::solve()
+{
+    for(int i=iFirst; i<iFirst+iCount; i++)
+        pAlgo->solveRR(i, *pEqnB, *pSolOLS, pWeightInit, *pSSSIn, *pWeight);
+}
+
+void RtSssAlgo::solveRR(int i, const MatrixXd& EqnB, const MatrixXd& SolOLS, const VectorXd* WeightInit, MatrixXd& SSSIn, MatrixXd& Weight) const
+{
+    int NumBIn, NumBOut;
     double RR_K1, RR_K2, RR_K3;
     double eqn_scale0, eqn_scale;
-    MatrixXd sol_X, sol_X_old, eqn_Y, eqn_D, temp_M, temp_N, sol_in, sol_out;
-    MatrixXd diagMat;
-    VectorXd eqn_err, weight_index;
-    QList<MatrixXd> RRsss;
+    MatrixXd eqn_Y, temp_N;
+    VectorXd sol_X, sol_X_old, eqn_D, temp_M, eqn_err, weight_index;
 
 //  % error tolerance for robust regression
     double ErrTolRel = 1e-3;
@@ -836,129 +894,72 @@ MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
 //  % weight threshold for robust regression
     double WeightThres = 1 - 1e-6;
 
-//  % initialization
     NumBIn = EqnIn.cols();
     NumBOut = EqnOut.cols();
-    NumCoil = EqnB.rows();
-    NumExp = EqnB.cols();
-
-    EqnRRInv = (EqnARR.transpose() * EqnARR).inverse();
-    EqnInv = (EqnA.transpose() * EqnA).inverse();
-
-    SSSIn.setZero(NumCoil,NumExp);
-    SSSOut.setZero(NumCoil,NumExp);
-    Weight.setZero(NumCoil,NumExp);
-    ErrRel.setZero(NumExp);
     RR_K3 = 3;
     RR_K2 = 4.685;
     RR_K1 = qSqrt(1-qSqrt(3)/2) * RR_K2;
 
-    for(int i=0; i<NumExp; i++)
-    {
-//      % solve OLS solution
-        sol_X = EqnRRInv * (EqnARR.transpose() * EqnB.col(i));
-//        std::cout << "sol_X ************************" << endl << sol_X.transpose() << endl;
-
-//      % scale linear equation
-        eqn_err = EqnARR * sol_X - EqnB.col(i);
-        eqn_scale0 = stdev(eqn_err);
-        eqn_err = eqn_err.cwiseAbs() / eqn_scale0;
-
-//      % solve iteratively re-weighted least squares (Bi-Square) -- subspace
-        sol_X_old.setConstant(sol_X.rows(), sol_X.cols(), 1e30);
-//        while (((sol_X-sol_X_old).norm() / sol_X.norm()) > ErrTolRel)
-        int cnt=0;
-        while (((sol_X.array()-sol_X_old.array()).matrix().norm() / sol_X.norm()) > ErrTolRel)
-//        for (int h=0; h<2; h++)
-        {
-            cnt++;
-//            cout << "while cnt: " << cnt << endl;
-            sol_X_old = sol_X;
-//            Weight(:,i) = (eqn_err <= RR_K1) + (eqn_err > RR_K1 & eqn_err <= RR_K2) .* (1-(eqn_err-RR_K1).^2/(RR_K2-RR_K1)^2).^2;
-//            Weight.col(i) = eigen_LTE(eqn_err, RR_K1) + eigen_AND(eigen_GT(eqn_err, RR_K1),eigen_LTE(eqn_err, RR_K2));
-            Weight.col(i) = eigen_LTE(eqn_err,RR_K1).array() + eigen_AND(eigen_GT(eqn_err,RR_K1),eigen_LTE(eqn_err,RR_K2)).array() * (1 - ((eqn_err.array()-RR_K1).pow(2)) / pow(RR_K2-RR_K1,2) ).pow(2);
-//            std::cout << "Weight **************************" << endl << Weight.transpose() << endl;
+//  % OLS solution
+    sol_X = SolOLS.col(i);
 
-//          % weight_index = find(Weight(:,i) < WeightThres);
-            weight_index = eigen_LT_index(Weight.col(i), WeightThres);
-//            weight_index = eigen_LT_index_test(Weight.col(i), h);
-//            std:cout << "weight_index ********************* " << endl << weight_index << endl;
+//  % scale linear equation
+    eqn_err = EqnARR * sol_X - EqnB.col(i);
+    eqn_scale0 = stdev(eqn_err);
+    eqn_err = eqn_err.cwiseAbs() / eqn_scale0;
 
-//          % eqn_Y = EqnARR(weight_index,:);   eqn_D = Weight(weight_index,i) - 1;
-            eqn_Y.resize(weight_index.size(), EqnARR.cols());
-            eqn_D.resize(weight_index.size(),1);
-            for(int k=0; k<weight_index.size(); k++)
-            {
-                eqn_Y.row(k) = EqnARR.row(weight_index(k));
-//                std::cout << "eqn_Y: " << eqn_Y.rows() << " x " << eqn_Y.cols() << endl;
-//                std::cout << "eqn_D: "  << eqn_D.rows() << " x " << eqn_D.cols() << endl;
-                eqn_D(k) = Weight(weight_index(k),i) - 1;
-            }
-//              std::cout << "eqn_D: " << endl << eqn_D.transpose() << endl << endl;
-            temp_M = EqnARR.transpose() * (Weight.col(i).array() * EqnB.col(i).array()).matrix();
-//              std::cout << "temp_M: " << endl << temp_M.transpose() << endl << endl;
-
-//            std::cout << "EqnRRInv: " << EqnRRInv.rows() << " x " << EqnRRInv.cols() << endl;
-//            std::cout << "eqn_Y: " << eqn_Y.rows() << " x " << eqn_Y.cols() << endl;
-//              std::cout << "EqnRRInv: " << endl << EqnRRInv.transpose() << endl << endl;
-//              std::cout << "eqn_Y: " << endl << eqn_Y.transpose() << endl << endl;
-
-            temp_N = EqnRRInv * eqn_Y.transpose();
-//              std::cout << "temp_N: " << endl << temp_N.transpose() << endl << endl;
-
-
-//            diagMat = eqn_D.asDiagonal();
-//        std::cout << "diagMat ************************" << endl << diagMat.transpose() << endl;
-//            diagMat = 1 / diagMat.array();
-//        std::cout << "diagMat ************************" << endl << diagMat.transpose() << endl;
-
-            diagMat = (1 / eqn_D.array()).matrix().asDiagonal();
-//            cout << "diagMat ************************" << i+1 << endl << diagMat.rows() << " x" << diagMat.cols() << endl;
-
-            sol_X = EqnRRInv * temp_M - temp_N * (diagMat + eqn_Y * temp_N).inverse() * (temp_N.transpose() * temp_M);
-            eqn_err = (EqnARR * sol_X - EqnB.col(i)).cwiseAbs();
-            eqn_scale = qMin(eqn_scale0, RR_K3 * qSqrt((Weight.col(i).array() * eqn_err.array() * eqn_err.array()).mean()));
-            eqn_err = eqn_err / eqn_scale;
-//             std::cout << "temp_M: " << endl << temp_M.transpose() << endl << endl;
+//  % solve iteratively re-weighted least squares (Bi-Square) -- subspace
+    sol_X_old.setConstant(sol_X.rows(), 1e30);
+    bool first = true;
+    while (((sol_X.array()-sol_X_old.array()).matrix().norm() / sol_X.norm()) > ErrTolRel)
+    {
+        sol_X_old = sol_X;
+//      % Weight(:,i) = (eqn_err <= RR_K1) + (eqn_err > RR_K1 & eqn_err <= RR_K2) .* (1-(eqn_err-RR_K1).^2/(RR_K2-RR_K1)^2).^2;
+//      % the first iteration starts from the weights of the previous block if given
+        if (first && WeightInit)
+            Weight.col(i) = *WeightInit;
+        else
+            Weight.col(i) = eigen_LTE(eqn_err,RR_K1).array() + eigen_AND(eigen_GT(eqn_err,RR_K1),eigen_LTE(eqn_err,RR_K2)).array() * (1 - ((eqn_err.array()-RR_K1).pow(2)) / pow(RR_K2-RR_K1,2) ).pow(2);
+        first = false;
 
-//            std::cout << "(sol_X.array()-sol_X_old.array()).matrix().norm(): " << (sol_X.array()-sol_X_old.array()).matrix().norm() << endl << endl;
-//            std::cout << "sol_X.norm():  " << sol_X.norm()  << endl  << endl;
-//        std::cout << "sol_X ************************" << endl << sol_X.transpose() << endl << endl;
+//      % weight_index = find(Weight(:,i) < WeightThres);
+        weight_index = eigen_LT_index(Weight.col(i), WeightThres);
 
+//      % eqn_Y = EqnARR(weight_index,:);   eqn_D = Weight(weight_index,i) - 1;
+        eqn_Y.resize(weight_index.size(), EqnARR.cols());
+        eqn_D.resize(weight_index.size());
+        for(int k=0; k<weight_index.size(); k++)
+        {
+            eqn_Y.row(k) = EqnARR.row(weight_index(k));
+            eqn_D(k) = Weight(weight_index(k),i) - 1;
         }
-//      % solve weighted SSS - full
-//      % eqn_Y = EqnA(weight_index,:); temp_M = EqnA' * (Weight(:,i).*EqnB(:,i)); temp_N = EqnInv * eqn_Y';
-        eqn_Y.resize(weight_index.size(), NumBIn+NumBOut);
-        for(int k=0; k<weight_index.size(); k++) eqn_Y.row(k) = EqnA.row(weight_index(k));
-        temp_M = EqnA.transpose() * (Weight.col(i).array() * EqnB.col(i).array()).matrix();
-        temp_N = EqnInv * eqn_Y.transpose();
-
-
-//      % sol_X = EqnInv * temp_M - temp_N * ((diag(1./eqn_D) + eqn_Y * temp_N); // \ (temp_N'*temp_M));
-//        diagMat = eqn_D.asDiagonal();
-//        diagMat = 1 / diagMat.array();
-        diagMat = (1 / eqn_D.array()).matrix().asDiagonal();
-        sol_X = EqnInv * temp_M - temp_N * (diagMat + eqn_Y * temp_N).inverse() * (temp_N.transpose() * temp_M);
+        temp_M = EqnARR.transpose() * (Weight.col(i).array() * EqnB.col(i).array()).matrix();
+        temp_N = EqnRRInv * eqn_Y.transpose();
 
-        ErrRel(i) = (EqnA * sol_X - EqnB.col(i)).norm() / EqnB.col(i).norm();
-
-        sol_in = sol_X.block(0,0,NumBIn,1);
-        sol_out = sol_X.block(NumBIn,0,NumBOut,1);  // sol_X(NumBIn+1:NumBIn+NumBOut,1);
-
-//      % recover internal/external MEG siganl
-        SSSIn.col(i) = EqnIn * sol_in;
-        SSSOut.col(i) = EqnOut * sol_out;
+//      % low-rank update of the cached inverse, only the down-weighted coils enter the small system
+        MatrixXd small = eqn_Y * temp_N;
+        small.diagonal() += (1 / eqn_D.array()).matrix();
+        sol_X = EqnRRInv * temp_M - temp_N * small.partialPivLu().solve(temp_N.transpose() * temp_M);
 
+        eqn_err = (EqnARR * sol_X - EqnB.col(i)).cwiseAbs();
+        eqn_scale = qMin(eqn_scale0, RR_K3 * qSqrt((Weight.col(i).array() * eqn_err.array() * eqn_err.array()).mean()));
+        eqn_err = eqn_err / eqn_scale;
     }
-    RRsss.append(SSSIn);
-    RRsss.append(SSSOut);
-    RRsss.append(Weight);
-    RRsss.append(ErrRel);
 
-    //qDebug() << "getSSSRR END";
+//  % solve weighted SSS - full
+//  % eqn_Y = EqnA(weight_index,:); temp_M = EqnA' * (Weight(:,i).*EqnB(:,i)); temp_N = EqnInv * eqn_Y';
+    eqn_Y.resize(weight_index.size(), NumBIn+NumBOut);
+    for(int k=0; k<weight_index.size(); k++) eqn_Y.row(k) = EqnA.row(weight_index(k));
+    temp_M = EqnA.transpose() * (Weight.col(i).array() * EqnB.col(i).array()).matrix();
+    temp_N = EqnInv * eqn_Y.transpose();
 
-//    return RRsss;
-    return SSSIn;
+//  % sol_X = EqnInv * temp_M - temp_N * ((diag(1./eqn_D) + eqn_Y * temp_N) \ (temp_N'*temp_M));
+    MatrixXd small = eqn_Y * temp_N;
+    small.diagonal() += (1 / eqn_D.array()).matrix();
+    sol_X = EqnInv * temp_M - temp_N * small.partialPivLu().solve(temp_N.transpose() * temp_M);
+
+//  % recover internal MEG siganl
+    SSSIn.col(i) = EqnIn * sol_X.head(NumBIn);
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -985,51 +986,35 @@ MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 //QList<MatrixXd> RtSssAlgo::getSSSOLS(MatrixXd EqnIn, MatrixXd EqnOut, MatrixXd EqnA, MatrixXd EqnB)
 //QList<MatrixXd> RtSssAlgo::getSSSOLS(MatrixXd EqnB)
-MatrixXd RtSssAlgo::getSSSOLS(MatrixXd EqnB)
+MatrixXd RtSssAlgo::getSSSOLS(const MatrixXd& EqnB)
 {
-    //qDebug() << "getSSSOLS START";
-
-    int NumBIn, NumBOut, NumCoil, NumExp;
-    MatrixXd EqnRRInv, EqnInv, SSSIn, SSSOut;
-    MatrixXd sol_X, sol_in, sol_out;
-    VectorXd ErrRel;
-    QList<MatrixXd> OLSsss;
+    int NumBIn;
+    MatrixXd SolX;
 
 //  % initialization
     NumBIn = EqnIn.cols();
-    NumBOut = EqnOut.cols();
-    NumCoil = EqnB.rows();
-    NumExp = EqnB.cols();
-
-    EqnRRInv = (EqnA.transpose() * EqnA).inverse();
-    SSSIn.setZero(NumCoil,NumExp);
-    SSSOut.setZero(NumCoil,NumExp);
-    ErrRel.setZero(NumExp);
-
-    for (int i=0; i<NumExp; i++)
-    {
-//      % solve OLS solution
-        sol_X = EqnRRInv * (EqnA.transpose() * EqnB.col(i));
-
-        ErrRel(i) = (EqnA * sol_X - EqnB.col(i)).norm() / EqnB.col(i).norm();
-
-        sol_in = sol_X.block(0,0,NumBIn,1);
 
-        sol_out = sol_X.block(NumBIn,0, NumBOut,1);    // probably NumBIn+0 is correct.  Please debug !!!!
+    if (EqnInv.rows() != EqnA.cols())
+        updateInverse();
 
-//      % recover internal/external MEG siganl
-        SSSIn.col(i) = EqnIn * sol_in;
-        SSSOut.col(i) = EqnOut * sol_out;
-    }
+//  % solve OLS solution of all samples at once
+    SolX = EqnInv * (EqnA.transpose() * EqnB);
 
-    OLSsss.append(SSSIn);
-    OLSsss.append(SSSOut);
-    OLSsss.append(ErrRel);
+//  % recover internal MEG siganl
+    return EqnIn * SolX.topRows(NumBIn);
+}
 
-    //qDebug() << "getSSSOLS END";
+void RtSssAlgo::updateInverse()
+{
+    EqnRRInv = (EqnARR.transpose() * EqnARR).inverse();
+    EqnInv = (EqnA.transpose() * EqnA).inverse();
+    EqnRRPinv = EqnRRInv * EqnARR.transpose();
+}
 
-//    return OLSsss;
-    return SSSIn;
+void RtSssAlgo::setWarmStart(bool warmStart)
+{
+    WarmStart = warmStart;
+    WeightPrev.resize(0);
 }
 
 // Return number of meg channels
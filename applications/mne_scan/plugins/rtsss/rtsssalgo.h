@@ -90,6 +90,22 @@ VectorXd eigen_LT_index_test(int);
 VectorXd eigen_GT(VectorXd V, double tol);
 VectorXd eigen_AND(VectorXd V1, VectorXd V2);
 
+class RtSssAlgo;
+
+// A contiguous range of samples which is solved by one thread
+struct RtSssChunk
+{
+    const RtSssAlgo* pAlgo;
+    const MatrixXd* pEqnB;          // SSS equation (RHS) of the block
+    const MatrixXd* pSolOLS;        // OLS solutions of the block
+    const VectorXd* pWeightInit;    // weights to start the iterations from, NULL to start from the OLS residuals
+    MatrixXd* pSSSIn;               // internal MEG signal
+    MatrixXd* pWeight;              // optimal weights
+    int iFirst, iCount;
+
+    void solve();
+};
+
 class RtSssAlgo
 {
 public:
@@ -101,11 +117,17 @@ public:
 
 //    QList<MatrixXd> getSSSRR(MatrixXd EqnIn, MatrixXd EqnOut, MatrixXd EqnARR, MatrixXd EqnA, MatrixXd EqnB);
 //    QList<MatrixXd> getSSSRR(MatrixXd EqnB);
-    MatrixXd getSSSRR(MatrixXd EqnB);
+    MatrixXd getSSSRR(const MatrixXd& EqnB);
 
 //    QList<MatrixXd> getSSSOLS(MatrixXd EqnIn, MatrixXd EqnOut, MatrixXd EqnA, MatrixXd EqnB);
 //    QList<MatrixXd> getSSSOLS(MatrixXd EqnB);
-    MatrixXd getSSSOLS(MatrixXd EqnB);
+    MatrixXd getSSSOLS(const MatrixXd& EqnB);
+
+    // Start the robust regression of each block from the weights of the previous block. Off by default, since it
+    // changes the result compared to starting each sample from its own OLS residuals.
+    void setWarmStart(bool warmStart);
+
+    void solveRR(int i, const MatrixXd& EqnB, const MatrixXd& SolOLS, const VectorXd* WeightInit, MatrixXd& SSSIn, MatrixXd& Weight) const;
 
     QList<MatrixXd> getLinEqn();
 
@@ -126,6 +148,7 @@ private:
     void getCartesianToSpherCoordinate(VectorXd, VectorXd, VectorXd);
     void getSphereToCartesianVector();
     int strmatch(char, char);
+    void updateInverse();
 
     qint32 NumMEGChan, NumCoil, NumBadCoil;
     VectorXi BadChan;
@@ -140,6 +163,9 @@ private:
     Vector3d Origin;
     MatrixXd BInX, BInY, BInZ, BOutX, BOutY, BOutZ;
     MatrixXd EqnInRR, EqnOutRR, EqnIn, EqnOut, EqnARR, EqnA, EqnB;
+    MatrixXd EqnRRInv, EqnInv, EqnRRPinv;   // (EqnARR'EqnARR)^-1, (EqnA'EqnA)^-1 and the OLS operator of EqnARR
+    VectorXd WeightPrev;                     // weights of the last sample of the previous block
+    bool WarmStart;
 
     VectorXd R, PHI, THETA;
     VectorXd R_X, R_Y, R_Z;
@@ -52,6 +52,7 @@
 #include "metrics/weightedphaselagindex.h"
 #include "metrics/unbiasedsquaredphaselagindex.h"
 #include "metrics/debiasedsquaredweightedphaselagindex.h"
+#include "metrics/spectralmetrics.h"
 
 
 //*************************************************************************************************************
@@ -144,3 +145,45 @@ Network Connectivity::calculateConnectivity() const
 
     return Network();
 }
+
+
+//*************************************************************************************************************
+
+QList<Network> Connectivity::calculateConnectivityList() const
+{
+    QList<Network> lNetworks;
+    const QStringList& lMethods = m_pConnectivitySettings->m_sConnectivityMethods;
+
+    //Compute all spectral methods in one pass
+    QStringList lSpectralMethods;
+    for(int i = 0; i < lMethods.size(); ++i) {
+        if(SpectralMetrics::supportedMetrics().contains(lMethods.at(i)) && !lSpectralMethods.contains(lMethods.at(i))) {
+            lSpectralMethods << lMethods.at(i);
+        }
+    }
+
+    QList<Network> lSpectralNetworks;
+    if(!lSpectralMethods.isEmpty()) {
+        lSpectralNetworks = SpectralMetrics::spectralMetrics(m_pConnectivitySettings->m_matDataList,
+                                                             m_pConnectivitySettings->m_matNodePositions,
+                                                             lSpectralMethods,
+                                                             m_pConnectivitySettings->m_iNfft,
+                                                             m_pConnectivitySettings->m_sWindowType);
+    }
+
+    for(int i = 0; i < lMethods.size(); ++i) {
+        int iSpectral = lSpectralMethods.indexOf(lMethods.at(i));
+
+        if(iSpectral >= 0 && iSpectral < lSpectralNetworks.size()) {
+            lNetworks.append(lSpectralNetworks.at(iSpectral));
+        } else if(lMethods.at(i) == "COR" || lMethods.at(i) == "XCOR") {
+            ConnectivitySettings settings(*m_pConnectivitySettings);
+            settings.m_sConnectivityMethods = QStringList() << lMethods.at(i);
+            lNetworks.append(Connectivity(settings).calculateConnectivity());
+        } else {
+            qDebug() << "Connectivity::calculateConnectivityList - Connectivity method unknown:" << lMethods.at(i);
+        }
+    }
+
+    return lNetworks;
+}
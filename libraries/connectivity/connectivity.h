@@ -51,6 +51,7 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QList>
 
 
 //*************************************************************************************************************
@@ -111,6 +112,16 @@ public:
     */
     Network calculateConnectivity() const;
 
+    //=========================================================================================================
+    /**
+    * Computes one network for each method in the settings. The spectral methods (COH, IMAGCOH, PLV, PLI,
+    * USPLI, WPLI, DSWPLI) share the tapered spectra and cross spectral densities, so requesting several of
+    * them costs a single spectral pass over the epochs.
+    *
+    * @return Returns the networks in the order of the methods in the settings. Unknown methods are skipped.
+    */
+    QList<Network> calculateConnectivityList() const;
+
 protected:
     QSharedPointer<ConnectivitySettings>    m_pConnectivitySettings;           /**< The current connectivity settings. */
 };
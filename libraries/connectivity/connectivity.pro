@@ -79,6 +79,7 @@ SOURCES += \
     metrics/weightedphaselagindex.cpp \
     metrics/debiasedsquaredweightedphaselagindex.cpp \
     metrics/phaselagindex.cpp \
+    metrics/spectralmetrics.cpp \
     network/network.cpp \
     network/networknode.cpp \
     network/networkedge.cpp \
@@ -98,6 +99,7 @@ HEADERS += \
     metrics/weightedphaselagindex.h \
     metrics/debiasedsquaredweightedphaselagindex.h \
     metrics/phaselagindex.h \
+    metrics/spectralmetrics.h \
     network/network.h \
     network/networknode.h \
     network/networkedge.h \
@@ -101,7 +101,7 @@ public:
     */
     explicit ConnectivitySettings();
 
-    QStringList                 m_sConnectivityMethods;         /**< The connectivity methods. */
+    QStringList                 m_sConnectivityMethods;         /**< The connectivity methods. Several methods are computed by Connectivity::calculateConnectivityList. */
 
     QList<Eigen::MatrixXd>      m_matDataList;                  /**< The input data. */
     Eigen::MatrixX3f            m_matNodePositions;             /**< The node position in 3D space. */
@@ -41,8 +41,8 @@
 // INCLUDES
 //=============================================================================================================
 
-#include "coherency.h"
 #include "coherence.h"
+#include "spectralmetrics.h"
 #include "network/networknode.h"
 #include "network/networkedge.h"
 #include "network/network.h"
@@ -54,7 +54,6 @@
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -62,8 +61,6 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
-#include <unsupported/Eigen/FFT>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -122,16 +119,7 @@ Network Coherence::coherence(const QList<MatrixXd> &matDataList,
     QVector<MatrixXd> vecCoh = Coherence::computeCoherence(matDataList, iNfft, sWindowType);
 
     //Add edges to network
-    for(int i = 0; i < vecCoh.length(); ++i) {
-        for(int j = i; j < matDataList.at(0).rows(); ++j) {
-            MatrixXd matWeight = vecCoh.at(i).row(j).transpose();
-            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
-        }
-    }
+    finalNetwork.setDenseWeights(vecCoh);
 
     return finalNetwork;
 }
@@ -143,10 +131,8 @@ QVector<MatrixXd> Coherence::computeCoherence(const QList<MatrixXd> &matDataList
                                               int iNfft,
                                               const QString &sWindowType)
 {
-    QVector<MatrixXcd> vecCoherency = Coherency::computeCoherency(matDataList, iNfft, sWindowType);
-    QVector<MatrixXd> vecCoherence;
-    for(int i = 0; i < vecCoherency.length(); ++i) {
-        vecCoherence.append(vecCoherency.at(i).cwiseAbs());
-    }
-    return vecCoherence;
+    return SpectralMetrics::computeSpectralMetrics(matDataList,
+                                                   QStringList() << "COH",
+                                                   iNfft,
+                                                   sWindowType)["COH"];
 }
@@ -178,28 +178,27 @@ AbstractMetricResultData Coherency::compute(const AbstractMetricInputData& input
                                                                                     inputData.iNfft,
                                                                                     false);
 
-    // This part could be parallelized with QtConcurrent::mappedReduced
+    // The CSD of all channel pairs is computed frequency by frequency from the stacked spectra, see
+    // SpectralMetrics. The PSD is its diagonal, the lower triangle is the conjugate of the upper one.
+    MatrixXcd matStacked = Spectral::stackTaperedSpectra(vecTapSpectra, inputData.tapers.second);
+    int iNTapers = inputData.tapers.second.rows();
+    MatrixXcd matCsd;
+
     for (int j = 0; j < inputData.iNRows; ++j) {
-        RowVectorXd vecTmpPsd = Spectral::psdFromTaperedSpectra(vecTapSpectra.at(j),
-                                                                inputData.tapers.second,
-                                                                inputData.iNfft,
-                                                                1.0);
-        matPsdAvg.row(j) = vecTmpPsd;
+        vecCsdAvg.append(MatrixXcd(inputData.iNRows, inputData.iNFreqs));
     }
 
-    // This part could be parallelized with QtConcurrent::mappedReduced
-    for (int j = 0; j < inputData.iNRows; ++j) {
-        MatrixXcd matCsd = MatrixXcd(inputData.iNRows, inputData.iNFreqs);
-        for (int k = 0; k < inputData.iNRows; ++k) {
-            matCsd.row(k) = Spectral::csdFromTaperedSpectra(vecTapSpectra.at(j),
-                                                            vecTapSpectra.at(k),
-                                                            inputData.tapers.second,
-                                                            inputData.tapers.second,
-                                                            inputData.iNfft,
-                                                            1.0);
-        }
+    for (int f = 0; f < inputData.iNFreqs; ++f) {
+        Spectral::csdFromStackedSpectra(matStacked, iNTapers, f, inputData.iNfft, matCsd, 1.0);
+
+        matPsdAvg.col(f) = matCsd.diagonal().real();
 
-        vecCsdAvg.append(matCsd);
+        for (int j = 0; j < inputData.iNRows; ++j) {
+            for (int k = j; k < inputData.iNRows; ++k) {
+                vecCsdAvg[j](k, f) = matCsd(j, k);
+                vecCsdAvg[k](j, f) = std::conj(matCsd(j, k));
+            }
+        }
     }
 
     AbstractMetricResultData resultData;
@@ -149,18 +149,7 @@ Network CrossCorrelation::crossCorrelation(const QList<MatrixXd> &matDataList,
     matDist /= matDataList.size();
 
     //Add edges to network
-    for(int i = 0; i < matDist.rows(); ++i) {
-        for(int j = i; j < matDist.cols(); ++j) {
-            MatrixXd matWeight(1,1);
-            matWeight << matDist(i,j);
-
-            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
-        }
-    }
+    finalNetwork.setDenseWeights(matDist);
 
     return finalNetwork;
 }
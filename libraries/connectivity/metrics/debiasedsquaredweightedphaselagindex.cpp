@@ -43,12 +43,11 @@
 //=============================================================================================================
 
 #include "debiasedsquaredweightedphaselagindex.h"
+#include "spectralmetrics.h"
 #include "network/networknode.h"
 #include "network/networkedge.h"
 #include "network/network.h"
 
-#include <utils/spectral.h>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -56,7 +55,6 @@
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -64,8 +62,6 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
-#include <unsupported/Eigen/FFT>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -74,7 +70,6 @@
 
 using namespace CONNECTIVITYLIB;
 using namespace Eigen;
-using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -127,17 +122,7 @@ Network DebiasedSquaredWeightedPhaseLagIndex::debiasedSquaredWeightedPhaseLagInd
                                                                                                                 sWindowType);
 
     //Add edges to network
-    for(int i = 0; i < vecDebiasedSquaredWPLI.length(); ++i) {
-        for(int j = j; j < matDataList.at(0).rows(); ++j) {
-            MatrixXd matWeight = vecDebiasedSquaredWPLI.at(i).row(j).transpose();
-
-            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
-        }
-    }
+    finalNetwork.setDenseWeights(vecDebiasedSquaredWPLI);
 
     return finalNetwork;
 }
@@ -149,62 +134,8 @@ QVector<MatrixXd> DebiasedSquaredWeightedPhaseLagIndex::computeDebiasedSquaredWP
                                                                                    int iNfft,
                                                                                    const QString &sWindowType)
 {
-    // Check that iNfft >= signal length
-    int iSignalLength = matDataList.at(0).cols();
-    if (iNfft < iSignalLength) {
-        iNfft = iSignalLength;
-    }
-
-    // Generate tapers
-    QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, sWindowType);
-
-    // Initialize vecPsdAvg and vecCsdAvg
-    int iNRows = matDataList.at(0).rows();
-    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
-    QVector<MatrixXd> vecCsdAvg;
-    QVector<MatrixXd> vecSquaredCsdAvg;
-    QVector<MatrixXd> vecCsdAbsAvg;
-    for (int j = 0; j < iNRows; ++j) {
-        vecCsdAvg.append(MatrixXd::Zero(iNRows, iNFreqs));
-        vecSquaredCsdAvg.append(MatrixXd::Zero(iNRows, iNFreqs));
-        vecCsdAbsAvg.append(MatrixXd::Zero(iNRows, iNFreqs));
-    }
-
-    // Generate tapered spectra and CSD and sum over epoch
-    // This part could be parallelized with QtConcurrent::mappedReduced
-    for (int i = 0; i < matDataList.length(); ++i) {
-        //Remove mean
-        MatrixXd matInputData = matDataList.at(i);
-        for (int i = 0; i < matInputData.rows(); ++i) {
-            matInputData.row(i).array() -= matInputData.row(i).mean();
-        }
-
-        // This part could be parallelized with QtConcurrent::mapped
-        QVector<MatrixXcd> vecTapSpectra = Spectral::computeTaperedSpectraMatrix(matInputData, tapers.first, iNfft);
-
-        // This part could be parallelized with QtConcurrent::mappedReduced
-        for (int j = 0; j < iNRows; ++j) {
-            MatrixXcd matCsd = MatrixXcd(iNRows, iNFreqs);
-            for (int k = 0; k < iNRows; ++k) {
-                matCsd.row(k) = Spectral::csdFromTaperedSpectra(vecTapSpectra.at(j), vecTapSpectra.at(k),
-                                                                tapers.second, tapers.second, iNfft, 1.0);
-            }
-            MatrixXd matCsdImag = matCsd.imag();
-            vecCsdAvg.replace(j, vecCsdAvg.at(j) + matCsdImag);
-            MatrixXd matCsdImag2 = matCsdImag.array().square();
-            vecSquaredCsdAvg.replace(j, vecSquaredCsdAvg.at(j) + matCsdImag2);
-            vecCsdAbsAvg.replace(j, vecCsdAbsAvg.at(j) + matCsdImag.cwiseAbs());
-        }
-    }
-
-    QVector<MatrixXd> vecDebiasedSquaredWPLI;
-    for (int j = 0; j < iNRows; ++j) {
-        MatrixXd matNom = vecCsdAvg.at(j).array().square();
-        matNom -= vecSquaredCsdAvg.at(j);
-        MatrixXd matDenom = vecCsdAbsAvg.at(j).array().square();
-        matDenom -= vecSquaredCsdAvg.at(j);
-        matDenom = (matDenom.array() == 0.).select(INFINITY, matDenom);
-        vecDebiasedSquaredWPLI.append(matNom.cwiseQuotient(matDenom));
-    }
-    return vecDebiasedSquaredWPLI;
+    return SpectralMetrics::computeSpectralMetrics(matDataList,
+                                                   QStringList() << "DSWPLI",
+                                                   iNfft,
+                                                   sWindowType)["DSWPLI"];
 }
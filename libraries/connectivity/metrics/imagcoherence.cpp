@@ -41,8 +41,8 @@
 // INCLUDES
 //=============================================================================================================
 
-#include "coherency.h"
 #include "imagcoherence.h"
+#include "spectralmetrics.h"
 #include "network/networknode.h"
 #include "network/networkedge.h"
 #include "network/network.h"
@@ -54,7 +54,6 @@
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -62,8 +61,6 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
-#include <unsupported/Eigen/FFT>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -122,17 +119,7 @@ Network ImagCoherence::imagCoherence(const QList<MatrixXd> &matDataList,
     QVector<MatrixXd> vecCoh = ImagCoherence::computeImagCoherence(matDataList, iNfft, sWindowType);
 
     //Add edges to network
-    for(int i = 0; i < vecCoh.length(); ++i) {
-        for(int j = i; j < matDataList.at(0).rows(); ++j) {
-            MatrixXd matWeight = vecCoh.at(i).row(j).transpose();
-
-            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
-        }
-    }
+    finalNetwork.setDenseWeights(vecCoh);
 
     return finalNetwork;
 }
@@ -144,10 +131,8 @@ QVector<MatrixXd> ImagCoherence::computeImagCoherence(const QList<MatrixXd> &mat
                                                       int iNfft,
                                                       const QString &sWindowType)
 {
-    QVector<MatrixXcd> vecCoherency = Coherency::computeCoherency(matDataList, iNfft, sWindowType);
-    QVector<MatrixXd> vecImagCoherence;
-    for(int i = 0; i < vecCoherency.length(); ++i) {
-        vecImagCoherence.append(vecCoherency.at(i).imag());
-    }
-    return vecImagCoherence;
+    return SpectralMetrics::computeSpectralMetrics(matDataList,
+                                                   QStringList() << "IMAGCOH",
+                                                   iNfft,
+                                                   sWindowType)["IMAGCOH"];
 }
@@ -0,0 +1,427 @@
+//=============================================================================================================
+/**
+* @file     spectralmetrics.cpp
+* @author   Daniel Strohmeier <daniel.strohmeier@tu-ilmenau.de>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Daniel Strohmeier and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    SpectralMetrics class definition.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "spectralmetrics.h"
+#include "network/networknode.h"
+#include "network/networkedge.h"
+#include "network/network.h"
+
+#include <utils/spectral.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace CONNECTIVITYLIB;
+using namespace Eigen;
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+//Converts packed upper triangle values (pairs x frequencies) to one rows x frequencies matrix per row. The
+//lower triangle is mirrored with the given sign.
+static QVector<MatrixXd> toNodeMajor(const MatrixXd& matPacked, int iNRows, double dLowerSign)
+{
+    QVector<MatrixXd> vecNodeMajor;
+
+    for (int j = 0; j < iNRows; ++j) {
+        vecNodeMajor.append(MatrixXd(iNRows, matPacked.cols()));
+    }
+
+    for (int k = 0; k < iNRows; ++k) {
+        Index iOffset = Index(k) * (k + 1) / 2;
+        for (int j = 0; j <= k; ++j) {
+            vecNodeMajor[j].row(k) = matPacked.row(iOffset + j);
+            vecNodeMajor[k].row(j) = dLowerSign * matPacked.row(iOffset + j);
+        }
+    }
+
+    return vecNodeMajor;
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+static void sumWorkers(T& matFinal, const T& matResult)
+{
+    if(matFinal.size() == 0) {
+        matFinal = matResult;
+    } else if(matResult.size() > 0) {
+        matFinal += matResult;
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+SpectralMetrics::SpectralMetrics()
+{
+}
+
+
+//*************************************************************************************************************
+
+QStringList SpectralMetrics::supportedMetrics()
+{
+    return QStringList() << "COH" << "IMAGCOH" << "PLV" << "PLI" << "USPLI" << "WPLI" << "DSWPLI";
+}
+
+
+//*******************************************************************************************************
+
+QList<Network> SpectralMetrics::spectralMetrics(const QList<MatrixXd> &matDataList,
+                                                const MatrixX3f& matVert,
+                                                const QStringList& lMetrics,
+                                                int iNfft,
+                                                const QString &sWindowType)
+{
+    QList<Network> lNetworks;
+
+    if(matDataList.empty()) {
+        qDebug() << "SpectralMetrics::spectralMetrics - Input data is empty";
+        return lNetworks;
+    }
+
+    QMap<QString, QVector<MatrixXd> > mapMetrics = computeSpectralMetrics(matDataList, lMetrics, iNfft, sWindowType);
+
+    //Use the same network names as the single metric classes
+    QMap<QString, QString> mapNames;
+    mapNames["COH"] = "Coherence";
+    mapNames["IMAGCOH"] = "ImagCoherence";
+    mapNames["PLV"] = "Phase Locking Value";
+    mapNames["PLI"] = "Phase Lag Index";
+    mapNames["USPLI"] = "Unbiased Squared Phase Lag Index";
+    mapNames["WPLI"] = "Weighted Phase Lag Index";
+    mapNames["DSWPLI"] = "Debiased Squared Weighted Phase Lag Index";
+
+    for(int i = 0; i < lMetrics.size(); ++i) {
+        if(mapMetrics.contains(lMetrics.at(i))) {
+            lNetworks.append(createNetwork(mapNames[lMetrics.at(i)],
+                                           mapMetrics[lMetrics.at(i)],
+                                           matVert,
+                                           matDataList.first().rows()));
+        }
+    }
+
+    return lNetworks;
+}
+
+
+//*************************************************************************************************************
+
+QMap<QString, QVector<MatrixXd> > SpectralMetrics::computeSpectralMetrics(const QList<MatrixXd> &matDataList,
+                                                                         const QStringList& lMetrics,
+                                                                         int iNfft,
+                                                                         const QString &sWindowType)
+{
+    QMap<QString, QVector<MatrixXd> > mapMetrics;
+
+    if(matDataList.empty()) {
+        return mapMetrics;
+    }
+
+    bool bCoh = lMetrics.contains("COH") || lMetrics.contains("IMAGCOH");
+    bool bPLV = lMetrics.contains("PLV");
+    bool bPLI = lMetrics.contains("PLI") || lMetrics.contains("USPLI");
+    bool bWPLI = lMetrics.contains("WPLI") || lMetrics.contains("DSWPLI");
+    bool bDSWPLI = lMetrics.contains("DSWPLI");
+
+    if(!bCoh && !bPLV && !bPLI && !bWPLI) {
+        qDebug() << "SpectralMetrics::computeSpectralMetrics - No spectral metric requested";
+        return mapMetrics;
+    }
+
+    // Check that iNfft >= signal length
+    int iSignalLength = matDataList.at(0).cols();
+    if (iNfft < iSignalLength) {
+        iNfft = iSignalLength;
+    }
+
+    // Generate tapers
+    QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, sWindowType);
+
+    int iNRows = matDataList.at(0).rows();
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+    int iNTrials = matDataList.length();
+
+    // Each worker sums a contiguous range of epochs into its own buffers. The number of workers only depends
+    // on the thread pool, so the sums do not depend on the thread scheduling.
+    int iNWorkers = qMax(1, qMin(iNTrials, QThreadPool::globalInstance()->maxThreadCount()));
+
+    QList<SpectralMetricsWorkerData> lWorkers;
+    SpectralMetricsWorkerData workerTemp;
+    workerTemp.input.data.iNRows = iNRows;
+    workerTemp.input.data.iNFreqs = iNFreqs;
+    workerTemp.input.data.iNfft = iNfft;
+    workerTemp.input.data.tapers = tapers;
+    workerTemp.input.pDataList = &matDataList;
+    workerTemp.input.bPsd = bCoh;
+    workerTemp.input.bCsd = bCoh;
+    workerTemp.input.bCsdNorm = bPLV;
+    workerTemp.input.bImagSign = bPLI;
+    workerTemp.input.bImag = bWPLI;
+    workerTemp.input.bImagSquared = bDSWPLI;
+
+    for (int i = 0; i < iNWorkers; ++i) {
+        workerTemp.input.iFirstEpoch = (iNTrials * i) / iNWorkers;
+        workerTemp.input.iNEpochs = (iNTrials * (i + 1)) / iNWorkers - workerTemp.input.iFirstEpoch;
+
+        lWorkers.append(workerTemp);
+    }
+
+    QtConcurrent::blockingMap(lWorkers, compute);
+
+    // Sum the workers in place, each worker's buffers are released once they were added
+    SpectralMetricsResultData finalResult;
+
+    for (int i = 0; i < lWorkers.size(); ++i) {
+        reduce(finalResult, lWorkers.at(i).result);
+        lWorkers[i].result = SpectralMetricsResultData();
+    }
+
+    // Derive the metrics from the packed sums
+    MatrixXd matCoh, matImagCoh;
+
+    if(bCoh) {
+        matCoh.resize(finalResult.matCsdSum.rows(), iNFreqs);
+        matImagCoh.resize(finalResult.matCsdSum.rows(), iNFreqs);
+
+        for (int f = 0; f < iNFreqs; ++f) {
+            VectorXd vecPsd = finalResult.matPsdSum.col(f).cwiseSqrt();
+            for (int k = 0; k < iNRows; ++k) {
+                Index iOffset = Index(k) * (k + 1) / 2;
+                VectorXcd vecCoherency = finalResult.matCsdSum.col(f).segment(iOffset, k + 1).cwiseQuotient((vecPsd.head(k + 1) * vecPsd[k]).cast<std::complex<double> >());
+                matCoh.col(f).segment(iOffset, k + 1) = vecCoherency.cwiseAbs();
+                matImagCoh.col(f).segment(iOffset, k + 1) = vecCoherency.imag();
+            }
+        }
+    }
+
+    // The imaginary part of the coherency is antisymmetric, all other metrics are symmetric
+    if(lMetrics.contains("COH")) {
+        mapMetrics["COH"] = toNodeMajor(matCoh, iNRows, 1.0);
+    }
+    if(lMetrics.contains("IMAGCOH")) {
+        mapMetrics["IMAGCOH"] = toNodeMajor(matImagCoh, iNRows, -1.0);
+    }
+    if(lMetrics.contains("PLV")) {
+        mapMetrics["PLV"] = toNodeMajor(finalResult.matCsdNormSum.cwiseAbs() / iNTrials, iNRows, 1.0);
+    }
+    if(bPLI) {
+        MatrixXd matPLI = finalResult.matImagSignSum.cwiseAbs() / iNTrials;
+
+        if(lMetrics.contains("PLI")) {
+            mapMetrics["PLI"] = toNodeMajor(matPLI, iNRows, 1.0);
+        }
+        if(lMetrics.contains("USPLI")) {
+            // Unbiased estimator according to Vinck et al., NeuroImage 55, pp. 1548-65, 2011
+            MatrixXd matUSPLI = (double(iNTrials) * matPLI.array().square() - 1.0) / double(iNTrials - 1);
+            mapMetrics["USPLI"] = toNodeMajor(matUSPLI, iNRows, 1.0);
+        }
+    }
+    if(lMetrics.contains("WPLI")) {
+        MatrixXd matDenom = (finalResult.matImagAbsSum.array() == 0.).select(INFINITY, finalResult.matImagAbsSum);
+        mapMetrics["WPLI"] = toNodeMajor(finalResult.matImagSum.cwiseAbs().cwiseQuotient(matDenom), iNRows, 1.0);
+    }
+    if(bDSWPLI) {
+        MatrixXd matNom = finalResult.matImagSum.array().square() - finalResult.matImagSquaredSum.array();
+        MatrixXd matDenom = finalResult.matImagAbsSum.array().square() - finalResult.matImagSquaredSum.array();
+        matDenom = (matDenom.array() == 0.).select(INFINITY, matDenom);
+        mapMetrics["DSWPLI"] = toNodeMajor(matNom.cwiseQuotient(matDenom), iNRows, 1.0);
+    }
+
+    return mapMetrics;
+}
+
+
+//*************************************************************************************************************
+
+void SpectralMetrics::compute(SpectralMetricsWorkerData& workerData)
+{
+    const SpectralMetricsInputData& inputData = workerData.input;
+    const AbstractMetricInputData& input = inputData.data;
+    SpectralMetricsResultData& resultData = workerData.result;
+
+    // The buffers of the worker are allocated once and accumulate all of its epochs
+    Index iNPairs = Index(input.iNRows) * (input.iNRows + 1) / 2;
+
+    if(inputData.bPsd) {
+        resultData.matPsdSum = MatrixXd::Zero(input.iNRows, input.iNFreqs);
+    }
+    if(inputData.bCsd) {
+        resultData.matCsdSum = MatrixXcd::Zero(iNPairs, input.iNFreqs);
+    }
+    if(inputData.bCsdNorm) {
+        resultData.matCsdNormSum = MatrixXcd::Zero(iNPairs, input.iNFreqs);
+    }
+    if(inputData.bImagSign) {
+        resultData.matImagSignSum = MatrixXd::Zero(iNPairs, input.iNFreqs);
+    }
+    if(inputData.bImag) {
+        resultData.matImagSum = MatrixXd::Zero(iNPairs, input.iNFreqs);
+        resultData.matImagAbsSum = MatrixXd::Zero(iNPairs, input.iNFreqs);
+    }
+    if(inputData.bImagSquared) {
+        resultData.matImagSquaredSum = MatrixXd::Zero(iNPairs, input.iNFreqs);
+    }
+
+    int iNTapers = input.tapers.second.rows();
+    MatrixXd data;
+    MatrixXcd matCsd;
+
+    for (int e = inputData.iFirstEpoch; e < inputData.iFirstEpoch + inputData.iNEpochs; ++e) {
+        data = inputData.pDataList->at(e);
+
+        //Remove mean
+        for (int i = 0; i < data.rows(); ++i) {
+            data.row(i).array() -= data.row(i).mean();
+        }
+
+        // Compute tapered spectra. Note: Multithread option to false as default because nested multithreading is not permitted in qt.
+        QVector<Eigen::MatrixXcd> vecTapSpectra = Spectral::computeTaperedSpectraMatrix(data,
+                                                                                        input.tapers.first,
+                                                                                        input.iNfft,
+                                                                                        false);
+
+        // The CSD of each frequency is computed once for the upper triangle of channel pairs and shared by all
+        // requested metrics, only its upper triangle columns are summed
+        MatrixXcd matStacked = Spectral::stackTaperedSpectra(vecTapSpectra, input.tapers.second);
+        vecTapSpectra.clear();
+
+        for (int f = 0; f < input.iNFreqs; ++f) {
+            Spectral::csdFromStackedSpectra(matStacked, iNTapers, f, input.iNfft, matCsd, 1.0);
+
+            if(inputData.bPsd) {
+                resultData.matPsdSum.col(f) += matCsd.diagonal().real();
+            }
+
+            for (int k = 0; k < input.iNRows; ++k) {
+                Index iOffset = Index(k) * (k + 1) / 2;
+                Ref<const VectorXcd> vecCsd = matCsd.col(k).head(k + 1);
+
+                if(inputData.bCsd) {
+                    resultData.matCsdSum.col(f).segment(iOffset, k + 1) += vecCsd;
+                }
+                if(inputData.bCsdNorm) {
+                    resultData.matCsdNormSum.col(f).segment(iOffset, k + 1) += vecCsd.cwiseQuotient(vecCsd.cwiseAbs().cast<std::complex<double> >());
+                }
+                if(inputData.bImagSign) {
+                    resultData.matImagSignSum.col(f).segment(iOffset, k + 1) += vecCsd.imag().cwiseSign();
+                }
+                if(inputData.bImag) {
+                    resultData.matImagSum.col(f).segment(iOffset, k + 1) += vecCsd.imag();
+                    resultData.matImagAbsSum.col(f).segment(iOffset, k + 1) += vecCsd.imag().cwiseAbs();
+                }
+                if(inputData.bImagSquared) {
+                    resultData.matImagSquaredSum.col(f).segment(iOffset, k + 1) += vecCsd.imag().cwiseAbs2();
+                }
+            }
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void SpectralMetrics::reduce(SpectralMetricsResultData& finalData,
+                             const SpectralMetricsResultData& resultData)
+{
+    sumWorkers(finalData.matPsdSum, resultData.matPsdSum);
+    sumWorkers(finalData.matCsdSum, resultData.matCsdSum);
+    sumWorkers(finalData.matCsdNormSum, resultData.matCsdNormSum);
+    sumWorkers(finalData.matImagSignSum, resultData.matImagSignSum);
+    sumWorkers(finalData.matImagSum, resultData.matImagSum);
+    sumWorkers(finalData.matImagAbsSum, resultData.matImagAbsSum);
+    sumWorkers(finalData.matImagSquaredSum, resultData.matImagSquaredSum);
+}
+
+
+//*************************************************************************************************************
+
+Network SpectralMetrics::createNetwork(const QString& sName,
+                                       const QVector<MatrixXd>& vecValues,
+                                       const MatrixX3f& matVert,
+                                       int iNRows)
+{
+    Network finalNetwork(sName);
+
+    //Create nodes
+    RowVectorXf rowVert = RowVectorXf::Zero(3);
+
+    for(int i = 0; i < iNRows; ++i) {
+        if(matVert.rows() != 0 && i < matVert.rows()) {
+            rowVert(0) = matVert.row(i)(0);
+            rowVert(1) = matVert.row(i)(1);
+            rowVert(2) = matVert.row(i)(2);
+        }
+
+        finalNetwork.append(NetworkNode::SPtr(new NetworkNode(i, rowVert)));
+    }
+
+    //Add edges to network
+    finalNetwork.setDenseWeights(vecValues);
+
+    return finalNetwork;
+}
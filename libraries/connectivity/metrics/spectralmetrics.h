@@ -0,0 +1,238 @@
+//=============================================================================================================
+/**
+* @file     spectralmetrics.h
+* @author   Daniel Strohmeier <daniel.strohmeier@tu-ilmenau.de>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Daniel Strohmeier and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    SpectralMetrics class declaration.
+*
+*/
+
+#ifndef SPECTRALMETRICS_H
+#define SPECTRALMETRICS_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../connectivity_global.h"
+
+#include "abstractmetric.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QStringList>
+#include <QMap>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE CONNECTIVITYLIB
+//=============================================================================================================
+
+namespace CONNECTIVITYLIB {
+
+struct SpectralMetricsInputData {
+    AbstractMetricInputData data;
+    const QList<Eigen::MatrixXd>* pDataList;    /**< The epochs, shared by all workers. */
+    int iFirstEpoch;            /**< The first epoch of this worker. */
+    int iNEpochs;               /**< The number of epochs of this worker. */
+    bool bPsd;                  /**< Whether to accumulate the PSD (COH, IMAGCOH). */
+    bool bCsd;                  /**< Whether to accumulate the CSD (COH, IMAGCOH). */
+    bool bCsdNorm;              /**< Whether to accumulate the phase of the CSD (PLV). */
+    bool bImagSign;             /**< Whether to accumulate the sign of the imaginary CSD (PLI, USPLI). */
+    bool bImag;                 /**< Whether to accumulate the imaginary CSD and its magnitude (WPLI, DSWPLI). */
+    bool bImagSquared;          /**< Whether to accumulate the squared imaginary CSD (DSWPLI). */
+};
+
+//The pair quantities are stored as packed upper triangles (pairs x frequencies), see SpectralMetrics
+struct SpectralMetricsResultData {
+    Eigen::MatrixXd matPsdSum;              /**< The PSD (rows x frequencies). */
+    Eigen::MatrixXcd matCsdSum;             /**< The CSD. */
+    Eigen::MatrixXcd matCsdNormSum;         /**< The phase of the CSD. */
+    Eigen::MatrixXd matImagSignSum;         /**< The sign of the imaginary CSD. */
+    Eigen::MatrixXd matImagSum;             /**< The imaginary CSD. */
+    Eigen::MatrixXd matImagAbsSum;          /**< The magnitude of the imaginary CSD. */
+    Eigen::MatrixXd matImagSquaredSum;      /**< The squared imaginary CSD. */
+};
+
+struct SpectralMetricsWorkerData {
+    SpectralMetricsInputData input;
+    SpectralMetricsResultData result;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// CONNECTIVITYLIB FORWARD DECLARATIONS
+//=============================================================================================================
+
+class Network;
+
+
+//=============================================================================================================
+/**
+* This class computes several spectral connectivity metrics in one pass. The tapered spectra of each epoch
+* and the cross spectral density of each channel pair are computed once, only the quantities needed by the
+* requested metrics are accumulated over the epochs. The metrics are derived from these sums and are the
+* same as the ones of the single metric classes (Coherence, ImagCoherence, PhaseLockingValue, PhaseLagIndex,
+* UnbiasedSquaredPhaseLagIndex, WeightedPhaseLagIndex and DebiasedSquaredWeightedPhaseLagIndex), which use
+* this class.
+*
+* The CSD is computed on the upper triangle of the frequency-major spectra. All pair quantities are kept as
+* packed upper triangles with one row per channel pair (j <= k, row k*(k+1)/2 + j) and one column per
+* frequency. The epochs are split into one contiguous range per thread, each thread accumulates into its own
+* buffers, which are summed in a fixed order. The square connectivity matrices are only formed for the
+* derived metrics.
+*
+* @brief This class computes several spectral connectivity metrics from shared tapered spectra.
+*/
+class CONNECTIVITYSHARED_EXPORT SpectralMetrics : public AbstractMetric
+{    
+
+public:
+    typedef QSharedPointer<SpectralMetrics> SPtr;            /**< Shared pointer type for SpectralMetrics. */
+    typedef QSharedPointer<const SpectralMetrics> ConstSPtr; /**< Const shared pointer type for SpectralMetrics. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a SpectralMetrics object.
+    */
+    explicit SpectralMetrics();
+
+    //=========================================================================================================
+    /**
+    * Returns the metrics which can be computed by this class.
+    *
+    * @return                   The names of the metrics (COH, IMAGCOH, PLV, PLI, USPLI, WPLI, DSWPLI).
+    */
+    static QStringList supportedMetrics();
+
+    //=========================================================================================================
+    /**
+    * Calculates the requested metrics between the rows of the data matrix.
+    *
+    * @param[in] matDataList    The input data.
+    * @param[in] matVert        The vertices of each network node.
+    * @param[in] lMetrics       The metrics to compute. Unsupported metrics are skipped.
+    * @param[in] iNfft          The FFT length.
+    * @param[in] sWindowType    The type of the window function used to compute tapered spectra.
+    *
+    * @return                   The connectivity information in form of one network per computed metric, in
+    *                           the order of lMetrics.
+    */
+    static QList<Network> spectralMetrics(const QList<Eigen::MatrixXd> &matDataList,
+                                          const Eigen::MatrixX3f& matVert,
+                                          const QStringList& lMetrics,
+                                          int iNfft=-1,
+                                          const QString &sWindowType="hanning");
+
+    //==========================================================================================================
+    /**
+    * Calculates the requested metrics between the rows of the data matrix.
+    *
+    * @param[in] matDataList    The input data.
+    * @param[in] lMetrics       The metrics to compute. Unsupported metrics are skipped.
+    * @param[in] iNfft          The FFT length.
+    * @param[in] sWindowType    The type of the window function used to compute tapered spectra.
+    *
+    * @return                   The connectivity values of each computed metric.
+    */
+    static QMap<QString, QVector<Eigen::MatrixXd> > computeSpectralMetrics(const QList<Eigen::MatrixXd> &matDataList,
+                                                                         const QStringList& lMetrics,
+                                                                         int iNfft,
+                                                                         const QString &sWindowType);
+
+private:
+    //=========================================================================================================
+    /**
+    * Computes the tapered spectra and the cross spectral densities of the epochs of one worker and sums the
+    * requested quantities into the buffers of the worker. This function gets called in parallel.
+    *
+    * @param[in, out] workerData    The epochs of the worker and its sums.
+    */
+    static void compute(SpectralMetricsWorkerData& workerData);
+
+    //=========================================================================================================
+    /**
+    * Adds the sums of a worker to the final sums.
+    *
+    * @param[in, out] finalData     The final sums.
+    * @param[in]  resultData        The sums of a worker.
+    */
+    static void reduce(SpectralMetricsResultData& finalData,
+                       const SpectralMetricsResultData& resultData);
+
+    //=========================================================================================================
+    /**
+    * Creates the network of a metric.
+    *
+    * @param[in] sName          The name of the network.
+    * @param[in] vecValues      The connectivity values.
+    * @param[in] matVert        The vertices of each network node.
+    * @param[in] iNRows         The number of nodes.
+    *
+    * @return                   The network.
+    */
+    static Network createNetwork(const QString& sName,
+                                 const QVector<Eigen::MatrixXd>& vecValues,
+                                 const Eigen::MatrixX3f& matVert,
+                                 int iNRows);
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+
+} // namespace CONNECTIVITYLIB
+
+#endif // SPECTRALMETRICS_H
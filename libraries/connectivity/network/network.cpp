@@ -47,6 +47,7 @@
 #include <utils/spectral.h>
 
 #include <limits>
+#include <vector>
 
 
 //*************************************************************************************************************
@@ -78,6 +79,29 @@ using namespace UTILSLIB;
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
+//Counts the in- and outdegree of each node of a dense network. The edge between node i < j starts at i and ends at j.
+static void denseDegrees(const RowVectorXd& vecWeights,
+                         int iNNodes,
+                         bool bThresholded,
+                         double dThreshold,
+                         VectorXi& vecIndegrees,
+                         VectorXi& vecOutdegrees)
+{
+    vecIndegrees = VectorXi::Zero(iNNodes);
+    vecOutdegrees = VectorXi::Zero(iNNodes);
+
+    int iPair = 0;
+
+    for(int i = 0; i < iNNodes; ++i) {
+        for(int j = i + 1; j < iNNodes; ++j, ++iPair) {
+            if(!bThresholded || fabs(vecWeights(iPair)) >= dThreshold) {
+                ++vecOutdegrees(i);
+                ++vecIndegrees(j);
+            }
+        }
+    }
+}
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -89,7 +113,10 @@ Network::Network(const QString& sConnectivityMethod,
 : m_sConnectivityMethod(sConnectivityMethod)
 , m_minMaxFullWeights(QPair<double,double>(std::numeric_limits<double>::max(),0.0))
 , m_minMaxThresholdedWeights(QPair<double,double>(std::numeric_limits<double>::max(),0.0))
+, m_minMaxFrequencyBins(QPair<int,int>(-1,-1))
 , m_dThreshold(dThreshold)
+, m_bDenseEdgesOutdated(false)
+, m_pDenseEdgesMutex(new QMutex)
 {
     qRegisterMetaType<CONNECTIVITYLIB::Network>("CONNECTIVITYLIB::Network");
 }
@@ -102,6 +129,18 @@ MatrixXd Network::getFullConnectivityMatrix() const
     MatrixXd matDist(m_lNodes.size(), m_lNodes.size());
     matDist.setZero();
 
+    if(isDense()) {
+        int iPair = 0;
+
+        for(int i = 0; i < matDist.rows(); ++i) {
+            for(int j = i + 1; j < matDist.cols(); ++j, ++iPair) {
+                matDist(i,j) = m_vecDenseAveragedWeights(iPair);
+            }
+        }
+
+        return matDist;
+    }
+
     for(int i = 0; i < m_lFullEdges.size(); ++i) {
         int row = m_lFullEdges.at(i)->getStartNodeID();
         int col = m_lFullEdges.at(i)->getEndNodeID();
@@ -123,6 +162,20 @@ MatrixXd Network::getThresholdedConnectivityMatrix() const
     MatrixXd matDist(m_lNodes.size(), m_lNodes.size());
     matDist.setZero();
 
+    if(isDense()) {
+        int iPair = 0;
+
+        for(int i = 0; i < matDist.rows(); ++i) {
+            for(int j = i + 1; j < matDist.cols(); ++j, ++iPair) {
+                if(fabs(m_vecDenseAveragedWeights(iPair)) >= m_dThreshold) {
+                    matDist(i,j) = m_vecDenseAveragedWeights(iPair);
+                }
+            }
+        }
+
+        return matDist;
+    }
+
     for(int i = 0; i < m_lThresholdedEdges.size(); ++i) {
         int row = m_lThresholdedEdges.at(i)->getStartNodeID();
         int col = m_lThresholdedEdges.at(i)->getEndNodeID();
@@ -136,10 +189,68 @@ MatrixXd Network::getThresholdedConnectivityMatrix() const
     return matDist;
 }
 
+
+//*************************************************************************************************************
+
+SparseMatrix<double, RowMajor> Network::getThresholdedSparseMatrix() const
+{
+    typedef Eigen::Triplet<double> T;
+    std::vector<T> tripletList;
+
+    if(isDense()) {
+        int iPair = 0;
+
+        for(int i = 0; i < m_lNodes.size(); ++i) {
+            for(int j = i + 1; j < m_lNodes.size(); ++j, ++iPair) {
+                if(fabs(m_vecDenseAveragedWeights(iPair)) >= m_dThreshold) {
+                    tripletList.push_back(T(i, j, m_vecDenseAveragedWeights(iPair)));
+                }
+            }
+        }
+    } else {
+        tripletList.reserve(m_lThresholdedEdges.size());
+
+        for(int i = 0; i < m_lThresholdedEdges.size(); ++i) {
+            int row = m_lThresholdedEdges.at(i)->getStartNodeID();
+            int col = m_lThresholdedEdges.at(i)->getEndNodeID();
+
+            if(row < m_lNodes.size() && col < m_lNodes.size()) {
+                tripletList.push_back(T(row, col, m_lThresholdedEdges.at(i)->getWeight()));
+            }
+        }
+    }
+
+    SparseMatrix<double, RowMajor> matDist(m_lNodes.size(), m_lNodes.size());
+    matDist.setFromTriplets(tripletList.begin(), tripletList.end());
+
+    return matDist;
+}
+
+
 //*************************************************************************************************************
 
 const QList<NetworkEdge::SPtr>& Network::getFullEdges() const
 {
+    //The full edges of dense networks are only created if somebody asks for them
+    if(isDense()) {
+        QMutexLocker locker(m_pDenseEdgesMutex.data());
+
+        if(m_lFullEdges.isEmpty()) {
+            int iPair = 0;
+
+            for(int i = 0; i < m_lNodes.size(); ++i) {
+                for(int j = i + 1; j < m_lNodes.size(); ++j, ++iPair) {
+                    m_lFullEdges << NetworkEdge::SPtr(new NetworkEdge(i,
+                                                                      j,
+                                                                      m_matDenseWeights.col(iPair),
+                                                                      fabs(m_vecDenseAveragedWeights(iPair)) >= m_dThreshold,
+                                                                      m_minMaxFrequencyBins.first,
+                                                                      m_minMaxFrequencyBins.second));
+                }
+            }
+        }
+    }
+
     return m_lFullEdges;
 }
 
@@ -148,6 +259,8 @@ const QList<NetworkEdge::SPtr>& Network::getFullEdges() const
 
 const QList<NetworkEdge::SPtr>& Network::getThresholdedEdges() const
 {
+    createDenseThresholdedEdges();
+
     return m_lThresholdedEdges;
 }
 
@@ -156,6 +269,8 @@ const QList<NetworkEdge::SPtr>& Network::getThresholdedEdges() const
 
 const QList<NetworkNode::SPtr>& Network::getNodes() const
 {
+    createDenseThresholdedEdges();
+
     return m_lNodes;
 }
 
@@ -164,6 +279,8 @@ const QList<NetworkNode::SPtr>& Network::getNodes() const
 
 NetworkNode::SPtr Network::getNodeAt(int i)
 {
+    createDenseThresholdedEdges();
+
     return m_lNodes.at(i);
 }
 
@@ -172,6 +289,10 @@ NetworkNode::SPtr Network::getNodeAt(int i)
 
 qint16 Network::getFullDistribution() const
 {
+    if(isDense()) {
+        return getFullDegrees().sum();
+    }
+
     qint16 distribution = 0;
 
     for(int i = 0; i < m_lNodes.size(); ++i) {
@@ -186,6 +307,10 @@ qint16 Network::getFullDistribution() const
 
 qint16 Network::getThresholdedDistribution() const
 {
+    if(isDense()) {
+        return getThresholdedDegrees().sum();
+    }
+
     qint16 distribution = 0;
 
     for(int i = 0; i < m_lNodes.size(); ++i) {
@@ -232,6 +357,11 @@ QPair<double, double> Network::getMinMaxThresholdedWeights() const
 
 QPair<int,int> Network::getMinMaxFullDegrees() const
 {
+    if(isDense()) {
+        VectorXi vecDegrees = getFullDegrees();
+        return QPair<int,int>(vecDegrees.minCoeff(), vecDegrees.maxCoeff());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -251,6 +381,11 @@ QPair<int,int> Network::getMinMaxFullDegrees() const
 
 QPair<int,int> Network::getMinMaxThresholdedDegrees() const
 {
+    if(isDense()) {
+        VectorXi vecDegrees = getThresholdedDegrees();
+        return QPair<int,int>(vecDegrees.minCoeff(), vecDegrees.maxCoeff());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -266,10 +401,56 @@ QPair<int,int> Network::getMinMaxThresholdedDegrees() const
 }
 
 
+//*************************************************************************************************************
+
+VectorXi Network::getFullDegrees() const
+{
+    VectorXi vecDegrees = VectorXi::Zero(m_lNodes.size());
+
+    if(isDense()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        denseDegrees(m_vecDenseAveragedWeights, m_lNodes.size(), false, m_dThreshold, vecIndegrees, vecOutdegrees);
+        vecDegrees = vecIndegrees + vecOutdegrees;
+    } else {
+        for(int i = 0; i < m_lNodes.size(); ++i) {
+            vecDegrees(i) = m_lNodes.at(i)->getFullDegree();
+        }
+    }
+
+    return vecDegrees;
+}
+
+
+//*************************************************************************************************************
+
+VectorXi Network::getThresholdedDegrees() const
+{
+    VectorXi vecDegrees = VectorXi::Zero(m_lNodes.size());
+
+    if(isDense()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        denseDegrees(m_vecDenseAveragedWeights, m_lNodes.size(), true, m_dThreshold, vecIndegrees, vecOutdegrees);
+        vecDegrees = vecIndegrees + vecOutdegrees;
+    } else {
+        for(int i = 0; i < m_lNodes.size(); ++i) {
+            vecDegrees(i) = m_lNodes.at(i)->getThresholdedDegree();
+        }
+    }
+
+    return vecDegrees;
+}
+
+
 //*************************************************************************************************************
 
 QPair<int,int> Network::getMinMaxFullIndegrees() const
 {
+    if(isDense()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        denseDegrees(m_vecDenseAveragedWeights, m_lNodes.size(), false, m_dThreshold, vecIndegrees, vecOutdegrees);
+        return QPair<int,int>(vecIndegrees.minCoeff(), vecIndegrees.maxCoeff());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -289,6 +470,12 @@ QPair<int,int> Network::getMinMaxFullIndegrees() const
 
 QPair<int,int> Network::getMinMaxThresholdedIndegrees() const
 {
+    if(isDense()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        denseDegrees(m_vecDenseAveragedWeights, m_lNodes.size(), true, m_dThreshold, vecIndegrees, vecOutdegrees);
+        return QPair<int,int>(vecIndegrees.minCoeff(), vecIndegrees.maxCoeff());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -308,6 +495,12 @@ QPair<int,int> Network::getMinMaxThresholdedIndegrees() const
 
 QPair<int,int> Network::getMinMaxFullOutdegrees() const
 {
+    if(isDense()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        denseDegrees(m_vecDenseAveragedWeights, m_lNodes.size(), false, m_dThreshold, vecIndegrees, vecOutdegrees);
+        return QPair<int,int>(vecOutdegrees.minCoeff(), vecOutdegrees.maxCoeff());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -327,6 +520,12 @@ QPair<int,int> Network::getMinMaxFullOutdegrees() const
 
 QPair<int,int> Network::getMinMaxThresholdedOutdegrees() const
 {
+    if(isDense()) {
+        VectorXi vecIndegrees, vecOutdegrees;
+        denseDegrees(m_vecDenseAveragedWeights, m_lNodes.size(), true, m_dThreshold, vecIndegrees, vecOutdegrees);
+        return QPair<int,int>(vecOutdegrees.minCoeff(), vecOutdegrees.maxCoeff());
+    }
+
     int maxDegree = 0;
     int minDegree = 1000000;
 
@@ -349,12 +548,16 @@ void Network::setThreshold(double dThreshold)
     m_dThreshold = dThreshold;
     m_lThresholdedEdges.clear();
 
-    for(int i = 0; i < m_lFullEdges.size(); ++i) {
-        if(fabs(m_lFullEdges.at(i)->getWeight()) >= m_dThreshold) {
-            m_lFullEdges.at(i)->setActive(true);
-            m_lThresholdedEdges.append(m_lFullEdges.at(i));
-        } else {
-            m_lFullEdges.at(i)->setActive(false);
+    if(isDense()) {
+        m_bDenseEdgesOutdated = true;
+    } else {
+        for(int i = 0; i < m_lFullEdges.size(); ++i) {
+            if(fabs(m_lFullEdges.at(i)->getWeight()) >= m_dThreshold) {
+                m_lFullEdges.at(i)->setActive(true);
+                m_lThresholdedEdges.append(m_lFullEdges.at(i));
+            } else {
+                m_lFullEdges.at(i)->setActive(false);
+            }
         }
     }
 
@@ -381,6 +584,12 @@ void Network::setFrequencyBins(int iLowerBin, int iUpperBin)
     for(int i = 0; i < m_lFullEdges.size(); ++i) {
         m_lFullEdges.at(i)->setFrequencyBins(QPair<int,int>(iLowerBin,iUpperBin));
     }
+
+    //The thresholded edges of dense networks are created from the new averaged weights
+    if(isDense()) {
+        calculateDenseAveragedWeights();
+        m_bDenseEdgesOutdated = true;
+    }
 }
 
 
@@ -425,10 +634,161 @@ void Network::append(NetworkNode::SPtr newNode)
 
 bool Network::isEmpty() const
 {
-    if(m_lFullEdges.isEmpty() || m_lNodes.isEmpty()) {
+    if((m_lFullEdges.isEmpty() && !isDense()) || m_lNodes.isEmpty()) {
         return true;
     }
 
     return false;
 }
 
+
+//*************************************************************************************************************
+
+void Network::setDenseWeights(const QVector<MatrixXd>& vecWeights)
+{
+    int iNNodes = m_lNodes.size();
+
+    if(vecWeights.size() != iNNodes || iNNodes == 0) {
+        qDebug() << "Network::setDenseWeights - Number of weight matrices does not match the number of nodes. Returning.";
+        return;
+    }
+
+    int iNBins = vecWeights.at(0).cols();
+    m_matDenseWeights.resize(iNBins, iNNodes * (iNNodes - 1) / 2);
+
+    int iPair = 0;
+
+    for(int i = 0; i < iNNodes; ++i) {
+        if(vecWeights.at(i).rows() != iNNodes || vecWeights.at(i).cols() != iNBins) {
+            qDebug() << "Network::setDenseWeights - Weight matrix" << i << "has the wrong dimensions. Returning.";
+            m_matDenseWeights.resize(0,0);
+            m_vecDenseAveragedWeights.resize(0);
+            return;
+        }
+
+        for(int j = i + 1; j < iNNodes; ++j, ++iPair) {
+            m_matDenseWeights.col(iPair) = vecWeights.at(i).row(j).transpose();
+        }
+    }
+
+    m_lFullEdges.clear();
+
+    calculateDenseAveragedWeights();
+    m_bDenseEdgesOutdated = true;
+}
+
+
+//*************************************************************************************************************
+
+void Network::setDenseWeights(const MatrixXd& matWeights)
+{
+    int iNNodes = m_lNodes.size();
+
+    if(matWeights.rows() != iNNodes || matWeights.cols() != iNNodes || iNNodes == 0) {
+        qDebug() << "Network::setDenseWeights - Weight matrix does not match the number of nodes. Returning.";
+        return;
+    }
+
+    m_matDenseWeights.resize(1, iNNodes * (iNNodes - 1) / 2);
+
+    int iPair = 0;
+
+    for(int i = 0; i < iNNodes; ++i) {
+        for(int j = i + 1; j < iNNodes; ++j, ++iPair) {
+            m_matDenseWeights(0,iPair) = matWeights(i,j);
+        }
+    }
+
+    m_lFullEdges.clear();
+
+    calculateDenseAveragedWeights();
+    m_bDenseEdgesOutdated = true;
+}
+
+
+//*************************************************************************************************************
+
+bool Network::isDense() const
+{
+    return m_matDenseWeights.size() > 0;
+}
+
+
+//*************************************************************************************************************
+
+void Network::calculateDenseAveragedWeights()
+{
+    int iStartWeightBin = m_minMaxFrequencyBins.first;
+    int iEndWeightBin = m_minMaxFrequencyBins.second;
+    int rows = m_matDenseWeights.rows();
+
+    if(m_vecDenseAveragedWeights.size() != m_matDenseWeights.cols()) {
+        m_vecDenseAveragedWeights = RowVectorXd::Zero(m_matDenseWeights.cols());
+    }
+
+    if(iEndWeightBin < iStartWeightBin || iStartWeightBin < -1 || iEndWeightBin < -1 ) {
+        qDebug() << "Network::calculateDenseAveragedWeights - end bin index is larger than start bin index or one of them is < -1.";
+    } else if(iEndWeightBin == -1 && iStartWeightBin == -1) {
+        m_vecDenseAveragedWeights = m_matDenseWeights.colwise().mean();
+    } else if(iStartWeightBin >= 0 && iStartWeightBin < rows && iEndWeightBin-iStartWeightBin > 0) {
+        if(iEndWeightBin < rows) {
+            m_vecDenseAveragedWeights = m_matDenseWeights.middleRows(iStartWeightBin,iEndWeightBin-iStartWeightBin).colwise().mean();
+        } else {
+            m_vecDenseAveragedWeights = m_matDenseWeights.middleRows(iStartWeightBin,rows-iStartWeightBin).colwise().mean();
+        }
+    }
+
+    m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
+
+    for(int i = 0; i < m_vecDenseAveragedWeights.size(); ++i) {
+        m_minMaxFullWeights.first = qMin(m_minMaxFullWeights.first, m_vecDenseAveragedWeights(i));
+        m_minMaxFullWeights.second = qMax(m_minMaxFullWeights.second, m_vecDenseAveragedWeights(i));
+    }
+
+    m_minMaxThresholdedWeights.second = m_minMaxFullWeights.second;
+}
+
+
+//*************************************************************************************************************
+
+void Network::createDenseThresholdedEdges() const
+{
+    QMutexLocker locker(m_pDenseEdgesMutex.data());
+
+    if(!m_bDenseEdgesOutdated) {
+        return;
+    }
+
+    //The nodes handed out before stay valid, only their edges are replaced
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        m_lNodes.at(i)->clearEdges();
+    }
+
+    m_lThresholdedEdges.clear();
+
+    int iPair = 0;
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        for(int j = i + 1; j < m_lNodes.size(); ++j, ++iPair) {
+            if(fabs(m_vecDenseAveragedWeights(iPair)) >= m_dThreshold) {
+                NetworkEdge::SPtr pEdge = NetworkEdge::SPtr(new NetworkEdge(i,
+                                                                            j,
+                                                                            m_matDenseWeights.col(iPair),
+                                                                            true,
+                                                                            m_minMaxFrequencyBins.first,
+                                                                            m_minMaxFrequencyBins.second));
+
+                m_lNodes.at(i)->append(pEdge);
+                m_lNodes.at(j)->append(pEdge);
+                m_lThresholdedEdges << pEdge;
+            }
+        }
+    }
+
+    m_bDenseEdgesOutdated = false;
+
+    //Full edges created on request do not know about the new threshold otherwise
+    for(int i = 0; i < m_lFullEdges.size(); ++i) {
+        m_lFullEdges.at(i)->setActive(fabs(m_lFullEdges.at(i)->getWeight()) >= m_dThreshold);
+    }
+}
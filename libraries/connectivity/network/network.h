@@ -50,7 +50,9 @@
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QMutex>
 #include <QSharedPointer>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -59,6 +61,7 @@
 //=============================================================================================================
 
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 
 //*************************************************************************************************************
@@ -88,6 +91,12 @@ class NetworkNode;
 /**
 * This class holds information (nodes and connecting edges) about a network, can compute a distance table and provide network metrics.
 *
+* The edge weights can either be appended as single NetworkEdge objects or be set for all node pairs at once with
+* setDenseWeights. In the latter case the weights of the upper triangle are kept in one contiguous buffer (one column
+* per node pair) and thresholding, the connectivity matrices and the degree statistics work directly on this buffer.
+* NetworkEdge objects are then only created for the thresholded edges, when the edges or nodes are requested, and
+* the nodes only hold these edges.
+*
 * @brief This class holds information about a network, can compute a distance table and provide network metrics.
 */
 
@@ -124,6 +133,15 @@ public:
     */
     Eigen::MatrixXd getThresholdedConnectivityMatrix() const;
 
+    //=========================================================================================================
+    /**
+    * Returns the thresholded connectivity matrix as sparse matrix in compressed row storage (CSR). Only the upper
+    * triangle (start node < end node) is stored, as in getThresholdedConnectivityMatrix.
+    *
+    * @return    The sparse thresholded connectivity matrix.
+    */
+    Eigen::SparseMatrix<double, Eigen::RowMajor> getThresholdedSparseMatrix() const;
+
     //=========================================================================================================
     /**
     * Returns the full and non thresholded edges.
@@ -264,6 +282,22 @@ public:
     */
     QPair<int,int> getMinMaxThresholdedOutdegrees() const;
 
+    //=========================================================================================================
+    /**
+    * Returns the degree of each node corresponding to the full network.
+    *
+    * @return   The degree of each node.
+    */
+    Eigen::VectorXi getFullDegrees() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the degree of each node corresponding to the thresholded network.
+    *
+    * @return   The degree of each node.
+    */
+    Eigen::VectorXi getThresholdedDegrees() const;
+
     //=========================================================================================================
     /**
     * Sets the threshold of the network and updates the resulting active edges.
@@ -313,6 +347,33 @@ public:
     */
     void append(QSharedPointer<NetworkNode> newNode);
 
+    //=========================================================================================================
+    /**
+    * Sets the weights of all node pairs, as returned by the compute functions of the connectivity metrics. The
+    * nodes have to be appended beforehand. No NetworkEdge objects are created for the full network.
+    *
+    * @param[in] vecWeights     The weights. Row j > i of vecWeights.at(i) holds the weights (e.g. one per
+    *                           frequency bin) of the edge between node i and node j.
+    */
+    void setDenseWeights(const QVector<Eigen::MatrixXd>& vecWeights);
+
+    //=========================================================================================================
+    /**
+    * Sets a single weight for all node pairs. The nodes have to be appended beforehand. No NetworkEdge objects
+    * are created for the full network.
+    *
+    * @param[in] matWeights     The weights (nodes x nodes). Only the upper triangle is used.
+    */
+    void setDenseWeights(const Eigen::MatrixXd& matWeights);
+
+    //=========================================================================================================
+    /**
+    * Returns whether the weights are held in the dense buffer, see setDenseWeights.
+    *
+    * @return   The flag identifying whether the network is dense.
+    */
+    bool isDense() const;
+
     //=========================================================================================================
     /**
     * Returns whether the Network is empty by checking the number of nodes and edges.
@@ -322,10 +383,25 @@ public:
     bool isEmpty() const;
 
 protected:
-    QList<QSharedPointer<NetworkEdge> >     m_lFullEdges;               /**< List with all edges of the network.*/
-    QList<QSharedPointer<NetworkEdge> >     m_lThresholdedEdges;        /**< List with all the active (thresholded) edges of the network.*/
+    //=========================================================================================================
+    /**
+    * Averages the dense weights between the current frequency bins, in the same way as
+    * NetworkEdge::calculateAveragedWeight, and updates the minimum and maximum full weights.
+    */
+    void calculateDenseAveragedWeights();
+
+    //=========================================================================================================
+    /**
+    * Creates the NetworkEdge objects of the thresholded dense network and attaches them to the existing nodes, if
+    * the threshold, the frequency bins or the weights changed since the last call. The const getters call this
+    * concurrently, hence it is guarded by m_pDenseEdgesMutex.
+    */
+    void createDenseThresholdedEdges() const;
 
-    QList<QSharedPointer<NetworkNode> >     m_lNodes;                   /**< List with all nodes of the network.*/
+    mutable QList<QSharedPointer<NetworkEdge> > m_lFullEdges;               /**< List with all edges of the network. Created on first request for dense networks.*/
+    mutable QList<QSharedPointer<NetworkEdge> > m_lThresholdedEdges;        /**< List with all the active (thresholded) edges of the network. Created on first request for dense networks.*/
+
+    QList<QSharedPointer<NetworkNode> >     m_lNodes;                   /**< List with all nodes of the network. The node objects stay the same when the dense edges are created again.*/
 
     Eigen::MatrixXd                         m_matDistMatrix;            /**< The distance matrix.*/
 
@@ -336,6 +412,11 @@ protected:
     QPair<int,int>                          m_minMaxFrequencyBins;      /**< The minimum and maximum frequency bins to average from/to.*/
 
     double                                  m_dThreshold;               /**< The current threshold value.*/
+
+    Eigen::MatrixXd                         m_matDenseWeights;          /**< The weights of the upper triangle of dense networks (bins x node pairs), pairs ordered row by row.*/
+    Eigen::RowVectorXd                      m_vecDenseAveragedWeights;  /**< The averaged weight of each node pair of dense networks.*/
+    mutable bool                            m_bDenseEdgesOutdated;      /**< Whether the thresholded edges of the dense network have to be created again.*/
+    QSharedPointer<QMutex>                  m_pDenseEdgesMutex;         /**< Guards the creation of the dense edges on request. Shared by copies of the network, since they share the nodes.*/
 };
 
 
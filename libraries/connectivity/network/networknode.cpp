@@ -396,4 +396,12 @@ void NetworkNode::append(QSharedPointer<NetworkEdge> newEdge)
 }
 
 
+//*************************************************************************************************************
+
+void NetworkNode::clearEdges()
+{
+    m_lEdges.clear();
+}
+
+
 
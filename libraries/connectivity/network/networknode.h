@@ -291,6 +291,12 @@ public:
     */
     void append(QSharedPointer<NetworkEdge> newEdge);
 
+    //=========================================================================================================
+    /**
+    * Removes all edges from this network node.
+    */
+    void clearEdges();
+
 protected:
     bool                                    m_bIsHub;       /**< Whether this node is a hub.*/
 
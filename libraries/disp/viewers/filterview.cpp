@@ -211,6 +211,8 @@ void FilterView::setFilterParameters(double hp, double lp, int order, int type,
         ui->m_comboBox_designMethod->setCurrentText("Tschebyscheff");
     if(designMethod == 1)
         ui->m_comboBox_designMethod->setCurrentText("Cosine");
+    if(designMethod == 3)
+        ui->m_comboBox_designMethod->setCurrentText("Butterworth");
 
     ui->m_doubleSpinBox_transitionband->setValue(transition);
 
@@ -572,6 +574,11 @@ void FilterView::changeStateSpinBoxes(int currentIndex)
             ui->m_spinBox_filterTaps->setVisible(true);
             ui->m_label_filterTaps->setVisible(true);
             break;
+
+        case 2: //Butterworth, the taps only determine the length of the plotted impulse response
+            ui->m_spinBox_filterTaps->setVisible(true);
+            ui->m_label_filterTaps->setVisible(true);
+            break;
     }
 
     //Change visibility of spin boxes depending on filter type
@@ -664,6 +671,9 @@ void FilterView::filterParametersChanged()
     if(ui->m_comboBox_designMethod->currentText() == "Cosine")
         dMethod = FilterData::Cosine;
 
+    if(ui->m_comboBox_designMethod->currentText() == "Butterworth")
+        dMethod = FilterData::Butterworth;
+
     //Generate filters
     QSharedPointer<FilterData> userDefinedFilterOperator;
 
@@ -51,6 +51,14 @@
 #include <QPainter>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // Eigen INCLUDES
@@ -84,8 +92,8 @@ ChannelDataDelegate::ChannelDataDelegate(QObject *parent)
 
 void ChannelDataDelegate::initPainterPaths(const QAbstractTableModel *model)
 {
-    for(int i = 0; i<model->rowCount(); i++)
-        m_painterPaths.append(QPainterPath());
+    m_vecPlotPathCache.clear();
+    m_vecPlotPathCache.resize(model->rowCount());
 
     // Init pens
     QColor colorMarker(233,0,43);
@@ -358,7 +366,7 @@ void ChannelDataDelegate::paint(QPainter *painter, const QStyleOptionViewItem &o
                 QPointF ellipsePos;
                 QString amplitude;
 
-                path = QPainterPath(QPointF(option.rect.x(),option.rect.y()));//QPointF(option.rect.x()+t_rtmsaModel->relFiffCursor(),option.rect.y()));
+                path = QPainterPath();
 
                 //QTime timer;
 
@@ -369,7 +377,7 @@ void ChannelDataDelegate::paint(QPainter *painter, const QStyleOptionViewItem &o
 
                 painter->setRenderHint(QPainter::Antialiasing, true);
                 painter->save();
-                painter->translate(0, t_fPlotHeight/2);
+                painter->translate(option.rect.x(), option.rect.y()+t_fPlotHeight/2);
 
                 if(bIsBadChannel) {
                     if(t_pModel->isFreezed()) {
@@ -398,7 +406,18 @@ void ChannelDataDelegate::paint(QPainter *painter, const QStyleOptionViewItem &o
                 }
 
                 //timer.start();
+                const PlotPathCache& plotPathCache = m_vecPlotPathCache.at(index.row());
+
+                painter->drawPath(plotPathCache.pathCurrent);
                 painter->drawPath(path);
+
+                //The last sweep is only visible right of the current sample
+                float fCurrentX = t_pModel->getCurrentSampleIndex() * ((float)option.rect.width()) / t_pModel->getMaxSamples();
+
+                painter->save();
+                painter->setClipRect(QRectF(fCurrentX, -t_fPlotHeight/2, option.rect.width() - fCurrentX, t_fPlotHeight), Qt::IntersectClip);
+                painter->drawPath(plotPathCache.pathLast);
+                painter->restore();
                 //timeMS = timer.elapsed();
                 //std::cout<<"Time drawPath Current data"<<timeMS<<std::endl;
 
@@ -482,6 +501,53 @@ QColor ChannelDataDelegate::getSignalColor()
 }
 
 
+//*************************************************************************************************************
+
+void ChannelDataDelegate::appendPlotColumns(QPainterPath& path,
+                                            const RowVectorPair& data,
+                                            qint32 iFirstColumn,
+                                            qint32 iLastColumn,
+                                            qint32 iNSamples,
+                                            double dSamplesPerColumn,
+                                            double dDx,
+                                            double dOffset,
+                                            double dScaleY) const
+{
+    for(qint32 c = iFirstColumn; c < iLastColumn; ++c) {
+        qint32 iFrom = (qint32)std::ceil(c * dSamplesPerColumn);
+        qint32 iTo = qMin((qint32)std::ceil((c+1) * dSamplesPerColumn), iNSamples);
+
+        if(iTo <= iFrom) {
+            continue;
+        }
+
+        double dMin = *(data.first+iFrom);
+        double dMax = dMin;
+
+        for(qint32 j = iFrom+1; j < iTo; ++j) {
+            double val = *(data.first+j);
+            dMin = qMin(dMin, val);
+            dMax = qMax(dMax, val);
+        }
+
+        //Reverse direction -> plot the right way
+        double dX = (iFrom+1)*dDx;
+        QPointF qMinPosition(dX, -(dMin - dOffset)*dScaleY);
+        QPointF qMaxPosition(dX, -(dMax - dOffset)*dScaleY);
+
+        if(path.elementCount() > 0) {
+            path.lineTo(qMinPosition);
+        } else {
+            path.moveTo(qMinPosition);
+        }
+
+        if(dMax != dMin) {
+            path.lineTo(qMaxPosition);
+        }
+    }
+}
+
+
 //*************************************************************************************************************
 
 void ChannelDataDelegate::createPlotPath(const QModelIndex &index,
@@ -553,56 +619,71 @@ void ChannelDataDelegate::createPlotPath(const QModelIndex &index,
         }
     }
 
-    double dValue;
     double dScaleY = option.rect.height()/(2*dMaxValue);
 
-    double y_base = path.currentPosition().y();
-    QPointF qSamplePosition;
+    //Pixel columns are at least one pixel and one sample wide
+    double dDx = ((double)option.rect.width()) / t_pModel->getMaxSamples();
+    double dColumnWidth = qMax(dDx, 1.0);
+    double dSamplesPerColumn = dColumnWidth / dDx;
 
-    double dDx = ((float)option.rect.width()) / t_pModel->getMaxSamples();
+    qint32 iCurrentSample = qBound(0, t_pModel->getCurrentSampleIndex(), data.second);
+    double dFirstValue = data.second > 0 ? *(data.first) : 0.0;
+    double dLastFirstValue = t_pModel->getLastBlockFirstValue(index.row());
 
-    int currentSampleIndex = t_pModel->getCurrentSampleIndex();
-    double lastFirstValue = t_pModel->getLastBlockFirstValue(index.row());
+    if(index.row() >= m_vecPlotPathCache.size()) {
+        m_vecPlotPathCache.resize(index.row() + 1);
+    }
 
-    //Move to initial starting point
-    if(data.second > 0)
-    {
-        dValue = 0;
+    PlotPathCache& cache = m_vecPlotPathCache[index.row()];
+
+    //Recreate the paths when a new sweep started or the data or plot changed
+    if(cache.pData != data.first
+       || cache.iNSamples != data.second
+       || cache.iWidth != option.rect.width()
+       || cache.dScaleY != dScaleY
+       || cache.dFirstValue != dFirstValue
+       || cache.dLastFirstValue != dLastFirstValue
+       || cache.iCurrentSample > iCurrentSample) {
+        cache = PlotPathCache();
+        cache.pData = data.first;
+        cache.iNSamples = data.second;
+        cache.iWidth = option.rect.width();
+        cache.dScaleY = dScaleY;
+        cache.dFirstValue = dFirstValue;
+        cache.dLastFirstValue = dLastFirstValue;
+
+        //do not remove first sample data[0] as offset because this is the last data part
+        qint32 iNColumns = (qint32)std::ceil(data.second / dSamplesPerColumn);
+        appendPlotColumns(cache.pathLast, data, 0, iNColumns, data.second, dSamplesPerColumn, dDx, dLastFirstValue, dScaleY);
+    }
 
-        //Reverse direction -> plot the right way
-        float newY = y_base-dValue;
+    //Append the columns which were completed since the last update, remove first sample data[0] as offset
+    qint32 iNColumnsCurrent = (qint32)(iCurrentSample / dSamplesPerColumn);
 
-        qSamplePosition.setY(newY);
-        qSamplePosition.setX(path.currentPosition().x());
-
-        path.moveTo(qSamplePosition);
+    if(iNColumnsCurrent > cache.iNColumnsCurrent) {
+        appendPlotColumns(cache.pathCurrent, data, cache.iNColumnsCurrent, iNColumnsCurrent, iCurrentSample, dSamplesPerColumn, dDx, dFirstValue, dScaleY);
+        cache.iNColumnsCurrent = iNColumnsCurrent;
     }
 
-    double val;
+    cache.iCurrentSample = iCurrentSample;
 
-    for(qint32 j=0; j < data.second; ++j)
-    {
-        if(j<currentSampleIndex)
-            val = *(data.first+j) - *(data.first); //remove first sample data[0] as offset
-        else
-            val = *(data.first+j) - lastFirstValue; //do not remove first sample data[0] as offset because this is the last data part
+    //The trailing column is not completed yet
+    if(cache.pathCurrent.elementCount() > 0) {
+        path.moveTo(cache.pathCurrent.currentPosition());
+    }
 
-        dValue = val*dScaleY;
-        //qDebug()<<"val"<<val<<"dScaleY"<<dScaleY<<"dValue"<<dValue;
+    appendPlotColumns(path, data, iNColumnsCurrent, iNColumnsCurrent + 1, iCurrentSample, dSamplesPerColumn, dDx, dFirstValue, dScaleY);
 
-        double newY = y_base-dValue;//Reverse direction -> plot the right way
+    //Create ellipse position
+    qint32 iMarkerSample = (qint32)(m_markerPosition.x()/dDx);
 
-        qSamplePosition.setY(newY);
-        qSamplePosition.setX(path.currentPosition().x()+dDx);
-        path.lineTo(qSamplePosition);
+    if(iMarkerSample >= 0 && iMarkerSample < data.second) {
+        double dOffset = iMarkerSample < iCurrentSample ? dFirstValue : dLastFirstValue;
 
-        //Create ellipse position
-        if(j == (qint32)(m_markerPosition.x()/dDx)) {
-            ellipsePos.setX(path.currentPosition().x()+dDx);
-            ellipsePos.setY(newY/*+(option.rect.height()/2)*/);
+        ellipsePos.setX(option.rect.x() + (iMarkerSample+1)*dDx);
+        ellipsePos.setY(option.rect.y() - (*(data.first+iMarkerSample) - dOffset)*dScaleY);
 
-            amplitude = QString::number(*(data.first+j));
-        }
+        amplitude = QString::number(*(data.first+iMarkerSample));
     }
 }
 
@@ -50,7 +50,9 @@
 //=============================================================================================================
 
 #include <QAbstractItemDelegate>
+#include <QPainterPath>
 #include <QPen>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -166,11 +168,14 @@ public:
 private:
     //=========================================================================================================
     /**
-    * createPlotPath creates the QPointer path for the data plot.
+    * createPlotPath updates the cached paths of the data plot of a row. Each pixel column is plotted by its minimum
+    * and maximum. Only the columns which were completed since the last call are appended to the cached path of the
+    * current sweep, the cached path of the last sweep is only recreated when a new sweep starts or the plot changes.
+    * The paths are created relative to the center left of the item rectangle.
     *
     * @param[in] index      Used to locate data in a data model.
     * @param[in] option     Describes the parameters used to draw an item in a view widget
-    * @param[in,out] path   The QPointerPath to create for the data plot.
+    * @param[in,out] path   The QPointerPath of the trailing, not yet completed pixel column of the current sweep.
     * @param[in] ellipsePos Position of the ellipse which is plotted at the current channel signal value.
     * @param[in] amplitude  String which is to be plotted.
     * @param[in] data       Current data for the given row.
@@ -182,6 +187,30 @@ private:
                         QString &amplitude,
                         DISPLIB::RowVectorPair &data) const;
 
+    //=========================================================================================================
+    /**
+    * appendPlotColumns appends the minimum and maximum of consecutive pixel columns to a path.
+    *
+    * @param[in,out] path           The QPointerPath to append to.
+    * @param[in] data               Data for the given row.
+    * @param[in] iFirstColumn       The first column to append.
+    * @param[in] iLastColumn        The column after the last column to append.
+    * @param[in] iNSamples          The number of samples which can be used, following samples are ignored.
+    * @param[in] dSamplesPerColumn  The number of samples per column.
+    * @param[in] dDx                The pixel distance between two samples.
+    * @param[in] dOffset            The offset which is subtracted from the data.
+    * @param[in] dScaleY            The vertical scaling.
+    */
+    void appendPlotColumns(QPainterPath& path,
+                           const RowVectorPair& data,
+                           qint32 iFirstColumn,
+                           qint32 iLastColumn,
+                           qint32 iNSamples,
+                           double dSamplesPerColumn,
+                           double dDx,
+                           double dOffset,
+                           double dScaleY) const;
+
     //=========================================================================================================
     /**
     * createCurrentPositionMarkerPath Creates the QPointer path for the current marker position plot.
@@ -249,7 +278,36 @@ private:
 
 
     QPoint              m_markerPosition;   /**< Current mouse position used to draw the marker in the plot. */
-    QList<QPainterPath> m_painterPaths;     /**< List of all current painter paths for each row. */
+
+    //=========================================================================================================
+    /**
+    * The cached plot paths of a row and the state they were created for.
+    */
+    struct PlotPathCache {
+        QPainterPath    pathCurrent;        /**< The completed pixel columns of the current sweep. */
+        QPainterPath    pathLast;           /**< The pixel columns of the last sweep. */
+        const double*   pData;              /**< The data the paths were created from. */
+        qint32          iNSamples;          /**< The number of samples of the data. */
+        qint32          iNColumnsCurrent;   /**< The number of completed pixel columns of the current sweep. */
+        qint32          iCurrentSample;     /**< The current sample index when the paths were last updated. */
+        int             iWidth;             /**< The width of the plot. */
+        double          dScaleY;            /**< The vertical scaling of the plot. */
+        double          dFirstValue;        /**< The offset of the current sweep. */
+        double          dLastFirstValue;    /**< The offset of the last sweep. */
+
+        PlotPathCache()
+        : pData(Q_NULLPTR)
+        , iNSamples(0)
+        , iNColumnsCurrent(0)
+        , iCurrentSample(0)
+        , iWidth(0)
+        , dScaleY(0.0)
+        , dFirstValue(0.0)
+        , dLastFirstValue(0.0)
+        {}
+    };
+
+    mutable QVector<PlotPathCache> m_vecPlotPathCache;  /**< The cached plot paths for each row. */
 
     double              m_dMaxValue;        /**< Maximum value of the data to plot. */
     double              m_dScaleY;          /**< Maximum amplitude of plot (max is m_dPlotHeight/2). */
@@ -342,15 +342,11 @@ void ChannelDataModel::setFiffInfo(QSharedPointer<FIFFLIB::FiffInfo> &p_pFiffInf
 
         m_matOverlap.conservativeResize(m_pFiffInfo->chs.size(), m_iMaxFilterLength);
 
-        m_matSparseProjMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
         m_matSparseCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
         m_matSparseSpharaMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-        m_matSparseProjCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
 
-        m_matSparseProjMult.setIdentity();
         m_matSparseCompMult.setIdentity();
         m_matSparseSpharaMult.setIdentity();
-        m_matSparseProjCompMult.setIdentity();
 
         //Create the initial Compensator projector
         updateCompensator(0);
@@ -382,6 +378,7 @@ void ChannelDataModel::setFiffInfo(QSharedPointer<FIFFLIB::FiffInfo> &p_pFiffInf
     } else {
         m_vecBadIdcs = RowVectorXi(0,0);
         m_matProj = MatrixXd(0,0);
+        m_matProjU = MatrixXd(0,0);
         m_matComp = MatrixXd(0,0);
     }
 }
@@ -453,6 +450,23 @@ void ChannelDataModel::addData(const QList<MatrixXd> &data)
             return;
         }
 
+        //Apply compensator and projector once to the whole incoming block, before it is split at the end of the window
+        const MatrixXd* pData = &data.at(b);
+
+        if(doComp || doProj) {
+            if(doComp) {
+                m_matDataProcessed = m_matSparseCompMult * data.at(b);
+            } else {
+                m_matDataProcessed = data.at(b);
+            }
+
+            if(doProj) {
+                applyProjector(m_matDataProcessed);
+            }
+
+            pData = &m_matDataProcessed;
+        }
+
         //Reset m_iCurrentSample and start filling the data matrix from the beginning again. Also add residual amount of data to the end of the matrix.
         if(m_iCurrentSample+nCol > m_matDataRaw.cols()) {
             m_iResidual = nCol - ((m_iCurrentSample+nCol) % m_matDataRaw.cols());
@@ -466,24 +480,7 @@ void ChannelDataModel::addData(const QList<MatrixXd> &data)
 //            std::cout<<"m_matDataRaw.cols(): "<<m_matDataRaw.cols()<<std::endl;
 //            std::cout<<"nCol-m_iResidual: "<<nCol-m_iResidual<<std::endl<<std::endl;
 
-            if(doComp) {
-                if(doProj) {
-                    //Comp + Proj
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjCompMult * data.at(b).block(0,0,nRow,m_iResidual);
-                } else {
-                    //Comp
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseCompMult * data.at(b).block(0,0,nRow,m_iResidual);
-                }
-            } else {
-                if(doProj)
-                {
-                    //Proj
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjMult * data.at(b).block(0,0,nRow,m_iResidual);
-                } else {
-                    //None - Raw
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = data.at(b).block(0,0,nRow,m_iResidual);
-                }
-            }
+            m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = pData->block(0,0,nRow,m_iResidual);
 
             m_iCurrentSample = 0;
 
@@ -509,23 +506,7 @@ void ChannelDataModel::addData(const QList<MatrixXd> &data)
 
         //std::cout<<"incoming data is ok"<<std::endl;
 
-        if(doComp) {
-            if(doProj) {
-                //Comp + Proj
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjCompMult * data.at(b);
-            } else {
-                //Comp
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseCompMult * data.at(b);
-            }
-        } else {
-            if(doProj) {
-                //Proj
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjMult * data.at(b);
-            } else {
-                //None - Raw
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = data.at(b);
-            }
-        }
+        m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = *pData;
 
         //Filter if neccessary else set filtered data matrix to zero
         if(!m_filterData.isEmpty()) {
@@ -728,7 +709,8 @@ void ChannelDataModel::updateProjection()
             }
         }
 
-        this->m_pFiffInfo->make_projector(m_matProj);
+        //Keep the orthonormal basis U of the SSP vectors, the projector I - U*U^T is applied in this low-rank form
+        FiffProj::make_projector(this->m_pFiffInfo->projs, this->m_pFiffInfo->ch_names, m_matProj, this->m_pFiffInfo->bads, m_matProjU);
         qDebug() << "ChannelDataModel::updateProjection - New projection calculated.";
 
         //set columns of matrix to zero depending on bad channels indexes
@@ -736,37 +718,11 @@ void ChannelDataModel::updateProjection()
             m_matProj.col(m_vecBadIdcs[j]).setZero();
         }
 
+        m_vecProjBadIdcs = m_vecBadIdcs;
+
 //        std::cout << "Bads\n" << m_vecBadIdcs << std::endl;
 //        std::cout << "Proj\n";
 //        std::cout << m_matProj.block(0,0,10,10) << std::endl;
-
-        //
-        // Make proj sparse
-        //
-        qint32 nchan = this->m_pFiffInfo->nchan;
-        qint32 i, k;
-
-        typedef Eigen::Triplet<double> T;
-        std::vector<T> tripletList;
-        tripletList.reserve(nchan);
-
-        tripletList.clear();
-        tripletList.reserve(m_matProj.rows()*m_matProj.cols());
-        for(i = 0; i < m_matProj.rows(); ++i) {
-            for(k = 0; k < m_matProj.cols(); ++k) {
-                if(m_matProj(i,k) != 0) {
-                    tripletList.push_back(T(i, k, m_matProj(i,k)));
-                }
-            }
-        }
-
-        m_matSparseProjMult = SparseMatrix<double>(m_matProj.rows(),m_matProj.cols());
-        if(tripletList.size() > 0) {
-            m_matSparseProjMult.setFromTriplets(tripletList.begin(), tripletList.end());
-        }
-
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
     }
 }
 
@@ -819,9 +775,6 @@ void ChannelDataModel::updateCompensator(int to)
         if(tripletList.size() > 0) {
             m_matSparseCompMult.setFromTriplets(tripletList.begin(), tripletList.end());
         }
-
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
     }
 }
 
@@ -1350,3 +1303,18 @@ void ChannelDataModel::clearModel()
     qDebug("ChannelDataModel cleared.");
 
 }
+
+
+//*************************************************************************************************************
+
+void ChannelDataModel::applyProjector(MatrixXd& matData) const
+{
+    //Equivalent to the multiplication with m_matProj, but with 2*nchan*nproj instead of nchan^2 operations per sample
+    for(qint32 j = 0; j < m_vecProjBadIdcs.cols(); ++j) {
+        matData.row(m_vecProjBadIdcs[j]).setZero();
+    }
+
+    if(m_matProjU.cols() > 0 && m_matProjU.rows() == matData.rows()) {
+        matData.noalias() -= m_matProjU * (m_matProjU.transpose() * matData);
+    }
+}
@@ -536,6 +536,15 @@ private:
     */
     void clearModel();
 
+    //=========================================================================================================
+    /**
+    * Applies the SSP projector in its low-rank form (I - U*U^T), with the columns of the bad channels set to zero,
+    * to a data block in-place.
+    *
+    * @param[in,out] matData    The data block which is to be projected.
+    */
+    void applyProjector(Eigen::MatrixXd& matData) const;
+
     bool                                m_bProjActivated;                           /**< Projections activated */
     bool                                m_bCompActivated;                           /**< Compensator activated */
     bool                                m_bSpharaActivated;                         /**< Sphara activated */
@@ -562,6 +571,7 @@ private:
     QSharedPointer<FIFFLIB::FiffInfo>   m_pFiffInfo;                                /**< Fiff info */
 
     Eigen::RowVectorXi                  m_vecBadIdcs;                               /**< Idcs of bad channels */
+    Eigen::RowVectorXi                  m_vecProjBadIdcs;                           /**< Idcs of bad channels when the SSP projector was created */
     Eigen::VectorXd                     m_vecLastBlockFirstValuesFiltered;          /**< The first value of the last complete filtered data display block */
     Eigen::VectorXd                     m_vecLastBlockFirstValuesRaw;               /**< The first value of the last complete raw data display block */
 
@@ -570,6 +580,7 @@ private:
     MatrixXdR                           m_matDataRawFreeze;                         /**< The raw data in freeze mode */
     MatrixXdR                           m_matDataFilteredFreeze;                    /**< The raw filtered data in freeze mode */
     Eigen::MatrixXd                     m_matOverlap;                               /**< Last overlap block for the back */
+    Eigen::MatrixXd                     m_matDataProcessed;                         /**< The incoming data block after compensation and projection */
 
     Eigen::VectorXi                     m_vecIndicesFirstVV;                        /**< The indices of the channels to pick for the first SPHARA operator in case of a VectorView system.*/
     Eigen::VectorXi                     m_vecIndicesSecondVV;                       /**< The indices of the channels to pick for the second SPHARA operator in case of a VectorView system.*/
@@ -578,11 +589,10 @@ private:
     Eigen::VectorXi                     m_vecIndicesFirstEEG;                       /**< The indices of the channels to pick for the second SPHARA operator in case of an EEG system.*/
 
     Eigen::SparseMatrix<double>         m_matSparseSpharaMult;                      /**< The final sparse SPHARA operator .*/
-    Eigen::SparseMatrix<double>         m_matSparseProjCompMult;                    /**< The final sparse projection + compensator operator.*/
-    Eigen::SparseMatrix<double>         m_matSparseProjMult;                        /**< The final sparse SSP projector */
     Eigen::SparseMatrix<double>         m_matSparseCompMult;                        /**< The final sparse compensator matrix */
 
     Eigen::MatrixXd                     m_matProj;                                  /**< SSP projector */
+    Eigen::MatrixXd                     m_matProjU;                                 /**< Orthonormal basis of the SSP vectors, the projector is I - U*U^T */
     Eigen::MatrixXd                     m_matComp;                                  /**< Compensator */
 
     Eigen::MatrixXd                     m_matSpharaVVGradLoaded;                    /**< The loaded VectorView gradiometer basis functions.*/
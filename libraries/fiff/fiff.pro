@@ -38,7 +38,7 @@ include(../../mne-cpp.pri)
 
 TEMPLATE = lib
 
-QT += network
+QT += network concurrent
 QT -= gui
 
 DEFINES += FIFF_LIBRARY
@@ -78,6 +78,9 @@ SOURCES += fiff.cpp \
     fiff_id.cpp \
     fiff_info.cpp \
     fiff_raw_dir.cpp \
+    fiff_raw_buffer_cache.cpp \
+    fiff_raw_memory_map.cpp \
+    fiff_raw_writer.cpp \
     fiff_dig_point.cpp \
     fiff_ch_pos.cpp \
     fiff_cov.cpp \
@@ -111,6 +114,9 @@ HEADERS += fiff.h \
     fiff_raw_data.h \
     fiff_dir_entry.h \
     fiff_raw_dir.h \
+    fiff_raw_buffer_cache.h \
+    fiff_raw_memory_map.h \
+    fiff_raw_writer.h \
     fiff_dig_point.h \
     fiff_ch_pos.h \
     fiff_cov.h \
@@ -0,0 +1,186 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_buffer_cache.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Definition of the FiffRawBufferCache Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_raw_buffer_cache.h"
+#include "fiff_tag.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawBufferCache::FiffRawBufferCache(int iMaxSizeMB)
+: m_iHits(0)
+, m_iMisses(0)
+{
+    m_qCache.setMaxCost(qMax(iMaxSizeMB, 0) * 1024);
+}
+
+
+//*************************************************************************************************************
+
+QSharedPointer<const MatrixXd> FiffRawBufferCache::buffer(const QSharedPointer<FiffStream>& p_pStream,
+                                                          const FiffRawDir& p_RawDir,
+                                                          fiff_int_t nchan)
+{
+    if(!p_pStream || !p_RawDir.ent) {
+        return BufferPtr();
+    }
+
+    QMutexLocker locker(&m_qMutex);
+
+    if(BufferPtr* pCached = m_qCache.object(p_RawDir.ent->pos)) {
+        ++m_iHits;
+        return *pCached;
+    }
+
+    ++m_iMisses;
+
+    FiffTag::SPtr t_pTag;
+    if(!p_pStream->read_tag(t_pTag, p_RawDir.ent->pos)) {
+        printf("Could not read raw data buffer at position %d\n", p_RawDir.ent->pos);
+        return BufferPtr();
+    }
+
+    QSharedPointer<MatrixXd> pBuffer(new MatrixXd);
+    if(!decode(t_pTag, nchan, p_RawDir.nsamp, *pBuffer)) {
+        printf("Data Storage Format not known jet!! Type: %d\n", t_pTag->type);
+        return BufferPtr();
+    }
+
+    //Cost is given in kB, buffers larger than the cache are not inserted
+    int iCost = qMax(1, (int)(pBuffer->size() * sizeof(double) / 1024));
+    if(iCost <= m_qCache.maxCost()) {
+        m_qCache.insert(p_RawDir.ent->pos, new BufferPtr(pBuffer), iCost);
+    }
+
+    return pBuffer;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawBufferCache::setMaxSize(int iMaxSizeMB)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_qCache.setMaxCost(qMax(iMaxSizeMB, 0) * 1024);
+}
+
+
+//*************************************************************************************************************
+
+int FiffRawBufferCache::maxSize() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_qCache.maxCost() / 1024;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawBufferCache::clear()
+{
+    QMutexLocker locker(&m_qMutex);
+    m_qCache.clear();
+    m_iHits = 0;
+    m_iMisses = 0;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffRawBufferCache::hits() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iHits;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffRawBufferCache::misses() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iMisses;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawBufferCache::decode(const FiffTag::SPtr& p_pTag,
+                                fiff_int_t nchan,
+                                fiff_int_t nsamp,
+                                MatrixXd& matData)
+{
+    switch(p_pTag->type) {
+        case FIFFT_DAU_PACK16:
+            matData = (Map< MatrixDau16 >(p_pTag->toDauPack16(), nchan, nsamp)).cast<double>();
+            return true;
+        case FIFFT_SHORT:
+            matData = (Map< MatrixShort >(p_pTag->toShort(), nchan, nsamp)).cast<double>();
+            return true;
+        case FIFFT_INT:
+            matData = (Map< MatrixXi >(p_pTag->toInt(), nchan, nsamp)).cast<double>();
+            return true;
+        case FIFFT_FLOAT:
+            matData = (Map< MatrixXf >(p_pTag->toFloat(), nchan, nsamp)).cast<double>();
+            return true;
+        default:
+            return false;
+    }
+}
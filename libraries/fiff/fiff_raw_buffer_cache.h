@@ -0,0 +1,179 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_buffer_cache.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffRawBufferCache class declaration.
+*
+*/
+
+#ifndef FIFF_RAW_BUFFER_CACHE_H
+#define FIFF_RAW_BUFFER_CACHE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+#include "fiff_raw_dir.h"
+#include "fiff_stream.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QCache>
+#include <QMutex>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+
+//=============================================================================================================
+/**
+* Least recently used cache of decoded raw data buffers. Buffers are stored uncalibrated (channels x samples)
+* and are identified by the file position of their tag, so that all FiffRawData copies which share the same
+* stream can share the cache as well. Stream access is serialized by the cache.
+*
+* @brief LRU cache of decoded raw data buffers.
+*/
+class FIFFSHARED_EXPORT FiffRawBufferCache
+{
+public:
+    typedef QSharedPointer<FiffRawBufferCache> SPtr;            /**< Shared pointer type for FiffRawBufferCache. */
+    typedef QSharedPointer<const FiffRawBufferCache> ConstSPtr; /**< Const shared pointer type for FiffRawBufferCache. */
+
+    //=========================================================================================================
+    /**
+    * Constructs the cache.
+    *
+    * @param[in] iMaxSizeMB     The maximal amount of decoded data kept in memory in MB. 0 disables caching.
+    */
+    explicit FiffRawBufferCache(int iMaxSizeMB = 64);
+
+    //=========================================================================================================
+    /**
+    * Returns the decoded data (channels x samples) of a raw data buffer. The buffer is read from the stream
+    * if it is not cached yet.
+    *
+    * @param[in] p_pStream      The stream to read from. The stream device has to be open.
+    * @param[in] p_RawDir       The raw directory entry of the buffer.
+    * @param[in] nchan          The number of channels stored in the buffer.
+    *
+    * @return the decoded buffer, or a null pointer if the buffer could not be read.
+    */
+    QSharedPointer<const Eigen::MatrixXd> buffer(const QSharedPointer<FiffStream>& p_pStream,
+                                                 const FiffRawDir& p_RawDir,
+                                                 fiff_int_t nchan);
+
+    //=========================================================================================================
+    /**
+    * Sets the maximal amount of decoded data kept in memory. Buffers exceeding the new size are released.
+    *
+    * @param[in] iMaxSizeMB     The maximal size in MB. 0 disables caching.
+    */
+    void setMaxSize(int iMaxSizeMB);
+
+    //=========================================================================================================
+    /**
+    * Returns the maximal amount of decoded data kept in memory.
+    *
+    * @return the maximal size in MB.
+    */
+    int maxSize() const;
+
+    //=========================================================================================================
+    /**
+    * Releases all cached buffers and resets the hit/miss counters.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Returns the number of buffer requests served from the cache.
+    *
+    * @return the number of cache hits.
+    */
+    qint64 hits() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of buffer requests which had to be read from the stream.
+    *
+    * @return the number of cache misses.
+    */
+    qint64 misses() const;
+
+    //=========================================================================================================
+    /**
+    * Decodes the payload of a raw data buffer tag (FIFFT_DAU_PACK16, FIFFT_SHORT, FIFFT_INT or FIFFT_FLOAT).
+    *
+    * @param[in] p_pTag         The tag holding the raw data buffer.
+    * @param[in] nchan          The number of channels stored in the buffer.
+    * @param[in] nsamp          The number of samples stored in the buffer.
+    * @param[out] matData       The decoded data (channels x samples).
+    *
+    * @return true if the tag type is supported, false otherwise.
+    */
+    static bool decode(const QSharedPointer<FiffTag>& p_pTag,
+                       fiff_int_t nchan,
+                       fiff_int_t nsamp,
+                       Eigen::MatrixXd& matData);
+
+private:
+    typedef QSharedPointer<const Eigen::MatrixXd> BufferPtr;    /**< Shared pointer type for a decoded buffer. */
+
+    QCache<fiff_int_t, BufferPtr>   m_qCache;       /**< The decoded buffers, key is the tag position, cost is in kB. */
+    mutable QMutex                  m_qMutex;       /**< Serializes cache and stream access. */
+    qint64                          m_iHits;        /**< Number of cache hits. */
+    qint64                          m_iMisses;      /**< Number of cache misses. */
+};
+
+} // NAMESPACE
+
+#endif // FIFF_RAW_BUFFER_CACHE_H
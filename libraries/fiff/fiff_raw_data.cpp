@@ -43,6 +43,20 @@
 #include "fiff_stream.h"
 #include "cstdlib"
 
+#include <algorithm>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QtConcurrent>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -51,6 +65,27 @@
 using namespace FIFFLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NESTED TYPES
+//=============================================================================================================
+
+struct FiffRawData::SegmentBufferTask
+{
+    const FiffRawData*              raw;        /**< The raw data to read from. */
+    qint32                          buffer;     /**< Index of the raw directory entry of the buffer. */
+    QVector<qint32>                 segments;   /**< Indices of the segments overlapping the buffer. */
+    const SparseMatrix<double>*     cal;        /**< The calibration matrix. */
+    const SparseMatrix<double>*     mult;       /**< The combined operator. */
+    const RowVectorXi*              sel;        /**< The channel selection. */
+    const VectorXi*                 from;       /**< First sample of each segment. */
+    const VectorXi*                 to;         /**< Last sample of each segment. */
+    const QVector<MatrixXd*>*       data;       /**< The segment data, each segment column is written by one task only. */
+
+    void scatter();
+};
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -59,6 +94,7 @@ using namespace FIFFLIB;
 FiffRawData::FiffRawData()
 : first_samp(-1)
 , last_samp(-1)
+, m_pBufferCache(new FiffRawBufferCache)
 {
 
 }
@@ -69,6 +105,7 @@ FiffRawData::FiffRawData()
 FiffRawData::FiffRawData(QIODevice &p_IODevice)
 : first_samp(-1)
 , last_samp(-1)
+, m_pBufferCache(new FiffRawBufferCache)
 {
     //setup FiffRawData object
     if(!FiffStream::setup_read_raw(p_IODevice, *this))
@@ -77,6 +114,8 @@ FiffRawData::FiffRawData(QIODevice &p_IODevice)
         //exit(EXIT_FAILURE); //ToDo Throw here, e.g.: throw std::runtime_error("IO Error! File not found");
         return;
     }
+
+    setMemoryMapped(true);
 }
 
 
@@ -91,6 +130,8 @@ FiffRawData::FiffRawData(const FiffRawData &p_FiffRawData)
 , rawdir(p_FiffRawData.rawdir)
 , proj(p_FiffRawData.proj)
 , comp(p_FiffRawData.comp)
+, m_pBufferCache(p_FiffRawData.m_pBufferCache)
+, m_pMemoryMap(p_FiffRawData.m_pMemoryMap)
 {
 
 }
@@ -115,6 +156,8 @@ void FiffRawData::clear()
     rawdir.clear();
     proj = MatrixXd();
     comp.clear();
+    m_pBufferCache = FiffRawBufferCache::SPtr(new FiffRawBufferCache);
+    m_pMemoryMap.clear();
 }
 
 
@@ -127,11 +170,21 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
                                    const RowVectorXi& sel,
                                    bool do_debug) const
 {
-    bool projAvailable = true;
+    SparseMatrix<double> multSegment;
+    return read_raw_segment(data, times, multSegment, from, to, sel, do_debug);
+}
 
-    if (this->proj.size() == 0)
-        projAvailable = false;
 
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_segment(MatrixXd& data,
+                                   MatrixXd& times,
+                                   SparseMatrix<double>& multSegment,
+                                   fiff_int_t from,
+                                   fiff_int_t to,
+                                   const RowVectorXi& sel,
+                                   bool do_debug) const
+{
     if(from == -1)
         from = this->first_samp;
     if(to == -1)
@@ -155,211 +208,33 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
     //
     qint32 nchan = this->info.nchan;
     qint32 dest  = 0;//1;
-    qint32 i, k, r;
-
-    typedef Eigen::Triplet<double> T;
-    std::vector<T> tripletList;
-    tripletList.reserve(nchan);
-    for(i = 0; i < nchan; ++i)
-        tripletList.push_back(T(i, i, this->cals[i]));
+    qint32 i, k;
 
-    SparseMatrix<double> cal(nchan, nchan);
-    cal.setFromTriplets(tripletList.begin(), tripletList.end());
-//    cal.makeCompressed();
-
-    MatrixXd mult_full;
-    //
-    if (sel.size() == 0)
-    {
-        data = MatrixXd(nchan, to-from+1);
-//            data->setZero();
-        if (projAvailable || this->comp.kind != -1)
-        {
-            if (!projAvailable)
-                mult_full = this->comp.data->data*cal;
-            else if (this->comp.kind == -1)
-                mult_full = this->proj*cal;
-            else
-                mult_full = this->proj*this->comp.data->data*cal;
-        }
-    }
-    else
-    {
-        data = MatrixXd(sel.size(),to-from+1);
+    data = MatrixXd(sel.size() == 0 ? nchan : sel.size(), to-from+1);
 //            data->setZero();
 
-        MatrixXd selVect(sel.size(), nchan);
-
-        selVect.setZero();
-
-        if (!projAvailable && this->comp.kind == -1)
-        {
-            tripletList.clear();
-            tripletList.reserve(sel.size());
-            for(i = 0; i < sel.size(); ++i)
-                tripletList.push_back(T(i, i, this->cals[sel[i]]));
-            cal = SparseMatrix<double>(sel.size(), sel.size());
-            cal.setFromTriplets(tripletList.begin(), tripletList.end());
-        }
-        else
-        {
-            if (!projAvailable)
-            {
-                qDebug() << "This has to be debugged! #1";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->comp.data->data.block(sel[i],0,1,nchan);
-                mult_full = selVect*cal;
-            }
-            else if (this->comp.kind == -1)
-            {
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
-
-                mult_full = selVect*cal;
-            }
-            else
-            {
-                qDebug() << "This has to be debugged! #3";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
-
-                mult_full = selVect*this->comp.data->data*cal;
-            }
-        }
-    }
-
-    //
-    // Make mult sparse
-    //
-    tripletList.clear();
-    tripletList.reserve(mult_full.rows()*mult_full.cols());
-    for(i = 0; i < mult_full.rows(); ++i)
-        for(k = 0; k < mult_full.cols(); ++k)
-            if(mult_full(i,k) != 0)
-                tripletList.push_back(T(i, k, mult_full(i,k)));
-
-    SparseMatrix<double> mult(mult_full.rows(),mult_full.cols());
-    if(tripletList.size() > 0)
-        mult.setFromTriplets(tripletList.begin(), tripletList.end());
-//    mult.makeCompressed();
-
+    SparseMatrix<double> cal, mult;
+    setup_segment_mult(sel, cal, mult);
     //
 
-    FiffStream::SPtr fid;
     if (!this->file->device()->isOpen())
     {
         if (!this->file->device()->open(QIODevice::ReadOnly))
         {
             printf("Cannot open file %s",this->info.filename.toUtf8().constData());
         }
-        fid = this->file;
-    }
-    else
-    {
-        fid = this->file;
     }
 
     MatrixXd one;
     fiff_int_t first_pick, last_pick, picksamp;
-    for(k = 0; k < this->rawdir.size(); ++k)
+    for(k = find_first_buffer(from); k < this->rawdir.size(); ++k)
     {
-        FiffRawDir thisRawDir = this->rawdir[k];
+        const FiffRawDir& thisRawDir = this->rawdir[k];
         //
         //  Do we need this buffer
         //
-        if (thisRawDir.last > from)
+        if (thisRawDir.last >= from)
         {
-            if (thisRawDir.ent->kind == -1)
-            {
-                //
-                //  Take the easy route: skip is translated to zeros
-                //
-                if(do_debug)
-                    printf("S");
-                if (sel.cols() <= 0)
-                    one.resize(nchan,thisRawDir.nsamp);
-                else
-                    one.resize(sel.cols(),thisRawDir.nsamp);
-
-                one.setZero();
-            }
-            else
-            {
-                FiffTag::SPtr t_pTag;
-                fid->read_tag(t_pTag, thisRawDir.ent->pos);
-                //
-                //   Depending on the state of the projection and selection
-                //   we proceed a little bit differently
-                //
-                if (mult.cols() == 0)
-                {
-                    if (sel.cols() == 0)
-                    {
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_INT)
-                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_SHORT)
-                            one = cal*(Map< MatrixShort >( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else
-                            printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
-                    }
-                    else
-                    {
-
-                        //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
-                        MatrixXd newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
-
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_INT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_SHORT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixShort > ( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else
-                        {
-                            printf("Data Storage Format not known jet [2]!! Type: %d\n", t_pTag->type);
-                        }
-
-                        one = cal*newData;
-                    }
-                }
-                else
-                {
-                    if (t_pTag->type == FIFFT_DAU_PACK16)
-                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_INT)
-                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_FLOAT)
-                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else
-                        printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
-                }
-            }
             //
             //  The picking logic is a bit complicated
             //
@@ -420,10 +295,32 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
 
             if (picksamp > 0)
             {
-//                    for(r = 0; r < data->rows(); ++r)
-//                        for(c = 0; c < picksamp; ++c)
-//                            (*data)(r,dest + c) = one(r,first_pick + c);
-                data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
+                bool isSkip = thisRawDir.ent.isNull() || thisRawDir.ent->kind == -1;
+
+                if (!isSkip && m_pMemoryMap && m_pMemoryMap->contains(thisRawDir, nchan))
+                {
+                    //
+                    //   Read the picked samples straight from the mapped file,
+                    //   calibration is fused into the conversion if there is no projection
+                    //
+                    if (mult.cols() == 0)
+                    {
+                        m_pMemoryMap->read(thisRawDir, nchan, first_pick, picksamp, sel, this->cals, data, dest);
+                    }
+                    else
+                    {
+                        one.resize(nchan, picksamp);
+                        m_pMemoryMap->read(thisRawDir, nchan, first_pick, picksamp, defaultRowVectorXi, RowVectorXd(), one);
+                        data.block(0,dest,data.rows(),picksamp) = mult*one;
+                    }
+                }
+                else
+                {
+                    if (!read_raw_buffer(thisRawDir, cal, mult, sel, one) && do_debug)
+                        printf("S");
+
+                    data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
+                }
 
                 dest += picksamp;
             }
@@ -438,6 +335,10 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
         }
     }
 
+    if(mult.cols()==0)
+        multSegment = cal;
+    else
+        multSegment = mult;
 //        fclose(fid);
 
     times = MatrixXd(1, to-from+1);
@@ -451,43 +352,243 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
 
 //*************************************************************************************************************
 
-bool FiffRawData::read_raw_segment(MatrixXd& data,
-                                   MatrixXd& times,
-                                   SparseMatrix<double>& multSegment,
-                                   fiff_int_t from,
-                                   fiff_int_t to,
-                                   const RowVectorXi& sel,
-                                   bool do_debug) const
+bool FiffRawData::read_raw_segment_times(MatrixXd& data,
+                                         MatrixXd& times,
+                                         float from,
+                                         float to,
+                                         const RowVectorXi& sel) const
 {
-    bool projAvailable = true;
+    //
+    //   Convert to samples
+    //
+    from = floor(from*this->info.sfreq);
+    to   = ceil(to*this->info.sfreq);
+    //
+    //   Read it
+    //
+    return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
+}
 
-    if (this->proj.size() == 0)
-        projAvailable = false;
 
-    if(from == -1)
-        from = this->first_samp;
-    if(to == -1)
-        to = this->last_samp;
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_segments(QList<MatrixXd>& data,
+                                    const VectorXi& from,
+                                    const VectorXi& to,
+                                    const RowVectorXi& sel,
+                                    bool bUseThreads) const
+{
+    data.clear();
+
+    if(from.size() != to.size())
+    {
+        printf("The number of segment starts and ends does not match\n");
+        return false;
+    }
+
+    qint32 nchan = this->info.nchan;
+    qint32 nrows = sel.size() == 0 ? nchan : sel.size();
+    qint32 nseg = from.size();
+    qint32 i, k;
+
     //
-    //  Initial checks
+    //  Clip the segments to the available data, empty segments are left empty
     //
-    if(from < this->first_samp)
-        from = this->first_samp;
-    if(to > this->last_samp)
-        to = this->last_samp;
+    VectorXi segFrom(nseg), segTo(nseg);
+    for(i = 0; i < nseg; ++i)
+    {
+        segFrom[i] = qMax(from[i], this->first_samp);
+        segTo[i] = qMin(to[i], this->last_samp);
+
+        if(segFrom[i] <= segTo[i])
+            data.append(MatrixXd(nrows, segTo[i]-segFrom[i]+1));
+        else
+            data.append(MatrixXd());
+    }
+
     //
-    if(from > to)
+    //  Sort the segments by their first sample and assign them to the buffers overlapping them
+    //
+    QVector<QPair<fiff_int_t, qint32> > order;
+    order.reserve(nseg);
+    for(i = 0; i < nseg; ++i)
+        if(segFrom[i] <= segTo[i])
+            order.append(qMakePair(segFrom[i], i));
+    std::sort(order.begin(), order.end());
+
+    QVector<SegmentBufferTask> tasks;
+    QMap<qint32, qint32> taskIdx;
+    for(i = 0; i < order.size(); ++i)
     {
-        printf("No data in this range\n");
+        qint32 seg = order[i].second;
+        for(k = find_first_buffer(segFrom[seg]); k < this->rawdir.size() && this->rawdir[k].first <= segTo[seg]; ++k)
+        {
+            if(!taskIdx.contains(k))
+            {
+                taskIdx.insert(k, tasks.size());
+                SegmentBufferTask task;
+                task.raw = this;
+                task.buffer = k;
+                tasks.append(task);
+            }
+            tasks[taskIdx[k]].segments.append(seg);
+        }
+    }
+
+    printf("Reading %d segments from %d buffers...", order.size(), tasks.size());
+
+    if (!this->file->device()->isOpen())
+    {
+        if (!this->file->device()->open(QIODevice::ReadOnly))
+        {
+            printf("Cannot open file %s",this->info.filename.toUtf8().constData());
+        }
+    }
+
+    //
+    //  The calibration and projection are set up once for all segments
+    //
+    SparseMatrix<double> cal, mult;
+    setup_segment_mult(sel, cal, mult);
+
+    //
+    //  Each buffer writes to distinct columns of the segments, hence buffers can be processed independently
+    //
+    QVector<MatrixXd*> segData(nseg);
+    for(i = 0; i < nseg; ++i)
+        segData[i] = &data[i];
+
+    for(i = 0; i < tasks.size(); ++i)
+    {
+        tasks[i].cal = &cal;
+        tasks[i].mult = &mult;
+        tasks[i].sel = &sel;
+        tasks[i].from = &segFrom;
+        tasks[i].to = &segTo;
+        tasks[i].data = &segData;
+    }
+
+    if(bUseThreads)
+        QtConcurrent::blockingMap(tasks, &SegmentBufferTask::scatter);
+    else
+        for(i = 0; i < tasks.size(); ++i)
+            tasks[i].scatter();
+
+    printf(" [done]\n");
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_buffer(const FiffRawDir& rawDir,
+                                  const SparseMatrix<double>& cal,
+                                  const SparseMatrix<double>& mult,
+                                  const RowVectorXi& sel,
+                                  MatrixXd& one) const
+{
+    qint32 nchan = this->info.nchan;
+    bool isSkip = rawDir.ent.isNull() || rawDir.ent->kind == -1;
+
+    if (!isSkip && m_pMemoryMap && m_pMemoryMap->contains(rawDir, nchan))
+    {
+        if (mult.cols() == 0)
+        {
+            one.resize(sel.cols() == 0 ? nchan : sel.cols(), rawDir.nsamp);
+            m_pMemoryMap->read(rawDir, nchan, 0, rawDir.nsamp, sel, this->cals, one);
+        }
+        else
+        {
+            MatrixXd rawBuffer(nchan, rawDir.nsamp);
+            m_pMemoryMap->read(rawDir, nchan, 0, rawDir.nsamp, defaultRowVectorXi, RowVectorXd(), rawBuffer);
+            one = mult*rawBuffer;
+        }
+        return true;
+    }
+
+    QSharedPointer<const MatrixXd> pBuffer;
+    if (isSkip || (pBuffer = m_pBufferCache->buffer(this->file, rawDir, nchan)).isNull())
+    {
+        //
+        //  Take the easy route: skip is translated to zeros
+        //
+        if (sel.cols() <= 0)
+            one.resize(nchan,rawDir.nsamp);
+        else
+            one.resize(sel.cols(),rawDir.nsamp);
+
+        one.setZero();
         return false;
     }
-    printf("Reading %d ... %d  =  %9.3f ... %9.3f secs...", from, to, ((float)from)/this->info.sfreq, ((float)to)/this->info.sfreq);
+
     //
-    //  Initialize the data and calibration vector
+    //   Depending on the state of the projection and selection
+    //   we proceed a little bit differently
     //
+    if (mult.cols() == 0)
+    {
+        if (sel.cols() == 0)
+        {
+            one = cal*(*pBuffer);
+        }
+        else
+        {
+            MatrixXd newData(sel.cols(), rawDir.nsamp);
+
+            for(qint32 r = 0; r < sel.size(); ++r)
+                newData.row(r) = pBuffer->row(sel[r]);
+
+            one = cal*newData;
+        }
+    }
+    else
+    {
+        one = mult*(*pBuffer);
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawData::SegmentBufferTask::scatter()
+{
+    const FiffRawDir& rawDir = raw->rawdir[buffer];
+
+    MatrixXd one;
+    raw->read_raw_buffer(rawDir, *cal, *mult, *sel, one);
+
+    for(qint32 i = 0; i < segments.size(); ++i)
+    {
+        qint32 seg = segments[i];
+
+        //
+        //  Intersection of the segment with the buffer
+        //
+        fiff_int_t first = qMax((*from)[seg], rawDir.first);
+        fiff_int_t last = qMin((*to)[seg], rawDir.last);
+
+        if(last >= first)
+            (*data)[seg]->block(0, first - (*from)[seg], one.rows(), last - first + 1) = one.block(0, first - rawDir.first, one.rows(), last - first + 1);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawData::setup_segment_mult(const RowVectorXi& sel,
+                                     SparseMatrix<double>& cal,
+                                     SparseMatrix<double>& mult) const
+{
+    bool projAvailable = true;
+
+    if (this->proj.size() == 0)
+        projAvailable = false;
+
     qint32 nchan = this->info.nchan;
-    qint32 dest  = 0;//1;
-    qint32 i, k, r;
+    qint32 i, k;
 
     typedef Eigen::Triplet<double> T;
     std::vector<T> tripletList;
@@ -495,7 +596,7 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
     for(i = 0; i < nchan; ++i)
         tripletList.push_back(T(i, i, this->cals[i]));
 
-    SparseMatrix<double> cal(nchan, nchan);
+    cal = SparseMatrix<double>(nchan, nchan);
     cal.setFromTriplets(tripletList.begin(), tripletList.end());
 //    cal.makeCompressed();
 
@@ -503,8 +604,6 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
     //
     if (sel.size() == 0)
     {
-        data = MatrixXd(nchan, to-from+1);
-//            data->setZero();
         if (projAvailable || this->comp.kind != -1)
         {
             if (!projAvailable)
@@ -517,9 +616,6 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
     }
     else
     {
-        data = MatrixXd(sel.size(),to-from+1);
-//            data->setZero();
-
         MatrixXd selVect(sel.size(), nchan);
 
         selVect.setZero();
@@ -570,236 +666,43 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
             if(mult_full(i,k) != 0)
                 tripletList.push_back(T(i, k, mult_full(i,k)));
 
-    SparseMatrix<double> mult(mult_full.rows(),mult_full.cols());
+    mult = SparseMatrix<double>(mult_full.rows(),mult_full.cols());
     if(tripletList.size() > 0)
         mult.setFromTriplets(tripletList.begin(), tripletList.end());
 //    mult.makeCompressed();
 
-    //
-
-    FiffStream::SPtr fid;
-    if (!this->file->device()->isOpen())
-    {
-        if (!this->file->device()->open(QIODevice::ReadOnly))
-        {
-            printf("Cannot open file %s",this->info.filename.toUtf8().constData());
-        }
-        fid = this->file;
-    }
-    else
-    {
-        fid = this->file;
-    }
-
-    MatrixXd one;
-    fiff_int_t first_pick, last_pick, picksamp;
-    for(k = 0; k < this->rawdir.size(); ++k)
-    {
-        FiffRawDir thisRawDir = this->rawdir[k];
-        //
-        //  Do we need this buffer
-        //
-        if (thisRawDir.last > from)
-        {
-            if (thisRawDir.ent->kind == -1)
-            {
-                //
-                //  Take the easy route: skip is translated to zeros
-                //
-                if(do_debug)
-                    printf("S");
-                if (sel.cols() <= 0)
-                    one.resize(nchan,thisRawDir.nsamp);
-                else
-                    one.resize(sel.cols(),thisRawDir.nsamp);
-
-                one.setZero();
-            }
-            else
-            {
-                FiffTag::SPtr t_pTag;
-                fid->read_tag(t_pTag, thisRawDir.ent->pos);
-                //
-                //   Depending on the state of the projection and selection
-                //   we proceed a little bit differently
-                //
-                if (mult.cols() == 0)
-                {
-                    if (sel.cols() == 0)
-                    {
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_INT)
-                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_SHORT)
-                            one = cal*(Map< MatrixShort >( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else
-                            printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
-                    }
-                    else
-                    {
-
-                        //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
-                        MatrixXd newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
-
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_INT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_SHORT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixShort > ( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else
-                        {
-                            printf("Data Storage Format not known jet [2]!! Type: %d\n", t_pTag->type);
-                        }
-
-                        one = cal*newData;
-                    }
-                }
-                else
-                {
-                    if (t_pTag->type == FIFFT_DAU_PACK16)
-                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_INT)
-                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_FLOAT)
-                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else
-                        printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
-                }
-            }
-            //
-            //  The picking logic is a bit complicated
-            //
-            if (to >= thisRawDir.last && from <= thisRawDir.first)
-            {
-                //
-                //  We need the whole buffer
-                //
-                first_pick = 0;//1;
-                last_pick  = thisRawDir.nsamp - 1;
-                if (do_debug)
-                    printf("W");
-            }
-            else if (from > thisRawDir.first)
-            {
-                first_pick = from - thisRawDir.first;// + 1;
-                if(to < thisRawDir.last)
-                {
-                    //
-                    //  Something from the middle
-                    //
-//                    qDebug() << "This needs to be debugged!";
-                    last_pick = thisRawDir.nsamp + to - thisRawDir.last - 1;//is this alright?
-                    if (do_debug)
-                        printf("M");
-                }
-                else
-                {
-                    //
-                    //  From the middle to the end
-                    //
-                    last_pick = thisRawDir.nsamp - 1;
-                    if (do_debug)
-                        printf("E");
-                }
-            }
-            else
-            {
-                //
-                //  From the beginning to the middle
-                //
-                first_pick = 0;//1;
-                last_pick  = to - thisRawDir.first;// + 1;
-                if (do_debug)
-                    printf("B");
-            }
-            //
-            //  Now we are ready to pick
-            //
-            picksamp = last_pick - first_pick + 1;
-
-            if(do_debug)
-            {
-                qDebug() << "first_pick: " << first_pick;
-                qDebug() << "last_pick: " << last_pick;
-                qDebug() << "picksamp: " << picksamp;
-            }
+}
 
-            if (picksamp > 0)
-            {
-//                    for(r = 0; r < data->rows(); ++r)
-//                        for(c = 0; c < picksamp; ++c)
-//                            (*data)(r,dest + c) = one(r,first_pick + c);
-                data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
 
-                dest += picksamp;
-            }
-        }
-        //
-        //  Done?
-        //
-        if (thisRawDir.last >= to)
-        {
-            printf(" [done]\n");
-            break;
-        }
-    }
+//*************************************************************************************************************
 
-    if(mult.cols()==0)
-        multSegment = cal;
+bool FiffRawData::setMemoryMapped(bool bMapped)
+{
+    if(bMapped && !this->file.isNull())
+        m_pMemoryMap = FiffRawMemoryMap::create(this->file->device());
     else
-        multSegment = mult;
-//        fclose(fid);
-
-    times = MatrixXd(1, to-from+1);
-
-    for (i = 0; i < times.cols(); ++i)
-        times(0, i) = ((float)(from+i)) / this->info.sfreq;
+        m_pMemoryMap.clear();
 
-    return true;
+    return !m_pMemoryMap.isNull();
 }
 
 
 //*************************************************************************************************************
 
-bool FiffRawData::read_raw_segment_times(MatrixXd& data,
-                                         MatrixXd& times,
-                                         float from,
-                                         float to,
-                                         const RowVectorXi& sel) const
+qint32 FiffRawData::find_first_buffer(fiff_int_t from) const
 {
     //
-    //   Convert to samples
-    //
-    from = floor(from*this->info.sfreq);
-    to   = ceil(to*this->info.sfreq);
+    //  Binary search for the first buffer with last >= from
     //
-    //   Read it
-    //
-    return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
+    qint32 lower = 0;
+    qint32 upper = this->rawdir.size();
+    while(lower < upper)
+    {
+        qint32 mid = lower + (upper - lower) / 2;
+        if(this->rawdir[mid].last >= from)
+            upper = mid;
+        else
+            lower = mid + 1;
+    }
+    return lower;
 }
@@ -44,6 +44,8 @@
 #include "fiff_global.h"
 #include "fiff_info.h"
 #include "fiff_raw_dir.h"
+#include "fiff_raw_buffer_cache.h"
+#include "fiff_raw_memory_map.h"
 #include "fiff_stream.h"
 
 
@@ -205,6 +207,107 @@ public:
                                 float to,
                                 const RowVectorXi& sel = defaultRowVectorXi) const;
 
+    //=========================================================================================================
+    /**
+    * Reads several raw data segments at once, e.g. the epochs around a list of events. Each raw data buffer is
+    * read and calibrated only once and scattered into all segments overlapping it, and the calibration and
+    * projection operator is set up only once for all segments. Segments are clipped to the available data.
+    *
+    * @param[out] data          returns the data matrices (channels x samples), one per segment in the order of from/to.
+    *                           Segments without any available data are returned as empty matrices.
+    * @param[in] from           first sample of each segment.
+    * @param[in] to             last sample of each segment.
+    * @param[in] sel            channel selection vector (optional)
+    * @param[in] bUseThreads    whether to process the raw data buffers in parallel (optional)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool read_raw_segments(QList<MatrixXd>& data,
+                           const VectorXi& from,
+                           const VectorXi& to,
+                           const RowVectorXi& sel = defaultRowVectorXi,
+                           bool bUseThreads = false) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the cache of decoded raw data buffers used by read_raw_segment. The cache is shared with all
+    * copies of this raw data object. Use FiffRawBufferCache::setMaxSize to resize or disable it.
+    *
+    * @return the raw data buffer cache.
+    */
+    inline FiffRawBufferCache::SPtr bufferCache() const
+    {
+        return m_pBufferCache;
+    }
+
+    //=========================================================================================================
+    /**
+    * Enables or disables memory mapped reading. If enabled, read_raw_segment reads the raw data buffers
+    * straight from the mapped file, fusing byte order conversion and calibration into one pass into the output
+    * matrix, instead of going through FiffStream::read_tag and the buffer cache. Mapping is only possible for
+    * file devices; memory mapped reading is enabled by default if the file could be mapped.
+    *
+    * @param[in] bMapped    Whether to read the raw data buffers from a memory mapped file.
+    *
+    * @return true if memory mapped reading is active, false otherwise.
+    */
+    bool setMemoryMapped(bool bMapped);
+
+    //=========================================================================================================
+    /**
+    * Returns whether the raw data buffers are read from a memory mapped file.
+    *
+    * @return true if memory mapped reading is active, false otherwise.
+    */
+    inline bool isMemoryMapped() const
+    {
+        return !m_pMemoryMap.isNull();
+    }
+
+private:
+    //=========================================================================================================
+    /**
+    * Looks up the first raw directory entry which is needed to read data starting at sample from. The entries
+    * of rawdir hold cumulative first/last samples in ascending order, which allows for a binary search.
+    *
+    * @param[in] from       first sample to include.
+    *
+    * @return the index of the first needed raw directory entry, rawdir.size() if there is none.
+    */
+    qint32 find_first_buffer(fiff_int_t from) const;
+
+    //=========================================================================================================
+    /**
+    * Sets up the calibration and the combined projection/compensation/calibration operator used to read data.
+    *
+    * @param[in] sel        channel selection vector.
+    * @param[out] cal       the calibration matrix of the selected channels.
+    * @param[out] mult      the combined operator, empty if neither projection nor compensation is active.
+    */
+    void setup_segment_mult(const RowVectorXi& sel,
+                            SparseMatrix<double>& cal,
+                            SparseMatrix<double>& mult) const;
+
+    //=========================================================================================================
+    /**
+    * Reads a whole raw data buffer and applies the calibration or the combined operator to it.
+    *
+    * @param[in] rawDir     the raw directory entry of the buffer.
+    * @param[in] cal        the calibration matrix as set up by setup_segment_mult.
+    * @param[in] mult       the combined operator as set up by setup_segment_mult.
+    * @param[in] sel        channel selection vector.
+    * @param[out] one       the calibrated buffer (channels x samples).
+    *
+    * @return true if the buffer was read, false if it was a skip or could not be read and was set to zero.
+    */
+    bool read_raw_buffer(const FiffRawDir& rawDir,
+                         const SparseMatrix<double>& cal,
+                         const SparseMatrix<double>& mult,
+                         const RowVectorXi& sel,
+                         MatrixXd& one) const;
+
+    struct SegmentBufferTask;   /**< Scatters one raw data buffer into all segments overlapping it. */
+
 public:
     FiffStream::SPtr file;      /**< replaces fid */
     FiffInfo info;              /**< Fiff measurement information */
@@ -214,6 +317,10 @@ public:
     QList<FiffRawDir> rawdir;   /**< Special fiff diretory entry for raw data. */
     MatrixXd proj;              /**< SSP operator to apply to the data. */
     FiffCtfComp comp;           /**< Compensator. */
+
+private:
+    FiffRawBufferCache::SPtr m_pBufferCache;    /**< LRU cache of decoded raw data buffers. */
+    FiffRawMemoryMap::SPtr m_pMemoryMap;        /**< Memory map of the raw data file, null if buffers are read via the stream. */
 };
 
 } // NAMESPACE
@@ -0,0 +1,239 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_memory_map.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Definition of the FiffRawMemoryMap Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_raw_memory_map.h"
+#include "fiff_file.h"
+
+#include <cstring>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QFileDevice>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE STATIC FUNCTIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Reads one big endian sample of type T from the mapped memory.
+*/
+template<typename T>
+inline double readSample(const uchar* p_pSrc);
+
+template<>
+inline double readSample<qint16>(const uchar* p_pSrc)
+{
+    return qFromBigEndian<qint16>(p_pSrc);
+}
+
+template<>
+inline double readSample<qint32>(const uchar* p_pSrc)
+{
+    return qFromBigEndian<qint32>(p_pSrc);
+}
+
+template<>
+inline double readSample<float>(const uchar* p_pSrc)
+{
+    quint32 bits = qFromBigEndian<quint32>(p_pSrc);
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+
+//=============================================================================================================
+/**
+* Fused byte order conversion, channel selection and calibration of a block of samples.
+*/
+template<typename T>
+void convertSamples(const uchar* p_pPayload,
+                    fiff_int_t nchan,
+                    fiff_int_t first_pick,
+                    fiff_int_t picksamp,
+                    const RowVectorXi& sel,
+                    const RowVectorXd& cals,
+                    MatrixXd& dest,
+                    fiff_int_t destCol)
+{
+    const bool bSelect = sel.size() > 0;
+    const bool bCalibrate = cals.size() > 0;
+    const qint32 nrows = bSelect ? sel.size() : nchan;
+
+    for(qint32 c = 0; c < picksamp; ++c) {
+        const uchar* pSample = p_pPayload + (qint64)(first_pick + c) * nchan * sizeof(T);
+        double* pDest = dest.data() + (qint64)(destCol + c) * dest.rows();
+
+        for(qint32 r = 0; r < nrows; ++r) {
+            const qint32 ch = bSelect ? sel[r] : r;
+            const double value = readSample<T>(pSample + ch * sizeof(T));
+            pDest[r] = bCalibrate ? cals[ch] * value : value;
+        }
+    }
+}
+
+} // NAMESPACE
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawMemoryMap::FiffRawMemoryMap(QFileDevice* p_pFileDevice, uchar* p_pData, qint64 size)
+: m_pFileDevice(p_pFileDevice)
+, m_pData(p_pData)
+, m_iSize(size)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+FiffRawMemoryMap::~FiffRawMemoryMap()
+{
+    if(m_pFileDevice) {
+        m_pFileDevice->unmap(m_pData);
+    }
+}
+
+
+//*************************************************************************************************************
+
+FiffRawMemoryMap::SPtr FiffRawMemoryMap::create(QIODevice* p_pIODevice)
+{
+    QFileDevice* pFileDevice = qobject_cast<QFileDevice*>(p_pIODevice);
+    if(!pFileDevice) {
+        return FiffRawMemoryMap::SPtr();
+    }
+
+    if(!pFileDevice->isOpen() && !pFileDevice->open(QIODevice::ReadOnly)) {
+        return FiffRawMemoryMap::SPtr();
+    }
+
+    qint64 size = pFileDevice->size();
+    uchar* pData = size > 0 ? pFileDevice->map(0, size) : 0;
+
+    if(!pData) {
+        return FiffRawMemoryMap::SPtr();
+    }
+
+    return FiffRawMemoryMap::SPtr(new FiffRawMemoryMap(pFileDevice, pData, size));
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawMemoryMap::contains(const FiffRawDir& p_RawDir, fiff_int_t nchan) const
+{
+    if(!m_pFileDevice || p_RawDir.ent.isNull() || p_RawDir.ent->kind != FIFF_DATA_BUFFER) {
+        return false;
+    }
+
+    qint64 sampleSize;
+    switch(p_RawDir.ent->type) {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            sampleSize = 2;
+            break;
+        case FIFFT_INT:
+        case FIFFT_FLOAT:
+            sampleSize = 4;
+            break;
+        default:
+            return false;
+    }
+
+    qint64 payloadSize = (qint64)nchan * p_RawDir.nsamp * sampleSize;
+    qint64 payloadStart = (qint64)p_RawDir.ent->pos + FIFFC_DATA_OFFSET;
+
+    return payloadSize <= p_RawDir.ent->size
+            && p_RawDir.ent->pos >= 0
+            && payloadStart + payloadSize <= m_iSize;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawMemoryMap::read(const FiffRawDir& p_RawDir,
+                            fiff_int_t nchan,
+                            fiff_int_t first_pick,
+                            fiff_int_t picksamp,
+                            const RowVectorXi& sel,
+                            const RowVectorXd& cals,
+                            MatrixXd& dest,
+                            fiff_int_t destCol) const
+{
+    switch(p_RawDir.ent->type) {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            convertSamples<qint16>(payload(p_RawDir), nchan, first_pick, picksamp, sel, cals, dest, destCol);
+            break;
+        case FIFFT_INT:
+            convertSamples<qint32>(payload(p_RawDir), nchan, first_pick, picksamp, sel, cals, dest, destCol);
+            break;
+        case FIFFT_FLOAT:
+            convertSamples<float>(payload(p_RawDir), nchan, first_pick, picksamp, sel, cals, dest, destCol);
+            break;
+        default:
+            printf("Data Storage Format not known jet!! Type: %d\n", p_RawDir.ent->type);
+    }
+}
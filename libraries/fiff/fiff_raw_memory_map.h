@@ -0,0 +1,217 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_memory_map.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffRawMemoryMap class declaration.
+*
+*/
+
+#ifndef FIFF_RAW_MEMORY_MAP_H
+#define FIFF_RAW_MEMORY_MAP_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+#include "fiff_constants.h"
+#include "fiff_raw_dir.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QPointer>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class QIODevice;
+class QFileDevice;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+
+//=============================================================================================================
+/**
+* Memory mapped access to the raw data buffers of a fif file. The buffers are read straight from the mapped
+* file, i.e. without allocating a FiffTag and without a separate byte order conversion pass. Byte swapping,
+* channel selection and calibration are fused into a single pass which writes into the caller's matrix.
+*
+* @brief Memory mapped raw data buffer reader.
+*/
+class FIFFSHARED_EXPORT FiffRawMemoryMap
+{
+public:
+    typedef QSharedPointer<FiffRawMemoryMap> SPtr;              /**< Shared pointer type for FiffRawMemoryMap. */
+    typedef QSharedPointer<const FiffRawMemoryMap> ConstSPtr;   /**< Const shared pointer type for FiffRawMemoryMap. */
+
+    //=========================================================================================================
+    /**
+    * Maps the whole file behind the given device into memory. The device is opened read only if it is not
+    * open yet and is left open. The mapping stays valid until this object or the device is destroyed.
+    *
+    * @param[in] p_pIODevice    The device to map. Only file devices can be mapped.
+    *
+    * @return the memory map, or a null pointer if the device could not be mapped.
+    */
+    static FiffRawMemoryMap::SPtr create(QIODevice* p_pIODevice);
+
+    //=========================================================================================================
+    /**
+    * Destroys the memory map and unmaps the file.
+    */
+    ~FiffRawMemoryMap();
+
+    //=========================================================================================================
+    /**
+    * Checks whether a raw data buffer can be read from the mapped file, i.e. whether it is a supported data
+    * buffer (FIFFT_DAU_PACK16, FIFFT_SHORT, FIFFT_INT or FIFFT_FLOAT) and whether it lies within the mapping.
+    *
+    * @param[in] p_RawDir       The raw directory entry of the buffer.
+    * @param[in] nchan          The number of channels stored in the buffer.
+    *
+    * @return true if the buffer can be read, false otherwise.
+    */
+    bool contains(const FiffRawDir& p_RawDir, fiff_int_t nchan) const;
+
+    //=========================================================================================================
+    /**
+    * Returns a view (channels x samples) on the payload of a raw data buffer. The elements are stored in file
+    * byte order (big endian), i.e. the view can only be used directly on big endian hosts. The element type T
+    * has to match the storage type of the buffer.
+    *
+    * @param[in] p_RawDir       The raw directory entry of the buffer. The buffer has to be contained in the map.
+    * @param[in] nchan          The number of channels stored in the buffer.
+    *
+    * @return the view on the mapped payload.
+    */
+    template<typename T>
+    inline Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> > view(const FiffRawDir& p_RawDir,
+                                                                                   fiff_int_t nchan) const;
+
+    //=========================================================================================================
+    /**
+    * Reads samples of a raw data buffer into dest. Byte order conversion, channel selection and calibration
+    * are done in one pass: dest(r, destCol + c) = cals[ch(r)] * buffer(ch(r), first_pick + c).
+    *
+    * @param[in] p_RawDir       The raw directory entry of the buffer. The buffer has to be contained in the map.
+    * @param[in] nchan          The number of channels stored in the buffer.
+    * @param[in] first_pick     The first sample within the buffer to read.
+    * @param[in] picksamp       The number of samples to read.
+    * @param[in] sel            The channels to read. If empty all channels are read.
+    * @param[in] cals           The calibration factor for each of the nchan channels. If empty no calibration is applied.
+    * @param[out] dest          The destination matrix, has to be large enough to hold the samples.
+    * @param[in] destCol        The column of dest to start writing at.
+    */
+    void read(const FiffRawDir& p_RawDir,
+              fiff_int_t nchan,
+              fiff_int_t first_pick,
+              fiff_int_t picksamp,
+              const Eigen::RowVectorXi& sel,
+              const Eigen::RowVectorXd& cals,
+              Eigen::MatrixXd& dest,
+              fiff_int_t destCol = 0) const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Constructs the memory map of an already mapped file.
+    *
+    * @param[in] p_pFileDevice  The mapped file device.
+    * @param[in] p_pData        The mapped memory.
+    * @param[in] size           The size of the mapped memory in bytes.
+    */
+    FiffRawMemoryMap(QFileDevice* p_pFileDevice, uchar* p_pData, qint64 size);
+
+    //=========================================================================================================
+    /**
+    * Returns the payload of a raw data buffer within the mapping.
+    *
+    * @param[in] p_RawDir       The raw directory entry of the buffer.
+    *
+    * @return the first byte of the payload.
+    */
+    inline const uchar* payload(const FiffRawDir& p_RawDir) const;
+
+    QPointer<QFileDevice>   m_pFileDevice;  /**< The mapped file device. */
+    uchar*                  m_pData;        /**< The mapped memory. */
+    qint64                  m_iSize;        /**< The size of the mapped memory in bytes. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+template<typename T>
+inline Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> > FiffRawMemoryMap::view(const FiffRawDir& p_RawDir,
+                                                                                                  fiff_int_t nchan) const
+{
+    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> >(reinterpret_cast<const T*>(payload(p_RawDir)),
+                                                                              nchan,
+                                                                              p_RawDir.nsamp);
+}
+
+
+//*************************************************************************************************************
+
+inline const uchar* FiffRawMemoryMap::payload(const FiffRawDir& p_RawDir) const
+{
+    return m_pData + (qint64)p_RawDir.ent->pos + FIFFC_DATA_OFFSET;
+}
+
+} // NAMESPACE
+
+#endif // FIFF_RAW_MEMORY_MAP_H
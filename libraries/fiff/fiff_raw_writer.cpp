@@ -0,0 +1,277 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_writer.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Definition of the FiffRawWriter Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_raw_writer.h"
+#include "fiff_constants.h"
+#include "fiff_file.h"
+
+#include <cmath>
+#include <cstring>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawWriter::FiffRawWriter(FiffStream::SPtr p_pStream,
+                             const RowVectorXd& cals,
+                             qint32 iQueueSize,
+                             bool bPackDau16,
+                             QObject* parent)
+: QThread(parent)
+, m_pStream(p_pStream)
+, m_bPackDau16(bPackDau16)
+, m_qVecSlots(qMax(iQueueSize, 2))
+, m_iHead(0)
+, m_iCount(0)
+, m_bIsRunning(true)
+{
+    memset(&m_stats, 0, sizeof(FiffRawWriterStats));
+
+    if(cals.size() > 0) {
+        m_vecInvCals = cals.cwiseInverse();
+    }
+
+    start();
+}
+
+
+//*************************************************************************************************************
+
+FiffRawWriter::~FiffRawWriter()
+{
+    stop();
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawWriter::write_raw_buffer(const MatrixXd& buf)
+{
+    if(m_vecInvCals.size() > 0 && buf.rows() != m_vecInvCals.size()) {
+        printf("buffer and calibration sizes do not match\n");
+        return false;
+    }
+
+    QMutexLocker locker(&m_qMutex);
+
+    if(m_iCount == m_qVecSlots.size() && m_bIsRunning) {
+        QElapsedTimer timer;
+        timer.start();
+
+        while(m_iCount == m_qVecSlots.size() && m_bIsRunning) {
+            m_qNotFull.wait(&m_qMutex);
+        }
+
+        qint64 iNsecs = timer.nsecsElapsed();
+        ++m_stats.iStalls;
+        m_stats.iStallNsecs += iNsecs;
+        m_stats.iMaxStallNsecs = qMax(m_stats.iMaxStallNsecs, iNsecs);
+    }
+
+    if(!m_bIsRunning) {
+        return false;
+    }
+
+    //The slot keeps its allocation as long as the buffer size does not change
+    m_qVecSlots[(m_iHead + m_iCount) % m_qVecSlots.size()] = buf;
+    ++m_iCount;
+
+    ++m_stats.iBuffersQueued;
+    m_stats.iMaxQueued = qMax(m_stats.iMaxQueued, m_iCount);
+
+    m_qNotEmpty.wakeOne();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::flush()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    while(m_iCount > 0 && isRunning()) {
+        m_qNotFull.wait(&m_qMutex);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::stop()
+{
+    m_qMutex.lock();
+    m_bIsRunning = false;
+    m_qNotEmpty.wakeAll();
+    m_qNotFull.wakeAll();
+    m_qMutex.unlock();
+
+    wait();
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::finish_writing_raw()
+{
+    stop();
+
+    if(m_pStream) {
+        m_pStream->finish_writing_raw();
+    }
+}
+
+
+//*************************************************************************************************************
+
+FiffRawWriterStats FiffRawWriter::stats() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_stats;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::run()
+{
+    forever {
+        m_qMutex.lock();
+
+        while(m_iCount == 0 && m_bIsRunning) {
+            m_qNotEmpty.wait(&m_qMutex);
+        }
+
+        //Pending buffers are written before the thread stops
+        if(m_iCount == 0) {
+            m_qMutex.unlock();
+            break;
+        }
+
+        m_qMutex.unlock();
+
+        //The slot at m_iHead is not touched by the producer until it is freed below
+        writeBuffer(m_qVecSlots.at(m_iHead));
+
+        m_qMutex.lock();
+        m_iHead = (m_iHead + 1) % m_qVecSlots.size();
+        --m_iCount;
+        m_qNotFull.wakeAll();
+        m_qMutex.unlock();
+    }
+
+    //Wake up flush calls waiting for an empty queue
+    m_qMutex.lock();
+    m_qNotFull.wakeAll();
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::writeBuffer(const MatrixXd& buf)
+{
+    if(!m_pStream) {
+        return;
+    }
+
+    const bool bCalibrate = m_vecInvCals.size() > 0;
+    qint64 iClipped = 0;
+    qint64 iBytes;
+
+    if(m_bPackDau16) {
+        m_matDau16.resize(buf.rows(), buf.cols());
+
+        for(qint32 c = 0; c < buf.cols(); ++c) {
+            for(qint32 r = 0; r < buf.rows(); ++r) {
+                double value = bCalibrate ? buf(r,c) * m_vecInvCals[r] : buf(r,c);
+                value = std::floor(value + 0.5);
+
+                if(value > 32767.0) {
+                    value = 32767.0;
+                    ++iClipped;
+                } else if(value < -32768.0) {
+                    value = -32768.0;
+                    ++iClipped;
+                }
+
+                m_matDau16(r,c) = (fiff_dau_pack16_t)value;
+            }
+        }
+
+        m_pStream->write_dau_pack16(FIFF_DATA_BUFFER, m_matDau16.data(), m_matDau16.size());
+        iBytes = m_matDau16.size() * sizeof(fiff_dau_pack16_t);
+    } else {
+        if(bCalibrate) {
+            m_matFloat = (m_vecInvCals.asDiagonal() * buf).cast<float>();
+        } else {
+            m_matFloat = buf.cast<float>();
+        }
+
+        m_pStream->write_float(FIFF_DATA_BUFFER, m_matFloat.data(), m_matFloat.size());
+        iBytes = m_matFloat.size() * sizeof(float);
+    }
+
+    QMutexLocker locker(&m_qMutex);
+    ++m_stats.iBuffersWritten;
+    m_stats.iBytesWritten += iBytes;
+    m_stats.iClippedSamples += iClipped;
+}
@@ -0,0 +1,236 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_writer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffRawWriter class declaration.
+*
+*/
+
+#ifndef FIFF_RAW_WRITER_H
+#define FIFF_RAW_WRITER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+#include "fiff_stream.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+
+//=============================================================================================================
+/**
+* Statistics of a FiffRawWriter. The producer is stalled whenever the queue is full, i.e. whenever the disk
+* can not keep up with the acquisition.
+*
+* @brief Back-pressure statistics of a FiffRawWriter.
+*/
+struct FiffRawWriterStats
+{
+    qint64  iBuffersQueued;     /**< Number of buffers handed to the writer. */
+    qint64  iBuffersWritten;    /**< Number of buffers written to the stream. */
+    qint64  iBytesWritten;      /**< Number of data bytes written to the stream. */
+    qint64  iStalls;            /**< Number of times the producer had to wait for a free slot. */
+    qint64  iStallNsecs;        /**< Total time the producer waited for free slots in nanoseconds. */
+    qint64  iMaxStallNsecs;     /**< Longest single wait for a free slot in nanoseconds. */
+    qint64  iClippedSamples;    /**< Number of samples which exceeded the 16-bit range when packing. */
+    qint32  iMaxQueued;         /**< Highest number of buffers waiting to be written. */
+};
+
+
+//=============================================================================================================
+/**
+* Asynchronous raw data writer. Buffers handed to write_raw_buffer are copied into a bounded queue of
+* preallocated slots and written to the stream by a dedicated flush thread, so the acquisition thread does not
+* block on disk I/O. Calibration and the optional packing to FIFFT_DAU_PACK16 are done on the flush thread as
+* well. If the queue is full write_raw_buffer waits for a free slot; these stalls are reported by stats().
+*
+* The stream has to be set up with FiffStream::start_writing_raw. While the writer is running the stream must
+* not be used by anybody else; call finish_writing_raw (or stop) before writing further tags.
+*
+* @brief Asynchronous raw data writer with a background flush thread.
+*/
+class FIFFSHARED_EXPORT FiffRawWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    typedef QSharedPointer<FiffRawWriter> SPtr;             /**< Shared pointer type for FiffRawWriter. */
+    typedef QSharedPointer<const FiffRawWriter> ConstSPtr;  /**< Const shared pointer type for FiffRawWriter. */
+
+    //=========================================================================================================
+    /**
+    * Constructs the writer and starts the flush thread.
+    *
+    * @param[in] p_pStream      The stream to write to, as returned by FiffStream::start_writing_raw.
+    * @param[in] cals           The calibration factors returned by FiffStream::start_writing_raw. Buffers are
+    *                           divided by them before they are written. If empty, buffers are written as they are.
+    * @param[in] iQueueSize     The number of buffer slots, at least 2 (double buffering).
+    * @param[in] bPackDau16     Whether to write the buffers as FIFFT_DAU_PACK16 instead of FIFFT_FLOAT. The
+    *                           calibrated values are rounded and clipped to the 16-bit range.
+    * @param[in] parent         Parent QObject (optional).
+    */
+    FiffRawWriter(FiffStream::SPtr p_pStream,
+                  const Eigen::RowVectorXd& cals = Eigen::RowVectorXd(),
+                  qint32 iQueueSize = 2,
+                  bool bPackDau16 = false,
+                  QObject* parent = 0);
+
+    //=========================================================================================================
+    /**
+    * Destroys the writer. Pending buffers are written, the raw data file is not finished.
+    */
+    ~FiffRawWriter();
+
+    //=========================================================================================================
+    /**
+    * Queues a raw data buffer (channels x samples) for writing. The buffer is copied into a free slot, if all
+    * slots are taken the call waits until the flush thread has written one of them.
+    *
+    * @param[in] buf        The buffer to write.
+    *
+    * @return true if the buffer was queued, false if the writer was stopped or the sizes do not match.
+    */
+    bool write_raw_buffer(const Eigen::MatrixXd& buf);
+
+    //=========================================================================================================
+    /**
+    * Waits until all queued buffers are written to the stream.
+    */
+    void flush();
+
+    //=========================================================================================================
+    /**
+    * Writes all queued buffers and stops the flush thread. The stream can be used again afterwards.
+    */
+    void stop();
+
+    //=========================================================================================================
+    /**
+    * Writes all queued buffers, stops the flush thread and finishes the raw data file
+    * (see FiffStream::finish_writing_raw).
+    */
+    void finish_writing_raw();
+
+    //=========================================================================================================
+    /**
+    * Returns the back-pressure statistics.
+    *
+    * @return the current statistics.
+    */
+    FiffRawWriterStats stats() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the stream the buffers are written to.
+    *
+    * @return the stream.
+    */
+    inline FiffStream::SPtr stream() const;
+
+protected:
+    //=========================================================================================================
+    /**
+    * The flush loop. Takes the oldest queued buffer, converts and writes it, and frees its slot.
+    */
+    virtual void run();
+
+private:
+    //=========================================================================================================
+    /**
+    * Converts a buffer to the storage type and writes it as FIFF_DATA_BUFFER tag.
+    *
+    * @param[in] buf        The buffer to write.
+    */
+    void writeBuffer(const Eigen::MatrixXd& buf);
+
+    FiffStream::SPtr            m_pStream;          /**< The stream to write to. */
+    Eigen::RowVectorXd          m_vecInvCals;       /**< The inverse calibration factors, empty if not calibrated. */
+    bool                        m_bPackDau16;       /**< Whether to write FIFFT_DAU_PACK16 instead of FIFFT_FLOAT. */
+
+    QVector<Eigen::MatrixXd>    m_qVecSlots;        /**< The preallocated buffer slots. */
+    qint32                      m_iHead;            /**< Slot of the oldest queued buffer. */
+    qint32                      m_iCount;           /**< Number of queued buffers. */
+    bool                        m_bIsRunning;       /**< Whether the writer accepts buffers. */
+
+    mutable QMutex              m_qMutex;           /**< Guards the queue and the statistics. */
+    QWaitCondition              m_qNotEmpty;        /**< Signaled when a buffer was queued or the writer stopped. */
+    QWaitCondition              m_qNotFull;         /**< Signaled when a slot was freed. */
+
+    FiffRawWriterStats          m_stats;            /**< The back-pressure statistics. */
+
+    Eigen::MatrixXf             m_matFloat;         /**< Conversion buffer for FIFFT_FLOAT. */
+    Eigen::Matrix<fiff_dau_pack16_t, Eigen::Dynamic, Eigen::Dynamic> m_matDau16;   /**< Conversion buffer for FIFFT_DAU_PACK16. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline FiffStream::SPtr FiffRawWriter::stream() const
+{
+    return m_pStream;
+}
+
+} // NAMESPACE
+
+#endif // FIFF_RAW_WRITER_H
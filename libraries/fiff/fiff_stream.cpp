@@ -2624,6 +2624,26 @@ fiff_long_t FiffStream::write_double(fiff_int_t kind, const double* data, fiff_i
 }
 
 
+//*************************************************************************************************************
+
+fiff_long_t FiffStream::write_dau_pack16(fiff_int_t kind, const fiff_dau_pack16_t* data, fiff_int_t nel)
+{
+    fiff_long_t pos = this->device()->pos();
+
+    qint32 datasize = nel * 2;
+
+    *this << (qint32)kind;
+    *this << (qint32)FIFFT_DAU_PACK16;
+    *this << (qint32)datasize;
+    *this << (qint32)FIFFV_NEXT_SEQ;
+
+    for(qint32 i = 0; i < nel; ++i)
+        *this << data[i];
+
+    return pos;
+}
+
+
 //*************************************************************************************************************
 
 fiff_long_t FiffStream::write_float(fiff_int_t kind, const float* data, fiff_int_t nel)
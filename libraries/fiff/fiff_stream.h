@@ -703,6 +703,18 @@ public:
     */
     fiff_long_t write_int_matrix(fiff_int_t kind, const MatrixXi& mat);
 
+    //=========================================================================================================
+    /**
+    * Writes a packed 16-bit integer tag (FIFFT_DAU_PACK16) to a fif file
+    *
+    * @param[in] kind       Tag kind
+    * @param[in] data       The packed data pointer
+    * @param[in] nel        Number of 16-bit integers to write (default = 1)
+    *
+    * @return the position where the packed data was written to
+    */
+    fiff_long_t write_dau_pack16(fiff_int_t kind, const fiff_dau_pack16_t* data, fiff_int_t nel = 1);
+
     //=========================================================================================================
     /**
     * Writes a single-precision floating point tag to a fif file
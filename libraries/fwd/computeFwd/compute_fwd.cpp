@@ -1974,6 +1974,14 @@ void ComputeFwd::calculateFwd() const
 
             eeg_model->scale_pos = settings->scale_eeg_pos;
             VEC_COPY_41(eeg_model->r0,settings->r0);
+            /*
+             * Without the equivalent sources the series coefficients have to be ready before the threads start
+             */
+            if (!settings->use_equiv_eeg) {
+                eeg_model->fwd_eeg_setup_multi_sphere_coeff();
+                if (settings->use_eeg_table && !eeg_model->fwd_eeg_setup_pot_table())
+                    goto out;
+            }
 
             printf("\n");
         }
@@ -113,6 +113,7 @@ void ComputeFwdSettings::initMembers()
     eeg_sphere_rad = 0.09f;   
     scale_eeg_pos = false;    
     use_equiv_eeg = true;     
+    use_eeg_table = false;
     use_threads = true;       
 
 }
@@ -141,6 +142,8 @@ void ComputeFwdSettings::usage(char *name)
     fprintf(stderr,"\t--eegmodels name  read EEG sphere model specifications from here.\n");
     fprintf(stderr,"\t--eegmodel  name  name of the EEG sphere model to use (default : Default)\n");
     fprintf(stderr,"\t--eegrad rad/mm   radius of the scalp surface to use in EEG sphere model (default : %7.1f mm)\n",1000*eeg_sphere_rad);
+    fprintf(stderr,"\t--noequiv         evaluate the series expansion of the EEG sphere model instead of using equivalent sources\n");
+    fprintf(stderr,"\t--eegtable        with --noequiv, interpolate the series expansion from a precomputed table\n");
     fprintf(stderr,"\t--mindist dist/mm minimum allowable distance of the sources from the inner skull surface.\n");
     fprintf(stderr,"\t--mindistout name Output the omitted source space points here.\n");
     fprintf(stderr,"\t--includeall      Omit all source space checks\n");
@@ -330,6 +333,14 @@ bool ComputeFwdSettings::check_args (int *argc,char **argv)
             found         = 1;
             scale_eeg_pos = true;
         }
+        else if (strcmp(argv[k],"--noequiv") == 0) {
+            found         = 1;
+            use_equiv_eeg = false;
+        }
+        else if (strcmp(argv[k],"--eegtable") == 0) {
+            found         = 1;
+            use_eeg_table = true;
+        }
         else if (strcmp(argv[k],"--mindist") == 0) {
             found = 2;
             if (k == *argc - 1) {
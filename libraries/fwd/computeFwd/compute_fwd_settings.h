@@ -145,6 +145,7 @@ public:
     float eeg_sphere_rad;   	/**< Scalp radius to use in EEG sphere model */
     bool scale_eeg_pos;     	/**< Scale the electrode locations to scalp in the sphere model */
     bool use_equiv_eeg;      	/**< Use the equivalent source approach for the EEG sphere model */
+    bool use_eeg_table;      	/**< Interpolate the series of the EEG sphere model from a table */
     bool use_threads;        	/**< Parallelize? */
 
 private:
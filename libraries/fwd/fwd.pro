@@ -89,7 +89,9 @@ SOURCES += \
     fwd_bem_solution.cpp \
     fwd_coil.cpp \
     fwd_coil_set.cpp \
+    fwd_coil_points.cpp \
     fwd_comp_data.cpp \
+    fwd_eeg_pot_table.cpp \
     fwd_eeg_sphere_layer.cpp \
     fwd_eeg_sphere_model.cpp \
     fwd_eeg_sphere_model_set.cpp \
@@ -103,7 +105,9 @@ HEADERS +=\
     fwd_bem_solution.h \
     fwd_coil.h \
     fwd_coil_set.h \
+    fwd_coil_points.h \
     fwd_comp_data.h \
+    fwd_eeg_pot_table.h \
     fwd_eeg_sphere_layer.h \
     fwd_eeg_sphere_model.h \
     fwd_eeg_sphere_model_set.h \
@@ -46,15 +46,23 @@
 #include <mne/c/mne_source_space_old.h>
 
 #include "fwd_comp_data.h"
+#include "fwd_coil_points.h"
 #include "fwd_bem_model.h"
 
 #include "fwd_thread_arg.h"
 
 #include <fiff/fiff_stream.h>
+#include <utils/ioutils.h>
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QList>
+#include <QSaveFile>
 #include <QThread>
+#include <QThreadPool>
 #include <QtConcurrent>
 
 #define _USE_MATH_DEFINES
@@ -62,6 +70,10 @@
 
 #include <Eigen/Dense>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 static float Qx[] = {1.0,0.0,0.0};
 static float Qy[] = {0.0,1.0,0.0};
@@ -212,15 +224,56 @@ void fromFloatEigenMatrix_40(const Eigen::MatrixXf& from_mat, float **& to_mat)
 
 
 
-float **mne_lu_invert_40(float **mat,int dim)
+typedef Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> RowMajorMatrixXf_40;
+typedef Eigen::PartialPivLU<Eigen::Ref<RowMajorMatrixXf_40> > InplaceLU_40;
+
 /*
-      * Invert a matrix using the LU decomposition from
-      * LAPACK
+ * One block of columns of the inverse, the blocks are solved in parallel
+ */
+struct LuSolveTask_40
+{
+    const InplaceLU_40* lu;     /**< The factorized matrix. */
+    Eigen::MatrixXf*    inv;    /**< The inverse, each column is written by one task only. */
+    int                 from;   /**< First column of the block. */
+    int                 ncol;   /**< Number of columns in the block. */
+
+    void solve()
+    {
+        int dim = inv->rows();
+        inv->middleCols(from,ncol) = lu->solve(Eigen::MatrixXf::Identity(dim,dim).middleCols(from,ncol));
+    }
+};
+
+#define LU_SOLVE_MIN_BLOCK 64
+
+
+float **FwdBemModel::fwd_bem_lu_invert(float **mat,int dim)
+/*
+      * Invert a matrix using a blocked LU decomposition.
+      * The matrix has to be allocated with mne_cmatrix_40 and
+      * is factorized in place.
       */
 {
-    Eigen::MatrixXf eigen_mat = toFloatEigenMatrix_40(mat, dim, dim);
-    Eigen::MatrixXf eigen_mat_inv = eigen_mat.inverse();
-    fromFloatEigenMatrix_40(eigen_mat_inv, mat);
+    Eigen::Map<RowMajorMatrixXf_40> eigen_mat(mat[0],dim,dim);
+    InplaceLU_40 lu(eigen_mat);
+    Eigen::MatrixXf eigen_mat_inv(dim,dim);
+    /*
+     * Solve for blocks of unit vectors
+     */
+    int nblock = qMax(1,qMin(QThread::idealThreadCount(),dim/LU_SOLVE_MIN_BLOCK));
+    int ncol   = (dim + nblock - 1)/nblock;
+    QVector<LuSolveTask_40> tasks;
+    for (int from = 0; from < dim; from += ncol) {
+        LuSolveTask_40 task;
+        task.lu   = &lu;
+        task.inv  = &eigen_mat_inv;
+        task.from = from;
+        task.ncol = qMin(ncol,dim-from);
+        tasks.append(task);
+    }
+    QtConcurrent::blockingMap(tasks,&LuSolveTask_40::solve);
+
+    eigen_mat = eigen_mat_inv;
     return mat;
 }
 
@@ -1076,6 +1129,107 @@ void FwdBemModel::correct_auto_elements(MneSurfaceOld *surf, float **mat)
 }
 
 
+//*************************************************************************************************************
+
+/*
+ * A block of rows of one surface pair in the linear collocation coefficients
+ */
+struct LinPotCoeffTask_40
+{
+    MneSurfaceOld*  surf1;  /**< The surface of the collocation points. */
+    MneSurfaceOld*  surf2;  /**< The surface of the triangles. */
+    bool            self;   /**< Whether both surfaces are the same. */
+    float           **mat;  /**< The coefficient matrix. */
+    int             joff;   /**< Row offset of the surface pair. */
+    int             koff;   /**< Column offset of the surface pair. */
+    int             from;   /**< First row of the block. */
+    int             to;     /**< One past the last row of the block. */
+
+    void compute()
+    {
+        MneTriangle* tri;
+        double omega[3];
+        int    j,k,c;
+        double *row = MALLOC_40(surf2->np,double);
+
+        for (j = from; j < to; j++) {
+            for (k = 0; k < surf2->np; k++)
+                row[k] = 0.0;
+            for (k = 0, tri = surf2->tris; k < surf2->ntri; k++,tri++) {
+                /*
+                 * No contribution from a triangle that
+                 * this vertex belongs to
+                 */
+                if (self && (tri->vert[0] == j || tri->vert[1] == j || tri->vert[2] == j))
+                    continue;
+                /*
+                 * Otherwise do the hard job
+                 */
+                FwdBemModel::lin_pot_coeff (surf1->rr[j],tri,omega);
+                for (c = 0; c < 3; c++)
+                    row[tri->vert[c]] = row[tri->vert[c]] - omega[c];
+            }
+            for (k = 0; k < surf2->np; k++)
+                mat[j+joff][k+koff] = row[k];
+        }
+        FREE_40(row);
+    }
+};
+
+/*
+ * A block of rows of one surface pair in the solid angle matrix
+ */
+struct SolidAngleTask_40
+{
+    MneSurfaceOld*  surf1;  /**< The surface of the triangle centers. */
+    MneSurfaceOld*  surf2;  /**< The surface of the triangles. */
+    bool            self;   /**< Whether both surfaces are the same. */
+    float           **mat;  /**< The solid angle matrix. */
+    int             joff;   /**< Row offset of the surface pair. */
+    int             koff;   /**< Column offset of the surface pair. */
+    int             from;   /**< First row of the block. */
+    int             to;     /**< One past the last row of the block. */
+
+    void compute()
+    {
+        MneTriangle* tri;
+        int j,k;
+
+        for (j = from; j < to; j++)
+            for (k = 0, tri = surf2->tris; k < surf2->ntri; k++, tri++) {
+                if (self && j == k)
+                    mat[j+joff][k+koff] = 0.0;
+                else
+                    mat[j+joff][k+koff] = MneSurfaceOrVolume::solid_angle (surf1->tris[j].cent,tri);
+            }
+    }
+};
+
+#define BEM_ROW_BLOCK 32
+
+/*
+ * Split the rows of a surface pair into blocks
+ */
+template<typename T>
+static QVector<T> make_row_tasks_40(MneSurfaceOld* surf1, MneSurfaceOld* surf2, bool self, float **mat, int joff, int koff, int nrow)
+{
+    QVector<T> tasks;
+    for (int from = 0; from < nrow; from += BEM_ROW_BLOCK) {
+        T task;
+        task.surf1 = surf1;
+        task.surf2 = surf2;
+        task.self  = self;
+        task.mat   = mat;
+        task.joff  = joff;
+        task.koff  = koff;
+        task.from  = from;
+        task.to    = qMin(from + BEM_ROW_BLOCK,nrow);
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+
 //*************************************************************************************************************
 
 float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
@@ -1085,12 +1239,8 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
 {
     float **mat = NULL;
     float **sub_mat = NULL;
-    int   np1,np2,ntri,np_tot,np_max;
-    float **nodes;
-    MneTriangle*   tri;
-    double omega[3];
-    double *row = NULL;
-    int    j,k,p,q,c;
+    int   np1,np2,np_tot,np_max;
+    int    j,k,p,q;
     int    joff,koff;
     MneSurfaceOld* surf1;
     MneSurfaceOld* surf2;
@@ -1105,41 +1255,23 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
     for (j = 0; j < np_tot; j++)
         for (k = 0; k < np_tot; k++)
             mat[j][k] = 0.0;
-    row        = MALLOC_40(np_max,double);
     sub_mat = MALLOC_40(np_max,float *);
     for (p = 0, joff = 0; p < surfs.size(); p++, joff = joff + np1) {
         surf1 = surfs[p];
         np1   = surf1->np;
-        nodes = surf1->rr;
         for (q = 0, koff = 0; q < surfs.size(); q++, koff = koff + np2) {
             surf2 = surfs[q];
             np2   = surf2->np;
-            ntri  = surf2->ntri;
 
             fprintf(stderr,"\t\t%s (%d) -> %s (%d) ... ",
                     fwd_bem_explain_surface(surf1->id).toUtf8().constData(),np1,
                     fwd_bem_explain_surface(surf2->id).toUtf8().constData(),np2);
+            /*
+             * The rows are independent, compute them in blocks in parallel
+             */
+            QVector<LinPotCoeffTask_40> tasks = make_row_tasks_40<LinPotCoeffTask_40>(surf1,surf2,p == q,mat,joff,koff,np1);
+            QtConcurrent::blockingMap(tasks,&LinPotCoeffTask_40::compute);
 
-            for (j = 0; j < np1; j++) {
-                for (k = 0; k < np2; k++)
-                    row[k] = 0.0;
-                for (k = 0, tri = surf2->tris; k < ntri; k++,tri++) {
-                    /*
-               * No contribution from a triangle that
-               * this vertex belongs to
-               */
-                    if (p == q && (tri->vert[0] == j || tri->vert[1] == j || tri->vert[2] == j))
-                        continue;
-                    /*
-               * Otherwise do the hard job
-               */
-                    lin_pot_coeff (nodes[j],tri,omega);
-                    for (c = 0; c < 3; c++)
-                        row[tri->vert[c]] = row[tri->vert[c]] - omega[c];
-                }
-                for (k = 0; k < np2; k++)
-                    mat[j+joff][k+koff] = row[k];
-            }
             if (p == q) {
                 for (j = 0; j < np1; j++)
                     sub_mat[j] = mat[j+joff]+koff;
@@ -1148,7 +1280,6 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
             fprintf(stderr,"[done]\n");
         }
     }
-    FREE_40(row);
     FREE_40(sub_mat);
     return(mat);
 }
@@ -1255,7 +1386,7 @@ float **FwdBemModel::fwd_bem_multi_solution(float **solids, float **gamma, int n
     for (k = 0; k < ntot; k++)
         solids[k][k] = solids[k][k] + 1.0;
 
-    return (mne_lu_invert_40(solids,ntot));
+    return (fwd_bem_lu_invert(solids,ntot));
 }
 
 
@@ -1395,12 +1526,10 @@ float **FwdBemModel::fwd_bem_solid_angles(const QList<MneSurfaceOld*>& surfs)
 {
     MneSurfaceOld* surf1;
     MneSurfaceOld* surf2;
-    MneTriangle* tri;
     int ntri1,ntri2,ntri_tot;
-    int j,k,p,q;
+    int j,p,q;
     int joff,koff;
     float **solids;
-    float result;
     float **sub_solids = NULL;
     float desired;
 
@@ -1416,14 +1545,12 @@ float **FwdBemModel::fwd_bem_solid_angles(const QList<MneSurfaceOld*>& surfs)
             surf2 = surfs[q];
             ntri2 = surf2->ntri;
             fprintf(stderr,"\t\t%s (%d) -> %s (%d) ... ",fwd_bem_explain_surface(surf1->id).toUtf8().constData(),ntri1,fwd_bem_explain_surface(surf2->id).toUtf8().constData(),ntri2);
-            for (j = 0; j < ntri1; j++)
-                for (k = 0, tri = surf2->tris; k < ntri2; k++, tri++) {
-                    if (p == q && j == k)
-                        result = 0.0;
-                    else
-                        result = MneSurfaceOrVolume::solid_angle (surf1->tris[j].cent,tri);
-                    solids[j+joff][k+koff] = result;
-                }
+            /*
+             * The rows are independent, compute them in blocks in parallel
+             */
+            QVector<SolidAngleTask_40> tasks = make_row_tasks_40<SolidAngleTask_40>(surf1,surf2,p == q,solids,joff,koff,ntri1);
+            QtConcurrent::blockingMap(tasks,&SolidAngleTask_40::compute);
+
             for (j = 0; j < ntri1; j++)
                 sub_solids[j] = solids[j+joff]+koff;
             fprintf(stderr,"[done]\n");
@@ -1560,7 +1687,131 @@ int FwdBemModel::fwd_bem_load_recompute_solution(const QString& name, int bem_me
     }
     if (bem_method == FWD_BEM_UNKNOWN)
         bem_method = FWD_BEM_LINEAR_COLL;
-    return fwd_bem_compute_solution(m,bem_method);
+    /*
+     * An identical model may have been solved before
+     */
+    QString cache_name = fwd_bem_solution_cache_name(m,bem_method);
+    if (!force_recompute && !cache_name.isEmpty() && fwd_bem_load_cached_solution(cache_name,bem_method,m) == OK) {
+        fprintf(stderr,"\nLoaded %s BEM solution from %s\n",fwd_bem_explain_method(m->bem_method).toUtf8().constData(),cache_name.toUtf8().constData());
+        return OK;
+    }
+    if (fwd_bem_compute_solution(m,bem_method) == FAIL)
+        return FAIL;
+    if (!cache_name.isEmpty() && fwd_bem_save_cached_solution(cache_name,m) == OK)
+        fprintf(stderr,"Stored the BEM solution in %s\n",cache_name.toUtf8().constData());
+    return OK;
+}
+
+
+//*************************************************************************************************************
+
+QString FwdBemModel::fwd_bem_solution_cache_name(FwdBemModel *m, int bem_method)
+/*
+* Name of the cached solution of this model
+*/
+{
+    QString cache_dir = UTILSLIB::IOUtils::get_cache_dir("bem");
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    int k,j;
+
+    if (cache_dir.isEmpty())
+        return QString();
+
+    hash.addData(reinterpret_cast<const char*>(&bem_method),sizeof(int));
+    hash.addData(reinterpret_cast<const char*>(&m->nsurf),sizeof(int));
+    for (k = 0; k < m->nsurf; k++) {
+        MneSurfaceOld* surf = m->surfs[k];
+        hash.addData(reinterpret_cast<const char*>(&surf->np),sizeof(int));
+        hash.addData(reinterpret_cast<const char*>(&surf->ntri),sizeof(int));
+        for (j = 0; j < surf->np; j++)
+            hash.addData(reinterpret_cast<const char*>(surf->rr[j]),3*sizeof(float));
+        for (j = 0; j < surf->ntri; j++)
+            hash.addData(reinterpret_cast<const char*>(surf->tris[j].vert),3*sizeof(int));
+    }
+    hash.addData(reinterpret_cast<const char*>(m->sigma),m->nsurf*sizeof(float));
+    hash.addData(reinterpret_cast<const char*>(&m->ip_approach_limit),sizeof(float));
+
+    return QString("%1/%2-bem-sol.dat").arg(cache_dir).arg(QString(hash.result().toHex()));
+}
+
+
+//*************************************************************************************************************
+
+#define BEM_CACHE_MAGIC   0x4d4e4542   /* Identifies a cached solution */
+#define BEM_CACHE_VERSION 1            /* Version of the cached solution layout */
+
+int FwdBemModel::fwd_bem_load_cached_solution(const QString &name, int bem_method, FwdBemModel *m)
+/*
+* Load a solution stored by fwd_bem_save_cached_solution
+*/
+{
+    QFile file(name);
+    quint32 magic;
+    qint32  version,method,nsol;
+    float   **sol = NULL;
+    int     k,dim;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return FAIL;
+
+    QDataStream stream(&file);
+    stream >> magic >> version >> method >> nsol;
+    for (k = 0, dim = 0; k < m->nsurf; k++)
+        dim = dim + ((bem_method == FWD_BEM_LINEAR_COLL) ? m->surfs[k]->np : m->surfs[k]->ntri);
+    if (stream.status() != QDataStream::Ok || magic != BEM_CACHE_MAGIC || version != BEM_CACHE_VERSION ||
+            method != bem_method || nsol != dim)
+        return FAIL;
+
+    int nbytes = nsol*sizeof(float);
+    sol = ALLOC_CMATRIX_40(nsol,nsol);
+    for (k = 0; k < nsol; k++)
+        if (stream.readRawData(reinterpret_cast<char*>(sol[k]),nbytes) != nbytes) {
+            FREE_CMATRIX_40(sol);
+            return FAIL;
+        }
+    m->fwd_bem_free_solution();
+    m->sol_name   = name;
+    m->solution   = sol;
+    m->nsol       = nsol;
+    m->bem_method = bem_method;
+
+    return OK;
+}
+
+
+//*************************************************************************************************************
+
+int FwdBemModel::fwd_bem_save_cached_solution(const QString &name, FwdBemModel *m)
+/*
+* Store the solution of the model for fwd_bem_load_cached_solution
+*/
+{
+    QString dir = QFileInfo(name).absolutePath();
+    if (!m->solution || m->nsol <= 0 || !QDir().mkpath(dir))
+        return FAIL;
+    /*
+     * Older solutions make room, a solution larger than the cache limit is not stored
+     */
+    if (!UTILSLIB::IOUtils::trim_cache_dir(dir,qint64(m->nsol)*m->nsol*sizeof(float)))
+        return FAIL;
+    /*
+     * Written to a temporary file first, an interrupted run leaves no partial solution behind
+     */
+    QSaveFile file(name);
+    if (!file.open(QIODevice::WriteOnly))
+        return FAIL;
+
+    QDataStream stream(&file);
+    stream << quint32(BEM_CACHE_MAGIC) << qint32(BEM_CACHE_VERSION) << qint32(m->bem_method) << qint32(m->nsol);
+
+    int nbytes = m->nsol*sizeof(float);
+    for (int k = 0; k < m->nsol; k++)
+        if (stream.writeRawData(reinterpret_cast<const char*>(m->solution[k]),nbytes) != nbytes)
+            return FAIL;
+    if (!file.commit())
+        return FAIL;
+
+    return OK;
 }
 
 
@@ -2522,6 +2773,7 @@ int FwdBemModel::fwd_bem_specify_coils(FwdBemModel *m, FwdCoilSet *coils)
 {
     float **sol = NULL;
     FwdBemSolution* csol;
+    int   s,k,p;
 
     if (!m) {
         printf("Model missing in fwd_bem_specify_coils");
@@ -2549,6 +2801,22 @@ int FwdBemModel::fwd_bem_specify_coils(FwdBemModel *m, FwdCoilSet *coils)
     csol->ncoil     = coils->ncoil;
     csol->np        = m->nsol;
     csol->solution  = mne_mat_mat_mult_40(sol,m->solution,coils->ncoil,m->nsol,m->nsol);//TODO: Suspicion, that this is slow - use Eigen
+    /*
+     * The batch field computation needs the vertices of all surfaces
+     */
+    if (m->bem_method == FWD_BEM_LINEAR_COLL) {
+        csol->vx.resize(m->nsol);
+        csol->vy.resize(m->nsol);
+        csol->vz.resize(m->nsol);
+        csol->vmult.resize(m->nsol);
+        for (s = 0, p = 0; s < m->nsurf; s++)
+            for (k = 0; k < m->surfs[s]->np; k++, p++) {
+                csol->vx[p]    = m->surfs[s]->rr[k][X_40];
+                csol->vy[p]    = m->surfs[s]->rr[k][Y_40];
+                csol->vz[p]    = m->surfs[s]->rr[k][Z_40];
+                csol->vmult[p] = m->source_mult[s];
+            }
+    }
 
     FREE_CMATRIX_40(sol);
     return OK;
@@ -2624,6 +2892,72 @@ void FwdBemModel::fwd_bem_lin_field_calc(float *rd, float *Q, FwdCoilSet *coils,
 }
 
 
+//*************************************************************************************************************
+
+void FwdBemModel::fwd_bem_lin_field_calc_batch(float **rd, float **Q, int ndip, FwdCoilSet *coils, FwdBemModel *m, float **B)
+/*
+     * Calculate the magnetic field of a block of dipoles in a set of coils
+     */
+{
+    FwdBemSolution* sol = (FwdBemSolution*)coils->user_data;
+    FwdCoilPoints::ConstSPtr pts = coils->coil_points();
+    const ArrayXf&  vx    = sol->vx;        /* The vertices of all surfaces, see fwd_bem_specify_coils */
+    const ArrayXf&  vy    = sol->vy;
+    const ArrayXf&  vz    = sol->vz;
+    const ArrayXf&  vmult = sol->vmult;
+    ArrayXf         dx,dy,dz,d2;
+    MatrixXf        v0(m->nsol,ndip);
+    MatrixXf        prim(pts->np,ndip);
+    float           my_rd[3],my_Q[3];
+    float           pi4 = 4.0*M_PI;
+    int             k,p;
+
+    for (k = 0; k < ndip; k++) {
+        /*
+         * The dipole location and orientation must be transformed
+         */
+        VEC_COPY_40(my_rd,rd[k]);
+        VEC_COPY_40(my_Q,Q[k]);
+        if (m->head_mri_t) {
+            FiffCoordTransOld::fiff_coord_trans(my_rd,m->head_mri_t,FIFFV_MOVE);
+            FiffCoordTransOld::fiff_coord_trans(my_Q,m->head_mri_t,FIFFV_NO_MOVE);
+        }
+        /*
+         * Infinite-medium potentials at the vertices
+         */
+        dx = vx - my_rd[X_40];
+        dy = vy - my_rd[Y_40];
+        dz = vz - my_rd[Z_40];
+        d2 = dx*dx + dy*dy + dz*dz;
+        v0.col(k) = (vmult*(my_Q[X_40]*dx + my_Q[Y_40]*dy + my_Q[Z_40]*dz)/(pi4*d2*d2.sqrt())).matrix();
+        /*
+         * Primary current contribution
+         * (can be calculated in the coil/dipole coordinates)
+         */
+        dx = pts->rx - rd[k][X_40];
+        dy = pts->ry - rd[k][Y_40];
+        dz = pts->rz - rd[k][Z_40];
+        d2 = dx*dx + dy*dy + dz*dz;
+        prim.col(k) = (((Q[k][Y_40]*dz - Q[k][Z_40]*dy)*pts->cx +
+                        (Q[k][Z_40]*dx - Q[k][X_40]*dz)*pts->cy +
+                        (Q[k][X_40]*dy - Q[k][Y_40]*dx)*pts->cz)/(d2*d2.sqrt())).matrix();
+    }
+    /*
+       * Volume current contribution of all dipoles at once
+       */
+    Map<Matrix<float,Dynamic,Dynamic,RowMajor> > solution(sol->solution[0],coils->ncoil,m->nsol);
+    MatrixXf res = pts->w*prim;
+    res.noalias() += solution*v0;
+    /*
+       * Scale correctly
+       */
+    for (k = 0; k < ndip; k++)
+        for (p = 0; p < coils->ncoil; p++)
+            B[k][p] = MAG_FACTOR*res(p,k);
+    return;
+}
+
+
 //*************************************************************************************************************
 
 void FwdBemModel::fwd_bem_field_calc(float *rd, float *Q, FwdCoilSet *coils, FwdBemModel *m, float *B)
@@ -2924,6 +3258,38 @@ int FwdBemModel::fwd_bem_field(float *rd, float *Q, FwdCoilSet *coils, float *B,
 }
 
 
+//*************************************************************************************************************
+
+int FwdBemModel::fwd_bem_field_batch(float **rd, float **Q, int ndip, FwdCoilSet *coils, float **B, void *client)  /* The model */
+/*
+     * This version calculates the magnetic field of a block of dipoles
+     * Call fwd_bem_specify_coils first to establish the coil-specific
+     * solution matrix
+     */
+{
+    FwdBemModel* m = (FwdBemModel*)client;
+    FwdBemSolution* sol = (FwdBemSolution*)coils->user_data;
+    int k;
+
+    if (!m) {
+        printf("No BEM model specified to fwd_bem_field_batch");
+        return FAIL;
+    }
+    if (!sol || !sol->solution || sol->ncoil != coils->ncoil) {
+        printf("No appropriate coil-specific data available in fwd_bem_field_batch");
+        return FAIL;
+    }
+    if (m->bem_method == FWD_BEM_LINEAR_COLL)
+        fwd_bem_lin_field_calc_batch(rd,Q,ndip,coils,m,B);
+    else {
+        for (k = 0; k < ndip; k++)
+            if (fwd_bem_field(rd[k],Q[k],coils,B[k],client) == FAIL)
+                return FAIL;
+    }
+    return OK;
+}
+
+
 //*************************************************************************************************************
 
 int FwdBemModel::fwd_bem_field_grad(float *rd, float Q[], FwdCoilSet *coils, float Bval[], float xgrad[], float ygrad[], float zgrad[], void *client)  /* Client data to be passed to some foward modelling routines */
@@ -2960,22 +3326,58 @@ int FwdBemModel::fwd_bem_field_grad(float *rd, float Q[], FwdCoilSet *coils, flo
 
 //*************************************************************************************************************
 
+#define FWD_DIPOLE_BATCH 96
+
 void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
 /*
 * Compute the MEG or EEG forward solution for one source space
-* and possibly for only one source component
+* or a range of its vertices and possibly for only one source component
 */
 {
     FwdThreadArg* a = (FwdThreadArg*)arg;
     MneSourceSpaceOld* s = a->s;
+    int            first = a->first;
+    int            last  = a->last < 0 ? s->np : a->last;
     int            j,p,q;
     float          *xyz[3];
 
+    if (a->field_pot_batch && !(a->field_pot_grad && a->res_grad) && (a->fixed_ori || a->comp < 0)) {
+        /*
+         * Compute blocks of dipoles at once,
+         * each vertex has one or three consecutive rows in the result
+         */
+        float *rd[FWD_DIPOLE_BATCH],*Q[FWD_DIPOLE_BATCH];
+        int   ndip = 0;
+
+        p = a->off;
+        for (j = first; j < last; j++) {
+            if (!s->inuse[j])
+                continue;
+            if (a->fixed_ori) {
+                rd[ndip] = s->rr[j]; Q[ndip++] = s->nn[j];
+            }
+            else {
+                rd[ndip] = s->rr[j]; Q[ndip++] = Qx;
+                rd[ndip] = s->rr[j]; Q[ndip++] = Qy;
+                rd[ndip] = s->rr[j]; Q[ndip++] = Qz;
+            }
+            if (ndip + 3 > FWD_DIPOLE_BATCH) {
+                if (a->field_pot_batch(rd,Q,ndip,a->coils_els,a->res+p,a->client) != OK)
+                    goto bad;
+                p = p + ndip;
+                ndip = 0;
+            }
+        }
+        if (ndip > 0 && a->field_pot_batch(rd,Q,ndip,a->coils_els,a->res+p,a->client) != OK)
+            goto bad;
+        a->stat = OK;
+        return NULL;
+    }
     p = a->off;
     q = 3*a->off;
     if (a->fixed_ori) {					  /* The normal source component only */
         if (a->field_pot_grad && a->res_grad) {                   /* Gradient requested? */
-            for (j = 0; j < s->np; j++)
+            for (j = first; j < last; j++)
                 if (s->inuse[j]) {
                     if (a->field_pot_grad(s->rr[j],s->nn[j],a->coils_els,a->res[p],
                                           a->res_grad[q],a->res_grad[q+1],a->res_grad[q+2],
@@ -2986,7 +3388,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
                 }
         }
         else {
-            for (j = 0; j < s->np; j++)
+            for (j = first; j < last; j++)
                 if (s->inuse[j])
                     if (a->field_pot(s->rr[j],s->nn[j],a->coils_els,a->res[p++],a->client) != OK)
                         goto bad;
@@ -2994,7 +3396,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
     }
     else {						  /* All source components */
         if (a->field_pot_grad && a->res_grad) {               /* Gradient requested? */
-            for (j = 0; j < s->np; j++) {
+            for (j = first; j < last; j++) {
                 if (s->inuse[j]) {
                     if (a->comp < 0) {				  /* Compute all components */
                         if (a->field_pot_grad(s->rr[j],Qx,a->coils_els,a->res[p],
@@ -3044,7 +3446,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
             }
         }
         else {
-            for (j = 0; j < s->np; j++) {
+            for (j = first; j < last; j++) {
                 if (s->inuse[j]) {
                     if (a->vec_field_pot) {
                         xyz[0] = a->res[p++];
@@ -3093,6 +3495,126 @@ bad : {
 }
 
 
+//*************************************************************************************************************
+
+/*
+ * A range of source space vertices processed at once
+ */
+struct FwdSourceChunk_40
+{
+    MneSourceSpaceOld*  s;      /**< The source space. */
+    int                 off;    /**< Offset within the result to the solution of the first vertex. */
+    int                 first;  /**< First vertex of the chunk. */
+    int                 last;   /**< One past the last vertex of the chunk. */
+};
+
+/*
+ * Each worker has its own workspace and takes chunks until none are left,
+ * so the load stays balanced however the sources are distributed over the spaces
+ */
+struct FwdChunkWorker_40
+{
+    FwdThreadArg*                       arg;    /**< The thread argument duplicate of this worker. */
+    const QVector<FwdSourceChunk_40>*   chunks; /**< All chunks. */
+    QAtomicInt*                         next;   /**< The next chunk to be taken. */
+
+    void run()
+    {
+        int k;
+#ifdef _OPENMP
+        /*
+         * The batch kernels multiply matrices, do not start OpenMP threads within the pool threads.
+         * The pool threads are reused by others, restore the setting when done.
+         */
+        int omp_threads = omp_get_max_threads();
+        omp_set_num_threads(1);
+#endif
+        arg->stat = OK;
+        while ((k = next->fetchAndAddRelaxed(1)) < chunks->size()) {
+            const FwdSourceChunk_40& chunk = chunks->at(k);
+            arg->s     = chunk.s;
+            arg->off   = chunk.off;
+            arg->first = chunk.first;
+            arg->last  = chunk.last;
+            FwdBemModel::meg_eeg_fwd_one_source_space(arg);
+            if (arg->stat != OK) {
+                next->fetchAndStoreRelaxed(chunks->size());
+                break;
+            }
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(omp_threads);
+#endif
+    }
+};
+
+#define FWD_SOURCE_CHUNK 32
+
+static int compute_forward_chunks_40(MneSourceSpaceOld **spaces,
+                                     int nspace,
+                                     FwdThreadArg* one_arg,
+                                     int nproc,
+                                     FwdThreadArg* (*create_duplicate)(FwdThreadArg*,bool),
+                                     void (*free_duplicate)(FwdThreadArg*,bool),
+                                     bool bem_model)
+/*
+ * Compute the forward solution in chunks of FWD_SOURCE_CHUNK source locations in parallel
+ */
+{
+    QVector<FwdSourceChunk_40> chunks;
+    QVector<FwdChunkWorker_40> workers;
+    QAtomicInt next(0);
+    int k,j,nuse,off,stat;
+    /*
+     * Split the source spaces
+     */
+    for (k = 0, off = 0; k < nspace; k++) {
+        FwdSourceChunk_40 chunk;
+        chunk.s     = spaces[k];
+        chunk.off   = off;
+        chunk.first = 0;
+        for (j = 0, nuse = 0; j < spaces[k]->np; j++) {
+            if (!spaces[k]->inuse[j])
+                continue;
+            if (nuse == FWD_SOURCE_CHUNK) {
+                chunk.last = j;
+                chunks.append(chunk);
+                chunk.off   = off;
+                chunk.first = j;
+                nuse = 0;
+            }
+            nuse++;
+            off = one_arg->fixed_ori ? off + 1 : off + 3;
+        }
+        if (nuse > 0) {
+            chunk.last = spaces[k]->np;
+            chunks.append(chunk);
+        }
+    }
+    /*
+     * We need copies to allocate separate workspace for each thread
+     */
+    for (k = 0; k < qMin(nproc,chunks.size()); k++) {
+        FwdChunkWorker_40 worker;
+        worker.arg    = create_duplicate(one_arg,bem_model);
+        worker.chunks = &chunks;
+        worker.next   = &next;
+        workers.append(worker);
+    }
+    fprintf(stderr,"%d processors. I will use %d threads for %d chunks of at most %d source locations.\n",
+            nproc,workers.size(),chunks.size(),FWD_SOURCE_CHUNK);
+
+    QtConcurrent::blockingMap(workers,&FwdChunkWorker_40::run);
+
+    for (k = 0, stat = OK; k < workers.size(); k++) {
+        if (workers[k].arg->stat != OK)
+            stat = FAIL;
+        free_duplicate(workers[k].arg,bem_model);
+    }
+    return stat;
+}
+
+
 //*************************************************************************************************************
 
 int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, FwdCoilSet *coils, FwdCoilSet *comp_coils, MneCTFCompDataSet *comp_data, bool fixed_ori, FwdBemModel *bem_model, Vector3f *r0, bool use_threads, MneNamedMatrix **resp, MneNamedMatrix **resp_grad)
@@ -3110,11 +3632,11 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, Fwd
                                              * for one dipole orientation */
     int                 nmeg = coils->ncoil;/* Number of channels */
     int                 nsource;            /* Total number of sources */
-    int                 k,p,q,off;
+    int                 k,off;
     QStringList         names;              /* Channel names */
     void                *client;
     FwdThreadArg*       one_arg = NULL;
-    int                 nproc = QThread::idealThreadCount();
+    int                 nproc = QThreadPool::globalInstance()->maxThreadCount();
     QStringList         emptyList;
 
     if (bem_model) {
@@ -3210,59 +3732,25 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, Fwd
     one_arg->field_pot      = field;
     one_arg->vec_field_pot  = vec_field;
     one_arg->field_pot_grad = field_grad;
+    one_arg->field_pot_batch = FwdCompData::fwd_comp_field_batch;
+    comp->batch_field        = bem_model ? FwdBemModel::fwd_bem_field_batch : fwd_sphere_field_batch;
+    /*
+     * Collect the coil integration points for the batch computations once
+     */
+    coils->fwd_setup_coil_points();
+    if (comp->comp_coils)
+        comp->comp_coils->fwd_setup_coil_points();
 
     if (nproc < 2)
         use_threads = false;
 
     if (use_threads) {
-        int            nthread  = (fixed_ori || vec_field || nproc < 6) ? nspace : 3*nspace;
-        QList <FwdThreadArg*> args; //fwdThreadArg   *args    = MALLOC_40(nthread,fwdThreadArg);
-        int            stat;
-        /*
-        * We need copies to allocate separate workspace for each thread
-        */
-        if (fixed_ori || vec_field || nproc < 6) {
-            for (k = 0, off = 0; k < nthread; k++) {
-                FwdThreadArg* t_arg = FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                t_arg->s   = spaces[k];
-                t_arg->off = off;
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-                args.append(t_arg);
-            }
-            fprintf(stderr,"%d processors. I will use one thread for each of the %d source spaces.\n",
-                    nproc,nspace);
-        }
-        else {
-            for (k = 0, off = 0, q = 0; k < nspace; k++) {
-                for (p = 0; p < 3; p++,q++) {
-                    FwdThreadArg* t_arg = FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                    t_arg->s    = spaces[k];
-                    t_arg->off  = off;
-                    t_arg->comp = p;
-                    args.append(t_arg);
-                }
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-            }
-            fprintf(stderr,"%d processors. I will use %d threads : %d source spaces x 3 source components.\n",
-                    nproc,nthread,nspace);
-        }
-        fprintf(stderr,"Computing MEG at %d source locations (%s orientations)...",
+        fprintf(stderr,"Computing MEG at %d source locations (%s orientations)...\n",
                 nsource,fixed_ori ? "fixed" : "free");
-        /*
-        * Ready to start the threads & Wait for them to complete
-        */
-        QtConcurrent::blockingMap(args, meg_eeg_fwd_one_source_space);
-        /*
-        * Check the results
-        */
-        for (k = 0, stat = OK; k < nthread; k++)
-            if (args[k]->stat != OK) {
-                stat = FAIL;
-                break;
-            }
-        for (k = 0; k < args.size(); k++)//nthread == args.size()
-            FwdThreadArg::free_meg_multi_thread_duplicate(args[k],bem_model != NULL);
-        if (stat != OK)
+        if (compute_forward_chunks_40(spaces,nspace,one_arg,nproc,
+                                      FwdThreadArg::create_meg_multi_thread_duplicate,
+                                      FwdThreadArg::free_meg_multi_thread_duplicate,
+                                      bem_model != NULL) != OK)
             goto bad;
     }
     else {
@@ -3323,11 +3811,11 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces, int nspace, Fwd
                                              * for one dipole orientation */
     int             nsource;                /* Total number of sources */
     int             neeg = els->ncoil;      /* Number of channels */
-    int             k,p,q,off;
+    int             k,off;
     QStringList     names;                  /* Channel names */
     void            *client;
     FwdThreadArg*   one_arg = NULL;
-    int             nproc = QThread::idealThreadCount();
+    int             nproc = QThreadPool::globalInstance()->maxThreadCount();
     QStringList     emptyList;
     /*
        * Count the sources
@@ -3394,57 +3882,20 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces, int nspace, Fwd
     one_arg->field_pot      = pot;
     one_arg->vec_field_pot  = vec_pot;
     one_arg->field_pot_grad = pot_grad;
+    one_arg->field_pot_batch = (!bem_model && m->nfit == 0) ? FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1_batch : NULL;
+    if (one_arg->field_pot_batch)
+        els->fwd_setup_coil_points(true);
 
     if (nproc < 2)
         use_threads = false;
 
     if (use_threads) {
-        int            nthread  = (fixed_ori || vec_pot || nproc < 6) ? nspace : 3*nspace;
-        QList <FwdThreadArg*> args; //FwdThreadArg*   *args    = MALLOC_40(nthread,FwdThreadArg*);
-        int            stat;
-        /*
-        * We need copies to allocate separate workspace for each thread
-        */
-        if (fixed_ori || vec_pot || nproc < 6) {
-            for (k = 0, off = 0; k < nthread; k++) {
-                FwdThreadArg* t_arg = FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                t_arg->s   = spaces[k];
-                t_arg->off = off;
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-                args.append(t_arg);
-            }
-            printf("%d processors. I will use one thread for each of the %d source spaces.\n",nproc,nspace);
-        }
-        else {
-            for (k = 0, off = 0, q = 0; k < nspace; k++) {
-                for (p = 0; p < 3; p++,q++) {
-                    FwdThreadArg* t_arg = FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                    t_arg->s    = spaces[k];
-                    t_arg->off  = off;
-                    t_arg->comp = p;
-                    args.append(t_arg);
-                }
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-            }
-            printf("%d processors. I will use %d threads : %d source spaces x 3 source components.\n",nproc,nthread,nspace);
-        }
-        printf("Computing EEG at %d source locations (%s orientations)...",
+        fprintf(stderr,"Computing EEG at %d source locations (%s orientations)...\n",
                 nsource,fixed_ori ? "fixed" : "free");
-        /*
-        * Ready to start the threads & Wait for them to complete
-        */
-        QtConcurrent::blockingMap(args, meg_eeg_fwd_one_source_space);
-        /*
-        * Check the results
-        */
-        for (k = 0, stat = OK; k < nthread; k++)
-            if (args[k]->stat != OK) {
-                stat = FAIL;
-                break;
-            }
-        for (k = 0; k < args.size(); k++)//nthread == args.size()
-            FwdThreadArg::free_eeg_multi_thread_duplicate(args[k],bem_model != NULL);
-        if (stat != OK)
+        if (compute_forward_chunks_40(spaces,nspace,one_arg,nproc,
+                                      FwdThreadArg::create_eeg_multi_thread_duplicate,
+                                      FwdThreadArg::free_eeg_multi_thread_duplicate,
+                                      bem_model != NULL) != OK)
             goto bad;
     }
     else {
@@ -3593,6 +4044,72 @@ int FwdBemModel::fwd_sphere_field(float *rd, float Q[], FwdCoilSet *coils, float
 }
 
 
+//*************************************************************************************************************
+
+int FwdBemModel::fwd_sphere_field_batch(float **rd, float **Q, int ndip, FwdCoilSet *coils, float **Bval, void *client)	/* Client data will be the sphere model origin */
+{
+    /* The same computation as in fwd_sphere_field, for a block of dipoles
+     * evaluated at all coil integration points at once
+     */
+    float *r0 = (float *)client;      /* The sphere model origin */
+    FwdCoilPoints::ConstSPtr pts = coils->coil_points();
+    ArrayXf px = pts->rx - r0[X_40];
+    ArrayXf py = pts->ry - r0[Y_40];
+    ArrayXf pz = pts->rz - r0[Z_40];
+    ArrayXf r2 = px*px + py*py + pz*pz;
+    ArrayXf r  = r2.sqrt();
+    ArrayXf re = px*pts->cx + py*pts->cy + pz*pts->cz;
+    ArrayXf ax,ay,az,a2,a,ar,ar0,F;
+    MatrixXf K(pts->np,ndip);
+    float myrd[3],v[3];
+    int   j,k,p;
+
+    for (k = 0; k < ndip; k++) {
+        /*
+         * Shift to the sphere model coordinates
+         */
+        for (p = 0; p < 3; p++)
+            myrd[p] = rd[k][p] - r0[p];
+        /*
+         * Check for a dipole at the origin
+         */
+        if (VEC_LEN_40(myrd) <= EPS) {
+            K.col(k).setZero();
+            continue;
+        }
+        CROSS_PRODUCT_40(Q[k],myrd,v);
+
+        /* Vector from dipole to the field point */
+
+        ax = px - myrd[X_40];
+        ay = py - myrd[Y_40];
+        az = pz - myrd[Z_40];
+        a2 = ax*ax + ay*ay + az*az;
+        a  = a2.sqrt();
+
+        /* The main ingredients */
+
+        ar  = r2 - (px*myrd[X_40] + py*myrd[Y_40] + pz*myrd[Z_40]);
+        ar0 = ar/a;
+        F   = a*(r*a + ar);
+
+        /* Mix them together, skipping the points where the formula breaks down */
+
+        K.col(k) = (a > 0.0f && r > 0.0f && ((ar/(a*r)) + 1.0f).abs() > CEPS).select(
+                    ((v[X_40]*pts->cx + v[Y_40]*pts->cy + v[Z_40]*pts->cz)*F +
+                     (v[X_40]*px + v[Y_40]*py + v[Z_40]*pz)*
+                     ((a + 2*r + ar0)*(myrd[X_40]*pts->cx + myrd[Y_40]*pts->cy + myrd[Z_40]*pts->cz) -
+                      (a2/r + ar0 + 2.0f*(a+r))*re))/(F*F),
+                    0.0f).matrix();
+    }
+    MatrixXf B = pts->w*K;
+    for (k = 0; k < ndip; k++)
+        for (j = 0; j < coils->ncoil; j++)
+            Bval[k][j] = MAG_FACTOR*B(j,k);
+    return OK;          /* Happy conclusion: this works always */
+}
+
+
 //*************************************************************************************************************
 
 int FwdBemModel::fwd_sphere_field_vec(float *rd, FwdCoilSet *coils, float **Bval, void *client)	/* Client data will be the sphere model origin */
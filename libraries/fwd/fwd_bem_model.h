@@ -249,6 +249,12 @@ public:
 
     static float **fwd_bem_solid_angles (const QList<MNELIB::MneSurfaceOld*>& surfs);
 
+    /*
+     * Invert a matrix in place using a blocked LU decomposition, the blocks of the inverse are solved in parallel.
+     * The rows of the matrix have to be contiguous in memory, as allocated by mne_cmatrix.
+     */
+    static float **fwd_bem_lu_invert(float **mat, int dim);
+
     static int fwd_bem_constant_collocation_solution(FwdBemModel* m);
 
     //============================= fwd_bem_model.c =============================
@@ -261,6 +267,22 @@ public:
                                         int         force_recompute,
                                         FwdBemModel* m);
 
+    /*
+     * The solution cache is keyed by a hash of everything the solution depends on:
+     * the surface geometry, the conductivities, the method, and the IP approach limit.
+     * The name is empty if the disk caches are switched off (MNE_CPP_CACHE=0), the size
+     * of the cache is limited by MNE_CPP_CACHE_MAX_MB, see IOUtils::trim_cache_dir
+     */
+    static QString fwd_bem_solution_cache_name(FwdBemModel* m,
+                                               int         bem_method);
+
+    static int fwd_bem_load_cached_solution(const QString& name,
+                                            int         bem_method,
+                                            FwdBemModel* m);
+
+    static int fwd_bem_save_cached_solution(const QString& name,
+                                            FwdBemModel* m);
+
     //============================= fwd_bem_pot.c =============================
 
     static float fwd_bem_inf_field(float *rd,      /* Dipole position */
@@ -399,6 +421,17 @@ public:
                                        FwdBemModel* m,
                                        float       *B);
 
+    /*
+     * The same for a block of dipoles: B[k] receives the field of dipole k.
+     * The potentials of all dipoles are combined with the solution in one matrix product.
+     */
+    static void fwd_bem_lin_field_calc_batch(float       **rd,
+                                             float       **Q,
+                                             int         ndip,
+                                             FwdCoilSet*  coils,
+                                             FwdBemModel* m,
+                                             float       **B);
+
     static void fwd_bem_field_calc(float       *rd,
                                    float       *Q,
                                    FwdCoilSet*  coils,
@@ -442,6 +475,13 @@ public:
                       float       *B,       /* Result */
                       void        *client);
 
+    static int fwd_bem_field_batch(float       **rd,  /* Dipole positions */
+                                   float       **Q,   /* Dipole orientations */
+                                   int         ndip,  /* Number of dipoles */
+                                   FwdCoilSet*  coils,     /* Coil descriptors */
+                                   float       **B,        /* Result, one row per dipole */
+                                   void        *client);
+
     static int fwd_bem_field_grad(float        *rd,      /* The dipole location */
                    float        Q[],      /* The dipole components (xyz) */
                    FwdCoilSet*  coils,    /* The coil definitions */
@@ -487,6 +527,13 @@ public:
                          float        Bval[],	/* Results */
                          void         *client);
 
+    static int fwd_sphere_field_batch(float       **rd,     /* The dipole locations */
+                                      float       **Q,      /* The dipole components (xyz) */
+                                      int         ndip,     /* Number of dipoles */
+                                      FwdCoilSet*  coils,   /* The coil definitions */
+                                      float       **Bval,   /* Results, one row per dipole */
+                                      void        *client);
+
     static int fwd_sphere_field_vec(float        *rd,	/* The dipole location */
                              FwdCoilSet*   coils,	/* The coil definitions */
                              float        **Bval,  /* Results: rows are the fields of the x,y, and z direction dipoles */
@@ -106,6 +106,10 @@ public:
     float **solution;                   /* The solution matrix */
     int   ncoil;                        /* Number of sensors */
     int   np;                           /* Number of potential solution points */
+    Eigen::ArrayXf vx;                  /* The x coordinates of the potential solution points (linear collocation) */
+    Eigen::ArrayXf vy;                  /* The y coordinates of the potential solution points */
+    Eigen::ArrayXf vz;                  /* The z coordinates of the potential solution points */
+    Eigen::ArrayXf vmult;               /* The source multipliers of the potential solution points */
 
 // ### OLD STRUCT ###
 //typedef struct {                        /* Space to store a solution matrix */
@@ -0,0 +1,100 @@
+//=============================================================================================================
+/**
+* @file     fwd_coil_points.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FwdCoilPoints class definition.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fwd_coil_points.h"
+#include "fwd_coil_set.h"
+#include "fwd_coil.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <vector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FWDLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FwdCoilPoints::FwdCoilPoints(const FwdCoilSet *coils, bool eeg)
+: ncoil(coils->ncoil)
+, np(0)
+{
+    std::vector<Triplet<float> > weights;
+    int k,p;
+
+    for (k = 0; k < coils->ncoil; k++) {
+        FwdCoil* coil = coils->coils[k];
+        if ((coil->coil_class == FWD_COILC_EEG) == eeg)
+            np += coil->np;
+    }
+    rx.resize(np); ry.resize(np); rz.resize(np);
+    cx.resize(np); cy.resize(np); cz.resize(np);
+    weights.reserve(np);
+
+    for (k = 0, np = 0; k < coils->ncoil; k++) {
+        FwdCoil* coil = coils->coils[k];
+        if ((coil->coil_class == FWD_COILC_EEG) != eeg)
+            continue;
+        for (p = 0; p < coil->np; p++, np++) {
+            rx[np] = coil->rmag[p][0];
+            ry[np] = coil->rmag[p][1];
+            rz[np] = coil->rmag[p][2];
+            cx[np] = coil->cosmag[p][0];
+            cy[np] = coil->cosmag[p][1];
+            cz[np] = coil->cosmag[p][2];
+            weights.push_back(Triplet<float>(k,np,coil->w[p]));
+        }
+    }
+    w.resize(ncoil,np);
+    w.setFromTriplets(weights.begin(),weights.end());
+}
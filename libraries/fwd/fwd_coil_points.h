@@ -0,0 +1,124 @@
+//=============================================================================================================
+/**
+* @file     fwd_coil_points.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FwdCoilPoints class declaration.
+*
+*/
+
+#ifndef FWDCOILPOINTS_H
+#define FWDCOILPOINTS_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fwd_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FWDLIB
+//=============================================================================================================
+
+namespace FWDLIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class FwdCoilSet;
+
+
+//=============================================================================================================
+/**
+* The integration points of all coils of a FwdCoilSet in structure-of-arrays layout. The batch field
+* computations evaluate a dipole at all points at once with Eigen array expressions, which are vectorized
+* with the instruction set the library is compiled for (and fall back to scalar code with EIGEN_DONT_VECTORIZE).
+* The field of each coil is then the weighted sum over its points, i.e., the product with the weight matrix.
+*
+* @brief Coil integration points in structure-of-arrays layout
+*/
+class FWDSHARED_EXPORT FwdCoilPoints
+{
+public:
+    typedef QSharedPointer<FwdCoilPoints> SPtr;              /**< Shared pointer type for FwdCoilPoints. */
+    typedef QSharedPointer<const FwdCoilPoints> ConstSPtr;   /**< Const shared pointer type for FwdCoilPoints. */
+
+    //=========================================================================================================
+    /**
+    * Collects the integration points of the MEG coils or of the EEG electrodes of a coil set.
+    * The coils of the other kind get empty rows in the weight matrix.
+    *
+    * @param[in] coils  The coil set
+    * @param[in] eeg    Collect the EEG electrodes instead of the MEG coils
+    */
+    FwdCoilPoints(const FwdCoilSet* coils, bool eeg = false);
+
+public:
+    int             ncoil;      /**< Number of coils in the set */
+    int             np;         /**< Number of integration points */
+    Eigen::ArrayXf  rx;         /**< The x coordinates of the field points */
+    Eigen::ArrayXf  ry;         /**< The y coordinates of the field points */
+    Eigen::ArrayXf  rz;         /**< The z coordinates of the field points */
+    Eigen::ArrayXf  cx;         /**< The x direction cosines */
+    Eigen::ArrayXf  cy;         /**< The y direction cosines */
+    Eigen::ArrayXf  cz;         /**< The z direction cosines */
+    Eigen::SparseMatrix<float,Eigen::RowMajor> w;   /**< The weights of the points (columns) for each coil (rows) */
+};
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+} // NAMESPACE FWDLIB
+
+#endif // FWDCOILPOINTS_H
@@ -623,3 +623,26 @@ bool FwdCoilSet::is_eeg_electrode_type(int type) const
     return type == FIFFV_COIL_EEG;
 }
 
+
+
+//*************************************************************************************************************
+
+void FwdCoilSet::fwd_setup_coil_points(bool eeg)
+{
+    if (eeg)
+        eeg_points = FwdCoilPoints::ConstSPtr(new FwdCoilPoints(this,true));
+    else
+        meg_points = FwdCoilPoints::ConstSPtr(new FwdCoilPoints(this,false));
+}
+
+
+//*************************************************************************************************************
+
+FwdCoilPoints::ConstSPtr FwdCoilSet::coil_points(bool eeg) const
+{
+    FwdCoilPoints::ConstSPtr pts = eeg ? eeg_points : meg_points;
+
+    if (!pts)
+        pts = FwdCoilPoints::ConstSPtr(new FwdCoilPoints(this,eeg));
+    return pts;
+}
@@ -43,6 +43,7 @@
 
 #include "fwd_global.h"
 #include "fwd_coil.h"
+#include "fwd_coil_points.h"
 #include <fiff/fiff_types.h>
 
 
@@ -226,12 +227,34 @@ public:
     */
     bool is_eeg_electrode_type(int type) const;
 
+    //=========================================================================================================
+    /**
+    * Collects the integration points of the coils for the batch field computations. Call this once the coil
+    * positions are final and before the coil set is shared between threads.
+    *
+    * @param[in] eeg    Collect the EEG electrodes instead of the MEG coils
+    */
+    void fwd_setup_coil_points(bool eeg = false);
+
+    //=========================================================================================================
+    /**
+    * Returns the integration points of the coils. If fwd_setup_coil_points was not called, the points are
+    * collected on the fly.
+    *
+    * @param[in] eeg    Return the EEG electrodes instead of the MEG coils
+    *
+    * @return   The coil integration points.
+    */
+    FwdCoilPoints::ConstSPtr coil_points(bool eeg = false) const;
+
 public:
     FwdCoil **coils;                 /* The coil or electrode positions */
     int     ncoil;
     int     coord_frame;            /* Common coordinate frame */
     void    *user_data;             /* We can put whatever in here */
     fwdUserFreeFunc user_data_free;
+    FwdCoilPoints::ConstSPtr meg_points;    /* The MEG coil integration points, see fwd_setup_coil_points */
+    FwdCoilPoints::ConstSPtr eeg_points;    /* The EEG electrode points, see fwd_setup_coil_points */
 
 // ### OLD STRUCT ###
 //    typedef struct {
@@ -144,6 +144,7 @@ FwdCompData::FwdCompData()
 ,field      (NULL)
 ,vec_field  (NULL)
 ,field_grad (NULL)
+,batch_field(NULL)
 ,client     (NULL)
 ,client_free(NULL)
 ,set        (NULL)
@@ -212,6 +213,55 @@ int FwdCompData::fwd_comp_field(float *rd, float *Q, FwdCoilSet *coils, float *r
 }
 
 
+//*************************************************************************************************************
+
+int FwdCompData::fwd_comp_field_batch(float **rd, float **Q, int ndip, FwdCoilSet *coils, float **res, void *client)
+/*
+          * Calculate the compensated field (a block of dipoles)
+          */
+{
+    FwdCompData* comp = (FwdCompData*)client;
+    float        **work = NULL;
+    int          k;
+
+    if (!comp->batch_field) {
+        for (k = 0; k < ndip; k++)
+            if (fwd_comp_field(rd[k],Q[k],coils,res[k],client) == FAIL)
+                return FAIL;
+        return OK;
+    }
+    /*
+       * First compute the field in the primary set of coils
+       */
+    if (comp->batch_field(rd,Q,ndip,coils,res,comp->client) == FAIL)
+        return FAIL;
+    /*
+       * Compensation needed?
+       */
+    if (!comp->comp_coils || comp->comp_coils->ncoil <= 0 || !comp->set || !comp->set->current)
+        return OK;
+    /*
+       * Compute the field in the compensation coils
+       */
+    work = ALLOC_CMATRIX_60(ndip,comp->comp_coils->ncoil);
+    if (comp->batch_field(rd,Q,ndip,comp->comp_coils,work,comp->client) == FAIL)
+        goto bad;
+    /*
+       * Compute the compensated field
+       */
+    for (k = 0; k < ndip; k++)
+        if (MneCTFCompDataSet::mne_apply_ctf_comp(comp->set,TRUE,res[k],coils->ncoil,work[k],comp->comp_coils->ncoil) == FAIL)
+            goto bad;
+    FREE_CMATRIX_60(work);
+    return OK;
+
+bad : {
+        FREE_CMATRIX_60(work);
+        return FAIL;
+    }
+}
+
+
 //*************************************************************************************************************
 
 void FwdCompData::fwd_free_comp_data(void *d)
@@ -120,6 +120,12 @@ public:
 
     static int fwd_comp_field(float *rd,float *Q, FwdCoilSet* coils, float *res, void *client);
 
+    /*
+     * Calculate the compensated field of a block of dipoles with batch_field,
+     * or one dipole at a time with fwd_comp_field if it is not set
+     */
+    static int fwd_comp_field_batch(float **rd,float **Q, int ndip, FwdCoilSet* coils, float **res, void *client);
+
 
     /*
      * Routines to implement the reference channel compensation in field computations
@@ -156,6 +162,7 @@ public:
     fwdFieldFunc        field;      /* Computes the field of given direction dipole */
     fwdVecFieldFunc     vec_field;  /* Computes the fields of all three dipole components  */
     fwdFieldGradFunc    field_grad; /* Computes the field and gradient of one dipole direction */
+    fwdBatchFieldFunc   batch_field;/* Computes the fields of a block of dipoles (optional) */
     void                *client;    /* Client data to pass to the above functions */
     fwdUserFreeFunc     client_free;
     float               *work;      /* The work areas */
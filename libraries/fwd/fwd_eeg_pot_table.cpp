@@ -0,0 +1,155 @@
+//=============================================================================================================
+/**
+* @file     fwd_eeg_pot_table.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FwdEegPotTable class definition.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fwd_eeg_pot_table.h"
+#include "fwd_eeg_sphere_model.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FWDLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FwdEegPotTable::FwdEegPotTable()
+: nbeta(0)
+, ngamma(0)
+, beta_max(0.0)
+, ds(0.0)
+, dgamma(0.0)
+, tol(FWD_EEG_POT_TABLE_TOL)
+, nexact(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+bool FwdEegPotTable::build(const VectorXd& fn, int nterms, double beta_max, double tol)
+{
+    int nb;
+
+    nbeta = 0;
+    if (nterms <= 0 || fn.size() < nterms || beta_max <= 0.0 || beta_max >= 1.0 || tol <= 0.0)
+        return false;
+    this->beta_max = beta_max;
+    this->tol      = tol;
+    /*
+     * Refine until all cells are accurate enough
+     */
+    for (nb = 16; ; nb *= 2) {
+        nexact = tabulate(fn,nterms,nb);
+        if (nexact == 0 || 2*nb > FWD_EEG_POT_TABLE_MAX_NBETA)
+            break;
+    }
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+int FwdEegPotTable::tabulate(const VectorXd& fn, int nterms, int nb)
+{
+    ArrayXd cgamma,cgamma_half,beta,r,t,r_mid,t_mid;
+    double  beta_mid,scale_r,scale_t,Vr_int,Vt_int;
+    bool    bad;
+    int     i,j,k,nbad;
+
+    nbeta  = nb;
+    ngamma = 4*nb;
+    ds     = -log(1.0-beta_max)/nbeta;
+    dgamma = M_PI/ngamma;
+    cgamma      = ArrayXd::LinSpaced(ngamma+1,0.0,M_PI).cos();
+    cgamma_half = ArrayXd::LinSpaced(2*ngamma+1,0.0,M_PI).cos();
+    /*
+     * The nodes
+     */
+    Vr.resize(nbeta+1,ngamma+1);
+    Vt.resize(nbeta+1,ngamma+1);
+    for (i = 0; i <= nbeta; i++) {
+        beta = ArrayXd::Constant(ngamma+1,1.0-exp(-i*ds));
+        FwdEegSphereModel::calc_pot_components_batch(beta,cgamma,r,t,fn,nterms);
+        Vr.row(i) = r.transpose();
+        Vt.row(i) = t.transpose();
+    }
+    exact = Array<bool,Dynamic,Dynamic>::Constant(nbeta,ngamma,false);
+    /*
+     * Check the center and the edge midpoints of each cell
+     */
+    for (i = 0, nbad = 0; i < nbeta; i++) {
+        scale_r = tol*qMax(Vr.row(i).abs().maxCoeff(),Vr.row(i+1).abs().maxCoeff());
+        scale_t = tol*qMax(Vt.row(i).abs().maxCoeff(),Vt.row(i+1).abs().maxCoeff());
+        beta_mid = 1.0-exp(-(i+0.5)*ds);
+        beta = ArrayXd::Constant(2*ngamma+1,beta_mid);
+        FwdEegSphereModel::calc_pot_components_batch(beta,cgamma_half,r_mid,t_mid,fn,nterms);
+        beta = ArrayXd::Constant(2*ngamma+1,1.0-exp(-i*ds));
+        FwdEegSphereModel::calc_pot_components_batch(beta,cgamma_half,r,t,fn,nterms);
+        for (j = 0; j < ngamma; j++) {
+            for (k = 0; k < 3; k++) {
+                if (k == 0) {           /* Center */
+                    interpolate(i+0.5,j+0.5,&Vr_int,&Vt_int);
+                    bad = fabs(Vr_int-r_mid[2*j+1]) > scale_r || fabs(Vt_int-t_mid[2*j+1]) > scale_t;
+                }
+                else if (k == 1) {      /* Midpoint of the edge at constant gamma */
+                    interpolate(i+0.5,j,&Vr_int,&Vt_int);
+                    bad = fabs(Vr_int-r_mid[2*j]) > scale_r || fabs(Vt_int-t_mid[2*j]) > scale_t;
+                }
+                else {                  /* Midpoint of the edge at constant beta */
+                    interpolate(i,j+0.5,&Vr_int,&Vt_int);
+                    bad = fabs(Vr_int-r[2*j+1]) > scale_r || fabs(Vt_int-t[2*j+1]) > scale_t;
+                }
+                if (bad) {
+                    exact(i,j) = true;
+                    nbad++;
+                    break;
+                }
+            }
+        }
+    }
+    return nbad;
+}
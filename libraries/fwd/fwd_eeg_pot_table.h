@@ -0,0 +1,248 @@
+//=============================================================================================================
+/**
+* @file     fwd_eeg_pot_table.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FwdEegPotTable class declaration.
+*
+*/
+
+#ifndef FWDEEGPOTTABLE_H
+#define FWDEEGPOTTABLE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fwd_global.h"
+
+#include <cmath>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define FWD_EEG_POT_TABLE_TOL       1e-6    /**< Default tolerance of the interpolated series */
+#define FWD_EEG_POT_TABLE_MAX_NBETA 512     /**< Largest number of beta intervals tried */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FWDLIB
+//=============================================================================================================
+
+namespace FWDLIB
+{
+
+
+//=============================================================================================================
+/**
+* Tabulated series expansion of the multilayer sphere model, see FwdEegSphereModel::calc_pot_components.
+* The two potential components Vr and Vt are stored on a grid over s = -ln(1 - beta) and gamma = acos(cgamma)
+* and interpolated with cubic Lagrange polynomials in both directions. The logarithmic spacing puts the nodes
+* where the series converges slowly, i.e., for sources close to the innermost sphere.
+*
+* The grid is refined until the interpolation error at the center and at the edge midpoints of every cell is
+* below tol times the largest magnitude of the component at that beta. Cells which still fail at the finest
+* grid are marked and the caller has to evaluate the series there.
+*
+* @brief Interpolation table for the multilayer sphere model potentials
+*/
+class FWDSHARED_EXPORT FwdEegPotTable
+{
+public:
+    typedef QSharedPointer<FwdEegPotTable> SPtr;              /**< Shared pointer type for FwdEegPotTable. */
+    typedef QSharedPointer<const FwdEegPotTable> ConstSPtr;   /**< Const shared pointer type for FwdEegPotTable. */
+
+    //=========================================================================================================
+    /**
+    * Constructs an empty table.
+    */
+    FwdEegPotTable();
+
+    //=========================================================================================================
+    /**
+    * Tabulates the series for 0 <= beta <= beta_max.
+    *
+    * @param[in] fn         The series coefficients of the model
+    * @param[in] nterms     Number of coefficients
+    * @param[in] beta_max   Largest beta covered, the ratio of the innermost and outermost radii
+    * @param[in] tol        Accepted interpolation error relative to the largest magnitude at the same beta
+    *
+    * @return false if the arguments are invalid
+    */
+    bool build(const Eigen::VectorXd& fn, int nterms, double beta_max, double tol = FWD_EEG_POT_TABLE_TOL);
+
+    //=========================================================================================================
+    /**
+    * Interpolates the two potential components.
+    *
+    * @param[in] beta       rd/r
+    * @param[in] cgamma     Cosine of the angle between the source and field points
+    * @param[out] Vrp       Potential component for the radial dipole
+    * @param[out] Vtp       Potential component for the tangential dipole
+    *
+    * @return false if the point is not covered by the table, the series has to be evaluated then
+    */
+    inline bool eval(double beta, double cgamma, double *Vrp, double *Vtp) const;
+
+    //=========================================================================================================
+    /**
+    * Returns whether the table has been built.
+    *
+    * @return true if the table can be used
+    */
+    inline bool isEmpty() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Computes the nodes of a nbeta x 4*nbeta grid and marks the cells which do not meet the tolerance.
+    *
+    * @return the number of marked cells
+    */
+    int tabulate(const Eigen::VectorXd& fn, int nterms, int nbeta);
+
+    //=========================================================================================================
+    /**
+    * Interpolates the two components at the grid coordinates u = s/ds and v = gamma/dgamma.
+    */
+    inline void interpolate(double u, double v, double *Vrp, double *Vtp) const;
+
+    //=========================================================================================================
+    /**
+    * Cubic Lagrange weights for the nodes 0...3 at position t.
+    */
+    static inline void lagrange_weights(double t, double *w);
+
+public:
+    int     nbeta;                  /**< Number of intervals in s */
+    int     ngamma;                 /**< Number of intervals in gamma */
+    double  beta_max;               /**< Largest tabulated beta */
+    double  ds;                     /**< Node spacing in s */
+    double  dgamma;                 /**< Node spacing in gamma */
+    double  tol;                    /**< The requested accuracy */
+    int     nexact;                 /**< Number of cells where the series has to be evaluated */
+    Eigen::ArrayXXd Vr;             /**< Radial component at the nodes (nbeta+1 x ngamma+1) */
+    Eigen::ArrayXXd Vt;             /**< Tangential component at the nodes (nbeta+1 x ngamma+1) */
+    Eigen::Array<bool,Eigen::Dynamic,Eigen::Dynamic> exact;  /**< Cells not meeting the tolerance (nbeta x ngamma) */
+};
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool FwdEegPotTable::isEmpty() const
+{
+    return nbeta == 0;
+}
+
+
+//*************************************************************************************************************
+
+inline void FwdEegPotTable::lagrange_weights(double t, double *w)
+{
+    w[0] = -(t-1.0)*(t-2.0)*(t-3.0)/6.0;
+    w[1] = t*(t-2.0)*(t-3.0)/2.0;
+    w[2] = -t*(t-1.0)*(t-3.0)/2.0;
+    w[3] = t*(t-1.0)*(t-2.0)/6.0;
+}
+
+
+//*************************************************************************************************************
+
+inline void FwdEegPotTable::interpolate(double u, double v, double *Vrp, double *Vtp) const
+{
+    double wu[4],wv[4],r,t,rk,tk;
+    int    i0,j0,k,l;
+    /*
+     * Four nodes around the point, shifted inwards at the borders
+     */
+    i0 = qBound(0,int(u)-1,nbeta-3);
+    j0 = qBound(0,int(v)-1,ngamma-3);
+    lagrange_weights(u-i0,wu);
+    lagrange_weights(v-j0,wv);
+    r = t = 0.0;
+    for (l = 0; l < 4; l++) {
+        rk = tk = 0.0;
+        for (k = 0; k < 4; k++) {
+            rk += wu[k]*Vr(i0+k,j0+l);
+            tk += wu[k]*Vt(i0+k,j0+l);
+        }
+        r += wv[l]*rk;
+        t += wv[l]*tk;
+    }
+    *Vrp = r;
+    *Vtp = t;
+}
+
+
+//*************************************************************************************************************
+
+inline bool FwdEegPotTable::eval(double beta, double cgamma, double *Vrp, double *Vtp) const
+{
+    double u,v;
+
+    if (nbeta == 0 || beta < 0.0 || beta > beta_max)
+        return false;
+    if (cgamma > 1.0)
+        cgamma = 1.0;
+    else if (cgamma < -1.0)
+        cgamma = -1.0;
+    u = -log(1.0-beta)/ds;
+    v = acos(cgamma)/dgamma;
+    if (exact(qMin(int(u),nbeta-1),qMin(int(v),ngamma-1)))
+        return false;
+    interpolate(u,v,Vrp,Vtp);
+    return true;
+}
+
+} // NAMESPACE FWDLIB
+
+#endif // FWDEEGPOTTABLE_H
@@ -43,6 +43,7 @@
 
 #include "fwd_eeg_sphere_model.h"
 #include "fwd_eeg_sphere_model_set.h"
+#include "fwd_coil_points.h"
 
 
 #include <QtAlgorithms>
@@ -279,6 +280,7 @@ FwdEegSphereModel::FwdEegSphereModel(const FwdEegSphereModel& p_FwdEegSphereMode
         }
     }
     this->scale_pos = p_FwdEegSphereModel.scale_pos;
+    this->pot_table = p_FwdEegSphereModel.pot_table;
 }
 
 
@@ -485,6 +487,48 @@ double FwdEegSphereModel::fwd_eeg_get_multi_sphere_model_coeff(int n)
 }
 
 
+//*************************************************************************************************************
+
+void FwdEegSphereModel::fwd_eeg_setup_multi_sphere_coeff()
+{
+    int k;
+
+    if (this->fn.size() == 0 || this->nterms != MAXTERMS) {
+        this->fn.resize(MAXTERMS);
+        this->nterms = MAXTERMS;
+        for (k = 0; k < MAXTERMS; k++)
+            this->fn[k] = (2*k+3)*this->fwd_eeg_get_multi_sphere_model_coeff(k+1);
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool FwdEegSphereModel::fwd_eeg_setup_pot_table(double tol)
+{
+    FwdEegPotTable::SPtr table(new FwdEegPotTable);
+    double beta_max;
+
+    if (this->nlayer() == 0)
+        return false;
+    this->fwd_eeg_setup_multi_sphere_coeff();
+    /*
+     * Sources are inside the innermost sphere, electrodes on the outermost one
+     */
+    beta_max = this->layers[0].rel_rad/this->layers[this->nlayer()-1].rel_rad;
+    if (beta_max >= 1.0) {
+        printf("Cannot tabulate the EEG sphere model series for a single layer model.\n");
+        return false;
+    }
+    if (!table->build(this->fn,this->nterms,beta_max,tol))
+        return false;
+    printf("EEG sphere model series tabulated on a %d x %d grid (tolerance %g, %d cells computed exactly)\n",
+           table->nbeta+1,table->ngamma+1,tol,table->nexact);
+    this->pot_table = table;
+    return true;
+}
+
+
 //*************************************************************************************************************
 // fwd_multi_spherepot.c
 void FwdEegSphereModel::next_legen(int n, double x, double *p0, double *p01, double *p1, double *p11)        /* Input: P1(n-2) Output: P1(n-1) */
@@ -550,6 +594,46 @@ void FwdEegSphereModel::calc_pot_components(double beta, double cgamma, double *
 }
 
 
+//*************************************************************************************************************
+
+void FwdEegSphereModel::calc_pot_components_batch(const ArrayXd& beta, const ArrayXd& cgamma, ArrayXd& Vr, ArrayXd& Vt, const VectorXd& fn, int nterms)
+{
+    ArrayXd p0,p01,p1,p11,help0,help1;
+    ArrayXd betan = ArrayXd::Ones(beta.size());
+    ArrayXd multn;
+    int     n;
+
+    Vr = ArrayXd::Zero(beta.size());
+    Vt = ArrayXd::Zero(beta.size());
+    for (n = 1; n <= nterms; n++) {
+        /*
+         * betan decreases monotonically, a point stays done once it is below EPS
+         */
+        if ((betan < EPS).all())
+            break;
+        if (n == 1) {
+            p01 = ArrayXd::Ones(beta.size());
+            p0  = cgamma;
+            p11 = ArrayXd::Zero(beta.size());
+            p1  = (1.0-cgamma*cgamma).sqrt();
+        }
+        else {
+            help0 = p0;
+            help1 = p1;
+            p0  = ((2*n-1)*cgamma*help0 - (n-1)*p01)/n;
+            p1  = ((2*n-1)*cgamma*help1 - n*p11)/(n-1);
+            p01 = help0;
+            p11 = help1;
+        }
+        multn = (betan < EPS).select(0.0,betan*fn[n-1]);	/* The 2*n + 1 factor is included in fn */
+        Vr += multn*p0;
+        Vt += multn*p1/n;
+        betan *= beta;
+    }
+    return;
+}
+
+
 //*************************************************************************************************************
 // fwd_multi_spherepot.c
 int FwdEegSphereModel::fwd_eeg_multi_spherepot(float *rd, float *Q, float **el, int neeg, float *Vval, void *client)	  /* The model definition */
@@ -586,12 +670,7 @@ int FwdEegSphereModel::fwd_eeg_multi_spherepot(float *rd, float *Q, float **el,
     /*
        * Precompute the coefficients
        */
-    if (m->fn.size() == 0 || m->nterms != MAXTERMS) {
-        m->fn.resize(MAXTERMS);
-        m->nterms = MAXTERMS;
-        for (k = 0; k < MAXTERMS; k++)
-            m->fn[k] = (2*k+3)*m->fwd_eeg_get_multi_sphere_model_coeff(k+1);
-    }
+    m->fwd_eeg_setup_multi_sphere_coeff();
     /*
        * Move to the sphere coordinates
        */
@@ -647,7 +726,8 @@ int FwdEegSphereModel::fwd_eeg_multi_spherepot(float *rd, float *Q, float **el,
          */
         cos_gamma = VEC_DOT_1(pos,rd)/(rd_len*pos_len);
         beta = rd_len/pos_len;
-        calc_pot_components(beta,cos_gamma,&Vr,&Vt,m->fn,m->nterms);
+        if (!m->pot_table || !m->pot_table->eval(beta,cos_gamma,&Vr,&Vt))
+            calc_pot_components(beta,cos_gamma,&Vr,&Vt,m->fn,m->nterms);
         /*
          * Then compute the combined result
          */
@@ -716,6 +796,112 @@ int FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1(float *rd, float *Q, FwdCoi
 }
 
 
+//*************************************************************************************************************
+// fwd_multi_spherepot.c
+int FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1_batch(float **rd, float **Q, int ndip, FwdCoilSet *els, float **Vval, void *client)           /* Client data will be the sphere model definition */
+/*
+* Calculate the EEG in the sphere model for a block of dipoles, see fwd_eeg_multi_spherepot.
+* All electrode points are evaluated at once.
+*/
+{
+    FwdEegSphereModel* m = (FwdEegSphereModel*)client;
+    FwdCoilPoints::ConstSPtr pts = els->coil_points(true);
+    ArrayXd  px,py,pz,pos2,pos_len,scale;
+    ArrayXd  cos_gamma,beta,Vr,Vt,cos_beta;
+    ArrayXd  vx,vy,vz,v2;
+    MatrixXf V(pts->np,ndip);
+    double   my_rd[3],my_Q[3],vec1[3];
+    double   rd_len,Q2,c,v1,Qr,Qt;
+    double   pi4_inv = 0.25/M_PI;
+    int      j,k,p;
+    /*
+       * Precompute the coefficients
+       */
+    m->fwd_eeg_setup_multi_sphere_coeff();
+    /*
+       * Electrode positions in the sphere coordinates
+       */
+    px = pts->rx.cast<double>() - double(m->r0[X_1]);
+    py = pts->ry.cast<double>() - double(m->r0[Y_1]);
+    pz = pts->rz.cast<double>() - double(m->r0[Z_1]);
+    if (m->scale_pos) {
+        scale = double(m->layers[m->nlayer()-1].rad)/(px*px + py*py + pz*pz).sqrt();
+        px *= scale;
+        py *= scale;
+        pz *= scale;
+    }
+    pos2    = px*px + py*py + pz*pz;
+    pos_len = pos2.sqrt();
+
+    for (k = 0; k < ndip; k++) {
+        /*
+         * Move to the sphere coordinates
+         */
+        for (p = 0; p < 3; p++) {
+            my_rd[p] = rd[k][p] - m->r0[p];
+            my_Q[p]  = Q[k][p];
+        }
+        rd_len = VEC_LEN_1(my_rd);
+        Q2     = VEC_DOT_1(my_Q,my_Q);
+        /*
+         * Ignore dipoles outside the innermost sphere
+         */
+        if (rd_len >= m->layers[0].rad) {
+            V.col(k).setZero();
+            continue;
+        }
+        cos_gamma = (px*my_rd[X_1] + py*my_rd[Y_1] + pz*my_rd[Z_1])/(rd_len*pos_len);
+        beta      = rd_len/pos_len;
+        if (m->pot_table) {
+            Vr.resize(pts->np);
+            Vt.resize(pts->np);
+            for (j = 0; j < pts->np; j++)
+                if (!m->pot_table->eval(beta[j],cos_gamma[j],&Vr[j],&Vt[j]))
+                    calc_pot_components(beta[j],cos_gamma[j],&Vr[j],&Vt[j],m->fn,m->nterms);
+        }
+        else
+            calc_pot_components_batch(beta,cos_gamma,Vr,Vt,m->fn,m->nterms);
+        /*
+         * Special case: rd and Q are parallel
+         */
+        c = VEC_DOT_1(my_rd,my_Q)/(rd_len*sqrt(Q2));
+        if ((1.0-c*c) < SIN_EPS) {      /* Almost parallel: Q is purely radial */
+            Qr = sqrt(Q2);
+            V.col(k) = (pi4_inv*Qr*Vr/pos2).cast<float>().matrix();
+        }
+        else {
+            CROSS_PRODUCT_1(my_rd,my_Q,vec1);
+            v1 = VEC_LEN_1(vec1);
+            Qr = VEC_DOT_1(my_Q,my_rd)/rd_len;
+            Qt = sqrt(Q2 - Qr*Qr);
+            /*
+             * rd x pos for all electrodes
+             */
+            vx = my_rd[Y_1]*pz - py*my_rd[Z_1];
+            vy = -(my_rd[X_1]*pz - px*my_rd[Z_1]);
+            vz = my_rd[X_1]*py - px*my_rd[Y_1];
+            v2 = (vx*vx + vy*vy + vz*vz).sqrt();
+            cos_beta = (v2 > 0.0).select((vec1[X_1]*vx + vec1[Y_1]*vy + vec1[Z_1]*vz)/(v1*v2),0.0);
+            V.col(k) = (pi4_inv*(Qr*Vr + Qt*cos_beta*Vt)/pos2).cast<float>().matrix();
+        }
+    }
+    /*
+       * Scale by the conductivity if we have the layers
+       * defined
+       */
+    if (m->nlayer() > 0)
+        V *= 1.0f/m->layers[m->nlayer()-1].sigma;
+    /*
+       * Weighted sum over the points of each electrode
+       */
+    MatrixXf res = pts->w*V;
+    for (k = 0; k < ndip; k++)
+        for (j = 0; j < els->ncoil; j++)
+            Vval[k][j] = res(j,k);
+    return OK;
+}
+
+
 //*************************************************************************************************************
 // fwd_multi_spherepot.c
 bool FwdEegSphereModel::fwd_eeg_spherepot_vec( float   *rd, float   **el, int neeg, float **Vval_vec, void *client)
@@ -44,6 +44,7 @@
 #include "fwd_global.h"
 #include "fwd_eeg_sphere_layer.h"
 #include "fwd_coil_set.h"
+#include "fwd_eeg_pot_table.h"
 
 
 //*************************************************************************************************************
@@ -174,6 +175,27 @@ public:
     */
     double fwd_eeg_get_multi_sphere_model_coeff(int n);
 
+    //=========================================================================================================
+    /**
+    * Precomputes the series coefficients fn used by fwd_eeg_multi_spherepot. This is done on first use
+    * otherwise, call this before the potentials are computed in several threads.
+    */
+    void fwd_eeg_setup_multi_sphere_coeff();
+
+    //=========================================================================================================
+    /**
+    * Tabulates the series expansion of fwd_eeg_multi_spherepot, see FwdEegPotTable. Afterwards the potentials
+    * are interpolated from the table, the series is evaluated only where the table does not meet the tolerance
+    * or for electrodes closer to the origin than the outermost sphere. The table is shared with the copies
+    * of the model made afterwards.
+    *
+    * @param[in] tol    Accepted interpolation error relative to the largest magnitude of the potential
+    *                   components at the same source depth
+    *
+    * @return True when the table was built, false otherwise
+    */
+    bool fwd_eeg_setup_pot_table(double tol = FWD_EEG_POT_TABLE_TOL);
+
 
 
 
@@ -192,6 +214,17 @@ public:
                     const Eigen::VectorXd& fn,
                     int    nterms);
 
+    /*
+     * The same for many field points at once, the series of each point
+     * is cut at the same term as in calc_pot_components
+     */
+    static void calc_pot_components_batch(const Eigen::ArrayXd& beta,
+                                          const Eigen::ArrayXd& cgamma,
+                                          Eigen::ArrayXd& Vr,
+                                          Eigen::ArrayXd& Vt,
+                                          const Eigen::VectorXd& fn,
+                                          int    nterms);
+
     static int fwd_eeg_multi_spherepot(float   *rd,	          /* Dipole position */
                        float   *Q,	          /* Dipole moment */
                        float   **el,	  /* Electrode positions */
@@ -208,6 +241,13 @@ public:
                       float      *Vval,             /* The potential values */
                       void       *client);
 
+    static int fwd_eeg_multi_spherepot_coil1_batch(float **rd,         /* Dipole positions */
+                      float      **Q,               /* Dipole moments */
+                      int        ndip,              /* Number of dipoles */
+                      FwdCoilSet* els,              /* Electrode positions */
+                      float      **Vval,            /* The potential values, one row per dipole */
+                      void       *client);
+
 
 
 
@@ -382,6 +422,7 @@ public:
 
     Eigen::VectorXd fn;                 /**< Coefficients saved to speed up the computations */
     int             nterms;             /**< How many? */
+    FwdEegPotTable::SPtr pot_table;     /**< Optional interpolation table of the series */
 
     Eigen::VectorXf mu;             /**< The Berg-Scherg equivalence parameters */
     Eigen::VectorXf lambda;
@@ -100,9 +100,12 @@ FwdThreadArg::FwdThreadArg()
 ,field_pot     (NULL)
 ,vec_field_pot (NULL)
 ,field_pot_grad(NULL)
+,field_pot_batch(NULL)
 ,coils_els     (NULL)
 ,client        (NULL)
 ,s             (NULL)
+,first         (0)
+,last          (-1)
 ,fixed_ori     (FALSE)
 ,stat          (FAIL)
 ,comp          (-1)
@@ -129,13 +129,16 @@ public:
 public:
     float               **res;             /* Destination for the solution */
     float               **res_grad;        /* Gradient result */
-    int                 off;               /* Offset within the result to the first source space vertex solution */
+    int                 off;               /* Offset within the result to the solution of the first vertex processed */
     fwdFieldFunc        field_pot;         /* Computes the field or potential for one dipole orientation */
     fwdVecFieldFunc     vec_field_pot;     /* Computes the field or potential for all dipole orientations */
     fwdFieldGradFunc    field_pot_grad;    /* Computes the gradient of field or potential for one dipole orientation */
+    fwdBatchFieldFunc   field_pot_batch;   /* Computes the field or potential for a block of dipoles (optional) */
     FwdCoilSet          *coils_els;        /* The coil definitions */
     void                *client;           /* Client data for the field computation function */
     MNELIB::MneSourceSpaceOld   *s;                 /* The source space to process */
+    int                 first;             /* First source space vertex to process */
+    int                 last;              /* One past the last source space vertex to process, -1 for all */
     int                 fixed_ori;         /* Compute fixed orientation solution? */
     int                 comp;              /* Which component to compute for free orientations */
     int                 stat;
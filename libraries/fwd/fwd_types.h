@@ -22,6 +22,10 @@ typedef int (*fwdFieldFunc)(float *rd,float *Q,FWDLIB::FwdCoilSet* coils,float *
 typedef int (*fwdVecFieldFunc)(float *rd,FWDLIB::FwdCoilSet* coils,float **res,void *client);
 typedef int (*fwdFieldGradFunc)(float *rd,float *Q,FWDLIB::FwdCoilSet* coils, float *res,
                                 float *xgrad, float *ygrad, float *zgrad, void *client);
+/*
+ * Computes the fields or potentials of a block of dipoles, res[k] receives the result of dipole k
+ */
+typedef int (*fwdBatchFieldFunc)(float **rd,float **Q,int ndip,FWDLIB::FwdCoilSet* coils,float **res,void *client);
 
 
 
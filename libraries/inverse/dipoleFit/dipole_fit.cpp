@@ -6,6 +6,9 @@
 
 #include <string.h>
 
+#include <QThread>
+#include <QtConcurrent>
+
 
 
 using namespace INVERSELIB;
@@ -597,6 +600,163 @@ int mne_get_values_from_data_ch (float time,      /* Interesting time point */
 
 
 
+//*************************************************************************************************************
+/*
+ * Parallel fitting of time points
+ *
+ * The time points are picked from the data serially and collected into batches. The fits of a batch are
+ * distributed over the threads in an interleaved fashion since their cost varies. Each thread finds the initial
+ * guesses of its time points with one pass over the guess matrix. Each thread uses a workspace
+ * of its own because the forward calculation clients keep scratch space. The results are stored by time point
+ * and added to the ECDSet in time order, i.e., the output does not depend on the number of threads.
+ */
+
+#define FIT_BATCH_PER_THREAD 16
+
+struct FitDipolesBatch;
+
+struct FitDipolesThreadArg {
+    FitDipolesBatch*    batch;      /* The batch to work on */
+    dipoleFitWorkspace  work;       /* The forward calculation workspace of this thread (NULL = use the one in fit) */
+    int                 first;      /* This thread fits time points first, first + stride, ... */
+    int                 stride;
+};
+
+struct FitDipolesBatch {
+    DipoleFitData*  fit;            /* Precomputed fitting data */
+    GuessData*      guess;          /* The initial guesses */
+    int             verbose;
+    int             nmax;           /* Capacity of the batch */
+    int             ntime;          /* Number of time points in the batch */
+    float           *times;         /* The time points */
+    float           **data;         /* The data to fit, one row per time point */
+    QVector<ECD>    dips;           /* The fitted dipoles */
+    QVector<int>    ok;             /* Did the fits succeed? */
+    QList<FitDipolesThreadArg> args;
+};
+
+
+static void free_fit_dipoles_batch(FitDipolesBatch* batch)
+
+{
+    if (!batch)
+        return;
+    for (int k = 0; k < batch->args.size(); k++)
+        DipoleFitData::free_dipole_fit_workspace(batch->args[k].work);
+    FREE(batch->times);
+    FREE_CMATRIX(batch->data);
+    delete batch;
+    return;
+}
+
+
+static FitDipolesBatch* new_fit_dipoles_batch(DipoleFitData* fit,
+                                              GuessData*     guess,
+                                              int            nchan,
+                                              int            verbose,
+                                              int            nthreads)  /* How many threads (<= 0 : one per core) */
+
+{
+    FitDipolesBatch* batch = new FitDipolesBatch;
+
+    if (nthreads <= 0)
+        nthreads = QThread::idealThreadCount();
+    if (nthreads < 1)
+        nthreads = 1;
+
+    batch->fit     = fit;
+    batch->guess   = guess;
+    batch->verbose = verbose;
+    batch->nmax    = nthreads*FIT_BATCH_PER_THREAD;
+    batch->ntime   = 0;
+    batch->times   = MALLOC(batch->nmax,float);
+    batch->data    = ALLOC_CMATRIX(batch->nmax,nchan);
+    batch->dips.resize(batch->nmax);
+    batch->ok.resize(batch->nmax);
+
+    for (int k = 0; k < nthreads; k++) {
+        FitDipolesThreadArg arg;
+        arg.batch  = batch;
+        arg.first  = k;
+        arg.stride = nthreads;
+        /*
+         * A single thread can use the workspace in fit
+         */
+        arg.work   = nthreads > 1 ? DipoleFitData::new_dipole_fit_workspace(fit) : NULL;
+        batch->args.append(arg);
+    }
+    if (nthreads > 1)
+        fprintf(stderr,"Fitting with %d threads.\n",nthreads);
+    return batch;
+}
+
+
+static void fit_dipoles_one_thread(FitDipolesThreadArg& arg)
+
+{
+    FitDipolesBatch* batch = arg.batch;
+    QVector<float>   times;
+    QVector<float*>  data;
+    QVector<ECD>     dips;
+    QVector<int>     ok;
+    int              k,j;
+    /*
+     * The initial guesses of all time points of this thread are scored together
+     */
+    for (k = arg.first; k < batch->ntime; k += arg.stride) {
+        times.append(batch->times[k]);
+        data.append(batch->data[k]);
+    }
+    if (times.isEmpty())
+        return;
+    dips.resize(times.size());
+    ok.resize(times.size());
+
+    DipoleFitData::fit_batch(batch->fit,arg.work,batch->guess,times.data(),data.data(),times.size(),batch->verbose,dips.data(),ok.data());
+
+    for (k = arg.first, j = 0; k < batch->ntime; k += arg.stride, j++) {
+        batch->dips[k] = dips[j];
+        batch->ok[k]   = ok[j];
+    }
+    return;
+}
+
+
+static void fit_dipoles_batch(FitDipolesBatch* batch,
+                              ECDSet&          set,
+                              int              report_interval)
+/*
+ * Fit the time points of the batch and add the dipoles to the set in time order
+ */
+{
+    int k;
+
+    if (batch->ntime <= 0)
+        return;
+
+    if (batch->args.size() > 1)
+        QtConcurrent::blockingMap(batch->args, fit_dipoles_one_thread);
+    else
+        fit_dipoles_one_thread(batch->args[0]);
+
+    for (k = 0; k < batch->ntime; k++) {
+        if (!batch->ok[k])
+            printf("t = %7.1f ms : %s\n",1000*batch->times[k],"error (tbd: catch)");
+        else {
+            set.addEcd(batch->dips[k]);
+            if (batch->verbose)
+                batch->dips[k].print(stdout);
+            else {
+                if (set.size() % report_interval == 0)
+                    fprintf(stderr,"%d..",set.size());
+            }
+        }
+    }
+    batch->ntime = 0;
+    return;
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -710,11 +870,11 @@ ECDSet DipoleFit::calculateFit() const
 
 
     if (raw) {
-        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose) == FAIL)
+        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,settings->nthreads) == FAIL)
             goto out;
     }
     else {
-        if (fit_dipoles(settings->measname,data,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set) == FAIL)
+        if (fit_dipoles(settings->measname,data,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set,settings->nthreads) == FAIL)
             goto out;
     }
     printf("%d dipoles fitted\n",set.size());
@@ -728,14 +888,13 @@ out : {
 
 //*************************************************************************************************************
 
-int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
+int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads)
 {
-    float *one = MALLOC(data->nchan,float);
     float time;
     ECDSet set;
-    ECD   dip;
     int   s;
     int   report_interval = 10;
+    FitDipolesBatch* batch = new_fit_dipoles_batch(fit,guess,data->nchan,verbose,nthreads);
 
     set.dataname = dataname;
 
@@ -745,26 +904,21 @@ int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFi
      * Pick the data point
      */
         if (mne_get_values_from_data(time,integ,data->current->data,data->current->np,data->nchan,data->current->tmin,
-                                     1.0/data->current->tstep,FALSE,one) == FAIL) {
+                                     1.0/data->current->tstep,FALSE,batch->data[batch->ntime]) == FAIL) {
             fprintf(stderr,"Cannot pick time: %7.1f ms\n",1000*time);
             continue;
         }
-
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            printf("t = %7.1f ms : %s\n",1000*time,"error (tbd: catch)");
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
-        }
+        batch->times[batch->ntime++] = time;
+        /*
+     * Fit when the batch is full
+     */
+        if (batch->ntime == batch->nmax)
+            fit_dipoles_batch(batch,set,report_interval);
     }
+    fit_dipoles_batch(batch,set,report_interval);
     if (!verbose)
         fprintf(stderr,"[done]\n");
-    FREE(one);
+    free_fit_dipoles_batch(batch);
     p_set = set;
     return OK;
 }
@@ -772,9 +926,8 @@ int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFi
 
 //*************************************************************************************************************
 
-int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
+int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads)
 {
-    float *one    = MALLOC(sel->nchan,float);
     float sfreq   = raw->info->sfreq;
     float myinteg = integ > 0.0 ? 2*integ : 0.1;
     int   overlap = ceil(myinteg*sfreq);
@@ -785,9 +938,9 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
     int   s,picks;
     float time,stime;
     float **data  = ALLOC_CMATRIX(sel->nchan,length);
-    ECD    dip;
     ECDSet set;
     int    report_interval = 10;
+    FitDipolesBatch* batch = new_fit_dipoles_batch(fit,guess,sel->nchan,verbose,nthreads);
 
     set.dataname = dataname;
 
@@ -810,35 +963,28 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
         /*
      * Get the values
      */
-        if (mne_get_values_from_data_ch (time,integ,data,length,sel->nchan,stime,sfreq,FALSE,one) == FAIL) {
+        if (mne_get_values_from_data_ch (time,integ,data,length,sel->nchan,stime,sfreq,FALSE,batch->data[batch->ntime]) == FAIL) {
             fprintf(stderr,"Cannot pick time: %8.3f s\n",time);
             continue;
         }
+        batch->times[batch->ntime++] = time;
         /*
-     * Fit
+     * Fit when the batch is full
      */
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            qWarning() << "Error";
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
-        }
+        if (batch->ntime == batch->nmax)
+            fit_dipoles_batch(batch,set,report_interval);
     }
+    fit_dipoles_batch(batch,set,report_interval);
     if (!verbose)
         fprintf(stderr,"[done]\n");
     FREE_CMATRIX(data);
-    FREE(one);
+    free_fit_dipoles_batch(batch);
     p_set = set;
     return OK;
 
 bad : {
         FREE_CMATRIX(data);
-        FREE(one);
+        free_fit_dipoles_batch(batch);
         return FAIL;
     }
 }
@@ -846,8 +992,8 @@ bad : {
 
 //*************************************************************************************************************
 
-int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose)
+int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, int nthreads)
 {
     ECDSet set;
-    return fit_dipoles_raw(dataname, raw, sel, fit, guess, tmin, tmax, tstep, integ, verbose, set);
+    return fit_dipoles_raw(dataname, raw, sel, fit, guess, tmin, tmax, tstep, integ, verbose, set, nthreads);
 }
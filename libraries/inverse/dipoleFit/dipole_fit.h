@@ -119,10 +119,12 @@ public:
     * @param[in] integ      Integration time
     * @param[in] verbose    Verbose output?
     * @param[out] p_set     the fitted ECD Set
+    * @param[in] nthreads   Number of threads fitting time points in parallel (<= 0: one per core). The result
+    *                       does not depend on it.
     *
     * @return true when successful
     */
-    static int fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set);
+    static int fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads = 1);
 
     //=========================================================================================================
     /**
@@ -141,10 +143,12 @@ public:
     * @param[in] integ      Integration time
     * @param[in] verbose    Verbose output?
     * @param[out] p_set     Return all results here. Warning: for large data files this may take a lot of memory
+    * @param[in] nthreads   Number of threads fitting time points in parallel (<= 0: one per core). The result
+    *                       does not depend on it.
     *
     * @return true when successful
     */
-    static int fit_dipoles_raw(const QString& dataname, MNELIB::MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set);
+    static int fit_dipoles_raw(const QString& dataname, MNELIB::MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads = 1);
 
     //=========================================================================================================
     /**
@@ -162,10 +166,11 @@ public:
     * @param[in] tstep      Time step to use
     * @param[in] integ      Integration time
     * @param[in] verbose    Verbose output?
+    * @param[in] nthreads   Number of threads fitting time points in parallel (<= 0: one per core).
     *
     * @return true when successful
     */
-    static int fit_dipoles_raw(const QString& dataname, MNELIB::MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose);
+    static int fit_dipoles_raw(const QString& dataname, MNELIB::MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, int nthreads = 1);
 
 private:
     DipoleFitSettings* settings;
@@ -561,6 +561,8 @@ FiffSparseMatrix* mne_convert_to_sparse_3(float **dense,        /* The dense mat
 
 
 typedef struct {
+    DipoleFitData*  fit;
+    dipoleFitFuncs  funcs;
     float          limit;
     int            report_dim;
     float          *B;
@@ -1606,6 +1608,106 @@ static dipoleFitFuncs new_dipole_fit_funcs()
 }
 
 
+//*************************************************************************************************************
+
+static FwdBemModel* dup_bem_model_workspace(FwdBemModel* orig)
+/*
+ * Shallow copy of a BEM model with its own space for the infinite-medium potentials
+ */
+{
+    FwdBemModel* res = new FwdBemModel();
+
+    *res    = *orig;
+    res->v0 = NULL;
+
+    return res;
+}
+
+
+//*************************************************************************************************************
+
+static void free_bem_model_workspace(FwdBemModel* m)
+
+{
+    if (!m)
+        return;
+    /*
+     * Everything except v0 belongs to the original model
+     */
+    m->surfs.clear();
+    m->nsurf       = 0;
+    m->ntri        = NULL;
+    m->np          = NULL;
+    m->sigma       = NULL;
+    m->gamma       = NULL;
+    m->source_mult = NULL;
+    m->field_mult  = NULL;
+    m->solution    = NULL;
+    m->head_mri_t  = NULL;
+
+    delete m;
+    return;
+}
+
+
+//*************************************************************************************************************
+
+static dipoleFitFuncs dup_dipole_fit_funcs(dipoleFitFuncs orig,
+                                           FwdBemModel*   orig_bem,    /* The BEM model used by orig */
+                                           FwdBemModel*   bem)         /* Use this copy of it instead */
+/*
+ * Create a duplicate to make the forward calculation thread safe
+ * Do not duplicate read-only parts of the relevant structures
+ */
+{
+    dipoleFitFuncs f = new_dipole_fit_funcs();
+
+    *f = *orig;
+    f->meg_client_free = NULL;
+    f->eeg_client_free = NULL;
+
+    if (orig->meg_client) {
+        FwdCompData* orig_comp = (FwdCompData*)orig->meg_client;
+        FwdCompData* comp      = new FwdCompData();
+
+        *comp = *orig_comp;
+        comp->work        = NULL;
+        comp->vec_work    = NULL;
+        comp->client_free = NULL;
+        comp->set         = orig_comp->set ? new MneCTFCompDataSet(*(orig_comp->set)) : NULL;
+        if (bem && comp->client == orig_bem)
+            comp->client = bem;
+        f->meg_client = comp;
+    }
+    if (bem && f->eeg_client == orig_bem)
+        f->eeg_client = bem;
+
+    return f;
+}
+
+
+//*************************************************************************************************************
+
+static void free_dipole_fit_funcs_dup(dipoleFitFuncs f)
+
+{
+    if (!f)
+        return;
+
+    if (f->meg_client) {
+        FwdCompData* comp = (FwdCompData*)f->meg_client;
+        /*
+         * The coils and the client belong to the original
+         */
+        comp->comp_coils = NULL;
+        comp->client     = NULL;
+        delete comp;
+    }
+    FREE_3(f);
+    return;
+}
+
+
 
 
 //============================= mne_simplex_fit.c =============================
@@ -4639,6 +4741,7 @@ out : {
 //*************************************************************************************************************
 
 DipoleForward* dipole_forward(DipoleFitData* d,
+                              dipoleFitFuncs funcs,
                               float         **rd,
                               int           ndip,
                               DipoleForward* old)
@@ -4675,7 +4778,7 @@ DipoleForward* dipole_forward(DipoleFitData* d,
         /*
      * Calculate the field of three orthogonal dipoles
      */
-        if ((DipoleFitData::compute_dipole_field(d,rd[k],TRUE,this_fwd)) == FAIL)
+        if ((DipoleFitData::compute_dipole_field(d,funcs,rd[k],TRUE,this_fwd)) == FAIL)
             goto bad;
         /*
      * Choice of column normalization
@@ -4734,10 +4837,24 @@ DipoleForward* DipoleFitData::dipole_forward_one(DipoleFitData* d,
 /*
  * Convenience function to compute the field of one dipole
  */
+{
+    return dipole_forward_one(d,d->funcs,rd,old);
+}
+
+
+//*************************************************************************************************************
+
+DipoleForward* DipoleFitData::dipole_forward_one(DipoleFitData* d,
+                                                 dipoleFitFuncs funcs,
+                                                 float         *rd,
+                                                 DipoleForward* old)
+/*
+ * Compute the field of one dipole with the given forward functions
+ */
 {
     float *rds[1];
     rds[0] = rd;
-    return dipole_forward(d,rds,1,old);
+    return dipole_forward(d,funcs,rds,1,old);
 }
 
 
@@ -4748,13 +4865,12 @@ static float fit_eval(float *rd,int npar,void *user)
  * Calculate the residual sum of squares
  */
 {
-    DipoleFitData* fit   = (DipoleFitData*)user;
+    fitDipUser       fuser = (fitDipUser)user;
     DipoleForward* fwd;
-    fitDipUser       fuser = (fitDipUser)fit->user;
     double        Bm2,one;
     int           ncomp,c;
 
-    fwd = fuser->fwd = DipoleFitData::dipole_forward_one(fit,rd,fuser->fwd);
+    fwd = fuser->fwd = DipoleFitData::dipole_forward_one(fuser->fit,fuser->funcs,rd,fuser->fwd);
     ncomp = fwd->sing[2]/fwd->sing[0] > fuser->limit ? 3 : 2;
     if (fuser->report_dim)
         fprintf(stderr,"ncomp = %d\n",ncomp);
@@ -4773,47 +4889,6 @@ static float fit_eval(float *rd,int npar,void *user)
 
 
 
-static int find_best_guess(float     *B,         /* The whitened data */
-                           int       nch,
-                           GuessData* guess,	 /* Guesses */
-                           float     limit,	 /* Pseudoradial component omission limit */
-                           int       *bestp,	 /* Which is the best */
-                           float     *goodp)	 /* Best goodness of fit */
-/*
- * Thanks to the precomputed SVD everything is really simple
- */
-{
-    int    k,c;
-    double B2,Bm2,this_good,one;
-    int    best = -1;
-    float  good = 0.0;
-    DipoleForward* fwd;
-    int    ncomp;
-
-    B2 = mne_dot_vectors_3(B,B,nch);
-    for (k = 0; k < guess->nguess; k++) {
-        fwd = guess->guess_fwd[k];
-        if (fwd->nch == nch) {
-            ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
-            for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
-                one = mne_dot_vectors_3(fwd->uu[c],B,nch);
-                Bm2 = Bm2 + one*one;
-            }
-            this_good = 1.0 - (B2 - Bm2)/B2;
-            if (this_good > good) {
-                best = k;
-                good = this_good;
-            }
-        }
-    }
-    if (best < 0) {
-        printf("No reasonable initial guess found.");
-        return FAIL;
-    }
-    *bestp = best;
-    *goodp = good;
-    return OK;
-}
 
 
 
@@ -4889,6 +4964,7 @@ static int report_func(int     loop,
 
 
 static int fit_Q(DipoleFitData* fit,	     /* The fit data */
+                 dipoleFitFuncs funcs,	     /* The forward functions to use */
                  float *B,		     /* Measurement */
                  float *rd,		     /* Dipole position */
                  float limit,		     /* Radial component omission limit */
@@ -4900,7 +4976,7 @@ static int fit_Q(DipoleFitData* fit,	     /* The fit data */
  */
 {
     int c;
-    DipoleForward* fwd = DipoleFitData::dipole_forward_one(fit,rd,NULL);
+    DipoleForward* fwd = DipoleFitData::dipole_forward_one(fit,funcs,rd,NULL);
     float Bm2,one;
 
     if (!fwd)
@@ -5112,6 +5188,9 @@ int simplex_minimize(float **p,		                              /* The initial si
 
 //*************************************************************************************************************
 // fit_dipoles.c
+
+#define FIT_GUESS_LIMIT 0.2f    /* (pseudo) radial component omission limit */
+
 bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitting data */
                     GuessData*     guess,	            /* The initial guesses */
                     float         time,              /* Which time is it? */
@@ -5120,9 +5199,99 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
                     ECD&          res               /* The fitted dipole */
                     )
 {
+    return fit_one(fit,NULL,guess,time,B,verbose,res);
+}
+
+
+//*************************************************************************************************************
+
+bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitting data */
+                    dipoleFitWorkspace work,         /* Forward functions of this thread (NULL = the ones in fit) */
+                    GuessData*     guess,	            /* The initial guesses */
+                    float         time,              /* Which time is it? */
+                    float         *B,	            /* The field to fit */
+                    int           verbose,
+                    ECD&          res               /* The fitted dipole */
+                    )
+{
+    int ok;
+
+    fit_batch(fit,work,guess,&time,&B,1,verbose,&res,&ok);
+    return ok;
+}
+
+
+//*************************************************************************************************************
+
+bool DipoleFitData::fit_batch(DipoleFitData* fit,	        /* Precomputed fitting data */
+                      dipoleFitWorkspace work,     /* Forward functions of this thread (NULL = the ones in fit) */
+                      GuessData*     guess,	        /* The initial guesses */
+                      float         *times,        /* Which times are these? */
+                      float         **B,	        /* The fields to fit */
+                      int           ntime,         /* How many time points */
+                      int           verbose,
+                      ECD           *res,          /* The fitted dipoles */
+                      int           *ok            /* Which fits succeeded */
+                      )
+/*
+ * The initial guesses of all time points are scored together with one matrix product
+ */
+{
+    int      nchan = fit->nmeg+fit->neeg;
+    int      k,p;
+    bool     all_ok = true;
+    VectorXi best;
+    VectorXf good;
+
+    for (k = 0; k < ntime; k++)
+        ok[k] = FALSE;
+    if (ntime <= 0)
+        return true;
+
+    MatrixXf matB(nchan,ntime);
+    for (k = 0; k < ntime; k++) {
+        if (MneProjOp::mne_proj_op_proj_vector(fit->proj,B[k],nchan,TRUE) == FAIL)
+            return false;
+        if (mne_whiten_one_data(B[k],B[k],nchan,fit->noise) == FAIL)
+            return false;
+        for (p = 0; p < nchan; p++)
+            matB(p,k) = B[k][p];
+    }
+    /*
+     * Get the initial guesses
+     */
+    guess->find_best_guesses(matB,FIT_GUESS_LIMIT,best,good);
+
+    for (k = 0; k < ntime; k++) {
+        if (best[k] < 0) {
+            printf("No reasonable initial guess found.");
+            all_ok = false;
+            continue;
+        }
+        ok[k] = fit_one_from_guess(fit,work,guess->rr[best[k]],times[k],B[k],verbose,res[k]);
+        if (!ok[k])
+            all_ok = false;
+    }
+    return all_ok;
+}
+
+
+//*************************************************************************************************************
+
+bool DipoleFitData::fit_one_from_guess(DipoleFitData* fit,	    /* Precomputed fitting data */
+                               dipoleFitWorkspace work, /* Forward functions of this thread (NULL = the ones in fit) */
+                               float         *rr,       /* The initial guess */
+                               float         time,      /* Which time is it? */
+                               float         *B,	    /* The projected and whitened field to fit */
+                               int           verbose,
+                               ECD&          res        /* The fitted dipole */
+                               )
+{
+    dipoleFitFuncs sphere_funcs    = work ? work->sphere_funcs : fit->sphere_funcs;
+    dipoleFitFuncs bem_funcs       = work ? work->bem_funcs : fit->bem_funcs;
     float  **simplex       = NULL;	       /* The simplex */
     float  vals[4];			       /* Values at the vertices */
-    float  limit           = 0.2;	               /* (pseudo) radial component omission limit */
+    float  limit           = FIT_GUESS_LIMIT;     /* (pseudo) radial component omission limit */
     float  size            = 1e-2;	       /* Size of the initial simplex */
     float  ftol[]          = { 1e-2, 1e-2 };     /* Tolerances on the the two passes */
     float  atol[]          = { 0.2e-3, 0.2e-3 }; /* If dipole movement between two iterations is less than this,
@@ -5131,8 +5300,7 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     int    max_eval        = 1000;	       /* Limit for fit function evaluations */
     int    report_interval = verbose ? 1 : -1;   /* How often to report the intermediate result */
 
-    int        best;
-    float      good,rd_guess[3],rd_final[3],Q[3],final_val;
+    float      rd_guess[3],rd_final[3],Q[3],final_val;
     fitDipUserRec user;
     int        k,p,neval,neval_tot,nchan,ncomp;
     int        fit_fail;
@@ -5140,27 +5308,16 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     nchan = fit->nmeg+fit->neeg;
     user.fwd = NULL;
 
-    if (MneProjOp::mne_proj_op_proj_vector(fit->proj,B,nchan,TRUE) == FAIL)
-        goto bad;
-
-    if (mne_whiten_one_data(B,B,nchan,fit->noise) == FAIL)
-        goto bad;
-    /*
-   * Get the initial guess
-   */
-    if (find_best_guess(B,nchan,guess,limit,&best,&good) < 0)
-        goto bad;
-
-
+    user.fit   = fit;
+    user.funcs = sphere_funcs;
     user.limit = limit;
     user.B     = B;
     user.B2    = mne_dot_vectors_3(B,B,nchan);
     user.fwd   = NULL;
     user.report_dim = FALSE;
-    fit->user  = &user;
 
-    VEC_COPY_3(rd_guess,guess->rr[best]);
-    VEC_COPY_3(rd_final,guess->rr[best]);
+    VEC_COPY_3(rd_guess,rr);
+    VEC_COPY_3(rd_final,rr);
 
     neval_tot = 0;
     fit_fail = FALSE;
@@ -5169,20 +5326,20 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
      * Do first pass with the sphere model
      */
         if (k == 0)
-            fit->funcs = fit->sphere_funcs;
+            user.funcs = sphere_funcs;
         else
-            fit->funcs = !fit->bemname.isEmpty() ? fit->bem_funcs : fit->sphere_funcs;
+            user.funcs = !fit->bemname.isEmpty() ? bem_funcs : sphere_funcs;
 
         simplex = make_initial_dipole_simplex(rd_guess,size);
         for (p = 0; p < 4; p++)
-            vals[p] = fit_eval(simplex[p],3,fit);
+            vals[p] = fit_eval(simplex[p],3,&user);
         if (simplex_minimize(simplex,           /* The initial simplex */
                              vals,              /* Function values at the vertices */
                              3,                 /* Number of variables */
                              ftol[k],           /* Relative convergence tolerance for the target function */
                              atol[k],           /* Absolute tolerance for the change in the parameters */
                              fit_eval,          /* The function to be evaluated */
-                             fit,               /* Data to be passed to the above function in each evaluation */
+                             &user,             /* Data to be passed to the above function in each evaluation */
                              max_eval,          /* Maximum number of function evaluations */
                              &neval,            /* Number of function evaluations */
                              report_interval,   /* How often to report (-1 = no_reporting) */
@@ -5208,7 +5365,7 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     /*
    * Compute the dipole moment at the final point
    */
-    if (fit_Q(fit,user.B,rd_final,user.limit,Q,&ncomp,&final_val) == OK) {
+    if (fit_Q(fit,user.funcs,user.B,rd_final,user.limit,Q,&ncomp,&final_val) == OK) {
         res.time  = time;
         res.valid = true;
         for(int i = 0; i < 3; ++i)
@@ -5240,6 +5397,43 @@ bad : {
 }
 
 
+//*************************************************************************************************************
+
+dipoleFitWorkspace DipoleFitData::new_dipole_fit_workspace(DipoleFitData* fit)
+{
+    dipoleFitWorkspace work = MALLOC_3(1,dipoleFitWorkspaceRec);
+
+    work->sphere_funcs = NULL;
+    work->bem_funcs    = NULL;
+    work->bem_model    = NULL;
+
+    if (fit->bem_model)
+        work->bem_model = dup_bem_model_workspace(fit->bem_model);
+    if (fit->sphere_funcs)
+        work->sphere_funcs = dup_dipole_fit_funcs(fit->sphere_funcs,NULL,NULL);
+    if (fit->bem_funcs)
+        work->bem_funcs = dup_dipole_fit_funcs(fit->bem_funcs,fit->bem_model,work->bem_model);
+
+    return work;
+}
+
+
+//*************************************************************************************************************
+
+void DipoleFitData::free_dipole_fit_workspace(dipoleFitWorkspace work)
+{
+    if (!work)
+        return;
+
+    free_dipole_fit_funcs_dup(work->sphere_funcs);
+    free_dipole_fit_funcs_dup(work->bem_funcs);
+    free_bem_model_workspace(work->bem_model);
+
+    FREE_3(work);
+    return;
+}
+
+
 
 
 
@@ -5256,6 +5450,17 @@ int DipoleFitData::compute_dipole_field(DipoleFitData* d, float *rd, int whiten,
 /*
  * Compute the field and take whitening and projection into account
  */
+{
+    return compute_dipole_field(d,d->funcs,rd,whiten,fwd);
+}
+
+
+//*************************************************************************************************************
+
+int DipoleFitData::compute_dipole_field(DipoleFitData* d, dipoleFitFuncs funcs, float *rd, int whiten, float **fwd)
+/*
+ * Compute the field with the given forward functions and take whitening and projection into account
+ */
 {
     float *eeg_fwd[3];
     static float Qx[] = {1.0,0.0,0.0};
@@ -5266,34 +5471,34 @@ int DipoleFitData::compute_dipole_field(DipoleFitData* d, float *rd, int whiten,
    * Compute the fields
    */
     if (d->nmeg > 0) {
-        if (d->funcs->meg_vec_field) {
-            if (d->funcs->meg_vec_field(rd,d->meg_coils,fwd,d->funcs->meg_client) != OK)
+        if (funcs->meg_vec_field) {
+            if (funcs->meg_vec_field(rd,d->meg_coils,fwd,funcs->meg_client) != OK)
                 goto bad;
         }
         else {
-            if (d->funcs->meg_field(rd,Qx,d->meg_coils,fwd[0],d->funcs->meg_client) != OK)
+            if (funcs->meg_field(rd,Qx,d->meg_coils,fwd[0],funcs->meg_client) != OK)
                 goto bad;
-            if (d->funcs->meg_field(rd,Qy,d->meg_coils,fwd[1],d->funcs->meg_client) != OK)
+            if (funcs->meg_field(rd,Qy,d->meg_coils,fwd[1],funcs->meg_client) != OK)
                 goto bad;
-            if (d->funcs->meg_field(rd,Qz,d->meg_coils,fwd[2],d->funcs->meg_client) != OK)
+            if (funcs->meg_field(rd,Qz,d->meg_coils,fwd[2],funcs->meg_client) != OK)
                 goto bad;
         }
     }
 
     if (d->neeg > 0) {
-        if (d->funcs->eeg_vec_pot) {
+        if (funcs->eeg_vec_pot) {
             eeg_fwd[0] = fwd[0]+d->nmeg;
             eeg_fwd[1] = fwd[1]+d->nmeg;
             eeg_fwd[2] = fwd[2]+d->nmeg;
-            if (d->funcs->eeg_vec_pot(rd,d->eeg_els,eeg_fwd,d->funcs->eeg_client) != OK)
+            if (funcs->eeg_vec_pot(rd,d->eeg_els,eeg_fwd,funcs->eeg_client) != OK)
                 goto bad;
         }
         else {
-            if (d->funcs->eeg_pot(rd,Qx,d->eeg_els,fwd[0]+d->nmeg,d->funcs->eeg_client) != OK)
+            if (funcs->eeg_pot(rd,Qx,d->eeg_els,fwd[0]+d->nmeg,funcs->eeg_client) != OK)
                 goto bad;
-            if (d->funcs->eeg_pot(rd,Qy,d->eeg_els,fwd[1]+d->nmeg,d->funcs->eeg_client) != OK)
+            if (funcs->eeg_pot(rd,Qy,d->eeg_els,fwd[1]+d->nmeg,funcs->eeg_client) != OK)
                 goto bad;
-            if (d->funcs->eeg_pot(rd,Qz,d->eeg_els,fwd[2]+d->nmeg,d->funcs->eeg_client) != OK)
+            if (funcs->eeg_pot(rd,Qz,d->eeg_els,fwd[2]+d->nmeg,funcs->eeg_client) != OK)
                 goto bad;
         }
     }
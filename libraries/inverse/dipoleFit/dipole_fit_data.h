@@ -91,6 +91,16 @@ typedef struct {
   mneUserFreeFunc eeg_client_free;
 } *dipoleFitFuncs,dipoleFitFuncsRec;
 
+/*
+ * The forward calculation clients keep scratch space of their own.
+ * Each thread which calls fit_one concurrently needs a private copy of them.
+ */
+typedef struct {
+  dipoleFitFuncs  sphere_funcs;	    /* Sphere model forward functions with private workspace */
+  dipoleFitFuncs  bem_funcs;	    /* BEM forward functions with private workspace */
+  FWDLIB::FwdBemModel *bem_model;   /* Copy of the BEM model with private workspace */
+} *dipoleFitWorkspace,dipoleFitWorkspaceRec;
+
 
 
 
@@ -214,18 +224,93 @@ public:
     */
     static bool fit_one(DipoleFitData* fit, GuessData* guess, float time, float *B, int verbose, ECD& res);
 
+    //=========================================================================================================
+    /**
+    * Fit a single dipole to the given data using the forward functions of a workspace. Does not modify fit,
+    * so several threads may fit different time points at once as long as each one uses a workspace of its own.
+    *
+    * @param[in] fit        Precomputed fitting data
+    * @param[in] work       The workspace of the calling thread, NULL to use the forward functions of fit
+    * @param[in] guess      The initial guesses
+    * @param[in] time       Which time is it?
+    * @param[in] B          The field to fit
+    * @param[in] verbose
+    * @param[in] res        The fitted dipole
+    */
+    static bool fit_one(DipoleFitData* fit, dipoleFitWorkspace work, GuessData* guess, float time, float *B, int verbose, ECD& res);
+
+    //=========================================================================================================
+    /**
+    * Fit dipoles to a block of time points. The data are projected and whitened in place and the initial
+    * guesses of all time points are found with one pass over the guess matrix (see
+    * GuessData::find_best_guesses). Does not modify fit, see fit_one.
+    *
+    * @param[in] fit        Precomputed fitting data
+    * @param[in] work       The workspace of the calling thread, NULL to use the forward functions of fit
+    * @param[in] guess      The initial guesses
+    * @param[in] times      The times of the time points
+    * @param[in] B          The fields to fit, one for each time point
+    * @param[in] ntime      Number of time points
+    * @param[in] verbose
+    * @param[out] res       The fitted dipoles
+    * @param[out] ok        Whether the fit succeeded, one for each time point
+    *
+    * @return true if all fits succeeded
+    */
+    static bool fit_batch(DipoleFitData* fit, dipoleFitWorkspace work, GuessData* guess, float *times, float **B, int ntime, int verbose, ECD *res, int *ok);
+
+    //=========================================================================================================
+    /**
+    * Fit a single dipole starting from the given initial guess
+    *
+    * @param[in] fit        Precomputed fitting data
+    * @param[in] work       The workspace of the calling thread, NULL to use the forward functions of fit
+    * @param[in] rr         The initial guess
+    * @param[in] time       Which time is it?
+    * @param[in] B          The projected and whitened field to fit
+    * @param[in] verbose
+    * @param[in] res        The fitted dipole
+    */
+    static bool fit_one_from_guess(DipoleFitData* fit, dipoleFitWorkspace work, float *rr, float time, float *B, int verbose, ECD& res);
+
+    //=========================================================================================================
+    /**
+    * Create a workspace for fit_one. The forward calculation clients are duplicated with empty scratch space,
+    * the read-only parts (coil definitions, BEM solution, compensation matrices) are shared with fit.
+    *
+    * @param[in] fit        Precomputed fitting data
+    *
+    * @return the workspace, NULL on failure. Free it with free_dipole_fit_workspace before fit is deleted.
+    */
+    static dipoleFitWorkspace new_dipole_fit_workspace(DipoleFitData* fit);
+
+    //=========================================================================================================
+    /**
+    * Free a workspace created with new_dipole_fit_workspace
+    *
+    * @param[in] work       The workspace to free
+    */
+    static void free_dipole_fit_workspace(dipoleFitWorkspace work);
+
 
 
 //============================= dipole_forward.c
 
     static int compute_dipole_field(DipoleFitData* d, float *rd, int whiten, float **fwd);
 
+    static int compute_dipole_field(DipoleFitData* d, dipoleFitFuncs funcs, float *rd, int whiten, float **fwd);
+
     //============================= dipole_forward.c
 
     static DipoleForward* dipole_forward_one(DipoleFitData* d,
                                      float         *rd,
                                      DipoleForward* old);
 
+    static DipoleForward* dipole_forward_one(DipoleFitData* d,
+                                     dipoleFitFuncs funcs,
+                                     float         *rd,
+                                     DipoleForward* old);
+
 
 
 
@@ -115,6 +115,7 @@ void DipoleFitSettings::initMembers()
     do_baseline  = false;         
     setno        = 1;             
     verbose      = false;
+    nthreads     = 0;
     omit_data_proj = false;
          
     eeg_sphere_rad = 0.09f;      
@@ -277,6 +278,7 @@ void DipoleFitSettings::usage(char *name)
     printf("\t--mindist dist/mm Exclude points which are closer than this distance from the inner skull surface  (default = %6.1f mm).\n",1000*guess_mindist);
     printf("\t--grid    dist/mm Source space grid size (default = %6.1f mm).\n",1000*guess_grid);
     printf("\t--magdip          Fit magnetic dipoles instead of current dipoles.\n");
+    printf("\t--nthreads n      Number of threads fitting time points in parallel (default : one per core, 1 = serial).\n");
     printf("\nOutput:\n\n");
     printf("\t--dip     name    xfit dip format output file name\n");
     printf("\t--bdip    name    xfit bdip format output file name\n");
@@ -843,6 +845,17 @@ bool DipoleFitSettings::check_args (int *argc,char **argv)
             found = 1;
             verbose = true;
         }
+        else if (strcmp(argv[k],"--nthreads") == 0) {
+            found = 2;
+            if (k == *argc - 1) {
+                qCritical ("--nthreads: argument required.");
+                return false;
+            }
+            if (sscanf(argv[k+1],"%d",&nthreads) != 1) {
+                qCritical ("Could not interpret the number of threads.");
+                return false;
+            }
+        }
         if (found) {
             for (int p = k; p < *argc-found; p++)
                 argv[p] = argv[p+found];
@@ -169,6 +169,7 @@ float guess_rad;       			/**< Radius of spherical guess surface */
     bool  do_baseline;         		/**< Are both baseline limits set? */
     int   setno;             		/**< Which data set */
     bool  verbose;
+    int   nthreads;                     /**< Number of threads fitting time points in parallel (<= 0: one per core) */
     mneFilterDefRec filter;
     QStringList projnames;              /**< Projection file names */
     bool omit_data_proj;
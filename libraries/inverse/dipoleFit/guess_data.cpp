@@ -297,6 +297,9 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
 
     fprintf(stderr,"[done %d sources]\n",p);
 
+    if (!this->compute_guess_matrix())
+        goto bad;
+
     return;
 //    return res;
 
@@ -462,5 +465,128 @@ bool GuessData::compute_guess_fields(DipoleFitData* f)
     f->funcs = orig;
     printf("[done %d sources]\n",this->nguess);
 
+    return compute_guess_matrix();
+}
+
+
+//*************************************************************************************************************
+
+bool GuessData::compute_guess_matrix()
+{
+    int nch,k,c;
+
+    if (nguess <= 0 || !guess_fwd || !guess_fwd[0]) {
+        qCritical("Guess fields missing in compute_guess_matrix");
+        return false;
+    }
+    nch = guess_fwd[0]->nch;
+
+    guess_uu.resize(nch,3*nguess);
+    guess_ratio.resize(nguess);
+    for (k = 0; k < nguess; k++) {
+        if (!guess_fwd[k] || guess_fwd[k]->nch != nch) {
+            qCritical("Inconsistent guess fields in compute_guess_matrix");
+            guess_uu.resize(0,0);
+            guess_ratio.resize(0);
+            return false;
+        }
+        for (c = 0; c < 3; c++)
+            guess_uu.col(3*k+c) = Map<VectorXf>(guess_fwd[k]->uu[c],nch);
+        guess_ratio[k] = guess_fwd[k]->sing[2]/guess_fwd[k]->sing[0];
+    }
     return true;
 }
+
+
+//*************************************************************************************************************
+
+bool GuessData::find_best_guesses(const MatrixXf& matB, float limit, VectorXi& vecBest, VectorXf& vecGood) const
+{
+    const float tol = 1e-4f;        /* Guesses this close to the best one are checked with the exact scan */
+    int   ntime = matB.cols();
+    int   nch   = matB.rows();
+    int   t,k,best;
+    float good,this_good,max_good;
+    bool  found_all = true;
+
+    vecBest = VectorXi::Constant(ntime,-1);
+    vecGood = VectorXf::Zero(ntime);
+
+    if (guess_uu.cols() != 3*nguess || guess_uu.rows() != nch) {
+        qCritical("Guess matrix does not match the data in find_best_guesses");
+        return false;
+    }
+    /*
+     * Components of the data along the left singular vectors of all guesses
+     */
+    MatrixXf matProj = guess_uu.transpose()*matB;
+    VectorXf vecGoodAll(nguess);
+
+    for (t = 0; t < ntime; t++) {
+        const float *B = matB.col(t).data();
+        float  B2f = 0.0;
+        double B2;
+        /*
+         * Same accumulation as mne_dot_vectors
+         */
+        for (k = 0; k < nch; k++)
+            B2f = B2f + B[k]*B[k];
+        B2 = B2f;
+        if (B2 <= 0.0) {
+            found_all = false;
+            continue;
+        }
+        /*
+         * Energy in the two or three components of each guess
+         */
+        const float *proj = matProj.col(t).data();
+        max_good = 0.0;
+        for (k = 0; k < nguess; k++) {
+            float Bm2 = proj[3*k]*proj[3*k] + proj[3*k+1]*proj[3*k+1];
+            if (guess_ratio[k] > limit)
+                Bm2 += proj[3*k+2]*proj[3*k+2];
+            vecGoodAll[k] = Bm2/B2f;
+            if (vecGoodAll[k] > max_good)
+                max_good = vecGoodAll[k];
+        }
+        /*
+         * Decide among the best ones exactly like the sequential scan
+         */
+        best = -1;
+        good = 0.0;
+        for (k = 0; k < nguess; k++) {
+            if (vecGoodAll[k] < max_good - tol)
+                continue;
+            this_good = guess_goodness(k,B,B2,limit);
+            if (this_good > good) {
+                best = k;
+                good = this_good;
+            }
+        }
+        if (best < 0)
+            found_all = false;
+        vecBest[t] = best;
+        vecGood[t] = good;
+    }
+    return found_all;
+}
+
+
+//*************************************************************************************************************
+
+double GuessData::guess_goodness(int k, const float *B, double B2, float limit) const
+{
+    DipoleForward* fwd = guess_fwd[k];
+    int    ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
+    int    c,p;
+    double Bm2,one;
+    float  dot;
+
+    for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
+        for (p = 0, dot = 0.0; p < fwd->nch; p++)
+            dot = dot + fwd->uu[c][p]*B[p];
+        one = dot;
+        Bm2 = Bm2 + one*one;
+    }
+    return 1.0 - (B2 - Bm2)/B2;
+}
@@ -144,11 +144,53 @@ public:
     */
     bool compute_guess_fields(DipoleFitData* f);
 
+    //=========================================================================================================
+    /**
+    * Collects the left singular vectors of all guess fields into one contiguous matrix for find_best_guesses.
+    * The guess fields are projected and whitened already. Called by compute_guess_fields.
+    *
+    * @return true when successful
+    */
+    bool compute_guess_matrix();
+
+    //=========================================================================================================
+    /**
+    * Finds the best initial guess for a block of time points. The data of all time points are projected onto
+    * the left singular vectors of all guesses with one matrix product, the goodness of fit of each guess is
+    * then the energy in its two or three components. Near-ties are decided with the exact per-guess scan, so
+    * the selection is the same as when the guesses are scored one at a time.
+    *
+    * @param[in] matB       The projected and whitened data, one column per time point (nch x ntime)
+    * @param[in] limit      Pseudoradial component omission limit
+    * @param[out] vecBest   The best guess for each time point, -1 if no reasonable guess was found
+    * @param[out] vecGood   The goodness of fit of the best guess for each time point
+    *
+    * @return true if a guess was found for all time points
+    */
+    bool find_best_guesses(const Eigen::MatrixXf& matB, float limit, Eigen::VectorXi& vecBest, Eigen::VectorXf& vecGood) const;
+
+private:
+    //=========================================================================================================
+    /**
+    * The goodness of fit of a single guess as computed by the original per-guess scan
+    *
+    * @param[in] k          The guess
+    * @param[in] B          The projected and whitened data
+    * @param[in] B2         The squared norm of B
+    * @param[in] limit      Pseudoradial component omission limit
+    *
+    * @return the goodness of fit
+    */
+    double guess_goodness(int k, const float *B, double B2, float limit) const;
+
 public:
     float          **rr;            /**< These are the guess dipole locations */
     DipoleForward** guess_fwd;      /**< Forward solutions for the guesses */
     int            nguess;          /**< How many sources */
 
+    Eigen::MatrixXf guess_uu;       /**< Left singular vectors of all guess fields, three columns per guess (nch x 3*nguess) */
+    Eigen::VectorXf guess_ratio;    /**< Ratio of the smallest to the largest singular value of each guess */
+
 // ### OLD STRUCT ###
 //    typedef struct {
 //        float          **rr;                    /**< These are the guess dipole locations */
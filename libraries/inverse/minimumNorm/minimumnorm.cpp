@@ -50,6 +50,7 @@
 //=============================================================================================================
 
 #include <iostream>
+#include <cmath>
 
 
 //*************************************************************************************************************
@@ -70,6 +71,56 @@ using namespace MNELIB;
 using namespace INVERSELIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE STATIC FUNCTIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Pools the xyz components of each source (if bCombine) and applies the noise normalization (if vecNoiseNorm is
+* not empty) in one pass over the kernel output.
+*/
+template<typename T>
+void poolAndNormalize(const Matrix<T, Dynamic, Dynamic>& matKernelData,
+                      bool bCombine,
+                      const VectorXd& vecNoiseNorm,
+                      MatrixXd& matSol)
+{
+    const bool bNormalize = vecNoiseNorm.size() > 0;
+    const qint32 iSources = matSol.rows();
+
+    for(qint32 t = 0; t < matSol.cols(); ++t) {
+        const T* pIn = matKernelData.data() + (qint64)t * matKernelData.rows();
+        double* pOut = matSol.data() + (qint64)t * iSources;
+
+        if(bCombine) {
+            for(qint32 s = 0; s < iSources; ++s) {
+                const double x = pIn[3*s];
+                const double y = pIn[3*s+1];
+                const double z = pIn[3*s+2];
+                pOut[s] = std::sqrt(x*x + y*y + z*z);
+            }
+        } else {
+            for(qint32 s = 0; s < iSources; ++s) {
+                pOut[s] = pIn[s];
+            }
+        }
+
+        if(bNormalize) {
+            for(qint32 s = 0; s < iSources; ++s) {
+                pOut[s] *= vecNoiseNorm[s];
+            }
+        }
+    }
+}
+
+} // NAMESPACE
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -78,6 +129,9 @@ using namespace INVERSELIB;
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString method)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bPickNormal(false)
+, m_bPrecombineNoiseNorm(false)
+, m_bSinglePrecision(false)
 {
     this->setRegularization(lambda);
     this->setMethod(method);
@@ -88,6 +142,9 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, bool dSPM, bool sLORETA)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bPickNormal(false)
+, m_bPrecombineNoiseNorm(false)
+, m_bSinglePrecision(false)
 {
     this->setRegularization(lambda);
     this->setMethod(dSPM, sLORETA);
@@ -208,31 +265,18 @@ MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin
 
     MatrixXd sol = K * data; //apply imaging kernel
 
-    if (inv.source_ori == FIFFV_MNE_FREE_ORI)
-    {
-        printf("combining the current components...");
-        MatrixXd sol1(sol.rows()/3,sol.cols());
-        for(qint32 i = 0; i < sol.cols(); ++i)
-        {
-            VectorXd* tmp = MNEMath::combine_xyz(sol.block(0,i,sol.rows(),1));
-            sol1.block(0,i,sol.rows()/3,1) = tmp->cwiseSqrt();
-            delete tmp;
-        }
-        sol.resize(sol1.rows(),sol1.cols());
-        sol = sol1;
-    }
+    //Pool the current components and apply the noise normalization in one pass
+    const bool bCombine = inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal;
+    VectorXd vecNoiseNorm;
+    if ((m_bdSPM || m_bsLORETA) && noise_norm.rows() > 0)
+        vecNoiseNorm = noise_norm.diagonal();
 
-    if (m_bdSPM)
+    if (bCombine || vecNoiseNorm.size() > 0)
     {
-        printf("(dSPM)...");
-        sol = inv.noisenorm*sol;
+        MatrixXd sol1(bCombine ? sol.rows()/3 : sol.rows(), sol.cols());
+        poolAndNormalize<double>(sol, bCombine, vecNoiseNorm, sol1);
+        sol.swap(sol1);
     }
-    else if (m_bsLORETA)
-    {
-        printf("(sLORETA)...");
-        sol = inv.noisenorm*sol;
-    }
-    printf("[done]\n");
 
     //Results
     VectorXi p_vecVertices(inv.src[0].vertno.size() + inv.src[1].vertno.size());
@@ -261,10 +305,100 @@ void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
 
     std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
 
+    m_bPickNormal = pick_normal;
+    setupApply();
+
     inverseSetup = true;
 }
 
 
+//*************************************************************************************************************
+
+bool MinimumNorm::applyInverse(const MatrixXd &data, MatrixXd &matSol)
+{
+    if(!inverseSetup) {
+        qWarning("MinimumNorm::applyInverse - Inverse not setup -> call doInverseSetup first!");
+        return false;
+    }
+
+    if(K.cols() != data.rows()) {
+        qWarning() << "MinimumNorm::applyInverse - Dimension mismatch between K.cols() and data.rows() -" << K.cols() << "x" << data.rows();
+        return false;
+    }
+
+    const bool bCombine = inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal;
+    const qint32 iSources = bCombine ? K.rows()/3 : K.rows();
+
+    //Resizing is a no-op if the block size did not change
+    matSol.resize(iSources, data.cols());
+
+    if(m_bSinglePrecision) {
+        m_matDataF = data.cast<float>();
+        m_matApplyScratchF.noalias() = m_matKernelApplyF * m_matDataF;
+        poolAndNormalize<float>(m_matApplyScratchF, bCombine, m_vecNoiseNormApply, matSol);
+
+        return true;
+    }
+
+    const MatrixXd& matKernel = m_bPrecombineNoiseNorm && m_matKernelApply.size() > 0 ? m_matKernelApply : K;
+
+    if(!bCombine && m_vecNoiseNormApply.size() == 0) {
+        matSol.noalias() = matKernel * data;
+    } else {
+        m_matApplyScratch.noalias() = matKernel * data;
+        poolAndNormalize<double>(m_matApplyScratch, bCombine, m_vecNoiseNormApply, matSol);
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::setApplyOptions(bool bPrecombineNoiseNorm, bool bSinglePrecision)
+{
+    m_bPrecombineNoiseNorm = bPrecombineNoiseNorm;
+    m_bSinglePrecision = bSinglePrecision;
+
+    if(inverseSetup) {
+        setupApply();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::setupApply()
+{
+    const bool bCombine = inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal;
+
+    m_vecNoiseNormApply.resize(0);
+    if((m_bdSPM || m_bsLORETA) && noise_norm.rows() > 0) {
+        m_vecNoiseNormApply = noise_norm.diagonal();
+    }
+
+    m_matKernelApply.resize(0,0);
+    m_matKernelApplyF.resize(0,0);
+
+    //The norm of the xyz components scales with a positive factor, hence the factor can be applied to the rows
+    if(m_bPrecombineNoiseNorm && m_vecNoiseNormApply.size() > 0) {
+        m_matKernelApply = K;
+        const qint32 iRowsPerSource = bCombine ? 3 : 1;
+
+        for(qint32 s = 0; s < m_vecNoiseNormApply.size(); ++s) {
+            m_matKernelApply.middleRows(s * iRowsPerSource, iRowsPerSource) *= m_vecNoiseNormApply[s];
+        }
+
+        m_vecNoiseNormApply.resize(0);
+    }
+
+    if(m_bSinglePrecision) {
+        m_matKernelApplyF = m_matKernelApply.size() > 0 ? m_matKernelApply.cast<float>() : K.cast<float>();
+        m_matKernelApply.resize(0,0);
+    }
+}
+
+
 //*************************************************************************************************************
 
 const char* MinimumNorm::getName() const
@@ -129,6 +129,30 @@ public:
 
     virtual void doInverseSetup(qint32 nave, bool pick_normal = false);
 
+    //=========================================================================================================
+    /**
+    * Applies the imaging kernel to a data block and writes the source amplitudes to a caller provided buffer.
+    * The kernel multiplication, the pooling of the orientations and the noise normalization are done in one
+    * pass, so nothing is allocated once the buffers have their final size. This is the real-time counterpart of
+    * calculateInverse(const MatrixXd&, float, float).
+    *
+    * @param[in] data       The data (channels x samples).
+    * @param[out] matSol    The source amplitudes (sources x samples), only reallocated if its size changes.
+    *
+    * @return true if successful, false if the inverse is not set up or the dimensions do not match.
+    */
+    bool applyInverse(const MatrixXd &data, MatrixXd &matSol);
+
+    //=========================================================================================================
+    /**
+    * Sets the options of applyInverse. If the inverse is set up already, the kernel copies are prepared again
+    * right away, otherwise with the next doInverseSetup.
+    *
+    * @param[in] bPrecombineNoiseNorm   Fold the noise normalization into a copy of the kernel.
+    * @param[in] bSinglePrecision       Apply a single precision copy of the kernel, which halves the memory traffic.
+    */
+    void setApplyOptions(bool bPrecombineNoiseNorm, bool bSinglePrecision);
+
 
     virtual const char* getName() const;
 
@@ -169,6 +193,13 @@ public:
 
     inline MatrixXd& getKernel();
 
+private:
+    //=========================================================================================================
+    /**
+    * Prepares the kernel copies and the noise normalization factors of applyInverse.
+    */
+    void setupApply();
+
 private:
     MNEInverseOperator m_inverseOperator;   /**< The inverse operator */
     float m_fLambda;                        /**< Regularization parameter */
@@ -183,6 +214,16 @@ private:
     Label label;                            /**< The corresponding labels */
     MatrixXd K;                             /**< Imaging kernel */
 
+    bool m_bPickNormal;                     /**< Whether only the normal component is kept */
+    bool m_bPrecombineNoiseNorm;            /**< Whether applyInverse uses a kernel with the noise normalization folded in */
+    bool m_bSinglePrecision;                /**< Whether applyInverse uses a single precision kernel */
+    MatrixXd m_matKernelApply;              /**< The kernel with the noise normalization folded in, if requested */
+    MatrixXf m_matKernelApplyF;             /**< The single precision kernel, if requested */
+    VectorXd m_vecNoiseNormApply;           /**< The noise normalization applied by applyInverse, empty if none */
+    MatrixXd m_matApplyScratch;             /**< Kernel times data */
+    MatrixXf m_matApplyScratchF;            /**< Kernel times data in single precision */
+    MatrixXf m_matDataF;                    /**< The data in single precision */
+
 };
 
 //*************************************************************************************************************
@@ -128,10 +128,10 @@ MneCTFCompData::MneCTFCompData(const MneCTFCompData& comp)
     kind       = comp.kind;
     mne_kind   = comp.mne_kind;
     calibrated = comp.calibrated;
-    data       = new MneNamedMatrix(*comp.data);
+    data       = comp.data ? new MneNamedMatrix(*comp.data) : NULL;
 
-    presel     = new FiffSparseMatrix(*comp.presel);
-    postsel    = new FiffSparseMatrix(*comp.postsel);
+    presel     = comp.presel ? new FiffSparseMatrix(*comp.presel) : NULL;
+    postsel    = comp.postsel ? new FiffSparseMatrix(*comp.postsel) : NULL;
 }
 
 
@@ -665,6 +665,11 @@ MneCTFCompDataSet::MneCTFCompDataSet()
 //*************************************************************************************************************
 
 MneCTFCompDataSet::MneCTFCompDataSet(const MneCTFCompDataSet &set)
+:ncomp(0)
+,chs(NULL)
+,nch(0)
+,undo(NULL)
+,current(NULL)
 {
 //    if (!set)
 //        return NULL;
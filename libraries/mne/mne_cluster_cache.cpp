@@ -0,0 +1,270 @@
+//=============================================================================================================
+/**
+* @file     mne_cluster_cache.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    MNEClusterCache class definition.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_cluster_cache.h"
+
+#include <utils/ioutils.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFileInfo>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNELIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+#define CLUSTER_CACHE_MAGIC   0x4d4e4543    //identifies cached clustering results
+#define CLUSTER_CACHE_VERSION 1             //version of the cached results layout
+
+static QAtomicInt s_iClusterCacheEnabled(1);    //switched off with MNEClusterCache::setEnabled
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+MNEClusterCache::MNEClusterCache(const QString& sType)
+: m_sType(sType)
+, m_hash(QCryptographicHash::Sha1)
+{
+    addData(sType);
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::addData(const MatrixXd& mat)
+{
+    addData(qint32(mat.rows()));
+    addData(qint32(mat.cols()));
+    m_hash.addData(reinterpret_cast<const char*>(mat.data()), mat.size()*sizeof(double));
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::addData(const VectorXi& vec)
+{
+    addData(qint32(vec.size()));
+    m_hash.addData(reinterpret_cast<const char*>(vec.data()), vec.size()*sizeof(int));
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::addData(qint32 iValue)
+{
+    m_hash.addData(reinterpret_cast<const char*>(&iValue), sizeof(qint32));
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::addData(const QString& sValue)
+{
+    QByteArray data = sValue.toUtf8();
+    addData(qint32(data.size()));
+    m_hash.addData(data);
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::setEnabled(bool bEnabled)
+{
+    s_iClusterCacheEnabled.storeRelease(bEnabled ? 1 : 0);
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::isEnabled()
+{
+    return s_iClusterCacheEnabled.loadAcquire() != 0 && !UTILSLIB::IOUtils::get_cache_dir("cluster").isEmpty();
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::clear()
+{
+    QString sDir = UTILSLIB::IOUtils::get_cache_dir("cluster");
+
+    return sDir.isEmpty() || UTILSLIB::IOUtils::clear_cache_dir(sDir);
+}
+
+
+//*************************************************************************************************************
+
+QString MNEClusterCache::fileName() const
+{
+    if(!isEnabled())
+        return QString();
+
+    return QString("%1/%2-%3-cluster.dat").arg(UTILSLIB::IOUtils::get_cache_dir("cluster"))
+                                          .arg(QString(m_hash.result().toHex()))
+                                          .arg(m_sType);
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::openRead(QFile& file, QDataStream& stream, qint32& nRegions) const
+{
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    quint32 iMagic;
+    qint32 iVersion;
+    stream >> iMagic >> iVersion >> nRegions;
+
+    return stream.status() == QDataStream::Ok
+            && iMagic == CLUSTER_CACHE_MAGIC
+            && iVersion == CLUSTER_CACHE_VERSION
+            && nRegions >= 0;
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::openWrite(QSaveFile& file, QDataStream& stream, qint32 nRegions, qint64 iBytes) const
+{
+    QString sDir = QFileInfo(file.fileName()).absolutePath();
+
+    if(!QDir().mkpath(sDir) || !UTILSLIB::IOUtils::trim_cache_dir(sDir, iBytes) || !file.open(QIODevice::WriteOnly))
+        return false;
+
+    stream << quint32(CLUSTER_CACHE_MAGIC) << qint32(CLUSTER_CACHE_VERSION) << nRegions;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::read(QDataStream& stream, MatrixXd& mat)
+{
+    qint32 iRows, iCols;
+    stream >> iRows >> iCols;
+
+    if(stream.status() != QDataStream::Ok || iRows < 0 || iCols < 0)
+        return false;
+
+    mat.resize(iRows, iCols);
+    int iBytes = mat.size()*sizeof(double);
+
+    return stream.readRawData(reinterpret_cast<char*>(mat.data()), iBytes) == iBytes;
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::read(QDataStream& stream, VectorXd& vec)
+{
+    MatrixXd mat;
+
+    if(!read(stream, mat) || mat.cols() != 1)
+        return false;
+
+    vec = mat.col(0);
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MNEClusterCache::read(QDataStream& stream, VectorXi& vec)
+{
+    qint32 iSize;
+    stream >> iSize;
+
+    if(stream.status() != QDataStream::Ok || iSize < 0)
+        return false;
+
+    vec.resize(iSize);
+    int iBytes = vec.size()*sizeof(int);
+
+    return stream.readRawData(reinterpret_cast<char*>(vec.data()), iBytes) == iBytes;
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::write(QDataStream& stream, const MatrixXd& mat)
+{
+    stream << qint32(mat.rows()) << qint32(mat.cols());
+    stream.writeRawData(reinterpret_cast<const char*>(mat.data()), mat.size()*sizeof(double));
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::write(QDataStream& stream, const VectorXd& vec)
+{
+    stream << qint32(vec.rows()) << qint32(1);
+    stream.writeRawData(reinterpret_cast<const char*>(vec.data()), vec.size()*sizeof(double));
+}
+
+
+//*************************************************************************************************************
+
+void MNEClusterCache::write(QDataStream& stream, const VectorXi& vec)
+{
+    stream << qint32(vec.size());
+    stream.writeRawData(reinterpret_cast<const char*>(vec.data()), vec.size()*sizeof(int));
+}
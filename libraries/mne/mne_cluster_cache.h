@@ -0,0 +1,308 @@
+//=============================================================================================================
+/**
+* @file     mne_cluster_cache.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    MNEClusterCache class declaration.
+*
+*/
+
+#ifndef MNE_CLUSTER_CACHE_H
+#define MNE_CLUSTER_CACHE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QList>
+#include <QSaveFile>
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE MNELIB
+//=============================================================================================================
+
+namespace MNELIB
+{
+
+
+//=============================================================================================================
+/**
+* Stores the k-means results of the regions of a clustered forward solution or kernel. The results are keyed
+* by a hash of the clustering input of all regions (method, label, number of clusters, source indices and the
+* region matrices), so a setup is only clustered once for the same forward solution and annotation.
+* The cache files are kept in the generic cache location of the user, see fileName. The k-means start is random,
+* a cached setup keeps the result of its first clustering until the cache is switched off or cleared, see
+* setEnabled and clear.
+*
+* The region type T needs the members roiIdx, ctrs, sumd, D and iLabelIdxOut, see RegionDataOut and RegionMTOut.
+*
+* @brief Disk cache of region clustering results
+*/
+class MNESHARED_EXPORT MNEClusterCache
+{
+public:
+    //=========================================================================================================
+    /**
+    * Constructs an empty cache key.
+    *
+    * @param[in] sType  The kind of clustered data, e.g., "fwd" or "kernel"; part of the file name.
+    */
+    explicit MNEClusterCache(const QString& sType);
+
+    //=========================================================================================================
+    /**
+    * Adds a matrix to the cache key.
+    *
+    * @param[in] mat    The matrix.
+    */
+    void addData(const Eigen::MatrixXd& mat);
+
+    //=========================================================================================================
+    /**
+    * Adds an index vector to the cache key.
+    *
+    * @param[in] vec    The vector.
+    */
+    void addData(const Eigen::VectorXi& vec);
+
+    //=========================================================================================================
+    /**
+    * Adds an integer to the cache key.
+    *
+    * @param[in] iValue The value.
+    */
+    void addData(qint32 iValue);
+
+    //=========================================================================================================
+    /**
+    * Adds a string to the cache key.
+    *
+    * @param[in] sValue The string.
+    */
+    void addData(const QString& sValue);
+
+    //=========================================================================================================
+    /**
+    * Switches the cluster cache on or off for this process. If off, all regions are clustered again and no
+    * results are stored. The cache is also off if the disk caches are switched off with the environment
+    * variable MNE_CPP_CACHE, see UTILSLIB::IOUtils::get_cache_dir.
+    *
+    * @param[in] bEnabled   Whether the cache is used, true by default.
+    */
+    static void setEnabled(bool bEnabled);
+
+    //=========================================================================================================
+    /**
+    * Returns whether the cluster cache is used.
+    *
+    * @return true if the cache is switched on for this process and the disk caches are not switched off.
+    */
+    static bool isEnabled();
+
+    //=========================================================================================================
+    /**
+    * Removes all cached clustering results.
+    *
+    * @return true if all cache files were removed.
+    */
+    static bool clear();
+
+    //=========================================================================================================
+    /**
+    * Returns the name of the cache file for the data added so far.
+    *
+    * @return the cache file name, or an empty string if the cache is switched off.
+    */
+    QString fileName() const;
+
+    //=========================================================================================================
+    /**
+    * Loads the cached results.
+    *
+    * @param[out] lRegions  The results of the regions, only changed on success.
+    *
+    * @return true if a valid cache file was read, false if there is none or the cache is switched off.
+    */
+    template<typename T>
+    bool load(QList<T>& lRegions) const;
+
+    //=========================================================================================================
+    /**
+    * Stores the results. The file is written to a temporary file first, an interrupted run leaves no
+    * partial results behind. The oldest results are removed if the cache exceeds its size limit.
+    *
+    * @param[in] lRegions   The results of the regions.
+    *
+    * @return true if the cache file was written, false if it failed or the cache is switched off.
+    */
+    template<typename T>
+    bool save(const QList<T>& lRegions) const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Opens the cache file for reading and checks its header.
+    *
+    * @param[in] file       The cache file.
+    * @param[in] stream     The stream attached to the file.
+    * @param[out] nRegions  The number of stored regions.
+    *
+    * @return true if the header is valid.
+    */
+    bool openRead(QFile& file, QDataStream& stream, qint32& nRegions) const;
+
+    //=========================================================================================================
+    /**
+    * Opens the cache file for writing and writes its header. Older cache files are removed to make room for
+    * the new one.
+    *
+    * @param[in] file       The cache file.
+    * @param[in] stream     The stream attached to the file.
+    * @param[in] nRegions   The number of regions to be stored.
+    * @param[in] iBytes     The approximate size of the file.
+    *
+    * @return true if succeeded.
+    */
+    bool openWrite(QSaveFile& file, QDataStream& stream, qint32 nRegions, qint64 iBytes) const;
+
+    //=========================================================================================================
+    /**
+    * Reads a matrix written by write.
+    */
+    static bool read(QDataStream& stream, Eigen::MatrixXd& mat);
+    static bool read(QDataStream& stream, Eigen::VectorXd& vec);
+    static bool read(QDataStream& stream, Eigen::VectorXi& vec);
+
+    //=========================================================================================================
+    /**
+    * Writes a matrix as its dimensions followed by the raw data.
+    */
+    static void write(QDataStream& stream, const Eigen::MatrixXd& mat);
+    static void write(QDataStream& stream, const Eigen::VectorXd& vec);
+    static void write(QDataStream& stream, const Eigen::VectorXi& vec);
+
+    QString             m_sType;    /**< The kind of clustered data. */
+    QCryptographicHash  m_hash;     /**< The hash of the clustering input. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+template<typename T>
+bool MNEClusterCache::load(QList<T>& lRegions) const
+{
+    QString sFile = fileName();
+    if(sFile.isEmpty())
+        return false;
+
+    QFile file(sFile);
+    QDataStream stream(&file);
+    qint32 nRegions;
+
+    if(!openRead(file, stream, nRegions))
+        return false;
+
+    QList<T> lRead;
+    for(qint32 i = 0; i < nRegions; ++i)
+    {
+        T region;
+        if(!read(stream, region.roiIdx) || !read(stream, region.ctrs) || !read(stream, region.sumd) || !read(stream, region.D))
+            return false;
+        stream >> region.iLabelIdxOut;
+        lRead.append(region);
+    }
+
+    if(stream.status() != QDataStream::Ok)
+        return false;
+
+    lRegions = lRead;
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+bool MNEClusterCache::save(const QList<T>& lRegions) const
+{
+    QString sFile = fileName();
+    if(sFile.isEmpty())
+        return false;
+
+    qint64 iBytes = 0;
+    for(qint32 i = 0; i < lRegions.size(); ++i)
+        iBytes += lRegions[i].roiIdx.size()*sizeof(int) + (lRegions[i].ctrs.size() + lRegions[i].sumd.size() + lRegions[i].D.size())*sizeof(double);
+
+    QSaveFile file(sFile);
+    QDataStream stream(&file);
+
+    if(!openWrite(file, stream, lRegions.size(), iBytes))
+        return false;
+
+    for(qint32 i = 0; i < lRegions.size(); ++i)
+    {
+        write(stream, lRegions[i].roiIdx);
+        write(stream, lRegions[i].ctrs);
+        write(stream, lRegions[i].sumd);
+        write(stream, lRegions[i].D);
+        stream << qint32(lRegions[i].iLabelIdxOut);
+    }
+
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+} // NAMESPACE MNELIB
+
+#endif // MNE_CLUSTER_CACHE_H
@@ -89,7 +89,8 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
                                               float tmin,
                                               float tmax,
                                               qint32 event,
-                                              double dEOGThreshold)
+                                              double dEOGThreshold,
+                                              bool bUseThreads)
 {
     MNEEpochDataList data;
 
@@ -115,7 +116,6 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
 
     fiff_int_t event_samp, from, to;
     fiff_int_t dropCount = 0;
-    MatrixXd timesDummy;
     MatrixXd times;
     double min, max;
 
@@ -140,50 +140,65 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
         qDebug() << "No EOG channel found for epoch rejection";
     }
 
+    // Read all data segments at once, each raw data buffer is only read once
+    VectorXi vecFrom(count), vecTo(count);
     for (p = 0; p < count; ++p) {
-        // Read a data segment
         event_samp = events(selected(p),0);
-        from = event_samp + tmin*raw.info.sfreq;
-        to   = event_samp + floor(tmax*raw.info.sfreq + 0.5);
+        vecFrom(p) = event_samp + tmin*raw.info.sfreq;
+        vecTo(p)   = event_samp + floor(tmax*raw.info.sfreq + 0.5);
+    }
+
+    QList<MatrixXd> lSegments;
+    if(!raw.read_raw_segments(lSegments, vecFrom, vecTo, picks, bUseThreads)) {
+        printf("Can't read the event data segments");
+        return data;
+    }
+
+    for (p = 0; p < count; ++p) {
+        if(lSegments.at(p).size() == 0) {
+            printf("Can't read the event data segments");
+            continue;
+        }
+
+        event_samp = events(selected(p),0);
+        from = qMax(vecFrom(p), raw.first_samp);
+        to   = qMin(vecTo(p), raw.last_samp);
 
         epoch = new MNEEpochData();
+        epoch->epoch = lSegments.at(p);
 
-        if(raw.read_raw_segment(epoch->epoch, timesDummy, from, to, picks)) {
-            if (p == 0) {
-                times.resize(1, to-from+1);
-                for (qint32 i = 0; i < times.cols(); ++i)
-                    times(0, i) = ((float)(from-event_samp+i)) / raw.info.sfreq;
-            }
+        if (p == 0) {
+            times.resize(1, to-from+1);
+            for (qint32 i = 0; i < times.cols(); ++i)
+                times(0, i) = ((float)(from-event_samp+i)) / raw.info.sfreq;
+        }
 
-            epoch->event = event;
-            epoch->tmin = ((float)(from)-(float)(raw.first_samp))/raw.info.sfreq;
-            epoch->tmax = ((float)(to)-(float)(raw.first_samp))/raw.info.sfreq;
+        epoch->event = event;
+        epoch->tmin = ((float)(from)-(float)(raw.first_samp))/raw.info.sfreq;
+        epoch->tmax = ((float)(to)-(float)(raw.first_samp))/raw.info.sfreq;
 
-            if(iEOGChIdx >= 0 &&
-               iEOGChIdx < epoch->epoch.rows() &&
-               dEOGThreshold > 0.0) {
-                RowVectorXd vecRow = epoch->epoch.row(iEOGChIdx);
-                //vecRow = vecRow.array() - vecRow(0);
-                vecRow = vecRow.array() - vecRow.mean();
+        if(iEOGChIdx >= 0 &&
+           iEOGChIdx < epoch->epoch.rows() &&
+           dEOGThreshold > 0.0) {
+            RowVectorXd vecRow = epoch->epoch.row(iEOGChIdx);
+            //vecRow = vecRow.array() - vecRow(0);
+            vecRow = vecRow.array() - vecRow.mean();
 
-                min = vecRow.minCoeff();
-                max = vecRow.maxCoeff();
+            min = vecRow.minCoeff();
+            max = vecRow.maxCoeff();
 
-                //qDebug() << "std::fabs(min)" << std::fabs(min);
-                //qDebug() << "std::fabs(max)" << std::fabs(max);
+            //qDebug() << "std::fabs(min)" << std::fabs(min);
+            //qDebug() << "std::fabs(max)" << std::fabs(max);
 
-                //If absolute vaue of min or max if bigger than threshold -> reject
-                if((std::fabs(min) > dEOGThreshold) || (std::fabs(max) > dEOGThreshold)) {
-                    epoch->bReject = true;
-                    dropCount++;
-                    //qDebug() << "Epoch at sample" << event_samp << "rejected based on EOG channel";
-                }
+            //If absolute vaue of min or max if bigger than threshold -> reject
+            if((std::fabs(min) > dEOGThreshold) || (std::fabs(max) > dEOGThreshold)) {
+                epoch->bReject = true;
+                dropCount++;
+                //qDebug() << "Epoch at sample" << event_samp << "rejected based on EOG channel";
             }
-
-            data.append(MNEEpochData::SPtr(epoch));//List takes ownwership of the pointer - no delete need
-        } else {
-            printf("Can't read the event data segments");
         }
+
+        data.append(MNEEpochData::SPtr(epoch));//List takes ownwership of the pointer - no delete need
     }
 
     qDebug() << "Read total of"<< data.size() <<"epochs and dropped"<< dropCount <<"of them";
@@ -93,7 +93,8 @@ public:
 
     //=========================================================================================================
     /**
-    * Read the epochs from a raw file based on provided events.
+    * Read the epochs from a raw file based on provided events. All epochs are read in one pass over the raw data
+    * buffers, i.e. buffers shared by overlapping epochs are read only once.
     *
     * @param[in] raw            The raw data.
     * @param[in] events         The events provided in samples and event kind.
@@ -104,6 +105,7 @@ public:
     * @param[in] dEOGThreshold  The threshold value to use to reject epochs based on the EOG channel.
     *                           No filtering is performed on the EOG channel. Default is set to no rejection.
     *                           The mean is subtracted from the EOG channel data before checking the threshold.
+    * @param[in] bUseThreads    Whether to read the raw data buffers in parallel. Default is set to false.
     */
     static MNEEpochDataList readEpochs(const FIFFLIB::FiffRawData& raw,
                                        const Eigen::MatrixXi& events,
@@ -111,7 +113,8 @@ public:
                                        float tmin,
                                        float tmax,
                                        qint32 event,
-                                       double dEOGThreshold = 0.0);
+                                       double dEOGThreshold = 0.0,
+                                       bool bUseThreads = false);
 
     //=========================================================================================================
     /**
@@ -39,6 +39,7 @@
 //=============================================================================================================
 
 #include "mne_forwardsolution.h"
+#include "mne_cluster_cache.h"
 
 #include <utils/ioutils.h>
 
@@ -360,10 +361,36 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const Annotation
         //
         // Calculate clusters
         //
-        printf("Clustering... ");
-        QFuture< RegionDataOut > res;
-        res = QtConcurrent::mapped(m_qListRegionDataIn, &RegionData::cluster);
-        res.waitForFinished();
+        // The same regions of the same forward solution and annotation were clustered before
+        MNEClusterCache t_cache("fwd");
+        t_cache.addData(p_sMethod);
+        for(qint32 i = 0; i < m_qListRegionDataIn.size(); ++i)
+        {
+            const RegionData& t_region = m_qListRegionDataIn[i];
+            t_cache.addData(t_region.iLabelIdxIn);
+            t_cache.addData(t_region.nClusters);
+            t_cache.addData(t_region.idcs);
+            t_cache.addData(qint32(t_region.bUseWhitened));
+            t_cache.addData(t_region.matRoiG);
+            if(t_region.bUseWhitened)
+                t_cache.addData(t_region.matRoiGWhitened);
+        }
+
+        QList<RegionDataOut> res;
+        if(t_cache.load(res) && res.size() == m_qListRegionDataIn.size())
+        {
+            printf("Loaded clusters from %s\n", t_cache.fileName().toUtf8().constData());
+        }
+        else
+        {
+            printf("Clustering... ");
+            QFuture< RegionDataOut > t_future;
+            t_future = QtConcurrent::mapped(m_qListRegionDataIn, &RegionData::cluster);
+            t_future.waitForFinished();
+            res = t_future.results();
+
+            t_cache.save(res);
+        }
 
         //
         // Assign results
@@ -374,7 +401,7 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const Annotation
         qint32 nSens;
         QList<RegionData>::const_iterator itIn;
         itIn = m_qListRegionDataIn.begin();
-        QFuture<RegionDataOut>::const_iterator itOut;
+        QList<RegionDataOut>::const_iterator itOut;
         for (itOut = res.constBegin(); itOut != res.constEnd(); ++itOut)
         {
             nClusters = itOut->ctrs.rows();
@@ -39,6 +39,7 @@
 //=============================================================================================================
 
 #include "mne_inverse_operator.h"
+#include "mne_cluster_cache.h"
 #include <fs/label.h>
 
 
@@ -515,10 +516,33 @@ MatrixXd MNEInverseOperator::cluster_kernel(const AnnotationSet &p_AnnotationSet
         //
         // Calculate clusters
         //
-        printf("Clustering... ");
-        QFuture< RegionMTOut > res;
-        res = QtConcurrent::mapped(m_qListRegionMTIn, &RegionMT::cluster);
-        res.waitForFinished();
+        // The same regions of the same kernel and annotation were clustered before
+        MNEClusterCache t_cache("kernel");
+        t_cache.addData(p_sMethod);
+        for(qint32 i = 0; i < m_qListRegionMTIn.size(); ++i)
+        {
+            const RegionMT& t_region = m_qListRegionMTIn[i];
+            t_cache.addData(t_region.iLabelIdxIn);
+            t_cache.addData(t_region.nClusters);
+            t_cache.addData(t_region.idcs);
+            t_cache.addData(t_region.matRoiMT);
+        }
+
+        QList<RegionMTOut> res;
+        if(t_cache.load(res) && res.size() == m_qListRegionMTIn.size())
+        {
+            printf("Loaded clusters from %s\n", t_cache.fileName().toUtf8().constData());
+        }
+        else
+        {
+            printf("Clustering... ");
+            QFuture< RegionMTOut > t_future;
+            t_future = QtConcurrent::mapped(m_qListRegionMTIn, &RegionMT::cluster);
+            t_future.waitForFinished();
+            res = t_future.results();
+
+            t_cache.save(res);
+        }
 
         //
         // Assign results
@@ -529,7 +553,7 @@ MatrixXd MNEInverseOperator::cluster_kernel(const AnnotationSet &p_AnnotationSet
         qint32 nSens;
         QList<RegionMT>::const_iterator itIn;
         itIn = m_qListRegionMTIn.begin();
-        QFuture<RegionMTOut>::const_iterator itOut;
+        QList<RegionMTOut>::const_iterator itOut;
         for (itOut = res.constBegin(); itOut != res.constEnd(); ++itOut)
         {
             nClusters = itOut->ctrs.rows();
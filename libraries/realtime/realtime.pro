@@ -85,6 +85,7 @@ SOURCES += \
     rtCommand/commandmanager.cpp \
     rtCommand/commandparser.cpp \
     rtCommand/rawcommand.cpp \
+    rtProcessing/rtprocessor.cpp \
     rtProcessing/rtcov.cpp \
     rtProcessing/rtinvop.cpp \
     rtProcessing/rtave.cpp \
@@ -102,6 +103,7 @@ HEADERS +=  \
     rtCommand/commandmanager.h \
     rtCommand/commandparser.h \
     rtCommand/rawcommand.h \
+    rtProcessing/rtprocessor.h \
     rtProcessing/rtcov.h \
     rtProcessing/rtinvop.h \
     rtProcessing/rtave.h \
@@ -92,6 +92,254 @@ double          m_dValueThreshold = 300e-6;     /**< Threshold to detect artifac
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
+RtAveAccumulator::RtAveAccumulator()
+: m_iNumAverages(1)
+, m_bCumulative(false)
+, m_vecEpochs(2)
+, m_vecRejected(2, false)
+, m_iHead(0)
+, m_iStored(0)
+, m_iNave(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::setWindow(int iNumAverages, bool bCumulative)
+{
+    m_iNumAverages = qMax(iNumAverages, 1);
+
+    if(bCumulative != m_bCumulative) {
+        m_bCumulative = bCumulative;
+        reset();
+    }
+
+    if(m_bCumulative) {
+        return;
+    }
+
+    //Rejected epochs are kept as long as they fit into twice the window
+    while(m_iNave > m_iNumAverages) {
+        dropOldest();
+    }
+
+    resizeRing(2 * m_iNumAverages);
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::append(const MatrixXd &matEpoch, bool bRejected)
+{
+    if(m_matMean.rows() != matEpoch.rows() || m_matMean.cols() != matEpoch.cols()) {
+        reset();
+        m_matMean = MatrixXd::Zero(matEpoch.rows(), matEpoch.cols());
+        m_matM2 = MatrixXd::Zero(matEpoch.rows(), matEpoch.cols());
+    }
+
+    if(m_bCumulative) {
+        if(!bRejected) {
+            addToStatistics(matEpoch);
+        }
+        return;
+    }
+
+    //Rejected epochs give way first, so that a high rejection rate does not shrink the window
+    if(m_iStored == m_vecEpochs.size()) {
+        dropOldestRejected();
+    }
+
+    //The slot keeps its allocation as long as the epoch size does not change
+    int iSlot = slot(m_iStored);
+    m_vecEpochs[iSlot] = matEpoch;
+    m_vecRejected[iSlot] = bRejected;
+    ++m_iStored;
+
+    if(!bRejected) {
+        addToStatistics(matEpoch);
+
+        while(m_iNave > m_iNumAverages) {
+            dropOldest();
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool RtAveAccumulator::setRejected(int iEpoch, bool bRejected)
+{
+    if(m_bCumulative || iEpoch < 0 || iEpoch >= m_iStored) {
+        return false;
+    }
+
+    int iSlot = slot(iEpoch);
+
+    if(m_vecRejected.at(iSlot) == bRejected) {
+        return false;
+    }
+
+    m_vecRejected[iSlot] = bRejected;
+
+    if(bRejected) {
+        removeFromStatistics(m_vecEpochs.at(iSlot));
+    } else {
+        addToStatistics(m_vecEpochs.at(iSlot));
+
+        while(m_iNave > m_iNumAverages) {
+            dropOldest();
+        }
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::reset()
+{
+    m_iHead = 0;
+    m_iStored = 0;
+    m_iNave = 0;
+
+    m_matMean.setZero();
+    m_matM2.setZero();
+}
+
+
+//*************************************************************************************************************
+
+bool RtAveAccumulator::variance(MatrixXd &matVar) const
+{
+    if(m_iNave < 2) {
+        return false;
+    }
+
+    matVar = m_matM2 / (m_iNave - 1);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool RtAveAccumulator::standardError(MatrixXd &matStdErr) const
+{
+    if(m_iNave < 2) {
+        return false;
+    }
+
+    matStdErr = (m_matM2 / (double(m_iNave - 1) * m_iNave)).cwiseSqrt();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::addToStatistics(const MatrixXd &matEpoch)
+{
+    ++m_iNave;
+
+    m_matDelta = matEpoch - m_matMean;
+    m_matMean += m_matDelta / m_iNave;
+    m_matM2.array() += m_matDelta.array() * (matEpoch - m_matMean).array();
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::removeFromStatistics(const MatrixXd &matEpoch)
+{
+    if(m_iNave <= 1) {
+        m_iNave = 0;
+        m_matMean.setZero();
+        m_matM2.setZero();
+        return;
+    }
+
+    --m_iNave;
+
+    //Reverse Welford step, the sum of squared deviations can not become negative
+    m_matDelta = matEpoch - m_matMean;
+    m_matMean -= m_matDelta / m_iNave;
+    m_matM2.array() -= m_matDelta.array() * (matEpoch - m_matMean).array();
+    m_matM2 = m_matM2.cwiseMax(0.0);
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::dropOldest()
+{
+    if(m_iStored == 0) {
+        return;
+    }
+
+    if(!m_vecRejected.at(m_iHead)) {
+        removeFromStatistics(m_vecEpochs.at(m_iHead));
+    }
+
+    m_iHead = (m_iHead + 1) % m_vecEpochs.size();
+    --m_iStored;
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::dropOldestRejected()
+{
+    int iEpoch = 0;
+
+    while(iEpoch < m_iStored && !m_vecRejected.at(slot(iEpoch))) {
+        ++iEpoch;
+    }
+
+    if(iEpoch == m_iStored) {
+        dropOldest();
+        return;
+    }
+
+    //Move the rejected epoch to the head, the older accepted epochs keep their order
+    for(int i = iEpoch; i > 0; --i) {
+        m_vecEpochs[slot(i)].swap(m_vecEpochs[slot(i - 1)]);
+        std::swap(m_vecRejected[slot(i)], m_vecRejected[slot(i - 1)]);
+    }
+
+    dropOldest();
+}
+
+
+//*************************************************************************************************************
+
+void RtAveAccumulator::resizeRing(int iSlots)
+{
+    if(iSlots == m_vecEpochs.size()) {
+        return;
+    }
+
+    while(m_iStored > iSlots) {
+        dropOldestRejected();
+    }
+
+    QVector<MatrixXd> vecEpochs(iSlots);
+    QVector<bool> vecRejected(iSlots, false);
+
+    for(int i = 0; i < m_iStored; ++i) {
+        vecEpochs[i].swap(m_vecEpochs[slot(i)]);
+        vecRejected[i] = m_vecRejected.at(slot(i));
+    }
+
+    m_vecEpochs = vecEpochs;
+    m_vecRejected = vecRejected;
+    m_iHead = 0;
+}
+
+
+//*************************************************************************************************************
+
 RtAve::RtAve(quint32 numAverages,
              quint32 p_iPreStimSamples,
              quint32 p_iPostStimSamples,
@@ -100,12 +348,12 @@ RtAve::RtAve(quint32 numAverages,
              quint32 p_iTriggerIndex,
              FiffInfo::SPtr p_pFiffInfo,
              QObject *parent)
-: QThread(parent)
+: RtProcessor(30, parent)
 , m_iNumAverages(numAverages)
+, m_iNewNumAverages(numAverages)
 , m_iPreStimSamples(p_iPreStimSamples)
 , m_iPostStimSamples(p_iPostStimSamples)
 , m_pFiffInfo(p_pFiffInfo)
-, m_bIsRunning(false)
 , m_bAutoAspect(true)
 , m_fTriggerThreshold(0.5)
 , m_iTriggerChIndex(-1)
@@ -117,6 +365,8 @@ RtAve::RtAve(quint32 numAverages,
 , m_pStimEvokedSet(FiffEvokedSet::SPtr(new FiffEvokedSet))
 , m_bActivateThreshold(false)
 , m_bActivateVariance(false)
+, m_bArtifactSettingsChanged(false)
+, m_bResetRequested(true)
 {
     qRegisterMetaType<FIFFLIB::FiffEvokedSet::SPtr>("FIFFLIB::FiffEvokedSet::SPtr");
 
@@ -141,12 +391,7 @@ RtAve::~RtAve()
 void RtAve::append(const MatrixXd &p_DataSegment)
 {
     // ToDo handle change buffersize
-    if(!m_pRawMatrixBuffer) {
-        QMutexLocker locker(&m_qMutex);
-        m_pRawMatrixBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(30, p_DataSegment.rows(), p_DataSegment.cols()));
-    }
-
-    m_pRawMatrixBuffer->push(&p_DataSegment);
+    appendData(p_DataSegment);
 }
 
 
@@ -155,7 +400,8 @@ void RtAve::append(const MatrixXd &p_DataSegment)
 void RtAve::setAverages(qint32 numAve)
 {
     QMutexLocker locker(&m_qMutex);
-    m_iNumAverages = numAve;
+    m_iNewNumAverages = numAve;
+    settingsChanged();
 }
 
 
@@ -165,6 +411,7 @@ void RtAve::setAverageMode(qint32 mode)
 {
     QMutexLocker locker(&m_qMutex);
     m_iNewAverageMode = mode;
+    settingsChanged();
 }
 
 
@@ -176,6 +423,7 @@ void RtAve::setPreStim(qint32 samples, qint32 secs)
 
     QMutexLocker locker(&m_qMutex);
     m_iNewPreStimSamples = samples;
+    settingsChanged();
 }
 
 
@@ -187,6 +435,7 @@ void RtAve::setPostStim(qint32 samples, qint32 secs)
 
     QMutexLocker locker(&m_qMutex);
     m_iNewPostStimSamples = samples;
+    settingsChanged();
 }
 
 
@@ -196,6 +445,7 @@ void RtAve::setTriggerChIndx(qint32 idx)
 {
     QMutexLocker locker(&m_qMutex);
     m_iNewTriggerIndex = idx;
+    settingsChanged();
 }
 
 
@@ -209,6 +459,10 @@ void RtAve::setArtifactReduction(bool bActivateThreshold, double dValueThreshold
 
     m_bActivateThreshold = bActivateThreshold;
     m_bActivateVariance = bActivateVariance;
+
+    //The stored epochs are checked again by the averaging thread
+    m_bArtifactSettingsChanged = true;
+    settingsChanged();
 }
 
 
@@ -264,31 +518,42 @@ void RtAve::setBaselineTo(int toSamp, int toMSec)
 
 //*************************************************************************************************************
 
-bool RtAve::start()
+bool RtAve::getStandardError(double dTriggerType, MatrixXd &matStdErr)
 {
-    //Check if the thread is already or still running. This can happen if the start button is pressed immediately after the stop button was pressed. In this case the stopping process is not finished yet but the start process is initiated.
-    if(this->isRunning())
-        QThread::wait();
-
-    m_bIsRunning = true;
+    QMutexLocker locker(&m_qMutex);
 
-    QThread::start();
+    if(!m_mapStimAve.contains(dTriggerType)) {
+        return false;
+    }
 
-    return true;
+    return m_mapStimAve[dTriggerType].standardError(matStdErr);
 }
 
 
 //*************************************************************************************************************
 
-bool RtAve::stop()
+bool RtAve::getSnr(double dTriggerType, MatrixXd &matSnr)
 {
     QMutexLocker locker(&m_qMutex);
 
-    m_bIsRunning = false;
+    MatrixXd matStdErr;
 
-    m_pRawMatrixBuffer->releaseFromPop();
+    if(!m_mapStimAve.contains(dTriggerType) || !m_mapStimAve[dTriggerType].standardError(matStdErr)) {
+        return false;
+    }
 
-    m_pRawMatrixBuffer->clear();
+    matSnr = m_mapStimAve[dTriggerType].mean();
+
+    if(m_bDoBaselineCorrection) {
+        for(int i = 0; i < m_pStimEvokedSet->evoked.size(); ++i) {
+            if(m_pStimEvokedSet->evoked.at(i).comment == QString::number(dTriggerType)) {
+                matSnr = MNEMath::rescale(matSnr, m_pStimEvokedSet->evoked.at(i).times, m_pairBaselineSec, QString("mean"));
+                break;
+            }
+        }
+    }
+
+    matSnr = (matStdErr.array() > 0.0).select(matSnr.array() / matStdErr.array(), 0.0);
 
     return true;
 }
@@ -296,31 +561,47 @@ bool RtAve::stop()
 
 //*************************************************************************************************************
 
-void RtAve::run()
+bool RtAve::start()
 {
-    //Do initial reset
     reset();
 
-    //Enter the main loop
-    while(m_bIsRunning) {
-        //Wait for first data block to arrive
-        if(isDataBufferInit()) {
-            if(controlValuesChanged()) {
-                reset();
-            }
+    return RtProcessor::start();
+}
 
-            //QElapsedTimer time;
-            //time.start();
 
-            //Acquire Data m_pRawMatrixBuffer is thread safe
-            MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
+//*************************************************************************************************************
 
-            //QMutexLocker locker(&m_qMutex);
-            doAveraging(rawSegment);
+void RtAve::applySettings()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(m_iNewNumAverages != m_iNumAverages) {
+        m_iNumAverages = m_iNewNumAverages;
 
-            //qDebug()<<"RtAve::run() - time.elapsed()"<<time.elapsed();
+        QMutableMapIterator<double,RtAveAccumulator> idx(m_mapStimAve);
+        while(idx.hasNext()) {
+            idx.next();
+            idx.value().setWindow(m_iNumAverages, m_iAverageMode == 1);
         }
     }
+
+    if(m_bResetRequested || controlValuesChanged()) {
+        resetAverages();
+        m_bResetRequested = false;
+    }
+
+    if(m_bArtifactSettingsChanged) {
+        updateRejection();
+        m_bArtifactSettingsChanged = false;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void RtAve::processData(const MatrixXd &matData)
+{
+    doAveraging(matData);
 }
 
 
@@ -541,20 +822,30 @@ void RtAve::mergeData(double dTriggerType)
     //Perform artifact threshold
     bool bArtifactedDetected = checkForArtifact(mergedData);
 
-    if(bArtifactedDetected == false) {
-        //Add cut data to average buffer
-        m_mapStimAve[dTriggerType].append(mergedData);
+    if(!m_mapStimAve.contains(dTriggerType)) {
+        m_mapStimAve[dTriggerType].setWindow(m_iNumAverages, m_iAverageMode == 1);
+    }
 
-        //Pop data from buffer
-        if(m_mapStimAve[dTriggerType].size() > m_iNumAverages && m_iNumAverages >= 1) {
-            for(int i = 0; i < m_mapStimAve[dTriggerType].size()-m_iNumAverages; ++i) {
-                m_mapStimAve[dTriggerType].pop_front();
-            }
-        }
+    //Add cut data to the running average. Rejected epochs are stored in case the artifact settings change.
+    m_mapStimAve[dTriggerType].append(mergedData, bArtifactedDetected);
+}
 
-        //Proceed a bit different if we use zero number of averages
-        if(m_mapStimAve[dTriggerType].size() > 1 && m_iNumAverages == 0) {
-            m_mapStimAve[dTriggerType].pop_front();
+
+//*************************************************************************************************************
+
+void RtAve::updateRejection()
+{
+    QMutableMapIterator<double,RtAveAccumulator> idx(m_mapStimAve);
+
+    while(idx.hasNext()) {
+        idx.next();
+        RtAveAccumulator& accumulator = idx.value();
+
+        //Go from the newest to the oldest epoch, accepting an epoch can drop the oldest ones from the window
+        for(int i = accumulator.storedEpochs() - 1; i >= 0; --i) {
+            int iStored = accumulator.storedEpochs();
+            accumulator.setRejected(i, checkForArtifact(accumulator.epoch(i)));
+            i -= iStored - accumulator.storedEpochs();
         }
     }
 }
@@ -611,7 +902,7 @@ void checkChThreshold(QPair<bool, RowVectorXd>& pairData)
 
 //*************************************************************************************************************
 
-bool RtAve::checkForArtifact(MatrixXd& data)
+bool RtAve::checkForArtifact(const MatrixXd& data)
 {
     bool bReject = false;
 
@@ -674,7 +965,7 @@ void RtAve::generateEvoked(double dTriggerType)
 {
     QMutexLocker locker(&m_qMutex);
 
-    if(m_mapStimAve[dTriggerType].isEmpty()) {
+    if(!m_mapStimAve.contains(dTriggerType) || m_mapStimAve[dTriggerType].nave() == 0) {
         return;
     }
 
@@ -710,42 +1001,16 @@ void RtAve::generateEvoked(double dTriggerType)
     }
 
     // Generate final evoked
-    MatrixXd finalAverage = MatrixXd::Zero(m_mapStimAve[dTriggerType].first().rows(), m_iPreStimSamples+m_iPostStimSamples);
-
-    if(m_iAverageMode == 0) {
-        for(int i = 0; i < m_mapStimAve[dTriggerType].size(); ++i) {
-            finalAverage += m_mapStimAve[dTriggerType].at(i);
-        }
-
-        if(m_mapStimAve[dTriggerType].isEmpty()) {
-            finalAverage = finalAverage/1;
-        } else {
-            finalAverage = finalAverage/m_mapStimAve[dTriggerType].size();
-        }
-
-        if(m_bDoBaselineCorrection) {
-            finalAverage = MNEMath::rescale(finalAverage, evoked.times, m_pairBaselineSec, QString("mean"));
-        }
-
-        evoked.data = finalAverage;
-
-        if(m_mapNumberCalcAverages[dTriggerType] < m_iNumAverages) {
-            m_mapNumberCalcAverages[dTriggerType]++;
-        }
-
-        evoked.nave = m_mapNumberCalcAverages[dTriggerType];
-    } else if(m_iAverageMode == 1) {
-        MatrixXd tempMatrix = m_mapStimAve[dTriggerType].last();
+    const RtAveAccumulator& accumulator = m_mapStimAve[dTriggerType];
 
-        if(m_bDoBaselineCorrection) {
-            tempMatrix = MNEMath::rescale(tempMatrix, evoked.times, m_pairBaselineSec, QString("mean"));
-        }
-
-        evoked += tempMatrix;
-
-        m_mapNumberCalcAverages[dTriggerType]++;
+    if(m_bDoBaselineCorrection) {
+        evoked.data = MNEMath::rescale(accumulator.mean(), evoked.times, m_pairBaselineSec, QString("mean"));
+    } else {
+        evoked.data = accumulator.mean();
     }
 
+    evoked.nave = accumulator.nave();
+
     //Add new data to evoked data set
     if(iEvokedIdx != -1) {
         //Evoked data is already present
@@ -761,9 +1026,19 @@ void RtAve::generateEvoked(double dTriggerType)
 
 void RtAve::reset()
 {
-//    qDebug()<<"RtAve::reset()";
     QMutexLocker locker(&m_qMutex);
 
+    m_bResetRequested = true;
+    settingsChanged();
+}
+
+
+//*************************************************************************************************************
+
+void RtAve::resetAverages()
+{
+//    qDebug()<<"RtAve::resetAverages()";
+
     //qDebug()<<"RtAve::reset() - 1";
 
     //Reset
@@ -784,7 +1059,6 @@ void RtAve::reset()
 //    m_mapDataPost.clear();
 //    m_mapFillingBackBuffer.clear();
 //    m_mapStimAve.clear();
-//    m_mapNumberCalcAverages.clear();
 
     m_qMapDetectedTrigger.clear();
     m_mapStimAve.clear();
@@ -792,7 +1066,6 @@ void RtAve::reset()
     m_mapDataPost.clear();
     m_mapMatDataPostIdx.clear();
     m_mapFillingBackBuffer.clear();
-    m_mapNumberCalcAverages.clear();
 
  //   qDebug()<<"RtAve::reset() - 4";
 
@@ -813,7 +1086,7 @@ void RtAve::reset()
 //    }
 
 //    //Reset data matrix buffer
-//    QMutableMapIterator<double,QList<Eigen::MatrixXd> > i2(m_mapStimAve);
+//    QMutableMapIterator<double,RtAveAccumulator> i2(m_mapStimAve);
 //    while (i2.hasNext()) {
 //        i2.next();
 
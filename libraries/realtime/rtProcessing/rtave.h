@@ -43,21 +43,20 @@
 //=============================================================================================================
 
 #include "../realtime_global.h"
+#include "rtprocessor.h"
 
 #include <fiff/fiff_evoked_set.h>
 #include <fiff/fiff_info.h>
 
-#include <utils/generics/circularmatrixbuffer.h>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
 // Qt INCLUDES
 //=============================================================================================================
 
-#include <QThread>
 #include <QMutex>
 #include <QSharedPointer>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -89,13 +88,197 @@ namespace REALTIMELIB
 //=============================================================================================================
 
 
+//=============================================================================================================
+/**
+* Running average of the epochs of one trigger type. The mean and the sum of squared deviations are updated with
+* Welford's method, so adding or removing an epoch costs one pass over the channels x times matrix, independent
+* of the number of averages. In the running mode the epochs of the moving window are kept in a ring of
+* preallocated slots. Rejected epochs are kept in the ring as well, without being part of the statistics, so
+* they can be added (or accepted epochs removed) incrementally when the rejection criteria change. The ring has
+* twice the window size; when it is full, the oldest rejected epoch is evicted, so the window always holds the
+* newest accepted epochs. In the cumulative mode no epochs are stored.
+*
+* @brief Running evoked accumulator with O(1) cost per trial.
+*/
+class REALTIMESHARED_EXPORT RtAveAccumulator
+{
+public:
+    //=========================================================================================================
+    /**
+    * Creates an accumulator in running mode with a window of one average.
+    */
+    RtAveAccumulator();
+
+    //=========================================================================================================
+    /**
+    * Sets the window. Switching between running and cumulative mode resets the accumulator, a smaller window
+    * removes the oldest epochs.
+    *
+    * @param[in] iNumAverages   The number of accepted epochs in the moving window, at least one is kept.
+    * @param[in] bCumulative    Whether to average all accepted epochs since the last reset.
+    */
+    void setWindow(int iNumAverages, bool bCumulative = false);
+
+    //=========================================================================================================
+    /**
+    * Adds an epoch (channels x times). The oldest epochs leave the window if it is full. The accumulator is
+    * reset if the size of the epochs changes.
+    *
+    * @param[in] matEpoch       The epoch.
+    * @param[in] bRejected      Whether the epoch is rejected. Rejected epochs are only stored.
+    */
+    void append(const Eigen::MatrixXd &matEpoch, bool bRejected = false);
+
+    //=========================================================================================================
+    /**
+    * Changes the rejection state of a stored epoch and updates the statistics.
+    *
+    * @param[in] iEpoch         The index of the stored epoch, 0 is the oldest.
+    * @param[in] bRejected      The new rejection state.
+    *
+    * @return true if the state changed, false otherwise.
+    */
+    bool setRejected(int iEpoch, bool bRejected);
+
+    //=========================================================================================================
+    /**
+    * Removes all epochs.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Computes the sample variance (normalized by the number of averages - 1) of the accepted epochs.
+    *
+    * @param[out] matVar    The variance (channels x times).
+    *
+    * @return true if more than one epoch was accepted, false otherwise.
+    */
+    bool variance(Eigen::MatrixXd &matVar) const;
+
+    //=========================================================================================================
+    /**
+    * Computes the standard error of the mean of the accepted epochs.
+    *
+    * @param[out] matStdErr The standard error (channels x times).
+    *
+    * @return true if more than one epoch was accepted, false otherwise.
+    */
+    bool standardError(Eigen::MatrixXd &matStdErr) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the mean of the accepted epochs.
+    *
+    * @return the mean, empty if no epoch was accepted yet.
+    */
+    inline const Eigen::MatrixXd& mean() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of accepted epochs, i.e. the number of averages.
+    *
+    * @return the number of averages.
+    */
+    inline int nave() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of stored epochs, accepted and rejected.
+    *
+    * @return the number of stored epochs.
+    */
+    inline int storedEpochs() const;
+
+    //=========================================================================================================
+    /**
+    * Returns a stored epoch.
+    *
+    * @param[in] iEpoch     The index of the stored epoch, 0 is the oldest.
+    *
+    * @return the epoch.
+    */
+    inline const Eigen::MatrixXd& epoch(int iEpoch) const;
+
+    //=========================================================================================================
+    /**
+    * Returns whether a stored epoch is rejected.
+    *
+    * @param[in] iEpoch     The index of the stored epoch, 0 is the oldest.
+    *
+    * @return true if the epoch is rejected, false otherwise.
+    */
+    inline bool isRejected(int iEpoch) const;
+
+protected:
+    //=========================================================================================================
+    /**
+    * Adds an epoch to the mean and the sum of squared deviations.
+    *
+    * @param[in] matEpoch   The epoch.
+    */
+    void addToStatistics(const Eigen::MatrixXd &matEpoch);
+
+    //=========================================================================================================
+    /**
+    * Removes an epoch from the mean and the sum of squared deviations.
+    *
+    * @param[in] matEpoch   The epoch.
+    */
+    void removeFromStatistics(const Eigen::MatrixXd &matEpoch);
+
+    //=========================================================================================================
+    /**
+    * Removes the oldest stored epoch.
+    */
+    void dropOldest();
+
+    //=========================================================================================================
+    /**
+    * Removes the oldest rejected epoch, or the oldest epoch if none is rejected.
+    */
+    void dropOldestRejected();
+
+    //=========================================================================================================
+    /**
+    * Copies the stored epochs into a ring of the given number of slots, oldest first.
+    *
+    * @param[in] iSlots     The new number of slots.
+    */
+    void resizeRing(int iSlots);
+
+    //=========================================================================================================
+    /**
+    * Returns the ring slot of a stored epoch.
+    *
+    * @param[in] iEpoch     The index of the stored epoch, 0 is the oldest.
+    *
+    * @return the slot.
+    */
+    inline int slot(int iEpoch) const;
+
+    int                         m_iNumAverages;     /**< The number of accepted epochs in the moving window. */
+    bool                        m_bCumulative;      /**< Whether all accepted epochs since the last reset are averaged. */
+
+    QVector<Eigen::MatrixXd>    m_vecEpochs;        /**< The ring of epoch slots. */
+    QVector<bool>               m_vecRejected;      /**< The rejection state of each slot. */
+    int                         m_iHead;            /**< The slot of the oldest stored epoch. */
+    int                         m_iStored;          /**< The number of stored epochs. */
+
+    int                         m_iNave;            /**< The number of accepted epochs. */
+    Eigen::MatrixXd             m_matMean;          /**< The mean of the accepted epochs. */
+    Eigen::MatrixXd             m_matM2;            /**< The sum of squared deviations from the mean. */
+    Eigen::MatrixXd             m_matDelta;         /**< Scratch buffer for the Welford updates. */
+};
+
+
 //=============================================================================================================
 /**
 * Real-time averaging and returns evoked data
 *
 * @brief Real-time averaging helper
 */
-class REALTIMESHARED_EXPORT RtAve : public QThread
+class REALTIMESHARED_EXPORT RtAve : public RtProcessor
 {
     Q_OBJECT
 public:
@@ -219,42 +402,63 @@ public:
 
     //=========================================================================================================
     /**
-    * Starts the RtAve by starting the producer's thread.
+    * Returns the standard error of the current average of a trigger type.
+    *
+    * @param[in] dTriggerType   The trigger type.
+    * @param[out] matStdErr     The standard error (channels x times).
+    *
+    * @return true if more than one epoch was averaged, false otherwise.
     */
-    virtual bool start();
+    bool getStandardError(double dTriggerType, Eigen::MatrixXd &matStdErr);
 
     //=========================================================================================================
     /**
-    * Stops the RtAve by stopping the producer's thread.
+    * Returns the signal-to-noise ratio of the current average of a trigger type, i.e. the (baseline corrected)
+    * average divided by its standard error. Entries with zero standard error are set to zero.
     *
-    * @return true if succeeded, false otherwise
+    * @param[in] dTriggerType   The trigger type.
+    * @param[out] matSnr        The signal-to-noise ratio (channels x times).
+    *
+    * @return true if more than one epoch was averaged, false otherwise.
     */
-    virtual bool stop();
+    bool getSnr(double dTriggerType, Eigen::MatrixXd &matSnr);
 
     //=========================================================================================================
     /**
-    * Returns true if is running, otherwise false.
+    * Starts the RtAve. The averaged data is reset before the first block.
     *
-    * @return true if is running, false otherwise
+    * @return true if succeeded, false otherwise
     */
-    inline bool isRunning();
+    virtual bool start();
 
     //=========================================================================================================
     /**
-    * Resets the averaged data stored.
+    * Resets the averaged data stored. The reset is done by the averaging thread before the next block.
     */
     void reset();
 
 protected:
     //=========================================================================================================
     /**
-    * The starting point for the thread. After calling start(), the newly created thread calls this function.
-    * Returning from this method will end the execution of the thread.
-    * Pure virtual method inherited by QThread.
+    * Takes over the changed settings. Resets the averages if the epoch or the trigger settings changed.
+    */
+    virtual void applySettings();
+
+    //=========================================================================================================
+    /**
+    * Scans a data block for triggers and updates the averages.
+    *
+    * @param[in] matData    The data block.
     */
-    virtual void run();
+    virtual void processData(const Eigen::MatrixXd &matData);
 
 private:
+    //=========================================================================================================
+    /**
+    * Takes over the epoch and trigger settings and clears all averages. m_qMutex has to be locked.
+    */
+    void resetAverages();
+
     //=========================================================================================================
     /**
     * do the actual averaging here.
@@ -273,6 +477,12 @@ private:
     */
     void fillBackBuffer(const Eigen::MatrixXd& data, double dTriggerType);
 
+    //=========================================================================================================
+    /**
+    * Checks all stored epochs again with the current artifact settings and updates the averages.
+    */
+    void updateRejection();
+
     //=========================================================================================================
     /**
     * Packs the buffers togehter as one and calcualtes the current running average and emits the result if number of averages has been reached.
@@ -293,23 +503,18 @@ private:
     *
     * @return   Whether a thresold artifact was detected.
     */
-    bool checkForArtifact(Eigen::MatrixXd& data);
-
-    //=========================================================================================================
-    /**
-    * Check if data buffer has been initialized
-    */
-    inline bool isDataBufferInit();
+    bool checkForArtifact(const Eigen::MatrixXd& data);
 
     //=========================================================================================================
     /**
-    * Check if control values have been changed
+    * Check if control values have been changed. m_qMutex has to be locked.
     */
     inline bool controlValuesChanged();
 
     QMutex                                          m_qMutex;                   /**< Provides access serialization between threads*/
 
     qint32                                          m_iNumAverages;             /**< Number of averages */
+    qint32                                          m_iNewNumAverages;          /**< New number of averages */
 
     qint32                                          m_iPreStimSamples;          /**< Amount of samples averaged before the stimulus. */
     qint32                                          m_iNewPreStimSamples;       /**< New amount of samples averaged before the stimulus. */
@@ -327,7 +532,8 @@ private:
 
     bool                                            m_bActivateThreshold;       /**< Whether to do threshold artifact reduction or not. */
     bool                                            m_bActivateVariance;        /**< Whether to do variance artifact reduction or not. */
-    bool                                            m_bIsRunning;               /**< Holds if real-time Covariance estimation is running.*/
+    bool                                            m_bArtifactSettingsChanged; /**< Whether the stored epochs have to be checked for artifacts again. */
+    bool                                            m_bResetRequested;          /**< Whether the averages have to be reset before the next block. */
     bool                                            m_bAutoAspect;              /**< Auto aspect detection on or off. */
     bool                                            m_bDoBaselineCorrection;    /**< Whether to perform baseline correction. */
 
@@ -338,14 +544,11 @@ private:
     FIFFLIB::FiffEvokedSet::SPtr                    m_pStimEvokedSet;           /**< Holds the evoked information. */
 
     QMap<int,QList<int> >                           m_qMapDetectedTrigger;      /**< Detected trigger for each trigger channel. */
-    QMap<double,QList<Eigen::MatrixXd> >            m_mapStimAve;               /**< the current stimulus average buffer. Holds m_iNumAverages vectors */
+    QMap<double,RtAveAccumulator>                   m_mapStimAve;               /**< The running average of each trigger type. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPre;               /**< The matrix holding the pre stim data. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPost;              /**< The matrix holding the post stim data. */
     QMap<double,qint32>                             m_mapMatDataPostIdx;        /**< Current index inside of the matrix m_matDataPost */
     QMap<double,bool>                               m_mapFillingBackBuffer;     /**< Whether the back buffer is currently getting filled. */
-    QMap<double,qint32>                             m_mapNumberCalcAverages;    /**< The number of currently calculated averages for each trigger type. */
-
-    IOBUFFER::CircularMatrixBuffer<double>::SPtr    m_pRawMatrixBuffer;         /**< The Circular Raw Matrix Buffer. */
 
 signals:
     //=========================================================================================================
@@ -363,39 +566,62 @@ signals:
 // INLINE DEFINITIONS
 //=============================================================================================================
 
-inline bool RtAve::isRunning()
+inline const Eigen::MatrixXd& RtAveAccumulator::mean() const
 {
-    return m_bIsRunning;
+    return m_matMean;
 }
 
 
 //*************************************************************************************************************
 
-inline bool RtAve::isDataBufferInit()
+inline int RtAveAccumulator::nave() const
 {
-    QMutexLocker locker(&m_qMutex);
+    return m_iNave;
+}
 
-    bool result = false;
 
-    if(m_pRawMatrixBuffer) {
-        result = true;
-    }
+//*************************************************************************************************************
 
-    return result;
+inline int RtAveAccumulator::storedEpochs() const
+{
+    return m_iStored;
 }
 
 
 //*************************************************************************************************************
 
-inline bool RtAve::controlValuesChanged()
+inline const Eigen::MatrixXd& RtAveAccumulator::epoch(int iEpoch) const
+{
+    return m_vecEpochs.at(slot(iEpoch));
+}
+
+
+//*************************************************************************************************************
+
+inline bool RtAveAccumulator::isRejected(int iEpoch) const
 {
-    QMutexLocker locker(&m_qMutex);
+    return m_vecRejected.at(slot(iEpoch));
+}
 
+
+//*************************************************************************************************************
+
+inline int RtAveAccumulator::slot(int iEpoch) const
+{
+    return (m_iHead + iEpoch) % m_vecEpochs.size();
+}
+
+
+//*************************************************************************************************************
+
+inline bool RtAve::controlValuesChanged()
+{
     bool result = false;
 
     if(m_iNewPreStimSamples != m_iPreStimSamples
             || m_iNewPostStimSamples != m_iPostStimSamples
-            || m_iNewTriggerIndex != m_iTriggerChIndex) {
+            || m_iNewTriggerIndex != m_iTriggerChIndex
+            || m_iNewAverageMode != m_iAverageMode) {
         result = true;
     }
 
@@ -45,6 +45,7 @@
 #include <fiff/fiff_cov.h>
 
 #include <iostream>
+#include <cmath>
 
 
 //*************************************************************************************************************
@@ -53,7 +54,6 @@
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -63,30 +63,176 @@
 
 using namespace REALTIMELIB;
 using namespace FIFFLIB;
+using namespace Eigen;
 
 
 //*************************************************************************************************************
 //=============================================================================================================
-// DEFINE MEMBER METHODS RtCovWorker
+// DEFINE MEMBER METHODS RtCovAccumulator
 //=============================================================================================================
 
-void RtCovWorker::doWork(const RtCovInput &inputData)
+RtCovAccumulator::RtCovAccumulator()
+: m_windowMode(Block)
+, m_iWindowSamples(0)
+, m_dForgettingFactor(1.0)
+, m_dSamples(0.0)
 {
-    if(this->thread()->isInterruptionRequested()) {
+}
+
+
+//*************************************************************************************************************
+
+void RtCovAccumulator::setWindow(WindowMode mode, int iWindowSamples, double dForgettingFactor)
+{
+    m_windowMode = mode;
+    m_iWindowSamples = iWindowSamples;
+    m_dForgettingFactor = qBound(0.0, dForgettingFactor, 1.0);
+
+    reset();
+}
+
+
+//*************************************************************************************************************
+
+void RtCovAccumulator::append(const MatrixXd &matData)
+{
+    if(matData.cols() == 0) {
         return;
     }
 
-    QFuture<RtCovComputeResult> result = QtConcurrent::mappedReduced(inputData.lData,
-                                                                     compute,
-                                                                     reduce);
+    if(m_vecSum.size() != matData.rows()) {
+        m_vecSum = VectorXd::Zero(matData.rows());
+        m_matSumSq = MatrixXd::Zero(matData.rows(), matData.rows());
+        m_dSamples = 0.0;
+        m_lWindow.clear();
+    }
+
+    switch(m_windowMode) {
+        case Exponential: {
+            //Age the previous samples by the block length and weight the new samples by their own age
+            const int iCols = matData.cols();
+            const double dDecay = std::pow(m_dForgettingFactor, iCols);
+
+            m_vecSum *= dDecay;
+            m_matSumSq.triangularView<Lower>() *= dDecay;
+            m_dSamples *= dDecay;
+
+            m_vecWeights.resize(iCols);
+            for(int j = 0; j < iCols; ++j) {
+                m_vecWeights(j) = std::pow(m_dForgettingFactor, iCols - 1 - j);
+            }
+
+            m_vecSum += matData * m_vecWeights.transpose();
+            m_matSumSq.selfadjointView<Lower>().rankUpdate(matData * m_vecWeights.cwiseSqrt().asDiagonal());
+            m_dSamples += m_vecWeights.sum();
+
+            break;
+        }
+
+        case Sliding: {
+            m_vecSum += matData.rowwise().sum();
+            m_matSumSq.selfadjointView<Lower>().rankUpdate(matData);
+            m_dSamples += matData.cols();
+
+            if(m_iWindowSamples <= 0) {
+                break;
+            }
+
+            m_lWindow.append(matData);
+
+            //Remove the samples which left the window with a rank-k downdate
+            while(m_dSamples > m_iWindowSamples && !m_lWindow.isEmpty()) {
+                MatrixXd& matOldest = m_lWindow.first();
+                const int iDrop = qMin((int)matOldest.cols(), (int)(m_dSamples - m_iWindowSamples));
+
+                m_vecSum -= matOldest.leftCols(iDrop).rowwise().sum();
+                m_matSumSq.selfadjointView<Lower>().rankUpdate(matOldest.leftCols(iDrop), -1.0);
+                m_dSamples -= iDrop;
+
+                if(iDrop == matOldest.cols()) {
+                    m_lWindow.removeFirst();
+                } else {
+                    matOldest = matOldest.rightCols(matOldest.cols() - iDrop).eval();
+                }
+            }
+
+            break;
+        }
+
+        default: {
+            m_vecSum += matData.rowwise().sum();
+            m_matSumSq.selfadjointView<Lower>().rankUpdate(matData);
+            m_dSamples += matData.cols();
+
+            break;
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void RtCovAccumulator::reset()
+{
+    m_vecSum.setZero();
+    m_matSumSq.setZero();
+    m_dSamples = 0.0;
+    m_lWindow.clear();
+}
+
+
+//*************************************************************************************************************
+
+bool RtCovAccumulator::covariance(MatrixXd &matCov) const
+{
+    if(m_dSamples <= 1.0) {
+        return false;
+    }
+
+    matCov = covarianceFromSums(m_vecSum, m_matSumSq, m_dSamples);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RtCovAccumulator::getSums(RtCovInput &inputData) const
+{
+    inputData.vecSum = m_vecSum;
+    inputData.matSumSq = m_matSumSq;
+    inputData.dSamples = m_dSamples;
+}
 
-    result.waitForFinished();
 
-    RtCovComputeResult finalResult = result.result();
+//*************************************************************************************************************
+
+MatrixXd RtCovAccumulator::covarianceFromSums(const VectorXd &vecSum,
+                                              const MatrixXd &matSumSq,
+                                              double dSamples)
+{
+    MatrixXd matCov = matSumSq.selfadjointView<Lower>();
+
+    VectorXd mu = vecSum / dSamples;
+    matCov.noalias() -= dSamples * mu * mu.transpose();
+    matCov /= (dSamples - 1.0);
+
+    return matCov;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS RtCovWorker
+//=============================================================================================================
+
+void RtCovWorker::doWork(const RtCovInput &inputData)
+{
+    if(this->thread()->isInterruptionRequested()) {
+        return;
+    }
 
-    //Final computation
     FiffCov computedCov;
-    computedCov.data = finalResult.matData;
 
     QStringList exclude;
     for(int i = 0; i<inputData.fiffInfo.chs.size(); i++) {
@@ -97,10 +243,8 @@ void RtCovWorker::doWork(const RtCovInput &inputData)
     }
     bool doProj = true;
 
-    if(inputData.iSamples > 0) {
-        finalResult.mu /= (float)inputData.iSamples;
-        computedCov.data.array() -= inputData.iSamples * (finalResult.mu * finalResult.mu.transpose()).array();
-        computedCov.data.array() /= (inputData.iSamples - 1);
+    if(inputData.dSamples > 1.0) {
+        computedCov.data = RtCovAccumulator::covarianceFromSums(inputData.vecSum, inputData.matSumSq, inputData.dSamples);
 
         computedCov.kind = FIFFV_MNE_NOISE_COV;
         computedCov.diag = false;
@@ -110,54 +254,19 @@ void RtCovWorker::doWork(const RtCovInput &inputData)
         computedCov.names = inputData.fiffInfo.ch_names;
         computedCov.projs = inputData.fiffInfo.projs;
         computedCov.bads = inputData.fiffInfo.bads;
-        computedCov.nfree = inputData.iSamples;
+        computedCov.nfree = (int)inputData.dSamples;
 
         // regularize noise covariance
         computedCov = computedCov.regularize(inputData.fiffInfo, 0.05, 0.05, 0.1, doProj, exclude);
 
-        //            qint32 samples = rawSegment.cols();
-        //            VectorXf mu = rawSegment.rowwise().sum().array() / (float)samples;
-
-        //            MatrixXf noise_covariance = rawSegment * rawSegment.transpose();// noise_covariance == raw_covariance
-        //            noise_covariance.array() -= samples * (mu * mu.transpose()).array();
-        //            noise_covariance.array() /= (samples - 1);
-
-        //            std::cout << "Noise Covariance:\n" << noise_covariance.block(0,0,10,10) << std::endl;
-
-        //            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
         emit resultReady(computedCov);
     } else {
-        qDebug() << "RtCovWorker::doWork - Number of samples equals zero. Regularization not possible. Returning without result.";
+        qDebug() << "RtCovWorker::doWork - Number of samples is too small. Regularization not possible. Returning without result.";
     }
 
 }
 
 
-//*************************************************************************************************************
-
-RtCovComputeResult RtCovWorker::compute(const MatrixXd &matData)
-{
-    RtCovComputeResult result;
-    result.mu = matData.rowwise().sum();
-    result.matData = matData * matData.transpose();
-    return result;
-}
-
-
-//*************************************************************************************************************
-
-void RtCovWorker::reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult)
-{
-    if(finalResult.matData.size() == 0 || finalResult.mu.size() == 0) {
-        finalResult.mu = tempResult.mu;
-        finalResult.matData = tempResult.matData;
-    } else {
-        finalResult.mu += tempResult.mu;
-        finalResult.matData += tempResult.matData;
-    }
-}
-
-
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS RtCov
@@ -205,23 +314,35 @@ void RtCov::setSamples(qint32 samples)
 }
 
 
+//*************************************************************************************************************
+
+void RtCov::setWindow(RtCovAccumulator::WindowMode mode, int iWindowSamples, double dForgettingFactor)
+{
+    m_accumulator.setWindow(mode, iWindowSamples, dForgettingFactor);
+    m_iSamples = 0;
+}
+
+
 //*************************************************************************************************************
 
 void RtCov::append(const MatrixXd &matDataSegment)
 {
-    m_lData.append(matDataSegment);
+    m_accumulator.append(matDataSegment);
     m_iSamples += matDataSegment.cols();
 
     if(m_iSamples >= m_iMaxSamples) {
+        //Only the channels x channels sums are handed to the worker, the blocks are not stored
         RtCovInput inputData;
-        inputData.lData = m_lData;
+        m_accumulator.getSums(inputData);
         inputData.fiffInfo = FiffInfo(*m_pFiffInfo);
-        inputData.iSamples = m_iSamples;
 
         emit operate(inputData);
 
         m_iSamples = 0;
-        m_lData.clear();
+
+        if(m_accumulator.windowMode() == RtCovAccumulator::Block) {
+            m_accumulator.reset();
+        }
     }
 }
 
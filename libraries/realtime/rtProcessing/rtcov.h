@@ -87,56 +87,146 @@ namespace REALTIMELIB
 // REALTIMELIB FORWARD DECLARATIONS
 //=============================================================================================================
 
-struct RtCovComputeResult {
-    Eigen::VectorXd mu;
-    Eigen::MatrixXd matData;
-};
-
 struct RtCovInput {
-    QList<Eigen::MatrixXd>      lData;
-    FIFFLIB::FiffInfo           fiffInfo;
-    int                         iSamples;
+    Eigen::VectorXd             vecSum;         /**< The (weighted) sum of the samples. */
+    Eigen::MatrixXd             matSumSq;       /**< The (weighted) sum of the outer products of the samples. */
+    double                      dSamples;       /**< The (effective) number of samples. */
+    FIFFLIB::FiffInfo           fiffInfo;       /**< The measurement information. */
 };
 
 
 //=============================================================================================================
 /**
-* Real-time covariance worker.
+* Online accumulator of the sufficient statistics of a covariance, i.e. the sum of the samples and the sum of
+* their outer products. The memory does not depend on the number of samples and each block costs one rank-k
+* update of the channels x channels sums. Three window modes are supported:
 *
-* @brief Real-time covariance worker.
+* Block:        all samples since the last reset are used with equal weight.
+* Exponential:  each sample is weighted by dForgettingFactor^age, nothing but the sums is stored.
+* Sliding:      the last iWindowSamples samples are used with equal weight. The samples which leave the window
+*               are removed again by a rank-k downdate, so the raw data of one window is kept for that.
+*
+* @brief Online covariance accumulator.
 */
-class RtCovWorker : public QObject
+class REALTIMESHARED_EXPORT RtCovAccumulator
 {
-    Q_OBJECT
-
 public:
+    enum WindowMode {
+        Block,
+        Exponential,
+        Sliding
+    };
+
+    //=========================================================================================================
+    /**
+    * Creates an accumulator in Block mode.
+    */
+    RtCovAccumulator();
+
     //=========================================================================================================
     /**
-    * Perform actual covariance estimation.
+    * Sets the window mode and resets the accumulator.
     *
-    * @param[in] inputData  Data to estimate the covariance from.
+    * @param[in] mode               The window mode.
+    * @param[in] iWindowSamples     The window length in samples, used by the Sliding mode.
+    * @param[in] dForgettingFactor  The weight decay per sample in (0, 1], used by the Exponential mode.
     */
-    void doWork(const RtCovInput &inputData);
+    void setWindow(WindowMode mode, int iWindowSamples = 0, double dForgettingFactor = 1.0);
 
-protected:
     //=========================================================================================================
     /**
-    * Computer multiplication with transposed.
+    * Adds a data block (channels x samples). The accumulator is reset if the number of channels changes.
     *
-    * @param[in] matData  Data to self multiply with.
+    * @param[in] matData    The data block.
+    */
+    void append(const Eigen::MatrixXd &matData);
+
+    //=========================================================================================================
+    /**
+    * Removes all samples.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Computes the covariance (normalized by the number of samples - 1) of the accumulated samples.
+    *
+    * @param[out] matCov    The covariance.
+    *
+    * @return true if more than one sample was accumulated, false otherwise.
+    */
+    bool covariance(Eigen::MatrixXd &matCov) const;
+
+    //=========================================================================================================
+    /**
+    * Copies the accumulated sums to the covariance worker input.
     *
-    * @return   The multiplication result.
+    * @param[out] inputData     The worker input, the measurement information is not touched.
     */
-    static RtCovComputeResult compute(const Eigen::MatrixXd &matData);
+    void getSums(RtCovInput &inputData) const;
 
     //=========================================================================================================
     /**
-    * Computer multiplication with transposed.
+    * Returns the (effective) number of accumulated samples.
     *
-    * @param[out]   finalResult     The final covariance estimation.
-    * @param[in]    tempResult      The intermediate result from the compute function
+    * @return the number of samples.
     */
-    static void reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult);
+    inline double samples() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the window mode.
+    *
+    * @return the window mode.
+    */
+    inline WindowMode windowMode() const;
+
+    //=========================================================================================================
+    /**
+    * Computes the covariance from the given sums.
+    *
+    * @param[in] vecSum     The sum of the samples.
+    * @param[in] matSumSq   The sum of the outer products, only the lower triangle is used.
+    * @param[in] dSamples   The number of samples.
+    *
+    * @return the covariance.
+    */
+    static Eigen::MatrixXd covarianceFromSums(const Eigen::VectorXd &vecSum,
+                                              const Eigen::MatrixXd &matSumSq,
+                                              double dSamples);
+
+protected:
+    WindowMode                  m_windowMode;           /**< The window mode. */
+    int                         m_iWindowSamples;       /**< The window length of the Sliding mode. */
+    double                      m_dForgettingFactor;    /**< The weight decay per sample of the Exponential mode. */
+
+    Eigen::VectorXd             m_vecSum;               /**< The (weighted) sum of the samples. */
+    Eigen::MatrixXd             m_matSumSq;             /**< The (weighted) sum of the outer products, lower triangle. */
+    double                      m_dSamples;             /**< The (effective) number of samples. */
+
+    QList<Eigen::MatrixXd>      m_lWindow;              /**< The blocks in the sliding window, oldest first. */
+    Eigen::RowVectorXd          m_vecWeights;           /**< Scratch buffer for the exponential sample weights. */
+};
+
+
+//=============================================================================================================
+/**
+* Real-time covariance worker.
+*
+* @brief Real-time covariance worker.
+*/
+class RtCovWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    //=========================================================================================================
+    /**
+    * Computes the covariance from the accumulated sums and regularizes it.
+    *
+    * @param[in] inputData  The accumulated sums to estimate the covariance from.
+    */
+    void doWork(const RtCovInput &inputData);
 
 signals:
     //=========================================================================================================
@@ -151,7 +241,8 @@ signals:
 
 //=============================================================================================================
 /**
-* Real-time covariance estimation
+* Real-time covariance estimation. The incoming blocks are added to an online accumulator and a new covariance is
+* published every iMaxSamples samples. The raw data is not stored, except for the Sliding window mode.
 *
 * @brief Real-time covariance estimation
 */
@@ -167,7 +258,7 @@ public:
     /**
     * Creates the real-time covariance estimation object.
     *
-    * @param[in] iMaxSamples      Number of samples to use for each data chunk
+    * @param[in] iMaxSamples      Number of samples between two published covariances
     * @param[in] pFiffInfo        Associated Fiff Information
     * @param[in] parent     Parent QObject (optional)
     */
@@ -191,12 +282,23 @@ public:
 
     //=========================================================================================================
     /**
-    * Set number of estimation samples
+    * Set number of samples between two published covariances
     *
     * @param[in] samples    estimation samples to set
     */
     void setSamples(qint32 samples);
 
+    //=========================================================================================================
+    /**
+    * Sets the window of the covariance estimation and drops the accumulated samples. The default Block mode
+    * estimates each covariance from the iMaxSamples samples since the previous one.
+    *
+    * @param[in] mode               The window mode.
+    * @param[in] iWindowSamples     The window length in samples, used by the Sliding mode.
+    * @param[in] dForgettingFactor  The weight decay per sample in (0, 1], used by the Exponential mode.
+    */
+    void setWindow(RtCovAccumulator::WindowMode mode, int iWindowSamples = 0, double dForgettingFactor = 1.0);
+
     //=========================================================================================================
     /**
     * Restarts the thread by interrupting its computation queue, quitting, waiting and then starting it again.
@@ -220,9 +322,9 @@ protected:
 
     qint32                  m_iMaxSamples;              /**< Maximal amount of samples received, before covariance is estimated.*/
     qint32                  m_iNewMaxSamples;           /**< New maximal amount of samples received, before covariance is estimated.*/
-    int                     m_iSamples;                 /**< The number of stored samples. */
+    int                     m_iSamples;                 /**< The number of samples since the last published covariance. */
 
-    QList<Eigen::MatrixXd>  m_lData;                    /**< The stored data blocks. */
+    RtCovAccumulator        m_accumulator;              /**< The online covariance accumulator. */
 
     QSharedPointer<FIFFLIB::FiffInfo>  m_pFiffInfo;     /**< Holds the fiff measurement information. */
 
@@ -237,9 +339,9 @@ signals:
 
     //=========================================================================================================
     /**
-    * Emit this signal whenver the worker should process a new batch of stored data blocks.
+    * Emit this signal whenver the worker should estimate a new covariance.
     *
-    * @param[in] inputData  The new batch of stored data.
+    * @param[in] inputData  The accumulated sums.
     */
     void operate(const RtCovInput &inputData);
 
@@ -250,6 +352,19 @@ signals:
 // INLINE DEFINITIONS
 //=============================================================================================================
 
+inline double RtCovAccumulator::samples() const
+{
+    return m_dSamples;
+}
+
+
+//*************************************************************************************************************
+
+inline RtCovAccumulator::WindowMode RtCovAccumulator::windowMode() const
+{
+    return m_windowMode;
+}
+
 } // NAMESPACE
 
 #endif // RTCOV_H
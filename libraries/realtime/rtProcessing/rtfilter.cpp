@@ -32,7 +32,6 @@
 *
 */
 
-
 //*************************************************************************************************************
 //=============================================================================================================
 // INCLUDES
@@ -41,6 +40,14 @@
 #include "rtfilter.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -54,24 +61,42 @@ using namespace FIFFLIB;
 
 //*************************************************************************************************************
 //=============================================================================================================
-// DEFINE GLOBAL METHODS
+// DEFINE MEMBER METHODS
 //=============================================================================================================
 
-void doFilterPerChannelRTMSA(QPair<QList<FilterData>,QPair<int,RowVectorXd> > &channelDataTime)
+void RtFilterChunk::filter()
 {
-    for(int i = 0; i < channelDataTime.first.size(); ++i) {
-        //channelDataTime.second.second = channelDataTime.first.at(i).applyConvFilter(channelDataTime.second.second, true, FilterData::ZeroPad);
-        channelDataTime.second.second = channelDataTime.first.at(i).applyFFTFilter(channelDataTime.second.second, true, FilterData::ZeroPad); //FFT Convolution for rt is not suitable. FFT make the signal filtering non causal.
+    MatrixXd& matData = *pMatData;
+    MatrixXd& matHistory = *pMatHistory;
+    const int iCols = matData.cols();
+
+    vecTime.resize(iFFTLength);
+
+    for(int i = 0; i < iChannels.size(); ++i) {
+        const int iChannel = iChannels.at(i);
+
+        //Assemble the history and the new block, the rest is zero padding
+        vecTime.head(iHistory) = matHistory.row(iChannel);
+        vecTime.segment(iHistory, iCols) = matData.row(iChannel);
+        vecTime.tail(iFFTLength - iHistory - iCols).setZero();
+
+        //Keep the last input samples for the next block before the row is overwritten
+        matHistory.row(iChannel) = vecTime.segment(iCols, iHistory);
+
+        fft.fwd(vecFreq, vecTime);
+        vecFreq = vecFreq.cwiseProduct(*pVecSpectrum);
+        fft.inv(vecTime, vecFreq);
+
+        //The first iHistory samples are corrupted by the circular convolution and discarded
+        matData.row(iChannel) = vecTime.segment(iHistory, iCols);
     }
 }
 
 
 //*************************************************************************************************************
-//=============================================================================================================
-// DEFINE MEMBER METHODS
-//=============================================================================================================
 
 RtFilter::RtFilter()
+: m_iFFTLength(0)
 {
 }
 
@@ -90,68 +115,228 @@ MatrixXd RtFilter::filterChannelsConcurrently(const MatrixXd& matDataIn,
                                               const QVector<int>& lFilterChannelList,
                                               const QList<FilterData>& lFilterData)
 {
-    //Initialise the overlay matrix
-    if(m_matOverlap.cols() != iMaxFilterLength || m_matOverlap.rows() < matDataIn.rows()) {
-        m_matOverlap.resize(matDataIn.rows(), iMaxFilterLength);
-        m_matOverlap.setZero();
+    MatrixXd matDataOut = matDataIn;
+
+    filterChannelsInPlace(matDataOut, iMaxFilterLength, lFilterChannelList, lFilterData);
+
+    return matDataOut;
+}
+
+
+//*************************************************************************************************************
+
+void RtFilter::filterChannelsInPlace(MatrixXd& matData,
+                                     int iMaxFilterLength,
+                                     const QVector<int>& lFilterChannelList,
+                                     const QList<FilterData>& lFilterData)
+{
+    if(matData.size() == 0) {
+        return;
     }
 
-    if(m_matDelay.cols() != iMaxFilterLength/2 || m_matOverlap.rows() < matDataIn.rows()) {
-        m_matDelay.resize(matDataIn.rows(), iMaxFilterLength/2);
-        m_matDelay.setZero();
+    bool bFilterChanged = updateImpulseResponse(lFilterData);
+    updateSetup(matData.rows(), matData.cols(), lFilterChannelList, bFilterChanged);
+
+    //Do the filtering
+    for(int i = 0; i < m_lChunks.size(); ++i) {
+        m_lChunks[i].pMatData = &matData;
     }
 
-    //Resize output matrix to match input matrix
-    MatrixXd matDataOut(matDataIn.rows(), matDataIn.cols());
+    if(m_lChunks.size() > 1) {
+        QtConcurrent::blockingMap(m_lChunks, &RtFilterChunk::filter);
+    } else if(m_lChunks.size() == 1) {
+        m_lChunks[0].filter();
+    }
 
-    //Generate QList structure which can be handled by the QConcurrent framework
-    QList<QPair<QList<FilterData>,QPair<int,RowVectorXd> > > timeData;
-    QList<int> notFilterChannelIndex;
+    //The IIR sections run on all filtered channels at once, their state is kept in m_iirFilter
+    if(m_iirFilter.sos().rows() > 0 && m_lIirChannels.size() > 0) {
+        m_matIirScratch.resize(m_lIirChannels.size(), matData.cols());
 
-    //Only select channels specified in lFilterChannelList
-    for(qint32 i = 0; i < matDataIn.rows(); ++i) {
-        int pos = lFilterChannelList.indexOf(i);
-        if(pos != -1 && pos < matDataIn.rows()) {
-            timeData.append(QPair<QList<FilterData>,QPair<int,RowVectorXd> >(lFilterData,QPair<int,RowVectorXd>(pos,matDataIn.row(pos))));
-        } else {
-            notFilterChannelIndex.append(i);
+        for(int i = 0; i < m_lIirChannels.size(); ++i) {
+            m_matIirScratch.row(i) = matData.row(m_lIirChannels.at(i));
+        }
+
+        m_iirFilter.filter(m_matIirScratch);
+
+        for(int i = 0; i < m_lIirChannels.size(); ++i) {
+            matData.row(m_lIirChannels.at(i)) = m_matIirScratch.row(i);
         }
     }
 
-    //Do the concurrent filtering
-    if(!timeData.isEmpty()) {
-        QFuture<void> future = QtConcurrent::map(timeData,
-                                             doFilterPerChannelRTMSA);
+    //Delay the channels which are not filtered by half of the filter length
+    int iDelay = iMaxFilterLength/2;
 
-        future.waitForFinished();
+    if(m_matDelay.rows() != matData.rows() || m_matDelay.cols() != iDelay) {
+        m_matDelay = MatrixXd::Zero(matData.rows(), iDelay);
+    }
+
+    if(iDelay > 0) {
+        m_vecDelayScratch.resize(iDelay + matData.cols());
+
+        for(int i = 0; i < matData.rows(); ++i) {
+            if(!m_lIsFiltered.at(i)) {
+                m_vecDelayScratch << m_matDelay.row(i), matData.row(i);
+                matData.row(i) = m_vecDelayScratch.head(matData.cols());
+                m_matDelay.row(i) = m_vecDelayScratch.tail(iDelay);
+            }
+        }
+    }
+}
 
-        //Do the overlap add method and store in matDataOut
-        int iFilteredNumberCols = timeData.at(0).second.second.cols();
 
-        for(int r = 0; r < timeData.size(); r++) {
-            //Get the currently filtered data. This data has a delay of filterLength/2 in front and back.
-            RowVectorXd tempData = timeData.at(r).second.second;
+//*************************************************************************************************************
 
-            //Perform the actual overlap add by adding the last filterlength data to the newly filtered one
-            tempData.head(iMaxFilterLength) += m_matOverlap.row(timeData.at(r).second.first);
+void RtFilter::reset()
+{
+    m_matHistory.setZero();
+    m_matDelay.setZero();
+    m_iirFilter.reset();
+}
 
-            //Write the newly calulated filtered data to the filter data matrix. Keep in mind that the current block also effect last part of the last block (begin at dataIndex-iFilterDelay).
-            int start = 0;
-            matDataOut.row(timeData.at(r).second.first).segment(start,iFilteredNumberCols-iMaxFilterLength) = tempData.head(iFilteredNumberCols-iMaxFilterLength);
 
-            //Refresh the m_matOverlap with the new calculated filtered data.
-            m_matOverlap.row(timeData.at(r).second.first) = timeData.at(r).second.second.tail(iMaxFilterLength);
+//*************************************************************************************************************
+
+int RtFilter::maxFirFilterLength(const QList<FilterData>& lFilterData)
+{
+    int iMaxFilterLength = 0;
+
+    for(int i = 0; i < lFilterData.size(); ++i) {
+        if(lFilterData.at(i).m_designMethod != FilterData::Butterworth) {
+            iMaxFilterLength = qMax(iMaxFilterLength, (int)lFilterData.at(i).m_dCoeffA.cols());
         }
     }
 
-    //Fill filtered data with raw data if the channel was not filtered
-    for(int i = 0; i < notFilterChannelIndex.size(); ++i) {
-        matDataOut.row(notFilterChannelIndex.at(i)) << m_matDelay.row(notFilterChannelIndex.at(i)), matDataIn.row(notFilterChannelIndex.at(i)).head(matDataIn.cols() - iMaxFilterLength/2);
+    return iMaxFilterLength;
+}
+
 
-        //matDataOut.row(notFilterChannelIndex.at(i)).segment(0, matDataIn.row(notFilterChannelIndex.at(i)).cols()) = matDataIn.row(notFilterChannelIndex.at(i));
+//*************************************************************************************************************
+
+bool RtFilter::updateImpulseResponse(const QList<FilterData>& lFilterData)
+{
+    bool bChanged = lFilterData.size() != m_lFilterCoeffs.size();
+
+    for(int i = 0; i < lFilterData.size() && !bChanged; ++i) {
+        const MatrixXd& matSos = lFilterData.at(i).m_matSos;
+        bChanged = lFilterData.at(i).m_dCoeffA.cols() != m_lFilterCoeffs.at(i).cols()
+                   || lFilterData.at(i).m_dCoeffA != m_lFilterCoeffs.at(i)
+                   || matSos.rows() != m_lFilterSos.at(i).rows()
+                   || matSos != m_lFilterSos.at(i);
     }
 
-    m_matDelay = matDataIn.block(0, matDataIn.cols()-iMaxFilterLength/2, matDataIn.rows(), iMaxFilterLength/2);
+    if(!bChanged) {
+        return false;
+    }
 
-    return matDataOut;
+    m_lFilterCoeffs.clear();
+    m_lFilterSos.clear();
+    m_vecImpulseResponse.resize(0);
+
+    MatrixXd matSos(0, 6);
+
+    //Cascaded filters are combined into one impulse response by convolving their coefficients, IIR filters are
+    //combined by stacking their second-order sections
+    for(int i = 0; i < lFilterData.size(); ++i) {
+        const RowVectorXd& vecCoeffs = lFilterData.at(i).m_dCoeffA;
+        const MatrixXd& matFilterSos = lFilterData.at(i).m_matSos;
+        m_lFilterCoeffs.append(vecCoeffs);
+        m_lFilterSos.append(matFilterSos);
+
+        if(lFilterData.at(i).m_designMethod == FilterData::Butterworth && matFilterSos.rows() > 0) {
+            MatrixXd matStacked(matSos.rows() + matFilterSos.rows(), 6);
+            matStacked << matSos, matFilterSos;
+            matSos = matStacked;
+            continue;
+        }
+
+        if(vecCoeffs.cols() == 0) {
+            continue;
+        }
+
+        if(m_vecImpulseResponse.cols() == 0) {
+            m_vecImpulseResponse = vecCoeffs;
+        } else {
+            RowVectorXd vecCombined = RowVectorXd::Zero(m_vecImpulseResponse.cols() + vecCoeffs.cols() - 1);
+            for(int k = 0; k < vecCoeffs.cols(); ++k) {
+                vecCombined.segment(k, m_vecImpulseResponse.cols()) += vecCoeffs(k) * m_vecImpulseResponse;
+            }
+            m_vecImpulseResponse = vecCombined;
+        }
+    }
+
+    m_iirFilter = IirFilter(matSos);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RtFilter::updateSetup(int iRows,
+                           int iCols,
+                           const QVector<int>& lFilterChannelList,
+                           bool bFilterChanged)
+{
+    int iHistory = qMax(0, (int)m_vecImpulseResponse.cols() - 1);
+
+    //Look up the filtered channels once instead of searching the channel list for each channel
+    if(bFilterChanged || lFilterChannelList != m_lFilterChannels || m_lIsFiltered.size() != iRows) {
+        m_lFilterChannels = lFilterChannelList;
+        m_lIsFiltered.fill(false, iRows);
+
+        QVector<int> lChannels;
+        if(m_vecImpulseResponse.cols() > 0 || m_iirFilter.sos().rows() > 0) {
+            for(int i = 0; i < lFilterChannelList.size(); ++i) {
+                int iChannel = lFilterChannelList.at(i);
+                if(iChannel >= 0 && iChannel < iRows && !m_lIsFiltered.at(iChannel)) {
+                    m_lIsFiltered[iChannel] = true;
+                    lChannels.append(iChannel);
+                }
+            }
+        }
+
+        m_lIirChannels = lChannels;
+        m_iirFilter.reset();
+
+        //Split the channels into one chunk per thread, the chunks only run the FIR part
+        int iNumChunks = m_vecImpulseResponse.cols() > 0
+                         ? qMin(qMax(QThread::idealThreadCount(), 1), lChannels.size())
+                         : 0;
+        m_lChunks.resize(iNumChunks);
+
+        for(int c = 0; c < iNumChunks; ++c) {
+            int iFirst = c * lChannels.size() / iNumChunks;
+            int iLast = (c + 1) * lChannels.size() / iNumChunks;
+
+            RtFilterChunk& chunk = m_lChunks[c];
+            chunk.iChannels = lChannels.mid(iFirst, iLast - iFirst);
+            chunk.fft.SetFlag(chunk.fft.HalfSpectrum);
+            chunk.pMatHistory = &m_matHistory;
+            chunk.pVecSpectrum = &m_vecSpectrum;
+        }
+
+        m_matHistory = MatrixXd::Zero(iRows, iHistory);
+    }
+
+    //Choose the FFT length for the current block size, the spectrum is only recomputed if it changes
+    int iFFTLength = 2;
+    while(iFFTLength < iCols + iHistory) {
+        iFFTLength *= 2;
+    }
+
+    if(bFilterChanged || iFFTLength != m_iFFTLength) {
+        m_iFFTLength = iFFTLength;
+
+        RowVectorXd vecPadded = RowVectorXd::Zero(m_iFFTLength);
+        vecPadded.head(m_vecImpulseResponse.cols()) = m_vecImpulseResponse;
+
+        Eigen::FFT<double> fft;
+        fft.SetFlag(fft.HalfSpectrum);
+        fft.fwd(m_vecSpectrum, vecPadded);
+    }
+
+    for(int c = 0; c < m_lChunks.size(); ++c) {
+        m_lChunks[c].iHistory = iHistory;
+        m_lChunks[c].iFFTLength = m_iFFTLength;
+    }
 }
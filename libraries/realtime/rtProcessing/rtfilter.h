@@ -43,6 +43,7 @@
 #include "../realtime_global.h"
 
 #include <utils/filterTools/filterdata.h>
+#include <utils/filterTools/iirfilter.h>
 #include <fiff/fiff_info.h>
 
 
@@ -54,6 +55,7 @@
 #include <QSharedPointer>
 #include <QtConcurrent/QtConcurrent>
 #include <QFuture>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -76,15 +78,41 @@ namespace REALTIMELIB
 
 //*************************************************************************************************************
 //=============================================================================================================
-// USED NAMESPACES
+// REALTIMELIB FORWARD DECLARATIONS
 //=============================================================================================================
 
+//=============================================================================================================
+/**
+* A contiguous range of filtered channels which is processed by one thread. Each chunk owns its FFT object, so
+* that the FFT plans are created once and reused for all following blocks.
+*/
+struct RtFilterChunk {
+    QVector<int>                iChannels;      /**< The channels of this chunk. */
+    Eigen::FFT<double>          fft;            /**< The FFT object, caches the plans for the current FFT length. */
+    Eigen::RowVectorXd          vecTime;        /**< Time domain scratch buffer. */
+    Eigen::RowVectorXcd         vecFreq;        /**< Frequency domain scratch buffer. */
+    Eigen::MatrixXd*            pMatData;       /**< The data block which is filtered in place. */
+    Eigen::MatrixXd*            pMatHistory;    /**< The last input samples of each channel. */
+    const Eigen::RowVectorXcd*  pVecSpectrum;   /**< The spectrum of the filter impulse response. */
+    int                         iHistory;       /**< The number of history samples, i.e. the impulse response length - 1. */
+    int                         iFFTLength;     /**< The FFT length. */
+
+    //=========================================================================================================
+    /**
+    * Filters all channels of this chunk with the overlap-save method.
+    */
+    void filter();
+};
+
 
 //=============================================================================================================
 /**
-* Real-time noise Spectrum estimation
+* Real-time filtering. The filter state is kept between consecutive data blocks, i.e. the blocks are filtered
+* as one continuous stream with the overlap-save method. All filters are combined into one impulse response
+* whose spectrum is computed once and reused until the filters, the channel count or the block size change.
+* Butterworth filters are applied as causal IIR filters (cascaded second-order sections) after the FIR part.
 *
-* @brief Real-time Noise estimation
+* @brief Real-time filtering
 */
 class REALTIMESHARED_EXPORT RtFilter
 {
@@ -95,13 +123,13 @@ public:
 
     //=========================================================================================================
     /**
-    * Creates the real-time covariance estimation object.
+    * Creates the real-time filter object.
     */
     explicit RtFilter();
 
     //=========================================================================================================
     /**
-    * Destroys the Real-time noise estimation object.
+    * Destroys the real-time filter object.
     */
     ~RtFilter();
 
@@ -109,21 +137,93 @@ public:
     /**
     * Calculates the filtered version of the raw input data
     *
-    * @param [in] matDataIn     data which is to be filtered
-    * @param [out] matDataOut    data which is to be filtered
-    * @param [in] iDataIndex    current position in the global data matrix
+    * @param [in] matDataIn             data which is to be filtered
+    * @param [in] iMaxFilterLength      the maximum filter length, unfiltered channels are delayed by half of it
+    * @param [in] lFilterChannelList    the indices of the channels to filter
+    * @param [in] lFilterData           the filters to apply
+    *
+    * @return the filtered data
     */
     Eigen::MatrixXd filterChannelsConcurrently(const Eigen::MatrixXd& matDataIn,
                                                int iMaxFilterLength,
                                                const QVector<int>& lFilterChannelList,
                                                const QList<UTILSLIB::FilterData> &lFilterData);
 
+    //=========================================================================================================
+    /**
+    * Filters a data block in place. The filtered channels are convolved with the combined impulse response of
+    * all filters, continuing the convolution of the previous block. The remaining channels are delayed by
+    * iMaxFilterLength/2 samples.
+    *
+    * @param [in, out] matData          data which is to be filtered (channels x samples)
+    * @param [in] iMaxFilterLength      the maximum filter length, unfiltered channels are delayed by half of it
+    * @param [in] lFilterChannelList    the indices of the channels to filter
+    * @param [in] lFilterData           the filters to apply
+    */
+    void filterChannelsInPlace(Eigen::MatrixXd& matData,
+                               int iMaxFilterLength,
+                               const QVector<int>& lFilterChannelList,
+                               const QList<UTILSLIB::FilterData> &lFilterData);
+
+    //=========================================================================================================
+    /**
+    * Resets the filter state, i.e. the next block is filtered as the beginning of a new stream.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Returns the filter length to pass as iMaxFilterLength, i.e. the length of the longest FIR filter. Butterworth
+    * filters do not count, they are causal and have almost no delay, hence it is zero if only IIR filters are active.
+    *
+    * @param [in] lFilterData   the filters to apply
+    *
+    * @return the maximum length of the FIR filters
+    */
+    static int maxFirFilterLength(const QList<UTILSLIB::FilterData> &lFilterData);
+
 protected:
-    Eigen::MatrixXd                 m_matOverlap;                   /**< Last overlap block */
-    Eigen::MatrixXd                 m_matDelay;                     /**< Last delay block */
+    //=========================================================================================================
+    /**
+    * Updates the combined impulse response and the IIR sections if the filters changed.
+    *
+    * @param [in] lFilterData   the filters to apply
+    *
+    * @return true if the impulse response changed, false otherwise
+    */
+    bool updateImpulseResponse(const QList<UTILSLIB::FilterData> &lFilterData);
 
-private:
+    //=========================================================================================================
+    /**
+    * Updates the FFT length, the filter spectrum, the filter state and the channel chunks for the given data
+    * dimensions. The filter state is reset if the filters or the channels changed.
+    *
+    * @param [in] iRows                 the number of channels
+    * @param [in] iCols                 the number of samples per block
+    * @param [in] lFilterChannelList    the indices of the channels to filter
+    * @param [in] bFilterChanged        whether the impulse response changed
+    */
+    void updateSetup(int iRows,
+                     int iCols,
+                     const QVector<int>& lFilterChannelList,
+                     bool bFilterChanged);
+
+    QList<Eigen::RowVectorXd>       m_lFilterCoeffs;                /**< The coefficients of the current filters. */
+    QList<Eigen::MatrixXd>          m_lFilterSos;                   /**< The second-order sections of the current filters. */
+    Eigen::RowVectorXd              m_vecImpulseResponse;           /**< The combined impulse response of all filters. */
+    Eigen::RowVectorXcd             m_vecSpectrum;                  /**< The spectrum of the impulse response, zero-padded to m_iFFTLength. */
+    int                             m_iFFTLength;                   /**< The current FFT length. */
+    QVector<int>                    m_lFilterChannels;              /**< The channels of the current setup. */
+    QVector<bool>                   m_lIsFiltered;                  /**< Whether a channel is filtered. */
+    QVector<RtFilterChunk>          m_lChunks;                      /**< The channel chunks processed in parallel. */
+
+    Eigen::MatrixXd                 m_matHistory;                   /**< Last input samples of the filtered channels */
+    Eigen::MatrixXd                 m_matDelay;                     /**< Last delay block */
+    Eigen::RowVectorXd              m_vecDelayScratch;              /**< Scratch buffer to delay the unfiltered channels */
 
+    UTILSLIB::IirFilter             m_iirFilter;                    /**< The stacked IIR sections of all Butterworth filters, keeps the IIR state. */
+    QVector<int>                    m_lIirChannels;                 /**< The channels the IIR sections are applied to. */
+    Eigen::MatrixXd                 m_matIirScratch;                /**< The filtered channels gathered for the IIR sections. */
 };
 
 //*************************************************************************************************************
@@ -46,6 +46,8 @@
 #include <mne/mne_forwardsolution.h>
 #include <mne/mne_inverse_operator.h>
 
+#include <cmath>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -61,6 +63,7 @@
 //=============================================================================================================
 
 #include <Eigen/Core>
+#include <Eigen/Eigenvalues>
 
 
 //*************************************************************************************************************
@@ -71,6 +74,16 @@
 using namespace REALTIMELIB;
 using namespace Eigen;
 using namespace MNELIB;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// CONST
+//=============================================================================================================
+
+const float LOOSE = 0.2f;     /**< The loose orientation constraint. */
+const float DEPTH = 0.8f;     /**< The depth weighting exponent. */
 
 
 //*************************************************************************************************************
@@ -78,21 +91,200 @@ using namespace MNELIB;
 // DEFINE MEMBER METHODS RtInvOpWorker
 //=============================================================================================================
 
+RtInvOpWorker::RtInvOpWorker()
+: m_bCacheValid(false)
+, m_iMethods(FIFFV_MNE_MEG)
+{
+}
+
+
+//*************************************************************************************************************
+
 void RtInvOpWorker::doWork(const RtInvOpInput &inputData)
 {
-    // Restrict forward solution as necessary for MEG
-    MNEForwardSolution forwardMeg = inputData.pFwd->pick_types(true, false);
+    if(this->thread()->isInterruptionRequested()) {
+        return;
+    }
+
+    //The cache only depends on the forward solution and the channels, i.e. the bad channels
+    QStringList lChNames;
+    for(int i = 0; i < inputData.pFiffInfo->chs.size(); ++i) {
+        const QString& sChName = inputData.pFiffInfo->chs.at(i).ch_name;
+        if(!inputData.pFiffInfo->bads.contains(sChName) && !inputData.noiseCov.bads.contains(sChName)) {
+            lChNames << sChName;
+        }
+    }
+
+    if(inputData.pFwd != m_pFwd || lChNames != m_lChNames) {
+        m_bCacheValid = updateCache(inputData, lChNames);
+    }
+
+    if(m_bCacheValid) {
+        emit resultReady(computeInverseOperator(inputData));
+        return;
+    }
 
     MNEInverseOperator invOpMeg(*inputData.pFiffInfo.data(),
-                                forwardMeg,
+                                *m_pFwdMeg,
                                 inputData.noiseCov,
-                                0.2f,
-                                0.8f);
+                                LOOSE,
+                                DEPTH);
 
     emit resultReady(invOpMeg);
 }
 
 
+//*************************************************************************************************************
+
+bool RtInvOpWorker::updateCache(const RtInvOpInput &inputData, const QStringList &lChNames)
+{
+    m_pFwd = inputData.pFwd;
+    m_lChNames = lChNames;
+
+    // Restrict forward solution as necessary for MEG
+    m_pFwdMeg = QSharedPointer<MNEForwardSolution>(new MNEForwardSolution(inputData.pFwd->pick_types(true, false)));
+
+    if(m_pFwdMeg->isFixedOrient() || m_pFwdMeg->source_ori == -1) {
+        return false;
+    }
+
+    //Pick the gain of the used channels, the whitener is computed for each noise covariance
+    MatrixXd matGain, matWhitener;
+    FiffCov noiseCov;
+    qint32 iNumNonZero;
+    m_pFwdMeg->prepare_forward(*inputData.pFiffInfo, inputData.noiseCov, false, m_gainInfo, matGain, noiseCov, matWhitener, iNumNonZero);
+
+    if(matGain.rows() == 0) {
+        return false;
+    }
+
+    //Depth and orientation priors
+    m_pDepthPrior = FiffCov::SDPtr(new FiffCov(MNEForwardSolution::compute_depth_prior(matGain, m_gainInfo, false, DEPTH, 10.0, defaultConstMatrixXd, true)));
+    m_pOrientPrior = FiffCov::SDPtr(new FiffCov(m_pFwdMeg->compute_orient_prior(LOOSE)));
+
+    m_pSourceCov = m_pDepthPrior;
+    m_pSourceCov->data.array() *= m_pOrientPrior->data.array();
+
+    //Weight the gain by the source standard deviations, the Gram matrix lets each update work on channels only
+    RowVectorXd vecSourceStd = m_pSourceCov->data.array().sqrt().transpose();
+    m_matGainWeighted = matGain * vecSourceStd.asDiagonal();
+    m_matGainGram = m_matGainWeighted * m_matGainWeighted.transpose();
+
+    //Channel types
+    bool bHasMeg = false;
+    bool bHasEeg = false;
+
+    for(int i = 0; i < m_gainInfo.chs.size(); ++i) {
+        QString sChType = m_gainInfo.channel_type(i);
+        if(sChType == "eeg") {
+            bHasEeg = true;
+        }
+        if(sChType == "mag" || sChType == "grad") {
+            bHasMeg = true;
+        }
+    }
+
+    if(bHasEeg && bHasMeg) {
+        m_iMethods = FIFFV_MNE_MEG_EEG;
+    } else if(bHasMeg) {
+        m_iMethods = FIFFV_MNE_MEG;
+    } else {
+        m_iMethods = FIFFV_MNE_EEG;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+MNEInverseOperator RtInvOpWorker::computeInverseOperator(const RtInvOpInput &inputData) const
+{
+    //Whitener, see MNEForwardSolution::prepare_forward
+    FiffCov noiseCov = inputData.noiseCov.prepare_noise_cov(*inputData.pFiffInfo, m_gainInfo.ch_names);
+
+    const int iNumChannels = m_gainInfo.ch_names.size();
+    qint32 iNumNonZero = 0;
+    VectorXd vecInvStd = VectorXd::Zero(iNumChannels);
+
+    for(int i = 0; i < noiseCov.eig.rows() && i < iNumChannels; ++i) {
+        if(noiseCov.eig[i] > 0) {
+            vecInvStd[i] = 1.0 / std::sqrt(noiseCov.eig[i]);
+            ++iNumNonZero;
+        }
+    }
+
+    // Cols of eigvec are the eigenvectors
+    MatrixXd matWhitener = vecInvStd.asDiagonal() * noiseCov.eigvec;
+
+    //The trace of G*R*G' is scaled to the number of non-zero channels
+    MatrixXd matGram = matWhitener * m_matGainGram * matWhitener.transpose();
+    const double dScaling = (double)iNumNonZero / matGram.trace();
+    matGram *= dScaling;
+
+    //G = U*S*V' is decomposed via G*G' = U*S^2*U', which only involves the channels
+    SelfAdjointEigenSolver<MatrixXd> eigSolver(matGram);
+
+    int iRank = 0;
+    const double dTol = eigSolver.eigenvalues().maxCoeff() * 1e-12;
+    for(int i = 0; i < eigSolver.eigenvalues().size(); ++i) {
+        if(eigSolver.eigenvalues()[i] > dTol) {
+            ++iRank;
+        }
+    }
+    if(inputData.iSvdRank > 0) {
+        iRank = qMin(iRank, inputData.iSvdRank);
+    }
+
+    //The eigenvalues are in increasing order, the singular values are stored in decreasing order
+    VectorXd vecSing(iRank);
+    MatrixXd matU(iNumChannels, iRank);
+
+    for(int i = 0; i < iRank; ++i) {
+        int iIdx = eigSolver.eigenvalues().size() - 1 - i;
+        vecSing[i] = std::sqrt(eigSolver.eigenvalues()[iIdx]);
+        matU.col(i) = eigSolver.eigenvectors().col(iIdx);
+    }
+
+    // V = G'*U*S^-1 with G = sqrt(scaling)*W*G_weighted
+    MatrixXd matV = m_matGainWeighted.transpose() * (matWhitener.transpose() * (std::sqrt(dScaling) * matU * vecSing.cwiseInverse().asDiagonal()));
+
+    FiffCov::SDPtr pSourceCov = m_pSourceCov;
+    pSourceCov->data.array() *= dScaling;
+
+    MNEInverseOperator invOp;
+    invOp.eigen_fields = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(matU.cols(),
+                                                                    matU.rows(),
+                                                                    defaultQStringList,
+                                                                    m_gainInfo.ch_names,
+                                                                    matU.transpose()));
+    invOp.eigen_leads = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(matV.rows(),
+                                                                   matV.cols(),
+                                                                   defaultQStringList,
+                                                                   defaultQStringList,
+                                                                   matV));
+    invOp.sing = vecSing;
+    invOp.nave = 1;
+    invOp.depth_prior = m_pDepthPrior;
+    invOp.source_cov = pSourceCov;
+    invOp.noise_cov = FiffCov::SDPtr(new FiffCov(noiseCov));
+    invOp.orient_prior = m_pOrientPrior;
+    invOp.projs = inputData.pFiffInfo->projs;
+    invOp.eigen_leads_weighted = false;
+    invOp.source_ori = m_pFwdMeg->source_ori;
+    invOp.mri_head_t = m_pFwdMeg->mri_head_t;
+    invOp.methods = m_iMethods;
+    invOp.nsource = m_pFwdMeg->nsource;
+    invOp.coord_frame = m_pFwdMeg->coord_frame;
+    invOp.source_nn = m_pFwdMeg->source_nn;
+    invOp.src = m_pFwdMeg->src;
+    invOp.info = m_pFwdMeg->info;
+    invOp.info.bads = inputData.pFiffInfo->bads;
+
+    return invOp;
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS RtInvOp
@@ -104,6 +296,7 @@ RtInvOp::RtInvOp(FiffInfo::SPtr &p_pFiffInfo,
 : QObject(parent)
 , m_pFiffInfo(p_pFiffInfo)
 , m_pFwd(p_pFwd)
+, m_iSvdRank(0)
 {
     if(this->thread()->isInterruptionRequested()) {
         return;
@@ -143,11 +336,20 @@ void RtInvOp::append(const FIFFLIB::FiffCov &noiseCov)
     inputData.noiseCov = noiseCov;
     inputData.pFiffInfo = m_pFiffInfo;
     inputData.pFwd = m_pFwd;
+    inputData.iSvdRank = m_iSvdRank;
 
     emit operate(inputData);
 }
 
 
+//*************************************************************************************************************
+
+void RtInvOp::setSvdRank(int iSvdRank)
+{
+    m_iSvdRank = iSvdRank;
+}
+
+
 //*************************************************************************************************************
 
 void RtInvOp::handleResults(const MNELIB::MNEInverseOperator& invOp)
@@ -44,6 +44,7 @@
 #include "../realtime_global.h"
 
 #include <fiff/fiff_cov.h>
+#include <fiff/fiff_info.h>
 
 
 //*************************************************************************************************************
@@ -53,16 +54,21 @@
 
 #include <QThread>
 #include <QSharedPointer>
+#include <QStringList>
 
 
 //*************************************************************************************************************
 //=============================================================================================================
-// FORWARD DECLARATIONS
+// Eigen INCLUDES
 //=============================================================================================================
 
-namespace FIFFLIB {
-    class FiffInfo;
-}
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
 
 namespace MNELIB {
     class MNEForwardSolution;
@@ -88,20 +94,30 @@ struct RtInvOpInput {
     QSharedPointer<FIFFLIB::FiffInfo>           pFiffInfo;
     QSharedPointer<MNELIB::MNEForwardSolution>  pFwd;
     FIFFLIB::FiffCov                            noiseCov;
+    int                                         iSvdRank;   /**< Number of singular components to keep, all if <= 0. */
 };
 
 
 //=============================================================================================================
 /**
-* Real-time inverse operator worker.
+* Real-time inverse operator worker. The parts of the inverse operator which do not depend on the noise
+* covariance, i.e. the picked forward solution, the depth and orientation priors and the weighted gain, are
+* computed once and cached. A new noise covariance then only requires the whitener and the decomposition of the
+* whitened gain, which is done via the channels x channels Gram matrix instead of a full SVD of the gain.
 *
 * @brief Real-time inverse operator worker.
 */
-class RtInvOpWorker : public QObject
+class REALTIMESHARED_EXPORT RtInvOpWorker : public QObject
 {
     Q_OBJECT
 
 public:
+    //=========================================================================================================
+    /**
+    * Creates the worker with an empty cache.
+    */
+    RtInvOpWorker();
+
     //=========================================================================================================
     /**
     * Perform actual inverse operator creation.
@@ -110,6 +126,41 @@ public:
     */
     void doWork(const RtInvOpInput &inputData);
 
+protected:
+    //=========================================================================================================
+    /**
+    * Computes the parts of the inverse operator which do not depend on the noise covariance.
+    *
+    * @param[in] inputData  The measurement info, the forward solution and the noise covariance.
+    * @param[in] lChNames   The channels the inverse operator is computed for.
+    *
+    * @return true if the cache can be used, false if the full computation is needed (fixed orientation).
+    */
+    bool updateCache(const RtInvOpInput &inputData, const QStringList &lChNames);
+
+    //=========================================================================================================
+    /**
+    * Computes the inverse operator for a new noise covariance from the cached parts.
+    *
+    * @param[in] inputData  The measurement info and the noise covariance.
+    *
+    * @return the inverse operator.
+    */
+    MNELIB::MNEInverseOperator computeInverseOperator(const RtInvOpInput &inputData) const;
+
+    QSharedPointer<MNELIB::MNEForwardSolution>  m_pFwd;             /**< The forward solution the cache was computed for. */
+    QSharedPointer<MNELIB::MNEForwardSolution>  m_pFwdMeg;          /**< The cached MEG forward solution. */
+    QStringList                                 m_lChNames;         /**< The channels of the cache. */
+    bool                                        m_bCacheValid;      /**< Whether the cache can be used. */
+
+    FIFFLIB::FiffInfo                           m_gainInfo;         /**< The measurement info of the gain channels. */
+    FIFFLIB::FiffCov::SDPtr                     m_pDepthPrior;      /**< The depth weighting prior. */
+    FIFFLIB::FiffCov::SDPtr                     m_pOrientPrior;     /**< The loose orientation prior. */
+    FIFFLIB::FiffCov::SDPtr                     m_pSourceCov;       /**< The source covariance before the trace scaling. */
+    Eigen::MatrixXd                             m_matGainWeighted;  /**< The gain weighted by the source standard deviations. */
+    Eigen::MatrixXd                             m_matGainGram;      /**< The Gram matrix of the weighted gain (channels x channels). */
+    qint32                                      m_iMethods;         /**< The channel types of the inverse operator. */
+
 signals:
     //=========================================================================================================
     /**
@@ -159,6 +210,15 @@ public:
     */
     void append(const FIFFLIB::FiffCov &noiseCov);
 
+    //=========================================================================================================
+    /**
+    * Sets the number of singular components of the whitened gain which are kept. Fewer components make the
+    * update after a new noise covariance faster.
+    *
+    * @param[in] iSvdRank     Number of components to keep, all if <= 0.
+    */
+    void setSvdRank(int iSvdRank);
+
     //=========================================================================================================
     /**
     * Restarts the thread by interrupting its computation queue, quitting, waiting and then starting it again.
@@ -182,6 +242,7 @@ protected:
     QSharedPointer<MNELIB::MNEForwardSolution>  m_pFwd;             /**< The forward solution. */
 
     QThread                                     m_workerThread;     /**< The worker thread. */
+    int                                         m_iSvdRank;         /**< Number of singular components to keep, all if <= 0. */
 
 signals:
     //=========================================================================================================
@@ -70,11 +70,11 @@ using namespace FIFFLIB;
 //=============================================================================================================
 
 RtNoise::RtNoise(qint32 p_iMaxSamples, FiffInfo::SPtr p_pFiffInfo, qint32 p_dataLen, QObject *parent)
-: QThread(parent)
+: RtProcessor(8, parent)
 , m_iFFTlength(p_iMaxSamples)
 , m_pFiffInfo(p_pFiffInfo)
 , m_dataLength(p_dataLen)
-, m_bIsRunning(false)
+, m_bFirstStart(true)
 , m_iNumOfBlocks(0)
 , m_iBlockSize(0)
 , m_iSensors(0)
@@ -156,11 +156,8 @@ QVector <float> RtNoise::hanning(int N, short itype)
 
 void RtNoise::append(const MatrixXd &p_DataSegment)
 {
-    if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(8, p_DataSegment.rows(), p_DataSegment.cols()));
-
     if (m_bSendDataToBuffer)
-        m_pRawMatrixBuffer->push(&p_DataSegment);
+        appendData(p_DataSegment);
 }
 
 
@@ -168,14 +165,9 @@ void RtNoise::append(const MatrixXd &p_DataSegment)
 
 bool RtNoise::start()
 {
-    //Check if the thread is already or still running. This can happen if the start button is pressed immediately after the stop button was pressed. In this case the stopping process is not finished yet but the start process is initiated.
-    if(this->isRunning())
-        QThread::wait();
-
-    m_bIsRunning = true;
-    QThread::start();
+    m_bFirstStart = true;
 
-    return true;
+    return RtProcessor::start();
 }
 
 
@@ -183,11 +175,7 @@ bool RtNoise::start()
 
 bool RtNoise::stop()
 {
-    m_bIsRunning = false;
-
-    m_pRawMatrixBuffer->releaseFromPop();
-
-    m_pRawMatrixBuffer->clear();
+    RtProcessor::stop();
 
     qDebug()<<" RtNoise Thread is stopped.";
 
@@ -197,116 +185,102 @@ bool RtNoise::stop()
 
 //*************************************************************************************************************
 
-void RtNoise::run()
+void RtNoise::processData(const MatrixXd &block)
 {
-    bool FirstStart = true;
+    if(m_bFirstStart){
+        //init the circ buffer and parameters
+        if(m_dataLength < 0) m_dataLength = 10;
+        m_iNumOfBlocks = m_dataLength;//60;
+        m_iBlockSize =  block.cols();
+        m_iSensors =  block.rows();
 
-    while(m_bIsRunning)
-    {
-        if(m_pRawMatrixBuffer)
-        {
-            MatrixXd block = m_pRawMatrixBuffer->pop();
+        m_matCircBuf.resize(m_iSensors,m_iNumOfBlocks*m_iBlockSize);
 
-            if(FirstStart){
-                //init the circ buffer and parameters
-                if(m_dataLength < 0) m_dataLength = 10;
-                m_iNumOfBlocks = m_dataLength;//60;
-                m_iBlockSize =  block.cols();
-                m_iSensors =  block.rows();
+        m_iBlockIndex = 0;
+        m_bFirstStart = false;
+    }
+    //concate blocks
+    for (int i=0; i< m_iSensors; i++)
+        for (int j=0; j< m_iBlockSize; j++)
+            m_matCircBuf(i,j+m_iBlockIndex*m_iBlockSize) = block(i,j);
 
-                m_matCircBuf.resize(m_iSensors,m_iNumOfBlocks*m_iBlockSize);
 
-                m_iBlockIndex = 0;
-                FirstStart = false;
-            }
-            //concate blocks
-            for (int i=0; i< m_iSensors; i++)
-                for (int j=0; j< m_iBlockSize; j++)
-                    m_matCircBuf(i,j+m_iBlockIndex*m_iBlockSize) = block(i,j);
-
-
-            m_iBlockIndex ++;
-            if (m_iBlockIndex >= m_iNumOfBlocks){
-
-                //m_pRawMatrixBuffer.clear(); //empty the buffer
-
-                m_bSendDataToBuffer = false;
-                //stop collect block and start to calculate the spectrum
-                m_iBlockIndex = 0;
-
-                MatrixXd sum_psdx = MatrixXd::Zero(m_iSensors,m_iFFTlength/2+1);
-
-                int nb = floor(m_iNumOfBlocks*m_iBlockSize/m_iFFTlength)+1;
-                qDebug()<<"nb"<<nb<<"NumOfBlocks"<<m_iNumOfBlocks<<"BlockSize"<<m_iBlockSize;
-                MatrixXd t_mat(m_iSensors,m_iFFTlength);
-                MatrixXd t_psdx(m_iSensors,m_iFFTlength/2+1);
-                for (int n = 0; n<nb; n++){
-                    //collect a data block with data length of m_iFFTlength;
-                    if(n==nb-1)
-                    {
-                        for(qint32 ii=0; ii<m_iSensors; ii++)
-                        for(qint32 jj=0; jj<m_iFFTlength; jj++)
-                            if(jj+n*m_iFFTlength<m_iNumOfBlocks*m_iBlockSize)
-                                t_mat(ii,jj) = m_matCircBuf(ii,jj+n*m_iFFTlength);
-                            else
-                                t_mat(ii,jj) = 0.0;
-
-                    }
+    m_iBlockIndex ++;
+    if (m_iBlockIndex >= m_iNumOfBlocks){
+
+        //m_pRawMatrixBuffer.clear(); //empty the buffer
+
+        m_bSendDataToBuffer = false;
+        //stop collect block and start to calculate the spectrum
+        m_iBlockIndex = 0;
+
+        MatrixXd sum_psdx = MatrixXd::Zero(m_iSensors,m_iFFTlength/2+1);
+
+        int nb = floor(m_iNumOfBlocks*m_iBlockSize/m_iFFTlength)+1;
+        qDebug()<<"nb"<<nb<<"NumOfBlocks"<<m_iNumOfBlocks<<"BlockSize"<<m_iBlockSize;
+        MatrixXd t_mat(m_iSensors,m_iFFTlength);
+        MatrixXd t_psdx(m_iSensors,m_iFFTlength/2+1);
+        for (int n = 0; n<nb; n++){
+            //collect a data block with data length of m_iFFTlength;
+            if(n==nb-1)
+            {
+                for(qint32 ii=0; ii<m_iSensors; ii++)
+                for(qint32 jj=0; jj<m_iFFTlength; jj++)
+                    if(jj+n*m_iFFTlength<m_iNumOfBlocks*m_iBlockSize)
+                        t_mat(ii,jj) = m_matCircBuf(ii,jj+n*m_iFFTlength);
                     else
-                    {
-                        for(qint32 ii=0; ii<m_iSensors; ii++)
-                        for(qint32 jj=0; jj<m_iFFTlength; jj++)
-                            t_mat(ii,jj) = m_matCircBuf(ii,jj+n*m_iFFTlength);
-                    }
-
-                    //FFT calculation by row
-                    for(qint32 i = 0; i < t_mat.rows(); i++){
-                        RowVectorXd data;
-
-                        data = t_mat.row(i);
-
-                        //zero-pad data to m_iFFTlength
-                        RowVectorXd t_dataZeroPad = RowVectorXd::Zero(m_iFFTlength);
-                        t_dataZeroPad.head(data.cols()) = data;
-
-                        for (qint32 lk = 0; lk<m_iFFTlength; lk++)
-                            t_dataZeroPad[lk] = t_dataZeroPad[lk]*m_fWin[lk];
-
-                        //generate fft object
-                        Eigen::FFT<double> fft;
-                        fft.SetFlag(fft.HalfSpectrum);
-
-                        //fft-transform data sequence
-                        RowVectorXcd t_freqData(m_iFFTlength/2+1);
-                        fft.fwd(t_freqData,t_dataZeroPad);
-
-                        // calculate spectrum from FFT
-                        for(qint32 j=0; j<m_iFFTlength/2+1;j++)
-                        {
-                            double mag_abs = sqrt(t_freqData(j).real()* t_freqData(j).real() +  t_freqData(j).imag()*t_freqData(j).imag());
-                            double spower = (1.0/(m_Fs*m_iFFTlength))* mag_abs;
-                            if (j>0&&j<m_iFFTlength/2) spower = 2.0*spower;
-                            sum_psdx(i,j) = sum_psdx(i,j) + spower;
-                        }
-                     }//row computing is done
-                }//nb
-
-                //DB-calculation
+                        t_mat(ii,jj) = 0.0;
+
+            }
+            else
+            {
                 for(qint32 ii=0; ii<m_iSensors; ii++)
-                    for(qint32 jj=0; jj<m_iFFTlength/2+1; jj++)
-                        t_psdx(ii,jj) = 10.0*log10(sum_psdx(ii,jj)/nb);
+                for(qint32 jj=0; jj<m_iFFTlength; jj++)
+                    t_mat(ii,jj) = m_matCircBuf(ii,jj+n*m_iFFTlength);
+            }
 
-                qDebug()<<"Send spectrum to Noise Estimator";
-                emit SpecCalculated(t_psdx); //send back the spectrum result
-                if(m_pRawMatrixBuffer->size()>0)
-                    m_pRawMatrixBuffer->clear();
+            //FFT calculation by row
+            for(qint32 i = 0; i < t_mat.rows(); i++){
+                RowVectorXd data;
 
-                m_bSendDataToBuffer = true;
-            }
+                data = t_mat.row(i);
 
-        }
+                //zero-pad data to m_iFFTlength
+                RowVectorXd t_dataZeroPad = RowVectorXd::Zero(m_iFFTlength);
+                t_dataZeroPad.head(data.cols()) = data;
 
-    }
+                for (qint32 lk = 0; lk<m_iFFTlength; lk++)
+                    t_dataZeroPad[lk] = t_dataZeroPad[lk]*m_fWin[lk];
 
+                //generate fft object
+                Eigen::FFT<double> fft;
+                fft.SetFlag(fft.HalfSpectrum);
+
+                //fft-transform data sequence
+                RowVectorXcd t_freqData(m_iFFTlength/2+1);
+                fft.fwd(t_freqData,t_dataZeroPad);
+
+                // calculate spectrum from FFT
+                for(qint32 j=0; j<m_iFFTlength/2+1;j++)
+                {
+                    double mag_abs = sqrt(t_freqData(j).real()* t_freqData(j).real() +  t_freqData(j).imag()*t_freqData(j).imag());
+                    double spower = (1.0/(m_Fs*m_iFFTlength))* mag_abs;
+                    if (j>0&&j<m_iFFTlength/2) spower = 2.0*spower;
+                    sum_psdx(i,j) = sum_psdx(i,j) + spower;
+                }
+             }//row computing is done
+        }//nb
+
+        //DB-calculation
+        for(qint32 ii=0; ii<m_iSensors; ii++)
+            for(qint32 jj=0; jj<m_iFFTlength/2+1; jj++)
+                t_psdx(ii,jj) = 10.0*log10(sum_psdx(ii,jj)/nb);
+
+        qDebug()<<"Send spectrum to Noise Estimator";
+        emit SpecCalculated(t_psdx); //send back the spectrum result
+        discardQueuedData();
+
+        m_bSendDataToBuffer = true;
+    }
 }
 
@@ -43,6 +43,7 @@
 //=============================================================================================================
 
 #include "../realtime_global.h"
+#include "rtprocessor.h"
 
 
 //*************************************************************************************************************
@@ -54,20 +55,11 @@
 #include <fiff/fiff_info.h>
 
 
-//*************************************************************************************************************
-//=============================================================================================================
-// Generics INCLUDES
-//=============================================================================================================
-
-#include <utils/generics/circularmatrixbuffer.h>
-
-
 //*************************************************************************************************************
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
-#include <QThread>
 #include <QMutex>
 #include <QSharedPointer>
 #include <QVector>
@@ -96,7 +88,6 @@ namespace REALTIMELIB
 //=============================================================================================================
 
 using namespace Eigen;
-using namespace IOBUFFER;
 using namespace FIFFLIB;
 
 
@@ -106,7 +97,7 @@ using namespace FIFFLIB;
 *
 * @brief Real-time Noise estimation
 */
-class REALTIMESHARED_EXPORT RtNoise : public QThread
+class REALTIMESHARED_EXPORT RtNoise : public RtProcessor
 {
     Q_OBJECT
 public:
@@ -137,18 +128,10 @@ public:
     */
     void append(const MatrixXd &p_DataSegment);
 
-    //=========================================================================================================
-    /**
-    * Returns true if is running, otherwise false.
-    *
-    * @return true if is running, false otherwise
-    */
-    inline bool isRunning();
-
 
     //=========================================================================================================
     /**
-    * Starts the RtNoise by starting the producer's thread.
+    * Starts the RtNoise by starting the worker thread. The spectrum is estimated from the following blocks.
     *
     * @return true if succeeded, false otherwise
     */
@@ -156,7 +139,7 @@ public:
 
     //=========================================================================================================
     /**
-    * Stops the RtNoise by stopping the producer's thread.
+    * Stops the RtNoise and waits until the worker thread has finished.
     *
     * @return true if succeeded, false otherwise
     */
@@ -174,11 +157,11 @@ signals:
 protected:
     //=========================================================================================================
     /**
-    * The starting point for the thread. After calling start(), the newly created thread calls this function.
-    * Returning from this method will end the execution of the thread.
-    * Pure virtual method inherited by QThread.
+    * Collects the data blocks and estimates the spectrum as soon as enough blocks were collected.
+    *
+    * @param[in] matData    The data block.
     */
-    virtual void run();
+    virtual void processData(const Eigen::MatrixXd &matData);
 
     QVector <float> hanning(int N, short itype);
 
@@ -187,9 +170,7 @@ private:
 
     FiffInfo::SPtr  m_pFiffInfo;        /**< Holds the fiff measurement information. */
 
-    bool        m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
-
-    CircularMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;   /**< The Circular Raw Matrix Buffer. */
+    bool        m_bFirstStart;          /**< Whether the next block is the first one after start. */
 
     QVector <float> m_fWin;
 
@@ -214,16 +195,6 @@ public:
 
 };
 
-//*************************************************************************************************************
-//=============================================================================================================
-// INLINE DEFINITIONS
-//=============================================================================================================
-
-inline bool RtNoise::isRunning()
-{
-    return m_bIsRunning;
-}
-
 } // NAMESPACE
 
 #ifndef metatype_matrix
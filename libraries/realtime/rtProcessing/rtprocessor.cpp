@@ -0,0 +1,256 @@
+//=============================================================================================================
+/**
+* @file     rtprocessor.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Definition of the RtProcessor Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rtprocessor.h"
+
+#include <cstring>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace REALTIMELIB;
+using namespace IOBUFFER;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+RtProcessor::RtProcessor(qint32 iQueueSize, QObject *parent)
+: QThread(parent)
+, m_iQueueSize(qMax(iQueueSize, 2))
+, m_iIsRunning(0)
+, m_iSettingsChanged(1)
+{
+    memset(&m_stats, 0, sizeof(RtProcessorStats));
+}
+
+
+//*************************************************************************************************************
+
+RtProcessor::~RtProcessor()
+{
+    RtProcessor::stop();
+}
+
+
+//*************************************************************************************************************
+
+bool RtProcessor::start()
+{
+    if(m_iIsRunning.loadAcquire()) {
+        return false;
+    }
+
+    //The worker might still finish its last block if it was stopped from its own thread
+    if(QThread::isRunning()) {
+        QThread::wait();
+    }
+
+    //The buffer is emptied before the running flag is published, so appended data is not cleared
+    m_qBufferMutex.lock();
+    if(m_pBuffer) {
+        m_pBuffer->clear();
+    }
+    m_iIsRunning.storeRelease(1);
+    m_qBufferMutex.unlock();
+
+    m_iSettingsChanged.storeRelease(1);
+
+    QThread::start();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool RtProcessor::stop()
+{
+    m_qBufferMutex.lock();
+    m_iIsRunning.storeRelease(0);
+    if(m_pBuffer) {
+        m_pBuffer->stop();
+    }
+    m_qBufferCreated.wakeAll();
+    m_qBufferMutex.unlock();
+
+    if(QThread::currentThread() != this) {
+        QThread::wait();
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+RtProcessorStats RtProcessor::stats() const
+{
+    QMutexLocker locker(&m_qStatsMutex);
+    return m_stats;
+}
+
+
+//*************************************************************************************************************
+
+void RtProcessor::resetStats()
+{
+    QMutexLocker locker(&m_qStatsMutex);
+    memset(&m_stats, 0, sizeof(RtProcessorStats));
+}
+
+
+//*************************************************************************************************************
+
+bool RtProcessor::appendData(const MatrixXd &matData)
+{
+    //Only the producer creates the queue, so it can read the pointer without locking
+    if(!m_pBuffer) {
+        QMutexLocker locker(&m_qBufferMutex);
+        m_pBuffer = SpscMatrixBuffer<double>::SPtr(new SpscMatrixBuffer<double>(m_iQueueSize, matData.rows(), matData.cols()));
+
+        if(!m_iIsRunning.loadAcquire()) {
+            m_pBuffer->stop();
+        }
+
+        m_qBufferCreated.wakeAll();
+    }
+
+    //The acquisition must never wait for the processing
+    bool bQueued = m_iIsRunning.loadAcquire() && m_pBuffer->push(matData, false);
+
+    QMutexLocker locker(&m_qStatsMutex);
+    ++m_stats.iBlocksQueued;
+    if(!bQueued) {
+        ++m_stats.iBlocksDropped;
+    }
+
+    return bQueued;
+}
+
+
+//*************************************************************************************************************
+
+void RtProcessor::settingsChanged()
+{
+    m_iSettingsChanged.storeRelease(1);
+}
+
+
+//*************************************************************************************************************
+
+void RtProcessor::discardQueuedData()
+{
+    if(!m_pBuffer) {
+        return;
+    }
+
+    qint32 iDiscarded = 0;
+    while(m_pBuffer->beginPop(false)) {
+        m_pBuffer->commitPop();
+        ++iDiscarded;
+    }
+
+    QMutexLocker locker(&m_qStatsMutex);
+    m_stats.iBlocksDropped += iDiscarded;
+    m_stats.iQueueDepth = 0;
+}
+
+
+//*************************************************************************************************************
+
+void RtProcessor::applySettings()
+{
+}
+
+
+//*************************************************************************************************************
+
+void RtProcessor::run()
+{
+    //Sleep until the first block has defined the size of the queue
+    m_qBufferMutex.lock();
+    while(!m_pBuffer && m_iIsRunning.loadAcquire()) {
+        m_qBufferCreated.wait(&m_qBufferMutex);
+    }
+    m_qBufferMutex.unlock();
+
+    if(!m_pBuffer) {
+        return;
+    }
+
+    MatrixXd matData;
+    QElapsedTimer timer;
+
+    //pop sleeps until a block arrives and fails as soon as the queue is stopped
+    while(m_pBuffer->pop(matData)) {
+        qint32 iQueueDepth = m_pBuffer->count();
+
+        if(m_iSettingsChanged.fetchAndStoreOrdered(0)) {
+            applySettings();
+        }
+
+        timer.start();
+        processData(matData);
+        qint64 iNsecs = timer.nsecsElapsed();
+
+        QMutexLocker locker(&m_qStatsMutex);
+        ++m_stats.iBlocksProcessed;
+        m_stats.iProcessingNsecs += iNsecs;
+        m_stats.iMaxProcessingNsecs = qMax(m_stats.iMaxProcessingNsecs, iNsecs);
+        m_stats.iQueueDepth = iQueueDepth;
+        m_stats.iMaxQueueDepth = qMax(m_stats.iMaxQueueDepth, iQueueDepth);
+    }
+}
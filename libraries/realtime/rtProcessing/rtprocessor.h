@@ -0,0 +1,242 @@
+//=============================================================================================================
+/**
+* @file     rtprocessor.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    RtProcessor class declaration.
+*
+*/
+
+#ifndef RTPROCESSOR_H
+#define RTPROCESSOR_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../realtime_global.h"
+
+#include <utils/generics/spscmatrixbuffer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE REALTIMELIB
+//=============================================================================================================
+
+namespace REALTIMELIB
+{
+
+
+//=============================================================================================================
+/**
+* Statistics of a RtProcessor. The queue stage is described by the number of queued, dropped and waiting
+* blocks, the processing stage by the time spent in processData.
+*
+* @brief Queue and processing statistics of a RtProcessor.
+*/
+struct RtProcessorStats
+{
+    qint64  iBlocksQueued;          /**< Number of blocks handed to appendData. */
+    qint64  iBlocksDropped;         /**< Number of blocks dropped because the queue was full or discarded. */
+    qint64  iBlocksProcessed;       /**< Number of blocks passed to processData. */
+    qint64  iProcessingNsecs;       /**< Total time spent in processData in nanoseconds. */
+    qint64  iMaxProcessingNsecs;    /**< Longest single processData call in nanoseconds. */
+    qint32  iQueueDepth;            /**< Number of blocks waiting in the queue after the last pop. */
+    qint32  iMaxQueueDepth;         /**< Highest number of blocks waiting in the queue. */
+};
+
+
+//=============================================================================================================
+/**
+* Base of the real-time processors which run on their own thread. Incoming blocks are passed through a lock-free
+* single-producer/single-consumer queue; the worker thread sleeps until a block arrives, so an idle processor does
+* not use any CPU. Settings are changed by the setters of the derived classes, which call settingsChanged(). The
+* worker then calls applySettings() once before the next block, where the derived class takes a consistent
+* snapshot of its settings. stop() wakes the worker and returns as soon as the current block is processed.
+*
+* appendData must always be called from the same thread. It never blocks, blocks which do not fit into the queue
+* are dropped and counted.
+*
+* @brief Event-driven base of the real-time processing threads.
+*/
+class REALTIMESHARED_EXPORT RtProcessor : public QThread
+{
+    Q_OBJECT
+
+public:
+    typedef QSharedPointer<RtProcessor> SPtr;             /**< Shared pointer type for RtProcessor. */
+    typedef QSharedPointer<const RtProcessor> ConstSPtr;  /**< Const shared pointer type for RtProcessor. */
+
+    //=========================================================================================================
+    /**
+    * Creates the processor. The queue is allocated with the size of the first block.
+    *
+    * @param[in] iQueueSize     The number of blocks the queue can hold.
+    * @param[in] parent         Parent QObject (optional).
+    */
+    explicit RtProcessor(qint32 iQueueSize, QObject *parent = 0);
+
+    //=========================================================================================================
+    /**
+    * Destroys the processor. Derived classes have to stop the processor in their own destructor.
+    */
+    virtual ~RtProcessor();
+
+    //=========================================================================================================
+    /**
+    * Starts the worker thread.
+    *
+    * @return true if succeeded, false if the worker is already running.
+    */
+    virtual bool start();
+
+    //=========================================================================================================
+    /**
+    * Stops the worker thread and waits until it has finished. Queued blocks are discarded.
+    *
+    * @return true if succeeded, false otherwise.
+    */
+    virtual bool stop();
+
+    //=========================================================================================================
+    /**
+    * Returns true if is running, otherwise false.
+    *
+    * @return true if is running, false otherwise.
+    */
+    inline bool isRunning();
+
+    //=========================================================================================================
+    /**
+    * Returns the queue and processing statistics.
+    *
+    * @return the current statistics.
+    */
+    RtProcessorStats stats() const;
+
+    //=========================================================================================================
+    /**
+    * Resets the queue and processing statistics.
+    */
+    void resetStats();
+
+protected:
+    //=========================================================================================================
+    /**
+    * Queues a data block for the worker thread. Producer only.
+    *
+    * @param[in] matData    The data block.
+    *
+    * @return true if the block was queued, false if it was dropped.
+    */
+    bool appendData(const Eigen::MatrixXd &matData);
+
+    //=========================================================================================================
+    /**
+    * Marks the settings as changed. applySettings is called by the worker before the next block.
+    */
+    void settingsChanged();
+
+    //=========================================================================================================
+    /**
+    * Drops all blocks which are currently queued. Worker thread only.
+    */
+    void discardQueuedData();
+
+    //=========================================================================================================
+    /**
+    * Takes a snapshot of the settings. Called on the worker thread before the first block and before each
+    * block which follows a settingsChanged() call.
+    */
+    virtual void applySettings();
+
+    //=========================================================================================================
+    /**
+    * Processes a data block. Called on the worker thread.
+    *
+    * @param[in] matData    The data block.
+    */
+    virtual void processData(const Eigen::MatrixXd &matData) = 0;
+
+    //=========================================================================================================
+    /**
+    * The worker loop. Sleeps until a block arrives and hands it to processData.
+    */
+    virtual void run();
+
+private:
+    qint32                                          m_iQueueSize;           /**< The number of blocks the queue can hold. */
+    QAtomicInt                                      m_iIsRunning;           /**< Whether the worker is running, read by the producer without locking. */
+    QAtomicInteger<int>                             m_iSettingsChanged;     /**< Whether applySettings has to be called. */
+
+    IOBUFFER::SpscMatrixBuffer<double>::SPtr        m_pBuffer;              /**< The queue, created with the first block. */
+    QMutex                                          m_qBufferMutex;         /**< Guards the creation of the queue and the running state. */
+    QWaitCondition                                  m_qBufferCreated;       /**< Signaled when the queue was created or the worker stopped. */
+
+    mutable QMutex                                  m_qStatsMutex;          /**< Guards the statistics. */
+    RtProcessorStats                                m_stats;                /**< The queue and processing statistics. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool RtProcessor::isRunning()
+{
+    return m_iIsRunning.loadAcquire() != 0;
+}
+
+} // NAMESPACE
+
+#endif // RTPROCESSOR_H
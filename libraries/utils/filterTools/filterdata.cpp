@@ -46,6 +46,7 @@
 
 #include "parksmcclellan.h"
 #include "cosinefilter.h"
+#include "iirfilter.h"
 
 
 //*************************************************************************************************************
@@ -98,6 +99,7 @@ FilterData::FilterData()
 , m_sFreq(1000)
 , m_dLowpassFreq(4)
 , m_dHighpassFreq(40)
+, m_iIirOrder(4)
 {
 
 }
@@ -105,7 +107,7 @@ FilterData::FilterData()
 
 //*************************************************************************************************************
 
-FilterData::FilterData(QString unique_name, FilterType type, int order, double centerfreq, double bandwidth, double parkswidth, double sFreq, qint32 fftlength, DesignMethod designMethod)
+FilterData::FilterData(QString unique_name, FilterType type, int order, double centerfreq, double bandwidth, double parkswidth, double sFreq, qint32 fftlength, DesignMethod designMethod, int iirOrder)
 : m_Type(type)
 , m_iFilterOrder(order)
 , m_iFFTlength(fftlength)
@@ -115,6 +117,7 @@ FilterData::FilterData(QString unique_name, FilterType type, int order, double c
 , m_dCenterFreq(centerfreq)
 , m_dBandwidth(bandwidth)
 , m_sFreq(sFreq)
+, m_iIirOrder(iirOrder)
 {
     designFilter();
 }
@@ -183,6 +186,26 @@ void FilterData::designFilter()
 
             break;
         }
+
+        case Butterworth: {
+            double dLowFreq = m_dCenterFreq;
+            double dHighFreq = m_dCenterFreq;
+
+            if(m_Type == BPF || m_Type == NOTCH) {
+                dLowFreq = m_dCenterFreq - m_dBandwidth/2;
+                dHighFreq = m_dCenterFreq + m_dBandwidth/2;
+            }
+
+            m_matSos = IirFilter::designButterworth(m_iIirOrder, dLowFreq, dHighFreq, (IirFilter::TPassType)m_Type);
+
+            //The FIR based filtering and plotting paths work on the truncated impulse response
+            IirFilter filter(m_matSos);
+            m_dCoeffA = filter.impulseResponse(m_iFilterOrder);
+
+            fftTransformCoeffs();
+
+            break;
+        }
     }
 
     switch(m_Type) {
@@ -338,6 +361,9 @@ QString FilterData::getStringForDesignMethod(const FilterData::DesignMethod &des
     if(designMethod == FilterData::Tschebyscheff)
         designMethodString = "Tschebyscheff";
 
+    if(designMethod == FilterData::Butterworth)
+        designMethodString = "Butterworth";
+
     return designMethodString;
 }
 
@@ -379,6 +405,9 @@ FilterData::DesignMethod FilterData::getDesignMethodForString(const QString &des
     if(designMethodString == "Cosine")
         designMethod = FilterData::Cosine;
 
+    if(designMethodString == "Butterworth")
+        designMethod = FilterData::Butterworth;
+
     return designMethod;
 }
 
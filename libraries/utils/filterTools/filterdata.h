@@ -102,7 +102,8 @@ public:
     enum DesignMethod {
         Tschebyscheff,
         Cosine,
-        External
+        External,
+        Butterworth
     } m_designMethod;
 
     enum FilterType {
@@ -134,9 +135,10 @@ public:
     * @param [in] parkswidth determines the width of the filter slopes (steepness)
     * @param [in] sFreq sampling frequency
     * @param [in] fftlength length of the fft (multiple integer of 2^x)
-    * @param [in] designMethod specifies the design method to use. Choose between Cosind and Tschebyscheff
+    * @param [in] designMethod specifies the design method to use. Choose between Cosind, Tschebyscheff and Butterworth (causal IIR)
+    * @param [in] iirOrder the order of the analog Butterworth prototype, ignored for FIR designs. Band pass and notch filters have twice this order.
     */
-    FilterData(QString unique_name, FilterType type, int order, double centerfreq, double bandwidth, double parkswidth, double sFreq, qint32 fftlength=4096, DesignMethod designMethod = Cosine);
+    FilterData(QString unique_name, FilterType type, int order, double centerfreq, double bandwidth, double parkswidth, double sFreq, qint32 fftlength=4096, DesignMethod designMethod = Cosine, int iirOrder = 4);
 
     /**
      * @brief fftTransformCoeffs transforms the calculated filter coefficients to frequency-domain
@@ -206,6 +208,9 @@ public:
 
     RowVectorXcd    m_dFFTCoeffA;       /**< the FFT-transformed forward filter coefficient set, required for frequency-domain filtering, zero-padded to m_iFFTlength. */
     RowVectorXcd    m_dFFTCoeffB;       /**< the FFT-transformed backward filter coefficient set, required for frequency-domain filtering, zero-padded to m_iFFTlength. */
+
+    int             m_iIirOrder;        /**< the order of the analog prototype of IIR designs (Butterworth), 4 by default. Call designFilter after changing it. */
+    MatrixXd        m_matSos;           /**< the second-order sections [b0 b1 b2 a0 a1 a2] of IIR designs, empty for FIR designs. For IIR designs m_dCoeffA holds the impulse response truncated to m_iFilterOrder taps. */
 };
 
 //*************************************************************************************************************
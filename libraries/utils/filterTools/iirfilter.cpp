@@ -0,0 +1,331 @@
+//=============================================================================================================
+/**
+* @file     iirfilter.cpp
+* @author   Lorenz Esch <lorenz.esch@tu-ilmenau.de>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Lorenz Esch. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Definition of the IirFilter class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "iirfilter.h"
+
+#include <cmath>
+#include <vector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE STATIC FUNCTIONS
+//=============================================================================================================
+
+namespace
+{
+
+typedef std::complex<double> Complex;
+
+//=============================================================================================================
+/**
+* Evaluates the frequency response of one section at the unit circle position z.
+*/
+Complex sectionResponse(const RowVectorXd& vecSection, const Complex& z)
+{
+    Complex zi = 1.0 / z;
+    Complex num = vecSection(0) + zi * (vecSection(1) + zi * vecSection(2));
+    Complex den = vecSection(3) + zi * (vecSection(4) + zi * vecSection(5));
+    return num / den;
+}
+
+
+//=============================================================================================================
+/**
+* Maps an analog pole or zero to the z-plane with the bilinear transform (sampling interval 1).
+*/
+Complex bilinear(const Complex& s)
+{
+    return (2.0 + s) / (2.0 - s);
+}
+
+} // NAMESPACE
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+IirFilter::IirFilter()
+{
+}
+
+
+//*************************************************************************************************************
+
+IirFilter::IirFilter(const MatrixXd& matSos)
+: m_matSos(matSos)
+{
+    //Normalize to a0 = 1
+    for(int s = 0; s < m_matSos.rows(); ++s) {
+        if(m_matSos(s,3) != 0.0 && m_matSos(s,3) != 1.0) {
+            m_matSos.row(s) /= m_matSos(s,3);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd IirFilter::designButterworth(int iOrder, double dLowFreq, double dHighFreq, TPassType type)
+{
+    iOrder = qMax(iOrder, 1);
+
+    //Pre-warp the cutoff frequencies
+    double dWLow = 2.0 * std::tan(M_PI * dLowFreq / 2.0);
+    double dWHigh = 2.0 * std::tan(M_PI * dHighFreq / 2.0);
+    double dW0 = std::sqrt(dWLow * dWHigh);
+    double dBW = dWHigh - dWLow;
+
+    //Poles of the analog prototype in the left half plane
+    std::vector<Complex> vecProtoPoles;
+    for(int k = 0; k < iOrder; ++k) {
+        vecProtoPoles.push_back(std::polar(1.0, M_PI * (2.0 * k + iOrder + 1) / (2.0 * iOrder)));
+    }
+
+    //Transform the prototype poles and map them to the z-plane
+    std::vector<Complex> vecPoles;
+    Complex sqrtTerm;
+    for(size_t k = 0; k < vecProtoPoles.size(); ++k) {
+        const Complex& p = vecProtoPoles[k];
+
+        switch(type) {
+            case LPF:
+                vecPoles.push_back(bilinear(p * dWLow));
+                break;
+
+            case HPF:
+                vecPoles.push_back(bilinear(dWLow / p));
+                break;
+
+            case BPF:
+                sqrtTerm = std::sqrt(p * p * dBW * dBW / 4.0 - dW0 * dW0);
+                vecPoles.push_back(bilinear(p * dBW / 2.0 + sqrtTerm));
+                vecPoles.push_back(bilinear(p * dBW / 2.0 - sqrtTerm));
+                break;
+
+            case NOTCH:
+                sqrtTerm = std::sqrt(dBW * dBW / (4.0 * p * p) - dW0 * dW0);
+                vecPoles.push_back(bilinear(dBW / (2.0 * p) + sqrtTerm));
+                vecPoles.push_back(bilinear(dBW / (2.0 * p) - sqrtTerm));
+                break;
+        }
+    }
+
+    //Pair complex conjugate poles, real poles are paired with each other
+    std::vector<Complex> vecComplexPoles, vecRealPoles;
+    for(size_t k = 0; k < vecPoles.size(); ++k) {
+        if(std::abs(vecPoles[k].imag()) > 1e-10) {
+            if(vecPoles[k].imag() > 0.0) {
+                vecComplexPoles.push_back(vecPoles[k]);
+            }
+        } else {
+            vecRealPoles.push_back(Complex(vecPoles[k].real(), 0.0));
+        }
+    }
+
+    int iNumSections = vecComplexPoles.size() + (vecRealPoles.size() + 1) / 2;
+    MatrixXd matSos = MatrixXd::Zero(iNumSections, 6);
+
+    int iSection = 0;
+    for(size_t k = 0; k < vecComplexPoles.size(); ++k, ++iSection) {
+        matSos(iSection,3) = 1.0;
+        matSos(iSection,4) = -2.0 * vecComplexPoles[k].real();
+        matSos(iSection,5) = std::norm(vecComplexPoles[k]);
+    }
+
+    for(size_t k = 0; k < vecRealPoles.size(); k += 2, ++iSection) {
+        matSos(iSection,3) = 1.0;
+        if(k + 1 < vecRealPoles.size()) {
+            matSos(iSection,4) = -(vecRealPoles[k].real() + vecRealPoles[k+1].real());
+            matSos(iSection,5) = vecRealPoles[k].real() * vecRealPoles[k+1].real();
+        } else {
+            matSos(iSection,4) = -vecRealPoles[k].real();
+        }
+    }
+
+    //Zeros and gain of each section: first order sections get a single zero
+    double dOmega0 = 2.0 * std::atan(dW0 / 2.0);
+    double dRefFreq = 0.0;
+
+    for(int s = 0; s < iNumSections; ++s) {
+        bool bFirstOrder = matSos(s,5) == 0.0 && (type == LPF || type == HPF);
+
+        switch(type) {
+            case LPF:
+                matSos.block(s,0,1,3) << 1.0, bFirstOrder ? 1.0 : 2.0, bFirstOrder ? 0.0 : 1.0;
+                dRefFreq = 0.0;
+                break;
+
+            case HPF:
+                matSos.block(s,0,1,3) << 1.0, bFirstOrder ? -1.0 : -2.0, bFirstOrder ? 0.0 : 1.0;
+                dRefFreq = 1.0;
+                break;
+
+            case BPF:
+                matSos.block(s,0,1,3) << 1.0, 0.0, -1.0;
+                dRefFreq = dOmega0 / M_PI;
+                break;
+
+            case NOTCH:
+                matSos.block(s,0,1,3) << 1.0, -2.0 * std::cos(dOmega0), 1.0;
+                dRefFreq = 0.0;
+                break;
+        }
+
+        //Unit gain of each section in the pass band keeps the intermediate signals bounded
+        double dGain = std::abs(sectionResponse(matSos.row(s), std::polar(1.0, M_PI * dRefFreq)));
+        if(dGain > 0.0) {
+            matSos.block(s,0,1,3) /= dGain;
+        }
+    }
+
+    return matSos;
+}
+
+
+//*************************************************************************************************************
+
+void IirFilter::filter(MatrixXd& matData)
+{
+    const int iSections = m_matSos.rows();
+
+    if(iSections == 0) {
+        return;
+    }
+
+    if(m_matZ1.rows() != matData.rows() || m_matZ1.cols() != iSections) {
+        m_matZ1 = MatrixXd::Zero(matData.rows(), iSections);
+        m_matZ2 = MatrixXd::Zero(matData.rows(), iSections);
+    }
+
+    for(int t = 0; t < matData.cols(); ++t) {
+        m_vecX = matData.col(t);
+
+        for(int s = 0; s < iSections; ++s) {
+            const double b0 = m_matSos(s,0), b1 = m_matSos(s,1), b2 = m_matSos(s,2);
+            const double a1 = m_matSos(s,4), a2 = m_matSos(s,5);
+
+            m_vecY = b0 * m_vecX + m_matZ1.col(s);
+            m_matZ1.col(s) = b1 * m_vecX - a1 * m_vecY + m_matZ2.col(s);
+            m_matZ2.col(s) = b2 * m_vecX - a2 * m_vecY;
+            m_vecX.swap(m_vecY);
+        }
+
+        matData.col(t) = m_vecX;
+    }
+}
+
+
+//*************************************************************************************************************
+
+RowVectorXd IirFilter::applyFilter(const RowVectorXd& vecData) const
+{
+    IirFilter filter(m_matSos);
+
+    MatrixXd matData = vecData;
+    filter.filter(matData);
+
+    return matData.row(0);
+}
+
+
+//*************************************************************************************************************
+
+void IirFilter::reset()
+{
+    m_matZ1.setZero();
+    m_matZ2.setZero();
+}
+
+
+//*************************************************************************************************************
+
+RowVectorXd IirFilter::impulseResponse(int iLength) const
+{
+    RowVectorXd vecImpulse = RowVectorXd::Zero(qMax(iLength, 0));
+
+    if(iLength > 0) {
+        vecImpulse(0) = 1.0;
+        vecImpulse = applyFilter(vecImpulse);
+    }
+
+    return vecImpulse;
+}
+
+
+//*************************************************************************************************************
+
+std::complex<double> IirFilter::frequencyResponse(double dFreq) const
+{
+    Complex z = std::polar(1.0, M_PI * dFreq);
+    Complex response(1.0, 0.0);
+
+    for(int s = 0; s < m_matSos.rows(); ++s) {
+        response *= sectionResponse(m_matSos.row(s), z);
+    }
+
+    return response;
+}
+
+
+//*************************************************************************************************************
+
+double IirFilter::groupDelay(double dFreq) const
+{
+    //Numerical derivative of the phase, tau = -dphi/domega
+    const double dDelta = 1e-6;
+
+    double dLow = qMax(dFreq - dDelta, 0.0);
+    double dHigh = qMin(dFreq + dDelta, 1.0);
+
+    Complex ratio = frequencyResponse(dHigh) / frequencyResponse(dLow);
+
+    return -std::arg(ratio) / (M_PI * (dHigh - dLow));
+}
@@ -0,0 +1,199 @@
+//=============================================================================================================
+/**
+* @file     iirfilter.h
+* @author   Lorenz Esch <lorenz.esch@tu-ilmenau.de>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Lorenz Esch. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    IirFilter class declaration.
+*
+*/
+
+#ifndef IIRFILTER_H
+#define IIRFILTER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../utils_global.h"
+
+#include <complex>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Causal IIR filter given as a cascade of second-order sections (biquads). Each row of the section matrix holds
+* [b0 b1 b2 a0 a1 a2] with a0 = 1. The sections are evaluated in transposed direct form II. The filter keeps
+* its state per channel, so consecutive data blocks are filtered as one continuous stream. All channels are
+* processed together sample by sample, which keeps the per-sample work vectorized across channels.
+*
+* @brief Causal multi-channel IIR filter of cascaded biquads.
+*/
+class UTILSSHARED_EXPORT IirFilter
+{
+public:
+    enum TPassType {LPF, HPF, BPF, NOTCH };
+
+    //=========================================================================================================
+    /**
+    * Constructs an empty IirFilter object, which passes the data unchanged.
+    */
+    IirFilter();
+
+    //=========================================================================================================
+    /**
+    * Constructs an IirFilter object.
+    *
+    * @param[in] matSos     the second-order sections (sections x 6) as [b0 b1 b2 a0 a1 a2].
+    */
+    explicit IirFilter(const MatrixXd& matSos);
+
+    //=========================================================================================================
+    /**
+    * Designs a Butterworth filter with the bilinear transform and returns its second-order sections. Band
+    * pass and notch filters have twice the given order.
+    *
+    * @param[in] iOrder     the order of the analog prototype.
+    * @param[in] dLowFreq   the lower cutoff frequency normalized to the Nyquist frequency. Cutoff of LPF/HPF.
+    * @param[in] dHighFreq  the upper cutoff frequency normalized to the Nyquist frequency. Ignored for LPF/HPF.
+    * @param[in] type       the filter type.
+    *
+    * @return the second-order sections (sections x 6).
+    */
+    static MatrixXd designButterworth(int iOrder, double dLowFreq, double dHighFreq, TPassType type);
+
+    //=========================================================================================================
+    /**
+    * Filters a data block (channels x samples) in place, continuing from the state of the previous block.
+    * The state is reset if the number of channels changes.
+    *
+    * @param[in, out] matData   the data to filter.
+    */
+    void filter(MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+    * Filters a single channel starting from a zero state. The state of the object is not touched.
+    *
+    * @param[in] vecData    the data to filter.
+    *
+    * @return the filtered data.
+    */
+    RowVectorXd applyFilter(const RowVectorXd& vecData) const;
+
+    //=========================================================================================================
+    /**
+    * Resets the filter state to zero.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Returns the impulse response of the cascade.
+    *
+    * @param[in] iLength    the number of samples.
+    *
+    * @return the impulse response.
+    */
+    RowVectorXd impulseResponse(int iLength) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the complex frequency response of the cascade.
+    *
+    * @param[in] dFreq      the frequency normalized to the Nyquist frequency.
+    *
+    * @return the frequency response.
+    */
+    std::complex<double> frequencyResponse(double dFreq) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the group delay of the cascade.
+    *
+    * @param[in] dFreq      the frequency normalized to the Nyquist frequency.
+    *
+    * @return the group delay in samples.
+    */
+    double groupDelay(double dFreq) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the second-order sections.
+    *
+    * @return the sections (sections x 6) as [b0 b1 b2 a0 a1 a2].
+    */
+    inline const MatrixXd& sos() const;
+
+private:
+    MatrixXd    m_matSos;       /**< The second-order sections normalized to a0 = 1. */
+    MatrixXd    m_matZ1;        /**< The first state variable of each channel (channels x sections). */
+    MatrixXd    m_matZ2;        /**< The second state variable of each channel (channels x sections). */
+    VectorXd    m_vecX;         /**< Section input of all channels. */
+    VectorXd    m_vecY;         /**< Section output of all channels. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline const MatrixXd& IirFilter::sos() const
+{
+    return m_matSos;
+}
+
+} // NAMESPACE UTILSLIB
+
+#endif // IIRFILTER_H
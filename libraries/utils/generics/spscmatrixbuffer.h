@@ -0,0 +1,706 @@
+//=============================================================================================================
+/**
+* @file     spscmatrixbuffer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    SpscMatrixBuffer class declaration
+*
+*/
+
+#ifndef SPSCMATRIXBUFFER_H
+#define SPSCMATRIXBUFFER_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../utils_global.h"
+#include "buffer.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <typeinfo>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <stdio.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE IOBUFFER
+//=============================================================================================================
+
+namespace IOBUFFER
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Lock-free single-producer/single-consumer ring buffer of matrices. Exactly one thread may push and exactly
+* one thread may pop. The slots are preallocated, the producer and the consumer only exchange two indices, which
+* live on separate cache lines. Blocks can be written and read in place via beginPush/commitPush and
+* beginPop/commitPop, which avoids copying a matrix per block.
+*
+* If blocking is enabled, a call which has to wait first spins shortly and then sleeps on a wait condition. The
+* other side only takes the mutex if somebody is actually sleeping, so the fast path stays lock-free. Without
+* blocking, all calls return immediately and the caller polls.
+*
+* @brief Lock-free single-producer/single-consumer matrix ring buffer
+*/
+template<typename _Tp>
+class SpscMatrixBuffer : public Buffer
+{
+public:
+    typedef QSharedPointer<SpscMatrixBuffer> SPtr;              /**< Shared pointer type for SpscMatrixBuffer. */
+    typedef QSharedPointer<const SpscMatrixBuffer> ConstSPtr;   /**< Const shared pointer type for SpscMatrixBuffer. */
+
+    typedef Matrix<_Tp, Dynamic, Dynamic> MatrixType;           /**< The stored matrix type. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a SpscMatrixBuffer. The number of slots is rounded up to the next power of two.
+    *
+    * @param [in] uiNumSlots    Number of matrices the buffer can hold.
+    * @param [in] uiRows        Number of rows.
+    * @param [in] uiCols        Number of columns.
+    * @param [in] bBlocking     Whether push and pop may sleep until a slot or a matrix is available.
+    */
+    explicit SpscMatrixBuffer(unsigned int uiNumSlots, unsigned int uiRows, unsigned int uiCols, bool bBlocking = true);
+
+    //=========================================================================================================
+    /**
+    * Destroys the SpscMatrixBuffer.
+    */
+    ~SpscMatrixBuffer();
+
+    //=========================================================================================================
+    /**
+    * Returns the next free slot for writing in place. Producer only. The matrix is published by commitPush.
+    *
+    * @param [in] bWait     Whether to wait for a free slot (only if blocking is enabled).
+    *
+    * @return the slot, or NULL if the buffer is full or was stopped.
+    */
+    inline MatrixType* beginPush(bool bWait = true);
+
+    //=========================================================================================================
+    /**
+    * Publishes the slot returned by beginPush. Producer only.
+    */
+    inline void commitPush();
+
+    //=========================================================================================================
+    /**
+    * Copies a matrix to the end of the buffer. Producer only.
+    *
+    * @param [in] matrix    The matrix to append, it has to have the dimensions of the buffer.
+    * @param [in] bWait     Whether to wait for a free slot (only if blocking is enabled).
+    *
+    * @return true if the matrix was appended.
+    */
+    inline bool push(const MatrixType& matrix, bool bWait = true);
+
+    //=========================================================================================================
+    /**
+    * Copies several matrices to the end of the buffer. The matrices are published together, i.e. the consumer
+    * is notified once per batch. Producer only.
+    *
+    * @param [in] lMatrices The matrices to append, they have to have the dimensions of the buffer.
+    * @param [in] bWait     Whether to wait until all matrices are appended (only if blocking is enabled).
+    *
+    * @return the number of appended matrices. Matrices with wrong dimensions are skipped.
+    */
+    int pushBatch(const QList<MatrixType>& lMatrices, bool bWait = true);
+
+    //=========================================================================================================
+    /**
+    * Returns the oldest matrix for reading in place. Consumer only. The slot is freed by commitPop.
+    *
+    * @param [in] bWait     Whether to wait for a matrix (only if blocking is enabled).
+    *
+    * @return the slot, or NULL if the buffer is empty or was stopped.
+    */
+    inline const MatrixType* beginPop(bool bWait = true);
+
+    //=========================================================================================================
+    /**
+    * Frees the slot returned by beginPop. Consumer only.
+    */
+    inline void commitPop();
+
+    //=========================================================================================================
+    /**
+    * Removes the oldest matrix from the buffer. Consumer only. The matrix is swapped with the slot, so no data
+    * is copied; pass the same matrix again to reuse its memory.
+    *
+    * @param [out] matrix   The popped matrix.
+    * @param [in] bWait     Whether to wait for a matrix (only if blocking is enabled).
+    *
+    * @return true if a matrix was popped.
+    */
+    inline bool pop(MatrixType& matrix, bool bWait = true);
+
+    //=========================================================================================================
+    /**
+    * Removes all available matrices, at most iMaxCount, from the buffer. Consumer only.
+    *
+    * @param [out] lMatrices    The popped matrices are appended to this list.
+    * @param [in] iMaxCount     The maximum number of matrices to pop.
+    * @param [in] bWait         Whether to wait for at least one matrix (only if blocking is enabled).
+    *
+    * @return the number of popped matrices.
+    */
+    int popBatch(QList<MatrixType>& lMatrices, int iMaxCount, bool bWait = true);
+
+    //=========================================================================================================
+    /**
+    * Stops the buffer. Waiting calls return and all further calls fail until clear is called.
+    */
+    void stop();
+
+    //=========================================================================================================
+    /**
+    * Clears the buffer and restarts it after stop. Neither the producer nor the consumer may use the buffer
+    * concurrently.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Number of matrices which are currently stored. Exact only on the producer or consumer thread.
+    */
+    inline quint32 count() const;
+
+    //=========================================================================================================
+    /**
+    * Number of slots of the buffer.
+    */
+    inline quint32 size() const;
+
+    //=========================================================================================================
+    /**
+    * Rows of the stored matrices of the buffer.
+    */
+    inline quint32 rows() const;
+
+    //=========================================================================================================
+    /**
+    * Cols of the stored matrices of the buffer.
+    */
+    inline quint32 cols() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Waits until the consumer freed a slot. Producer only.
+    *
+    * @return true if a slot is free, false if the buffer was stopped or does not block.
+    */
+    bool waitForSlot();
+
+    //=========================================================================================================
+    /**
+    * Waits until the producer published a matrix. Consumer only.
+    *
+    * @return true if a matrix is available, false if the buffer was stopped or does not block.
+    */
+    bool waitForMatrix();
+
+    //=========================================================================================================
+    /**
+    * Wakes the other side if it is sleeping on the given flag.
+    *
+    * @param [in] iWaiting      The waiting flag of the other side.
+    * @param [in] condition     The wait condition the other side sleeps on.
+    */
+    inline void wake(QAtomicInteger<int>& iWaiting, QWaitCondition& condition);
+
+    enum { CacheLineSize = 64 };    /**< Padding which keeps the indices on separate cache lines. */
+
+    QVector<MatrixType>     m_vecSlots;                 /**< The preallocated slots. */
+    quint32                 m_uiMask;                   /**< Number of slots - 1, the number of slots is a power of two. */
+    quint32                 m_uiRows;                   /**< Holds the number rows. */
+    quint32                 m_uiCols;                   /**< Holds the number cols. */
+    bool                    m_bBlocking;                /**< Whether push and pop may sleep. */
+
+    char                    m_pad0[CacheLineSize];
+
+    QAtomicInteger<quint32> m_uiHead;                   /**< Number of published matrices, written by the producer. */
+    quint32                 m_uiCachedTail;             /**< The producer's copy of m_uiTail. */
+    QAtomicInteger<int>     m_iProducerWaiting;         /**< Whether the producer sleeps on m_qNotFull. */
+
+    char                    m_pad1[CacheLineSize];
+
+    QAtomicInteger<quint32> m_uiTail;                   /**< Number of freed matrices, written by the consumer. */
+    quint32                 m_uiCachedHead;             /**< The consumer's copy of m_uiHead. */
+    QAtomicInteger<int>     m_iConsumerWaiting;         /**< Whether the consumer sleeps on m_qNotEmpty. */
+
+    char                    m_pad2[CacheLineSize];
+
+    QAtomicInteger<int>     m_iStopped;                 /**< Whether the buffer was stopped. */
+    QMutex                  m_qMutex;                   /**< Only taken to sleep and to wake a sleeping side. */
+    QWaitCondition          m_qNotEmpty;                /**< Signaled when a matrix was published. */
+    QWaitCondition          m_qNotFull;                 /**< Signaled when a slot was freed. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+template<typename _Tp>
+SpscMatrixBuffer<_Tp>::SpscMatrixBuffer(unsigned int uiNumSlots, unsigned int uiRows, unsigned int uiCols, bool bBlocking)
+: Buffer(typeid(_Tp).name())
+, m_uiRows(uiRows)
+, m_uiCols(uiCols)
+, m_bBlocking(bBlocking)
+, m_uiHead(0)
+, m_uiCachedTail(0)
+, m_iProducerWaiting(0)
+, m_uiTail(0)
+, m_uiCachedHead(0)
+, m_iConsumerWaiting(0)
+, m_iStopped(0)
+{
+    quint32 uiSize = 1;
+    while(uiSize < uiNumSlots) {
+        uiSize *= 2;
+    }
+
+    m_uiMask = uiSize - 1;
+    m_vecSlots.fill(MatrixType::Zero(m_uiRows, m_uiCols), uiSize);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+SpscMatrixBuffer<_Tp>::~SpscMatrixBuffer()
+{
+    stop();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline typename SpscMatrixBuffer<_Tp>::MatrixType* SpscMatrixBuffer<_Tp>::beginPush(bool bWait)
+{
+    if(m_iStopped.loadAcquire()) {
+        return 0;
+    }
+
+    const quint32 uiHead = m_uiHead.load();
+
+    //Only read the consumer's index if the cached one says the buffer is full
+    if(uiHead - m_uiCachedTail > m_uiMask) {
+        m_uiCachedTail = m_uiTail.loadAcquire();
+
+        if(uiHead - m_uiCachedTail > m_uiMask && !(bWait && waitForSlot())) {
+            return 0;
+        }
+    }
+
+    MatrixType& slot = m_vecSlots[uiHead & m_uiMask];
+    slot.resize(m_uiRows, m_uiCols);
+
+    return &slot;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void SpscMatrixBuffer<_Tp>::commitPush()
+{
+    m_uiHead.storeRelease(m_uiHead.load() + 1);
+
+    if(m_bBlocking) {
+        wake(m_iConsumerWaiting, m_qNotEmpty);
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool SpscMatrixBuffer<_Tp>::push(const MatrixType& matrix, bool bWait)
+{
+    if((quint32)matrix.rows() != m_uiRows || (quint32)matrix.cols() != m_uiCols) {
+        printf("Error: Matrix not appended to SpscMatrixBuffer - wrong dimensions\n");
+        return false;
+    }
+
+    MatrixType* pSlot = beginPush(bWait);
+    if(!pSlot) {
+        return false;
+    }
+
+    *pSlot = matrix;
+    commitPush();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+int SpscMatrixBuffer<_Tp>::pushBatch(const QList<MatrixType>& lMatrices, bool bWait)
+{
+    int iPushed = 0;
+    int iNext = 0;
+
+    while(iNext < lMatrices.size() && !m_iStopped.loadAcquire()) {
+        const quint32 uiHead = m_uiHead.load();
+        m_uiCachedTail = m_uiTail.loadAcquire();
+
+        quint32 uiFree = m_uiMask + 1 - (uiHead - m_uiCachedTail);
+        if(uiFree == 0) {
+            if(bWait && waitForSlot()) {
+                continue;
+            }
+            break;
+        }
+
+        //Fill all free slots and publish them with one index update
+        quint32 uiCount = 0;
+        while(uiCount < uiFree && iNext < lMatrices.size()) {
+            const MatrixType& matrix = lMatrices.at(iNext++);
+
+            if((quint32)matrix.rows() != m_uiRows || (quint32)matrix.cols() != m_uiCols) {
+                printf("Error: Matrix not appended to SpscMatrixBuffer - wrong dimensions\n");
+                continue;
+            }
+
+            m_vecSlots[(uiHead + uiCount) & m_uiMask] = matrix;
+            ++uiCount;
+        }
+
+        if(uiCount > 0) {
+            iPushed += uiCount;
+            m_uiHead.storeRelease(uiHead + uiCount);
+
+            if(m_bBlocking) {
+                wake(m_iConsumerWaiting, m_qNotEmpty);
+            }
+        }
+    }
+
+    return iPushed;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline const typename SpscMatrixBuffer<_Tp>::MatrixType* SpscMatrixBuffer<_Tp>::beginPop(bool bWait)
+{
+    if(m_iStopped.loadAcquire()) {
+        return 0;
+    }
+
+    const quint32 uiTail = m_uiTail.load();
+
+    //Only read the producer's index if the cached one says the buffer is empty
+    if(uiTail == m_uiCachedHead) {
+        m_uiCachedHead = m_uiHead.loadAcquire();
+
+        if(uiTail == m_uiCachedHead && !(bWait && waitForMatrix())) {
+            return 0;
+        }
+    }
+
+    return &m_vecSlots.at(uiTail & m_uiMask);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void SpscMatrixBuffer<_Tp>::commitPop()
+{
+    m_uiTail.storeRelease(m_uiTail.load() + 1);
+
+    if(m_bBlocking) {
+        wake(m_iProducerWaiting, m_qNotFull);
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool SpscMatrixBuffer<_Tp>::pop(MatrixType& matrix, bool bWait)
+{
+    if(!beginPop(bWait)) {
+        return false;
+    }
+
+    //The consumer owns the slot until commitPop, the producer resizes it before it writes to it again
+    matrix.swap(m_vecSlots[m_uiTail.load() & m_uiMask]);
+    commitPop();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+int SpscMatrixBuffer<_Tp>::popBatch(QList<MatrixType>& lMatrices, int iMaxCount, bool bWait)
+{
+    if(iMaxCount <= 0 || !beginPop(bWait)) {
+        return 0;
+    }
+
+    const quint32 uiTail = m_uiTail.load();
+    m_uiCachedHead = m_uiHead.loadAcquire();
+
+    const quint32 uiCount = qMin((quint32)iMaxCount, m_uiCachedHead - uiTail);
+
+    for(quint32 i = 0; i < uiCount; ++i) {
+        lMatrices.append(MatrixType());
+        lMatrices.last().swap(m_vecSlots[(uiTail + i) & m_uiMask]);
+    }
+
+    //Free all popped slots with one index update
+    m_uiTail.storeRelease(uiTail + uiCount);
+
+    if(m_bBlocking) {
+        wake(m_iProducerWaiting, m_qNotFull);
+    }
+
+    return (int)uiCount;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void SpscMatrixBuffer<_Tp>::stop()
+{
+    QMutexLocker locker(&m_qMutex);
+    m_iStopped.storeRelease(1);
+    m_qNotEmpty.wakeAll();
+    m_qNotFull.wakeAll();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void SpscMatrixBuffer<_Tp>::clear()
+{
+    QMutexLocker locker(&m_qMutex);
+    m_uiHead.storeRelease(0);
+    m_uiTail.storeRelease(0);
+    m_uiCachedHead = 0;
+    m_uiCachedTail = 0;
+    m_iStopped.storeRelease(0);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 SpscMatrixBuffer<_Tp>::count() const
+{
+    return m_uiHead.loadAcquire() - m_uiTail.loadAcquire();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 SpscMatrixBuffer<_Tp>::size() const
+{
+    return m_uiMask + 1;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 SpscMatrixBuffer<_Tp>::rows() const
+{
+    return m_uiRows;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 SpscMatrixBuffer<_Tp>::cols() const
+{
+    return m_uiCols;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+bool SpscMatrixBuffer<_Tp>::waitForSlot()
+{
+    if(!m_bBlocking) {
+        return false;
+    }
+
+    const quint32 uiHead = m_uiHead.load();
+
+    //Spin shortly, blocks usually arrive in quick succession
+    for(int i = 0; i < 100; ++i) {
+        m_uiCachedTail = m_uiTail.loadAcquire();
+        if(uiHead - m_uiCachedTail <= m_uiMask) {
+            return true;
+        }
+        QThread::yieldCurrentThread();
+    }
+
+    QMutexLocker locker(&m_qMutex);
+
+    while(!m_iStopped.loadAcquire()) {
+        //The ordered exchange makes sure the consumer either sees the flag or we see its index update
+        m_iProducerWaiting.fetchAndStoreOrdered(1);
+
+        m_uiCachedTail = m_uiTail.loadAcquire();
+        if(uiHead - m_uiCachedTail <= m_uiMask) {
+            m_iProducerWaiting.storeRelease(0);
+            return true;
+        }
+
+        m_qNotFull.wait(&m_qMutex);
+    }
+
+    m_iProducerWaiting.storeRelease(0);
+
+    return false;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+bool SpscMatrixBuffer<_Tp>::waitForMatrix()
+{
+    if(!m_bBlocking) {
+        return false;
+    }
+
+    const quint32 uiTail = m_uiTail.load();
+
+    //Spin shortly, blocks usually arrive in quick succession
+    for(int i = 0; i < 100; ++i) {
+        m_uiCachedHead = m_uiHead.loadAcquire();
+        if(uiTail != m_uiCachedHead) {
+            return true;
+        }
+        QThread::yieldCurrentThread();
+    }
+
+    QMutexLocker locker(&m_qMutex);
+
+    while(!m_iStopped.loadAcquire()) {
+        //The ordered exchange makes sure the producer either sees the flag or we see its index update
+        m_iConsumerWaiting.fetchAndStoreOrdered(1);
+
+        m_uiCachedHead = m_uiHead.loadAcquire();
+        if(uiTail != m_uiCachedHead) {
+            m_iConsumerWaiting.storeRelease(0);
+            return true;
+        }
+
+        m_qNotEmpty.wait(&m_qMutex);
+    }
+
+    m_iConsumerWaiting.storeRelease(0);
+
+    return false;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void SpscMatrixBuffer<_Tp>::wake(QAtomicInteger<int>& iWaiting, QWaitCondition& condition)
+{
+    //The ordered read pairs with the exchange in the wait functions, the mutex is only taken if somebody sleeps
+    if(iWaiting.fetchAndAddOrdered(0) != 0) {
+        QMutexLocker locker(&m_qMutex);
+        condition.wakeAll();
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// TYPEDEF
+//=============================================================================================================
+
+typedef UTILSSHARED_EXPORT SpscMatrixBuffer<float>                      _float_SpscMatrixBuffer;                   /**< Defines SpscMatrixBuffer of float type.*/
+typedef UTILSSHARED_EXPORT SpscMatrixBuffer<double>                     _double_SpscMatrixBuffer;                  /**< Defines SpscMatrixBuffer of double type.*/
+
+} // NAMESPACE
+
+#endif // SPSCMATRIXBUFFER_H
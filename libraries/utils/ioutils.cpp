@@ -47,6 +47,9 @@
 //=============================================================================================================
 
 #include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
 
 
 //*************************************************************************************************************
@@ -342,3 +345,67 @@ bool IOUtils::check_matching_chnames_conventions(const QStringList& chNamesA, co
 
     return bMatching;
 }
+
+
+//*************************************************************************************************************
+
+QString IOUtils::get_cache_dir(const QString& sName)
+{
+    QByteArray sEnabled = qgetenv("MNE_CPP_CACHE").trimmed().toLower();
+
+    if(sEnabled == "0" || sEnabled == "off" || sEnabled == "false") {
+        return QString();
+    }
+
+    return QString("%1/mne-cpp/%2").arg(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).arg(sName);
+}
+
+
+//*************************************************************************************************************
+
+bool IOUtils::trim_cache_dir(const QString& sDir, qint64 iReserve)
+{
+    bool bOk = false;
+    qint64 iMaxMB = qgetenv("MNE_CPP_CACHE_MAX_MB").toLongLong(&bOk);
+    qint64 iMaxBytes = (bOk && iMaxMB >= 0 ? iMaxMB : 2048) * 1024 * 1024;
+
+    if(iReserve > iMaxBytes) {
+        return false;
+    }
+
+    //Newest first, the oldest files are removed from the end
+    QFileInfoList lFiles = QDir(sDir).entryInfoList(QDir::Files, QDir::Time);
+    qint64 iTotal = iReserve;
+
+    for(int i = 0; i < lFiles.size(); ++i) {
+        iTotal += lFiles.at(i).size();
+    }
+
+    while(iTotal > iMaxBytes && !lFiles.isEmpty()) {
+        QFileInfo fileInfo = lFiles.takeLast();
+        if(QFile::remove(fileInfo.absoluteFilePath())) {
+            iTotal -= fileInfo.size();
+        }
+    }
+
+    return iTotal <= iMaxBytes;
+}
+
+
+//*************************************************************************************************************
+
+bool IOUtils::clear_cache_dir(const QString& sDir)
+{
+    if(sDir.isEmpty()) {
+        return false;
+    }
+
+    bool bOk = true;
+    QFileInfoList lFiles = QDir(sDir).entryInfoList(QDir::Files);
+
+    for(int i = 0; i < lFiles.size(); ++i) {
+        bOk = QFile::remove(lFiles.at(i).absoluteFilePath()) && bOk;
+    }
+
+    return bOk;
+}
@@ -261,6 +261,39 @@ public:
     * @return True if all names in chNamesA are present in chNamesB, false otherwise.
     */
     static bool check_matching_chnames_conventions(const QStringList& chNamesA, const QStringList& chNamesB, bool bCheckForNewNamingConvention = false);
+
+    //=========================================================================================================
+    /**
+    * Returns the folder of a disk cache, i.e., mne-cpp/<sName> in the generic cache location of the user. All disk
+    * caches are switched off by setting the environment variable MNE_CPP_CACHE to 0.
+    *
+    * @param[in] sName    The name of the cache, e.g., "bem".
+    *
+    * @return The cache folder, or an empty string if the disk caches are switched off.
+    */
+    static QString get_cache_dir(const QString& sName);
+
+    //=========================================================================================================
+    /**
+    * Removes the oldest files of a cache folder until a new file of iReserve bytes fits into the size limit of the
+    * folder. The limit is 2048 MB, it can be changed with the environment variable MNE_CPP_CACHE_MAX_MB.
+    *
+    * @param[in] sDir       The cache folder, see get_cache_dir.
+    * @param[in] iReserve   The size of the file to be added in bytes.
+    *
+    * @return True if the new file fits, false if it is larger than the limit.
+    */
+    static bool trim_cache_dir(const QString& sDir, qint64 iReserve);
+
+    //=========================================================================================================
+    /**
+    * Removes all files of a cache folder.
+    *
+    * @param[in] sDir       The cache folder, see get_cache_dir.
+    *
+    * @return True if all files were removed.
+    */
+    static bool clear_cache_dir(const QString& sDir);
 };
 
 //*************************************************************************************************************
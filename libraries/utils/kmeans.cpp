@@ -51,6 +51,7 @@
 #include <algorithm>
 #include <vector>
 #include <time.h>
+#include <limits>
 
 
 //*************************************************************************************************************
@@ -69,18 +70,65 @@
 using namespace UTILSLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+//Distance between two rows in single precision, Euclidean for "sqeuclidean" so that the triangle inequality holds
+static inline float point_dist(const float* x, const float* c, qint32 p, bool bCityblock)
+{
+    Map<const RowVectorXf> vx(x, p);
+    Map<const RowVectorXf> vc(c, p);
+
+    return bCityblock ? (vx - vc).cwiseAbs().sum() : (vx - vc).norm();
+}
+
+
+//*************************************************************************************************************
+
+//Closest of the k centroids C (one per row), ties are resolved in favor of centroid a
+static inline qint32 nearest_centroid(const float* x, const float* C, qint32 k, qint32 p, qint32 a, bool bCityblock, float& d1, float& d2)
+{
+    qint32 best = a;
+
+    d1 = point_dist(x, C + a*p, p, bCityblock);
+    d2 = std::numeric_limits<float>::max();
+
+    for(qint32 j = 0; j < k; ++j)
+    {
+        if(j == a)
+            continue;
+
+        float dj = point_dist(x, C + j*p, p, bCityblock);
+        if(dj < d1)
+        {
+            d2 = d1;
+            d1 = dj;
+            best = j;
+        }
+        else if(dj < d2)
+            d2 = dj;
+    }
+
+    return best;
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
-KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit)
+KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit, qint32 batchsize, bool bounded)
 : m_sDistance(distance)
 , m_sStart(start)
 , m_iReps(replicates)
 , m_sEmptyact(emptyact)
 , m_iMaxit(maxit)
 , m_bOnline(online)
+, m_iBatchSize(batchsize)
+, m_bBounded(bounded)
 , emptyErrCnt(0)
 , iter(0)
 , k(0)
@@ -102,6 +150,13 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
     if (kClusters < 1)
         return false;
 
+    if (m_sStart.compare("numeric") == 0 && (C.rows() != kClusters || C.cols() != X.cols()))
+    {
+        printf("Error: The numeric start needs %d initial centroids of dimension %d\n", kClusters, int(X.cols()));
+        return false;
+    }
+    MatrixXd Cstart = C;
+
     //Init random generator
     srand ( time(NULL) );
 
@@ -194,6 +249,14 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 //            C.block(1,0,1,p) = X.block(7, 0, 1, p);
 //            C.block(2,0,1,p) = X.block(17, 0, 1, p);
         }
+        else if (m_sStart.compare("plus") == 0)
+        {
+            C = plusplus(X);
+        }
+        else if (m_sStart.compare("numeric") == 0)
+        {
+            C = Cstart;
+        }
     //    else if (start.compare("cluster") == 0)
     //    {
     //        Xsubset = X(randsample(n,floor(.1*n)),:);
@@ -204,25 +267,37 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
     //        C = CC(:,:,rep);
     //    }
 
-        // Compute the distance from every point to each cluster centroid and the
-        // initial assignment of points to clusters
-        D = distfun(X, C);//, 0);
-        idx = VectorXi::Zero(D.rows());
-        d = VectorXd::Zero(D.rows());
+        // The bounded batch reassignments do their own initial assignment, the distances of
+        // the final clusters are computed below
+        bool bBounded = m_bBounded && (m_sDistance.compare("sqeuclidean") == 0 || m_sDistance.compare("cityblock") == 0);
 
-        for(qint32 i = 0; i < D.rows(); ++i)
-            d[i] = D.row(i).minCoeff(&idx[i]);
+        if (bBounded)
+        {
+            D = MatrixXd(n,k);
+            D.fill(std::numeric_limits<double>::quiet_NaN());
+        }
+        else
+        {
+            // Compute the distance from every point to each cluster centroid and the
+            // initial assignment of points to clusters
+            D = distfun(X, C);//, 0);
+            idx = VectorXi::Zero(D.rows());
+            d = VectorXd::Zero(D.rows());
 
-        m = VectorXi::Zero(k);
-        for(qint32 i = 0; i < k; ++i)
-            for (qint32 j = 0; j < idx.rows(); ++j)
-                if(idx[j] == i)
-                    ++ m[i];
+            for(qint32 i = 0; i < D.rows(); ++i)
+                d[i] = D.row(i).minCoeff(&idx[i]);
+
+            m = VectorXi::Zero(k);
+            for(qint32 i = 0; i < k; ++i)
+                for (qint32 j = 0; j < idx.rows(); ++j)
+                    if(idx[j] == i)
+                        ++ m[i];
+        }
 
         try // catch empty cluster errors and move on to next rep
         {
             // Begin phase one:  batch reassignments
-            bool converged = batchUpdate(X, C, idx);
+            bool converged = bBounded ? boundedUpdate(X, C, idx) : batchUpdate(X, C, idx);
 
             // Begin phase two:  single reassignments
             if (m_bOnline)
@@ -327,6 +402,225 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 }
 
 
+//*************************************************************************************************************
+
+MatrixXd KMeans::plusplus(const MatrixXd& X)
+{
+    MatrixXd C = MatrixXd::Zero(k,p);
+    C.row(0) = X.row(rand() % n);
+
+    MatrixXd Ci = C.row(0);
+    VectorXd minD = distfun(X, Ci);
+
+    for(qint32 i = 1; i < k; ++i)
+    {
+        // Draw the next centroid with a probability proportional to the distance to the closest one
+        double dSum = minD.sum();
+        qint32 iSel = rand() % n;
+
+        if(dSum > 0)
+        {
+            double r = dSum * ((double)rand() / ((double)RAND_MAX + 1.0));
+            for(iSel = 0; iSel < n - 1; ++iSel)
+            {
+                r -= minD[iSel];
+                if(r < 0)
+                    break;
+            }
+        }
+
+        C.row(i) = X.row(iSel);
+        Ci = C.row(i);
+        minD = minD.cwiseMin(distfun(X, Ci).col(0));
+    }
+
+    return C;
+}
+
+
+//*************************************************************************************************************
+
+bool KMeans::boundedUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
+{
+    bool bCityblock = m_sDistance.compare("cityblock") == 0;
+
+    RowMatrixXf Xf = X.cast<float>();
+    RowMatrixXf Cf = C.cast<float>();
+    RowMatrixXf Cold;
+
+    VectorXf u(n);      // upper bound of the distance to the own centroid
+    VectorXf l(n);      // lower bound of the distance to all other centroids
+    VectorXf delta(k);  // centroid shifts
+    VectorXf s(k);      // half the distance to the closest other centroid
+
+    qint32 i, j, a;
+
+    if (!bCityblock && m_iBatchSize > 0 && m_iBatchSize < n)
+        miniBatchUpdate(Xf, Cf);
+
+    // Initial assignment with exact bounds
+    idx = VectorXi::Zero(n);
+    for(i = 0; i < n; ++i)
+        idx[i] = nearest_centroid(Xf.data() + i*p, Cf.data(), k, p, 0, bCityblock, u[i], l[i]);
+
+    iter = 0;
+    bool converged = false;
+    while(true)
+    {
+        ++iter;
+
+        // Move the centroids to the center of their clusters
+        Cold = Cf;
+        fcentroids(Xf, idx, Cf);
+
+        if (m.minCoeff() == 0 && m_sEmptyact.compare("error") == 0)
+            break;
+
+        if (iter >= m_iMaxit)
+            break;
+
+        // Largest and second largest centroid shift
+        qint32 jmax = 0;
+        float dmax1 = 0, dmax2 = 0;
+        for(j = 0; j < k; ++j)
+        {
+            delta[j] = point_dist(Cold.data() + j*p, Cf.data() + j*p, p, bCityblock);
+            if(delta[j] > dmax1)
+            {
+                dmax2 = dmax1;
+                dmax1 = delta[j];
+                jmax = j;
+            }
+            else if(delta[j] > dmax2)
+                dmax2 = delta[j];
+        }
+
+        for(j = 0; j < k; ++j)
+        {
+            s[j] = std::numeric_limits<float>::max();
+            for(qint32 j2 = 0; j2 < k; ++j2)
+                if(j2 != j)
+                    s[j] = std::min(s[j], 0.5f * point_dist(Cf.data() + j*p, Cf.data() + j2*p, p, bCityblock));
+        }
+
+        // Correct the bounds, only points whose bounds overlap need the distances
+        qint32 nmoved = 0;
+        for(i = 0; i < n; ++i)
+        {
+            a = idx[i];
+            u[i] += delta[a];
+            l[i] -= (a == jmax) ? dmax2 : dmax1;
+
+            float z = std::max(l[i], s[a]);
+            if(u[i] <= z)
+                continue;
+
+            u[i] = point_dist(Xf.data() + i*p, Cf.data() + a*p, p, bCityblock);
+            if(u[i] <= z)
+                continue;
+
+            idx[i] = nearest_centroid(Xf.data() + i*p, Cf.data(), k, p, a, bCityblock, u[i], l[i]);
+            if(idx[i] != a)
+                ++nmoved;
+        }
+
+        if(nmoved == 0)
+        {
+            converged = true;
+            break;
+        }
+    }
+
+    C = Cf.cast<double>();
+
+    return converged;
+}
+
+
+//*************************************************************************************************************
+
+void KMeans::miniBatchUpdate(const RowMatrixXf& X, RowMatrixXf& C)
+{
+    VectorXi counts = VectorXi::Zero(k);
+    VectorXi batch(m_iBatchSize);
+    VectorXi nearest(m_iBatchSize);
+    float d1, d2;
+
+    for(qint32 it = 0; it < m_iMaxit; ++it)
+    {
+        // Assign the whole sample to the current centroids before any of them moves
+        for(qint32 b = 0; b < m_iBatchSize; ++b)
+        {
+            batch[b] = rand() % n;
+            nearest[b] = nearest_centroid(X.data() + batch[b]*p, C.data(), k, p, 0, false, d1, d2);
+        }
+
+        // Per-centroid learning rate 1/count
+        for(qint32 b = 0; b < m_iBatchSize; ++b)
+        {
+            qint32 j = nearest[b];
+            ++counts[j];
+            float eta = 1.0f / counts[j];
+            C.row(j) = (1.0f - eta) * C.row(j) + eta * X.row(batch[b]);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void KMeans::fcentroids(const RowMatrixXf& X, const VectorXi& idx, RowMatrixXf& C)
+{
+    qint32 i, j;
+
+    m = VectorXi::Zero(k);
+    for(i = 0; i < n; ++i)
+        ++m[idx[i]];
+
+    if(m_sDistance.compare("cityblock") == 0)
+    {
+        // Component-wise median, the mean of the two middle values for an even count as in gcentroids
+        std::vector< std::vector<qint32> > members(k);
+        for(i = 0; i < n; ++i)
+            members[idx[i]].push_back(i);
+
+        MatrixXf Xj;
+        for(j = 0; j < k; ++j)
+        {
+            if(m[j] == 0)
+                continue;
+
+            // Members of the cluster column-wise, each coordinate is contiguous
+            Xj.resize(m[j],p);
+            for(i = 0; i < m[j]; ++i)
+                Xj.row(i) = X.row(members[j][i]);
+
+            qint32 half = m[j] / 2;
+            for(qint32 c = 0; c < p; ++c)
+            {
+                float* values = Xj.col(c).data();
+
+                std::nth_element(values, values + half, values + m[j]);
+                if(m[j] % 2 == 0)
+                    C(j,c) = 0.5f * (values[half] + *std::max_element(values, values + half));
+                else
+                    C(j,c) = values[half];
+            }
+        }
+    }
+    else
+    {
+        RowMatrixXf sums = RowMatrixXf::Zero(k,p);
+        for(i = 0; i < n; ++i)
+            sums.row(idx[i]) += X.row(i);
+
+        for(j = 0; j < k; ++j)
+            if(m[j] > 0)
+                C.row(j) = sums.row(j) / float(m[j]);
+    }
+}
+
+
 //*************************************************************************************************************
 
 bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
@@ -626,7 +920,7 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
                 Del.col(i) = ((double)m[i] / ((double)m[i] + sgn.cast<double>().array()));
 
-                Del.col(i).array() *= (X - C.row(i).replicate(n,1)).array().pow(2).rowwise().sum().array();
+                Del.col(i).array() *= (X.rowwise() - C.row(i)).rowwise().squaredNorm().array();
             }
         }
         else if (m_sDistance.compare("cityblock") == 0)
@@ -636,26 +930,20 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                 qint32 i = changed[j];
                 if (m(i) % 2 == 0) // this will never catch singleton clusters
                 {
-                    MatrixXd ldist = Xmid1.row(i).replicate(n,1) - X;
-                    MatrixXd rdist = X - Xmid2.row(i).replicate(n,1);
                     VectorXd mbrs = VectorXd::Zero(idx.rows());
 
                     for(qint32 l = 0; l < idx.rows(); ++l)
                         if(idx[l] == i)
                             mbrs[l] = 1;
-                    MatrixXd sgn = ((-2*mbrs).array() + 1).replicate(1, p); // -1 for members, 1 for nonmembers
-                    rdist = sgn.array()*rdist.array(); ldist = sgn.array()*ldist.array();
+                    ArrayXd sgn = (-2*mbrs).array() + 1; // -1 for members, 1 for nonmembers
+                    ArrayXXd ldist = (-(X.rowwise() - Xmid1.row(i))).array().colwise() * sgn;
+                    ArrayXXd rdist = (X.rowwise() - Xmid2.row(i)).array().colwise() * sgn;
 
-                    for(qint32 l = 0; l < idx.rows(); ++l)
-                    {
-                        double sum = 0;
-                        for(qint32 h = 0; h < rdist.cols(); ++h)
-                            sum += rdist(l,h) > ldist(l,h) ? rdist(l,h) < 0 ? 0 : rdist(l,h) : ldist(l,h) < 0 ? 0 : ldist(l,h);
-                        Del(l,i) = sum;
-                    }
+                    // Sum of max(rdist, ldist, 0) over the coordinates
+                    Del.col(i) = rdist.max(ldist).max(0.0).rowwise().sum().matrix();
                 }
                 else
-                    Del.col(i) = ((X - C.row(i).replicate(n,1)).array().abs()).rowwise().sum();
+                    Del.col(i) = (X.rowwise() - C.row(i)).array().abs().rowwise().sum().matrix();
             }
         }
         else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
@@ -890,10 +1178,10 @@ MatrixXd KMeans::distfun(const MatrixXd& X, MatrixXd& C)//, qint32 iter)
     {
         for(qint32 i = 0; i < nclusts; ++i)
         {
-            D.col(i) = (X.col(0).array() - C(i,0)).pow(2);
+            D.col(i) = (X.col(0).array() - C(i,0)).square();
 
             for(qint32 j = 1; j < p; ++j)
-                D.col(i) = D.col(i).array() + (X.col(j).array() - C(i,j)).pow(2);
+                D.col(i) = D.col(i).array() + (X.col(j).array() - C(i,j)).square();
         }
     }
     else if (m_sDistance.compare("cityblock") == 0)
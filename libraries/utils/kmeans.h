@@ -90,7 +90,7 @@ public:
     typedef QSharedPointer<const KMeans> ConstSPtr; /**< Const shared pointer type for KMeans. */
 
     //distance {'sqeuclidean','cityblock','cosine','correlation','hamming'};
-    //startNames = {'uniform','sample','cluster'};
+    //startNames = {'uniform','sample','cluster','plus','numeric'};
     //emptyactNames = {'error','drop','singleton'};
 
     //=========================================================================================================
@@ -98,13 +98,18 @@ public:
     * Constructs a KMeans algorithm object.
     *
     * @param[in] distance   (optional) K-Means distance measure: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming"
-    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "cluster"
+    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "cluster", "plus" (k-means++),
+    *                       "numeric" (the centroids passed to calculate)
     * @param[in] replicates (optional) Number of K-Means replicates, which are generated. Best is returned.
     * @param[in] emptyact   (optional) What happens if a cluster wents empty: "error" (default), "drop", "singleton"
     * @param[in] online     (optional) If centroids should be updated during iterations: true (default), false
     * @param[in] maxit      (optional) maximal number of iterations per replicate; 100 by default
+    * @param[in] batchsize  (optional) "sqeuclidean" only: number of points per mini-batch step used to move the initial
+    *                       centroids before the batch reassignments; 0 (default) or at least the number of points disables it
+    * @param[in] bounded    (optional) "sqeuclidean" and "cityblock" only: if the batch reassignments should use the bounded
+    *                       single precision iterations: true (default), false for the exact double precision ones
     */
-    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100);
+    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100, qint32 batchsize = 0, bool bounded = true);
 
     //=========================================================================================================
     /**
@@ -113,7 +118,7 @@ public:
     * @param[in] X          Input data (rows = points; cols = p dimensional space)
     * @param[in] kClusters  Number of k clusters
     * @param[out] idx       The cluster indeces to which cluster the input points belong to
-    * @param[out] C         Cluster centroids k x p
+    * @param[in, out] C     Cluster centroids k x p; for the "numeric" start the initial centroids of all replicates
     * @param[out] sumD      Summation of the distances to the centroid within one cluster
     * @param[out] D         Cluster distances to the centroid
     */
@@ -121,6 +126,55 @@ public:
 
 
 private:
+    typedef Matrix<float, Dynamic, Dynamic, RowMajor> RowMatrixXf;   /**< Points and centroids in single precision, one per row. */
+
+    //=========================================================================================================
+    /**
+    * Chooses the initial centroids with k-means++: the first one is a random point, every following one is
+    * a point drawn with a probability proportional to its distance to the closest centroid chosen so far.
+    *
+    * @param[in] X  Input data (rows = points; cols = p dimensional space)
+    *
+    * @return Initial cluster centroids k x p
+    */
+    MatrixXd plusplus(const MatrixXd& X);
+
+    //=========================================================================================================
+    /**
+    * Batch reassignments for "sqeuclidean" and "cityblock", which replace batchUpdate for these distances.
+    * Points and centroids are stored in single precision. Each point keeps an upper bound of the distance to
+    * its own centroid and a lower bound of the distance to all others (Hamerly). The bounds are corrected by
+    * the centroid shifts after each update and most points skip the distance computations. The bounds use
+    * the Euclidean distance for "sqeuclidean", so the result equals the one without pruning.
+    *
+    * @param[in] X          Input data
+    * @param[in, out] C     Cluster centroids
+    * @param[out] idx       The cluster indeces to which cluster the input points belong to
+    *
+    * @return true if converged, false otherwise
+    */
+    bool boundedUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx);
+
+    //=========================================================================================================
+    /**
+    * Mini-batch steps (Sculley) which move the centroids towards random samples of the points.
+    *
+    * @param[in] X          Input data in single precision
+    * @param[in, out] C     Cluster centroids in single precision
+    */
+    void miniBatchUpdate(const RowMatrixXf& X, RowMatrixXf& C);
+
+    //=========================================================================================================
+    /**
+    * Centroids of the clusters, the mean for "sqeuclidean" and the component-wise median for "cityblock".
+    * Empty clusters keep their centroid.
+    *
+    * @param[in] X          Input data in single precision
+    * @param[in] idx        The cluster indeces to which cluster the input points belong to
+    * @param[in, out] C     Cluster centroids in single precision
+    */
+    void fcentroids(const RowMatrixXf& X, const VectorXi& idx, RowMatrixXf& C);
+
     //=========================================================================================================
     /**
     * Calculate point to cluster centroid distances.
@@ -188,6 +242,8 @@ private:
     QString m_sEmptyact;    /**< What should be done if a cluster wents empty: "error" (default), "drop", "singleton" */
     qint32 m_iMaxit;        /**< Maximal number of iterations per replicate */
     bool m_bOnline;         /**< If online update should be performed */
+    qint32 m_iBatchSize;    /**< Number of points per mini-batch step, 0 if no mini-batch steps should be performed */
+    bool m_bBounded;        /**< If the bounded batch reassignments should be used for "sqeuclidean" and "cityblock" */
 
     qint32 emptyErrCnt;     /**< Counts the occurence of empty errors */
 
@@ -239,6 +239,82 @@ RowVectorXcd Spectral::csdFromTaperedSpectra(const MatrixXcd &vecTapSpectrumSeed
 }
 
 
+//*************************************************************************************************************
+
+MatrixXcd Spectral::stackTaperedSpectra(const QVector<MatrixXcd> &vecTapSpectra,
+                                        const VectorXd &vecTapWeights)
+{
+    //Check inputs
+    if (vecTapSpectra.isEmpty() || vecTapSpectra.at(0).rows() != vecTapWeights.rows()) {
+        return MatrixXcd();
+    }
+
+    int iNTapers = vecTapWeights.rows();
+    int iNFreqs = vecTapSpectra.at(0).cols();
+
+    //Weights of seed and target are applied on both sides of the product, hence the square root
+    VectorXd vecWeights = vecTapWeights / sqrt(vecTapWeights.cwiseAbs2().sum());
+
+    MatrixXcd matStacked(vecTapSpectra.size(), iNFreqs * iNTapers);
+    for (int j = 0; j < vecTapSpectra.size(); ++j) {
+        for (int f = 0; f < iNFreqs; ++f) {
+            for (int t = 0; t < iNTapers; ++t) {
+                matStacked(j, f * iNTapers + t) = vecWeights(t) * vecTapSpectra.at(j)(t, f);
+            }
+        }
+    }
+
+    return matStacked;
+}
+
+
+//*************************************************************************************************************
+
+void Spectral::csdFromStackedSpectra(const MatrixXcd &matStackedSpectra,
+                                     int iNTapers,
+                                     int iFreq,
+                                     int iNfft,
+                                     MatrixXcd &matCsd,
+                                     double dSampFreq,
+                                     int iBlockSize)
+{
+    int iNRows = matStackedSpectra.rows();
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+
+    if (matCsd.rows() != iNRows || matCsd.cols() != iNRows) {
+        matCsd.resize(iNRows, iNRows);
+    }
+    if (iBlockSize < 1) {
+        iBlockSize = iNRows;
+    }
+
+    //multiply by 2 due to half spectrum
+    double dScale = 2.0;
+    if (iFreq == 0 || (iNfft % 2 == 0 && iFreq == iNFreqs - 1)) {
+        dScale = 1.0;
+    }
+
+    //Normalization
+    dScale /= dSampFreq;
+
+    MatrixXcd matSpectra = matStackedSpectra.middleCols(iFreq * iNTapers, iNTapers);
+
+    //Upper triangle block by block
+    for (int j = 0; j < iNRows; j += iBlockSize) {
+        int iNj = qMin(iBlockSize, iNRows - j);
+        for (int k = j; k < iNRows; k += iBlockSize) {
+            int iNk = qMin(iBlockSize, iNRows - k);
+            matCsd.block(j, k, iNj, iNk).noalias() = dScale * (matSpectra.middleRows(j, iNj) * matSpectra.middleRows(k, iNk).adjoint());
+        }
+    }
+
+    //The auto spectra are real
+    for (int j = 0; j < iNRows; ++j) {
+        matCsd(j, j) = std::complex<double>(matCsd(j, j).real(), 0.0);
+    }
+}
+
+
 //*************************************************************************************************************
 
 VectorXd Spectral::calculateFFTFreqs(int iNfft, double dSampFreq)
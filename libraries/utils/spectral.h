@@ -62,6 +62,7 @@
 
 #include <QString>
 #include <QPair>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -180,6 +181,43 @@ public:
                                                      int iNfft,
                                                      double dSampFreq=1.0);
 
+    //=========================================================================================================
+    /**
+    * Stacks the tapered spectra of all rows frequency-major for csdFromStackedSpectra. The columns
+    * f*nTapers ... (f+1)*nTapers-1 hold the weighted tapered spectra of all rows at frequency f, so the data of
+    * one frequency are contiguous. The taper weights and their normalization are applied here.
+    *
+    * @param[in] vecTapSpectra      tapered spectra of each row (tapers x frequencies)
+    * @param[in] vecTapWeights      taper weights
+    *
+    * @return stacked spectra (rows x frequencies*tapers)
+    */
+    static Eigen::MatrixXcd stackTaperedSpectra(const QVector<Eigen::MatrixXcd> &vecTapSpectra,
+                                                const Eigen::VectorXd &vecTapWeights);
+
+    //=========================================================================================================
+    /**
+    * Calculates the cross-spectral density between all rows at one frequency. Only the upper triangle (j <= k)
+    * is computed, the lower triangle follows from csd(k,j) = conj(csd(j,k)) and is left untouched. The rows are
+    * processed in blocks, each block pair is one matrix product. The values equal the ones of
+    * csdFromTaperedSpectra up to rounding.
+    *
+    * @param[in] matStackedSpectra  stacked spectra as returned by stackTaperedSpectra
+    * @param[in] iNTapers           number of tapers
+    * @param[in] iFreq              the frequency bin
+    * @param[in] iNfft              FFT length
+    * @param[out] matCsd            cross-spectral density (rows x rows), upper triangle
+    * @param[in] dSampFreq          sampling frequency of the input data
+    * @param[in] iBlockSize         number of rows per block
+    */
+    static void csdFromStackedSpectra(const Eigen::MatrixXcd &matStackedSpectra,
+                                      int iNTapers,
+                                      int iFreq,
+                                      int iNfft,
+                                      Eigen::MatrixXcd &matCsd,
+                                      double dSampFreq=1.0,
+                                      int iBlockSize=256);
+
     //=========================================================================================================
     /**
     * Calculates the FFT frequencies
@@ -71,6 +71,7 @@ SOURCES += \
     mp/fixdictmp.cpp \
     selectionio.cpp \
     filterTools/cosinefilter.cpp \
+    filterTools/iirfilter.cpp \
     filterTools/parksmcclellan.cpp \
     filterTools/filterdata.cpp \
     filterTools/filterio.cpp \
@@ -82,6 +83,7 @@ SOURCES += \
     generics/buffer.cpp \
     generics/circularbuffer.cpp \
     generics/circularmatrixbuffer.cpp \
+    generics/spscmatrixbuffer.cpp \
     generics/observerpattern.cpp \
     spectral.cpp
 
@@ -99,6 +101,7 @@ HEADERS += \
     selectionio.h \
     layoutmaker.h \
     filterTools/cosinefilter.h \
+    filterTools/iirfilter.h \
     filterTools/parksmcclellan.h \
     filterTools/filterdata.h \
     filterTools/filterio.h \
@@ -113,6 +116,7 @@ HEADERS += \
     generics/circularbuffer_old.h \
     generics/circularmatrixbuffer.h \
     generics/circularmultichannelbuffer_old.h \
+    generics/spscmatrixbuffer.h \
     generics/commandpattern.h \
     generics/observerpattern.h \
     generics/typename_old.h \
@@ -41,6 +41,18 @@
 
 #include <inverse/dipoleFit/dipole_fit_settings.h>
 #include <inverse/dipoleFit/dipole_fit.h>
+#include <inverse/dipoleFit/dipole_forward.h>
+#include <inverse/dipoleFit/guess_data.h>
+
+#include <stdlib.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Dense>
 
 
 //*************************************************************************************************************
@@ -57,6 +69,7 @@
 //=============================================================================================================
 
 using namespace INVERSELIB;
+using namespace Eigen;
 
 
 //=============================================================================================================
@@ -77,10 +90,16 @@ private slots:
     void initTestCase();
     void dipoleFitSimple();
     void dipoleFitAdvanced();
+    void dipoleFitParallel();
+    void guessScoringBatched();
+    void benchmarkGuessScoring();
     void cleanupTestCase();
 
 private:
     void compareFit();
+    GuessData* makeGuessGrid(int nch, float grid) const;
+    MatrixXf makeGuessData(const GuessData* guess, int ntime) const;
+    int scanBestGuess(const GuessData* guess, const float* B, float limit) const;
 
     double epsilon;
 
@@ -273,6 +292,245 @@ void TestDipoleFit::dipoleFitAdvanced()
 }
 
 
+//*************************************************************************************************************
+
+void TestDipoleFit::dipoleFitParallel()
+{
+    QFile testFile;
+
+    //*********************************************************************************************************
+    // Dipole Fit Settings
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Dipole Fit Settings >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    DipoleFitSettings settings;
+    testFile.setFileName(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif"); QVERIFY( testFile.exists() );
+    settings.measname = testFile.fileName();
+    settings.is_raw = false;
+    settings.setno = 1;
+    settings.include_meg = true;
+    settings.include_eeg = true;
+    settings.tmin = 32.0f/1000.0f;
+    settings.tmax = 148.0f/1000.0f;
+    settings.bmin = -100.0f/1000.0f;
+    settings.bmax = 0.0f/1000.0f;
+
+    settings.checkIntegrity();
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Dipole Fit Settings Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+
+
+    //*********************************************************************************************************
+    // Compute Dipole Fit serially and with several threads
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compute Dipole Fit Serial/Parallel >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    settings.nthreads = 1;
+    DipoleFit dipFitSerial(&settings);
+    m_refECDSet = dipFitSerial.calculateFit();
+
+    settings.nthreads = 4;
+    DipoleFit dipFitParallel(&settings);
+    m_ECDSet = dipFitParallel.calculateFit();
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compute Dipole Fit Serial/Parallel Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+
+
+    //*********************************************************************************************************
+    // Compare Fit - the result must not depend on the number of threads
+    //*********************************************************************************************************
+
+    QVERIFY( m_refECDSet.size() > 0 );
+    compareFit();
+
+    for (int i = 0; i < m_refECDSet.size(); ++i) {
+        QVERIFY( m_ECDSet[i].time == m_refECDSet[i].time );
+        QVERIFY( m_ECDSet[i].khi2 == m_refECDSet[i].khi2 );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestDipoleFit::guessScoringBatched()
+{
+    //*********************************************************************************************************
+    // The batched scoring must select the same guesses as the per-guess scan
+    //*********************************************************************************************************
+
+    GuessData* guess = makeGuessGrid(306,0.010f);
+    QVERIFY( guess->nguess > 0 );
+
+    MatrixXf matB = makeGuessData(guess,64);
+    VectorXi vecBest;
+    VectorXf vecGood;
+
+    QVERIFY( guess->find_best_guesses(matB,0.2f,vecBest,vecGood) );
+
+    for (int t = 0; t < matB.cols(); ++t)
+        QCOMPARE( vecBest[t], scanBestGuess(guess,matB.col(t).data(),0.2f) );
+
+    delete guess;
+}
+
+
+//*************************************************************************************************************
+
+void TestDipoleFit::benchmarkGuessScoring()
+{
+    //*********************************************************************************************************
+    // Score a 5 mm guess grid, one time point at a time and in blocks
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Benchmark Guess Scoring >>>>>>>>>>>>>>>>>>>>>>>>>
+");
+
+    const int ntime = 64;
+    GuessData* guess = makeGuessGrid(366,0.005f);
+    MatrixXf matB = makeGuessData(guess,ntime);
+    QVector<int> scanBest(ntime);
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int t = 0; t < ntime; ++t)
+        scanBest[t] = scanBestGuess(guess,matB.col(t).data(),0.2f);
+    qint64 iScanNsecs = timer.nsecsElapsed();
+
+    printf("%d guesses, %d channels, %d time points\n",guess->nguess,(int)guess->guess_uu.rows(),ntime);
+    printf("per-guess scan     : %8.3f ms per time point\n",iScanNsecs/1e6/ntime);
+
+    QList<int> blockSizes;
+    blockSizes << 1 << 16 << 64;
+
+    for (int b = 0; b < blockSizes.size(); ++b) {
+        int nblock = blockSizes[b];
+        VectorXi vecBest;
+        VectorXf vecGood;
+
+        timer.restart();
+        for (int t = 0; t < ntime; t += nblock) {
+            guess->find_best_guesses(matB.middleCols(t,qMin(nblock,ntime-t)),0.2f,vecBest,vecGood);
+            for (int k = 0; k < vecBest.size(); ++k)
+                QCOMPARE( vecBest[k], scanBest[t+k] );
+        }
+        qint64 iNsecs = timer.nsecsElapsed();
+
+        printf("batched, block %3d : %8.3f ms per time point (speedup %5.1f)\n",
+               nblock,iNsecs/1e6/ntime,(double)iScanNsecs/iNsecs);
+    }
+
+    delete guess;
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Benchmark Guess Scoring Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+GuessData* TestDipoleFit::makeGuessGrid(int nch, float grid) const
+{
+    //Guess locations on a grid inside a 80 mm sphere excluding the innermost 20 mm, like the default guess grid
+    QVector<Vector3f> rr;
+    const float rad = 0.080f;
+    const float exclude = 0.020f;
+    int n = (int)(rad/grid);
+
+    for (int i = -n; i <= n; ++i)
+        for (int j = -n; j <= n; ++j)
+            for (int k = -n; k <= n; ++k) {
+                Vector3f r(i*grid,j*grid,k*grid);
+                if (r.norm() <= rad && r.norm() >= exclude)
+                    rr.append(r);
+            }
+
+    //Orthonormal fields with a spread of singular values, a part of the guesses has a weak third component
+    srand(42);
+    GuessData* guess = new GuessData();
+    guess->nguess = rr.size();
+    guess->rr = (float **)malloc(guess->nguess*sizeof(float *));
+    guess->rr[0] = (float *)malloc(3*guess->nguess*sizeof(float));
+    guess->guess_fwd = (DipoleForward **)malloc(guess->nguess*sizeof(DipoleForward *));
+
+    for (int g = 0; g < guess->nguess; ++g) {
+        guess->rr[g] = guess->rr[0] + 3*g;
+        for (int c = 0; c < 3; ++c)
+            guess->rr[g][c] = rr[g][c];
+
+        MatrixXf matUU = HouseholderQR<MatrixXf>(MatrixXf::Random(nch,3)).householderQ()*MatrixXf::Identity(nch,3);
+
+        DipoleForward* fwd = new DipoleForward();
+        fwd->nch = nch;
+        fwd->uu = (float **)malloc(3*sizeof(float *));
+        fwd->uu[0] = (float *)malloc(3*nch*sizeof(float));
+        fwd->sing = (float *)malloc(3*sizeof(float));
+        for (int c = 0; c < 3; ++c) {
+            fwd->uu[c] = fwd->uu[0] + c*nch;
+            for (int p = 0; p < nch; ++p)
+                fwd->uu[c][p] = matUU(p,c);
+        }
+        fwd->sing[0] = 1.0f;
+        fwd->sing[1] = 0.5f + 0.5f*rand()/RAND_MAX;
+        fwd->sing[2] = 0.4f*rand()/RAND_MAX;
+        guess->guess_fwd[g] = fwd;
+    }
+    guess->compute_guess_matrix();
+
+    return guess;
+}
+
+
+//*************************************************************************************************************
+
+MatrixXf TestDipoleFit::makeGuessData(const GuessData* guess, int ntime) const
+{
+    //Field of a random guess plus noise
+    int nch = guess->guess_uu.rows();
+    MatrixXf matB = 0.1f*MatrixXf::Random(nch,ntime);
+
+    for (int t = 0; t < ntime; ++t)
+        matB.col(t) += guess->guess_uu.middleCols(3*(rand() % guess->nguess),3)*Vector3f::Random();
+
+    return matB;
+}
+
+
+//*************************************************************************************************************
+
+int TestDipoleFit::scanBestGuess(const GuessData* guess, const float* B, float limit) const
+{
+    //The original per-guess scan of find_best_guess (fit_dipoles.c)
+    int nch = guess->guess_uu.rows();
+    int best = -1;
+    float good = 0.0;
+    float B2f = 0.0;
+
+    for (int p = 0; p < nch; ++p)
+        B2f = B2f + B[p]*B[p];
+    double B2 = B2f;
+
+    for (int k = 0; k < guess->nguess; ++k) {
+        DipoleForward* fwd = guess->guess_fwd[k];
+        int ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
+        double Bm2 = 0.0;
+        for (int c = 0; c < ncomp; ++c) {
+            float dot = 0.0;
+            for (int p = 0; p < nch; ++p)
+                dot = dot + fwd->uu[c][p]*B[p];
+            double one = dot;
+            Bm2 = Bm2 + one*one;
+        }
+        double this_good = 1.0 - (B2 - Bm2)/B2;
+        if (this_good > good) {
+            best = k;
+            good = this_good;
+        }
+    }
+    return best;
+}
+
+
 //*************************************************************************************************************
 
 void TestDipoleFit::compareFit()
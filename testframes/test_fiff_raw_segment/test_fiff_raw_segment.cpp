@@ -0,0 +1,315 @@
+//=============================================================================================================
+/**
+* @file     test_fiff_raw_segment.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test and random access benchmark for FiffRawData::read_raw_segment
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+
+#include <algorithm>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestFiffRawSegment
+*
+* @brief The TestFiffRawSegment class verifies cached, memory mapped and batched raw segment reading and benchmarks random access
+*
+*/
+class TestFiffRawSegment: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFiffRawSegment();
+
+private slots:
+    void initTestCase();
+    void compareCachedReads();
+    void compareBatchedReads();
+    void benchmarkRandomWindows();
+    void cleanupTestCase();
+
+private:
+    QVector<fiff_int_t> randomWindowStarts(int iNumWindows, fiff_int_t iWindowSize) const;
+    QVector<double> readWindows(const FiffRawData& raw, const QVector<fiff_int_t>& vecStarts, fiff_int_t iWindowSize) const;
+    void printPercentiles(const QString& sName, QVector<double> vecLatencies) const;
+
+    double epsilon;
+    QString m_sFileName;
+    int m_iNumWindows;
+};
+
+
+//*************************************************************************************************************
+
+TestFiffRawSegment::TestFiffRawSegment()
+: epsilon(0.000001)
+, m_iNumWindows(10000)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawSegment::initTestCase()
+{
+    //Prefer the long recording, fall back to the short one
+    m_sFileName = "./mne-cpp-test-data/MEG/sample/sample_audvis_raw.fif";
+    if(!QFile::exists(m_sFileName)) {
+        m_sFileName = "./mne-cpp-test-data/MEG/sample/sample_audvis_raw_short.fif";
+    }
+
+    QVERIFY(QFile::exists(m_sFileName));
+
+    qsrand(42);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawSegment::compareCachedReads()
+{
+    QFile t_fileMapped(m_sFileName);
+    QFile t_fileCached(m_sFileName);
+    QFile t_fileUncached(m_sFileName);
+    FiffRawData rawMapped(t_fileMapped);
+    FiffRawData rawCached(t_fileCached);
+    FiffRawData rawUncached(t_fileUncached);
+    rawCached.setMemoryMapped(false);
+    rawUncached.setMemoryMapped(false);
+    rawUncached.bufferCache()->setMaxSize(0);
+
+    QVERIFY(rawMapped.isMemoryMapped());
+
+    fiff_int_t iWindowSize = (fiff_int_t)rawCached.info.sfreq;
+    QVector<fiff_int_t> vecStarts = randomWindowStarts(200, iWindowSize);
+
+    RowVectorXi sel(3);
+    sel << 0, 10, rawCached.info.nchan - 1;
+
+    MatrixXd dataMapped, dataCached, dataUncached, times;
+
+    for(int i = 0; i < vecStarts.size(); ++i) {
+        const RowVectorXi& selection = (i % 2 == 0) ? defaultRowVectorXi : sel;
+
+        QVERIFY(rawMapped.read_raw_segment(dataMapped, times, vecStarts[i], vecStarts[i] + iWindowSize - 1, selection));
+        QVERIFY(rawCached.read_raw_segment(dataCached, times, vecStarts[i], vecStarts[i] + iWindowSize - 1, selection));
+        QVERIFY(rawUncached.read_raw_segment(dataUncached, times, vecStarts[i], vecStarts[i] + iWindowSize - 1, selection));
+
+        QCOMPARE(dataCached.rows(), dataUncached.rows());
+        QCOMPARE(dataCached.cols(), dataUncached.cols());
+        QCOMPARE(dataMapped.rows(), dataUncached.rows());
+        QCOMPARE(dataMapped.cols(), dataUncached.cols());
+        QVERIFY((dataCached - dataUncached).cwiseAbs().maxCoeff() < epsilon);
+        QVERIFY((dataMapped - dataUncached).cwiseAbs().maxCoeff() < epsilon);
+    }
+
+    QVERIFY(rawCached.bufferCache()->hits() > 0);
+    QCOMPARE(rawUncached.bufferCache()->hits(), (qint64)0);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawSegment::compareBatchedReads()
+{
+    QFile t_fileIn(m_sFileName);
+    FiffRawData raw(t_fileIn);
+
+    //Overlapping windows in random order, the last one reaching beyond the end of the recording
+    fiff_int_t iWindowSize = (fiff_int_t)raw.info.sfreq;
+    QVector<fiff_int_t> vecStarts = randomWindowStarts(100, iWindowSize);
+    vecStarts.append(raw.last_samp - iWindowSize / 2);
+
+    VectorXi vecFrom(vecStarts.size()), vecTo(vecStarts.size());
+    for(int i = 0; i < vecStarts.size(); ++i) {
+        vecFrom[i] = vecStarts[i];
+        vecTo[i] = vecStarts[i] + iWindowSize - 1;
+    }
+
+    RowVectorXi sel(3);
+    sel << 0, 10, raw.info.nchan - 1;
+
+    for(int iRun = 0; iRun < 4; ++iRun) {
+        const RowVectorXi& selection = (iRun % 2 == 0) ? defaultRowVectorXi : sel;
+        raw.setMemoryMapped(iRun < 2);
+
+        QList<MatrixXd> lBatched, lThreaded;
+        QVERIFY(raw.read_raw_segments(lBatched, vecFrom, vecTo, selection));
+        QVERIFY(raw.read_raw_segments(lThreaded, vecFrom, vecTo, selection, true));
+        QCOMPARE(lBatched.size(), vecStarts.size());
+        QCOMPARE(lThreaded.size(), vecStarts.size());
+
+        MatrixXd data, times;
+        for(int i = 0; i < vecStarts.size(); ++i) {
+            QVERIFY(raw.read_raw_segment(data, times, vecFrom[i], vecTo[i], selection));
+
+            QCOMPARE(lBatched[i].rows(), data.rows());
+            QCOMPARE(lBatched[i].cols(), data.cols());
+            QVERIFY((lBatched[i] - data).cwiseAbs().maxCoeff() < epsilon);
+            QVERIFY((lThreaded[i] - data).cwiseAbs().maxCoeff() < epsilon);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawSegment::benchmarkRandomWindows()
+{
+    QFile t_fileIn(m_sFileName);
+    FiffRawData raw(t_fileIn);
+
+    fiff_int_t iWindowSize = (fiff_int_t)raw.info.sfreq;
+    QVector<fiff_int_t> vecStarts = randomWindowStarts(m_iNumWindows, iWindowSize);
+
+    printf("\n>>>>>>>>>>>>>>>>>>>>>>>>> Benchmark: %d random 1 s windows of %s >>>>>>>>>>>>>>>>>>>>>>>>>\n",
+           m_iNumWindows, m_sFileName.toUtf8().constData());
+
+    //Memory mapped: samples are converted straight from the mapped file
+    QVector<double> vecMapped = readWindows(raw, vecStarts, iWindowSize);
+
+    //Uncached: every window reads and decodes the tags of all overlapping buffers
+    raw.setMemoryMapped(false);
+    raw.bufferCache()->setMaxSize(0);
+    QVector<double> vecUncached = readWindows(raw, vecStarts, iWindowSize);
+
+    //Cached: decoded buffers are reused between windows
+    raw.bufferCache()->clear();
+    raw.bufferCache()->setMaxSize(64);
+    QVector<double> vecCached = readWindows(raw, vecStarts, iWindowSize);
+
+    printPercentiles("Uncached", vecUncached);
+    printPercentiles("Cached", vecCached);
+    printPercentiles("Mapped", vecMapped);
+    printf("Cache hits: %lld, misses: %lld\n", raw.bufferCache()->hits(), raw.bufferCache()->misses());
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Benchmark Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawSegment::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+QVector<fiff_int_t> TestFiffRawSegment::randomWindowStarts(int iNumWindows, fiff_int_t iWindowSize) const
+{
+    QFile t_fileIn(m_sFileName);
+    FiffRawData raw(t_fileIn);
+
+    fiff_int_t iRange = raw.last_samp - raw.first_samp - iWindowSize + 1;
+
+    QVector<fiff_int_t> vecStarts(iNumWindows);
+    for(int i = 0; i < iNumWindows; ++i) {
+        vecStarts[i] = raw.first_samp + (iRange > 0 ? qrand() % iRange : 0);
+    }
+
+    return vecStarts;
+}
+
+
+//*************************************************************************************************************
+
+QVector<double> TestFiffRawSegment::readWindows(const FiffRawData& raw,
+                                                const QVector<fiff_int_t>& vecStarts,
+                                                fiff_int_t iWindowSize) const
+{
+    QVector<double> vecLatencies(vecStarts.size());
+    MatrixXd data, times;
+    QElapsedTimer timer;
+
+    for(int i = 0; i < vecStarts.size(); ++i) {
+        timer.start();
+        raw.read_raw_segment(data, times, vecStarts[i], vecStarts[i] + iWindowSize - 1);
+        vecLatencies[i] = timer.nsecsElapsed() / 1000000.0;
+    }
+
+    return vecLatencies;
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawSegment::printPercentiles(const QString& sName, QVector<double> vecLatencies) const
+{
+    if(vecLatencies.isEmpty()) {
+        return;
+    }
+
+    std::sort(vecLatencies.begin(), vecLatencies.end());
+
+    int iLast = vecLatencies.size() - 1;
+
+    printf("%s latency [ms]: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+           sName.toUtf8().constData(),
+           vecLatencies[iLast * 50 / 100],
+           vecLatencies[iLast * 90 / 100],
+           vecLatencies[iLast * 99 / 100],
+           vecLatencies[iLast]);
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestFiffRawSegment)
+#include "test_fiff_raw_segment.moc"
@@ -0,0 +1,230 @@
+//=============================================================================================================
+/**
+* @file     test_fiff_raw_writer.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the asynchronous raw writer FiffRawWriter
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestFiffRawWriter
+*
+* @brief The TestFiffRawWriter class verifies that the asynchronous raw writer produces the same data as the
+*        synchronous one
+*
+*/
+class TestFiffRawWriter: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFiffRawWriter();
+
+private slots:
+    void initTestCase();
+    void compareFloatWrite();
+    void compareDau16Write();
+    void cleanupTestCase();
+
+private:
+    bool writeAsync(const QString& sFileName, bool bPackDau16, FiffRawWriterStats& stats) const;
+    void compareWithInput(const QString& sFileName, double dEpsilon) const;
+
+    double epsilon;
+    QString m_sFileIn;
+    QString m_sFileFloat;
+    QString m_sFileDau16;
+    fiff_int_t m_iQuantum;
+    MatrixXd m_matInData;
+};
+
+
+//*************************************************************************************************************
+
+TestFiffRawWriter::TestFiffRawWriter()
+: epsilon(0.000001)
+, m_iQuantum(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawWriter::initTestCase()
+{
+    m_sFileIn = "./mne-cpp-test-data/MEG/sample/sample_audvis_raw_short.fif";
+    m_sFileFloat = "./mne-cpp-test-data/MEG/sample/sample_audvis_raw_short_test_raw_writer_float_out.fif";
+    m_sFileDau16 = "./mne-cpp-test-data/MEG/sample/sample_audvis_raw_short_test_raw_writer_dau16_out.fif";
+
+    QVERIFY(QFile::exists(m_sFileIn));
+
+    QFile t_fileIn(m_sFileIn);
+    FiffRawData raw(t_fileIn);
+
+    MatrixXd times;
+    QVERIFY(raw.read_raw_segment(m_matInData, times, raw.first_samp, raw.last_samp));
+
+    m_iQuantum = ceil(0.1*raw.info.sfreq);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawWriter::compareFloatWrite()
+{
+    FiffRawWriterStats stats;
+    QVERIFY(writeAsync(m_sFileFloat, false, stats));
+
+    QCOMPARE(stats.iBuffersWritten, stats.iBuffersQueued);
+    QCOMPARE(stats.iBytesWritten, (qint64)m_matInData.size() * 4);
+    QVERIFY(stats.iMaxQueued <= 2);
+
+    printf("Float: %lld buffers, %lld stalls, %.3f ms max stall\n",
+           stats.iBuffersWritten, stats.iStalls, stats.iMaxStallNsecs / 1000000.0);
+
+    compareWithInput(m_sFileFloat, epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawWriter::compareDau16Write()
+{
+    FiffRawWriterStats stats;
+    QVERIFY(writeAsync(m_sFileDau16, true, stats));
+
+    QCOMPARE(stats.iBuffersWritten, stats.iBuffersQueued);
+    QCOMPARE(stats.iBytesWritten, (qint64)m_matInData.size() * 2);
+
+    printf("DAU16: %lld buffers, %lld stalls, %lld clipped samples\n",
+           stats.iBuffersWritten, stats.iStalls, stats.iClippedSamples);
+
+    //The input was stored as 16-bit integers, hence it survives the packing without clipping
+    QCOMPARE(stats.iClippedSamples, 0LL);
+    compareWithInput(m_sFileDau16, epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawWriter::cleanupTestCase()
+{
+    QFile::remove(m_sFileFloat);
+    QFile::remove(m_sFileDau16);
+}
+
+
+//*************************************************************************************************************
+
+bool TestFiffRawWriter::writeAsync(const QString& sFileName, bool bPackDau16, FiffRawWriterStats& stats) const
+{
+    QFile t_fileIn(m_sFileIn);
+    FiffRawData raw(t_fileIn);
+
+    QFile t_fileOut(sFileName);
+    RowVectorXd cals;
+    FiffStream::SPtr outfid = FiffStream::start_writing_raw(t_fileOut, raw.info, cals);
+    if(!outfid) {
+        return false;
+    }
+
+    fiff_int_t first = raw.first_samp;
+    outfid->write_int(FIFF_FIRST_SAMPLE, &first);
+
+    FiffRawWriter writer(outfid, cals, 2, bPackDau16);
+
+    for(qint32 col = 0; col < m_matInData.cols(); col += m_iQuantum) {
+        qint32 ncols = qMin(m_iQuantum, (qint32)m_matInData.cols() - col);
+        if(!writer.write_raw_buffer(m_matInData.block(0, col, m_matInData.rows(), ncols))) {
+            return false;
+        }
+    }
+
+    writer.finish_writing_raw();
+    stats = writer.stats();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawWriter::compareWithInput(const QString& sFileName, double dEpsilon) const
+{
+    QFile t_fileOut(sFileName);
+    FiffRawData raw(t_fileOut);
+
+    MatrixXd data, times;
+    QVERIFY(raw.read_raw_segment(data, times, raw.first_samp, raw.last_samp));
+
+    QCOMPARE(data.rows(), m_matInData.rows());
+    QCOMPARE(data.cols(), m_matInData.cols());
+
+    //Compare relative to the channel magnitudes, MEG and EEG differ by orders of magnitude
+    for(qint32 r = 0; r < data.rows(); ++r) {
+        double dScale = qMax(m_matInData.row(r).cwiseAbs().maxCoeff(), 1e-30);
+        QVERIFY((data.row(r) - m_matInData.row(r)).cwiseAbs().maxCoeff() / dScale < dEpsilon);
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestFiffRawWriter)
+#include "test_fiff_raw_writer.moc"
@@ -41,7 +41,22 @@
 
 #include <fwd/computeFwd/compute_fwd_settings.h>
 #include <fwd/computeFwd/compute_fwd.h>
+#include <fwd/fwd_eeg_sphere_model.h>
+#include <fwd/fwd_bem_model.h>
+#include <fwd/fwd_coil_set.h>
+#include <fwd/fwd_comp_data.h>
 #include <mne/mne.h>
+#include <mne/c/mne_ctf_comp_data_set.h>
+#include <mne/c/mne_ctf_comp_data.h>
+#include <mne/c/mne_named_matrix.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Dense>
 
 
 //*************************************************************************************************************
@@ -50,6 +65,8 @@
 //=============================================================================================================
 
 #include <QtTest>
+#include <QElapsedTimer>
+#include <QThreadPool>
 
 
 //*************************************************************************************************************
@@ -59,6 +76,7 @@
 
 using namespace FWDLIB;
 using namespace MNELIB;
+using namespace Eigen;
 
 
 //=============================================================================================================
@@ -78,12 +96,24 @@ public:
 private slots:
     void initTestCase();
     void computeForward();
+    void benchmarkComputeForwardScaling();
+    void compareEegSpherePotTable();
+    void compareLuInvert();
+    void compareBemSolutionCache();
+    void compareSphereFieldBatch();
+    void compareEegSpherePotBatch();
+    void compareCompFieldBatch();
     void cleanupTestCase();
 
 private:
+    void setupSettings(ComputeFwdSettings& settings);
     void compareForward();
+    FwdCoilSet* createMegCoils(int ncoil, float rad, const QString& sPrefix);
+    FwdCoilSet* createEegEls(int neeg, float rad);
+    void compareBatch(fwdFieldFunc field, fwdBatchFieldFunc field_batch, FwdCoilSet* coils, void* client, float rad);
 
     double epsilon;
+    QString m_sScalingFwdName;
 
 };
 
@@ -92,6 +122,7 @@ private:
 
 TestForwardSolution::TestForwardSolution()
 : epsilon(0.000001)
+, m_sScalingFwdName(QDir::currentPath()+"./mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd-scaling.fif")
 {
 }
 
@@ -100,7 +131,8 @@ TestForwardSolution::TestForwardSolution()
 
 void TestForwardSolution::initTestCase()
 {
-
+    //The BEM solution has to be computed in every run, not loaded from the disk cache
+    qputenv("MNE_CPP_CACHE", "0");
 }
 
 
@@ -114,23 +146,8 @@ void TestForwardSolution::computeForward()
 
     printf(">>>>>>>>>>>>>>>>>>>>>>>>> Forward Solution Settings >>>>>>>>>>>>>>>>>>>>>>>>>\n");
 
-    //Following is equivalent to: --meg --accurate --src ./MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif
-    // --meas ./MNE-sample-data/MEG/sample/sample_audvis_raw.fif
-    // --mri ./MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif
-    // --bem ./MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif
-    // --mindist 5 --fwd ./MNE-sample-data/Result/sample_audvis-meg-oct-6-fwd.fif
     ComputeFwdSettings settings;
-
-    settings.include_meg = true;
-    settings.accurate = true;
-    settings.srcname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif";
-    settings.measname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/MEG/sample/sample_audvis_raw.fif";
-    settings.mriname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif";
-    settings.mri_head_ident = false;
-    settings.transname.clear();
-    settings.bemname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif";
-    settings.mindist = 5.0f/1000.0f;
-    settings.solname = QDir::currentPath()+"./mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd.fif";
+    setupSettings(settings);
 
     settings.checkIntegrity();
 
@@ -166,6 +183,391 @@ void TestForwardSolution::computeForward()
 }
 
 
+//*************************************************************************************************************
+
+void TestForwardSolution::benchmarkComputeForwardScaling()
+{
+    //*********************************************************************************************************
+    // Compute the forward solution with an increasing number of threads
+    //*********************************************************************************************************
+
+    //The forward solution is computed once per thread count, which is too slow for the regular test run
+    if(qgetenv("MNE_CPP_BENCHMARK").isEmpty()) {
+        QSKIP("Set MNE_CPP_BENCHMARK to run the forward solution scaling benchmark");
+    }
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Forward Solution Scaling >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    ComputeFwdSettings settings;
+    setupSettings(settings);
+    settings.solname = m_sScalingFwdName;
+    settings.checkIntegrity();
+
+    //Powers of two up to all cores
+    QList<int> lThreads;
+    for(int iThreads = 1; iThreads < QThread::idealThreadCount(); iThreads *= 2) {
+        lThreads << iThreads;
+    }
+    lThreads << QThread::idealThreadCount();
+
+    int iOrigThreads = QThreadPool::globalInstance()->maxThreadCount();
+    qint64 iSerial = 0;
+    MatrixXd matSerialSol;
+    double dMaxError = 0.0;
+
+    QElapsedTimer timer;
+
+    for(int i = 0; i < lThreads.size(); ++i) {
+        int iThreads = lThreads.at(i);
+        QThreadPool::globalInstance()->setMaxThreadCount(iThreads);
+
+        //A solution left by an earlier run must not be mistaken for the one of this run
+        QFile::remove(settings.solname);
+
+        ComputeFwd cmpFwd(&settings);
+
+        timer.start();
+        cmpFwd.calculateFwd();
+        qint64 iElapsed = timer.elapsed();
+
+        //Every thread count has to give the solution of the serial run
+        QFile t_fileForwardSolution(settings.solname);
+        MNEForwardSolution t_Fwd(t_fileForwardSolution);
+        MatrixXd matSol = t_Fwd.isEmpty() ? MatrixXd() : t_Fwd.sol->data;
+
+        if(iThreads == 1) {
+            iSerial = iElapsed;
+            matSerialSol = matSol;
+        }
+
+        double dError = 1.0;
+        if(matSol.size() > 0 && matSol.rows() == matSerialSol.rows() && matSol.cols() == matSerialSol.cols()) {
+            dError = (matSol - matSerialSol).cwiseAbs().maxCoeff() / matSerialSol.cwiseAbs().maxCoeff();
+        }
+        dMaxError = qMax(dMaxError, dError);
+
+        printf("calculateFwd with %2d threads: %8lld ms, speedup %5.2f, relative deviation %g\n", iThreads, iElapsed, double(iSerial) / qMax(iElapsed, qint64(1)), dError);
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(iOrigThreads);
+
+    QVERIFY(dMaxError < epsilon);
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Forward Solution Scaling Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareEegSpherePotTable()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare EEG Sphere Model Table >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    const int nlayer = 4;
+    const int neeg = 60;
+    const int ndip = 2000;
+    const float rad = 0.09f;
+
+    VectorXf rads(nlayer), sigmas(nlayer);
+    rads << 0.90f,0.92f,0.97f,1.0f;
+    sigmas << 0.33f,1.0f,0.4e-2f,0.33f;
+
+    FwdEegSphereModel* model = FwdEegSphereModel::fwd_create_eeg_sphere_model("Default",nlayer,rads,sigmas);
+    QVERIFY(model->fwd_setup_eeg_sphere_model(rad,false,0));
+    model->fwd_eeg_setup_multi_sphere_coeff();
+
+    FwdEegSphereModel* model_table = new FwdEegSphereModel(*model);
+    QVERIFY(model_table->fwd_eeg_setup_pot_table());
+
+    //Electrodes on the scalp, dipoles anywhere inside the innermost sphere
+    qsrand(42);
+    FwdCoilSet* els = createEegEls(neeg,rad);
+    QVector<float*> el(neeg);
+    for (int k = 0; k < neeg; ++k)
+        el[k] = els->coils[k]->rmag[0];
+    MatrixXf rd(3,ndip), Q(3,ndip);
+    QVector<float*> rd_cols(ndip), Q_cols(ndip);
+    for (int j = 0; j < ndip; ++j) {
+        float r = 0.995f*rads[0]*rad*float(qrand())/RAND_MAX;
+        rd.col(j) = r*Vector3f::Random().normalized();
+        Q.col(j) = Vector3f::Random();
+        rd_cols[j] = rd.col(j).data();
+        Q_cols[j] = Q.col(j).data();
+    }
+
+    MatrixXf V(neeg,ndip), V_table(neeg,ndip);
+    Matrix<float,Dynamic,Dynamic,RowMajor> V_batch(ndip,neeg);
+    QVector<float*> V_batch_rows(ndip);
+    for (int j = 0; j < ndip; ++j)
+        V_batch_rows[j] = V_batch.data() + j*neeg;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int j = 0; j < ndip; ++j)
+        FwdEegSphereModel::fwd_eeg_multi_spherepot(rd.col(j).data(),Q.col(j).data(),el.data(),neeg,V.col(j).data(),model);
+    qint64 iSeries = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int j = 0; j < ndip; ++j)
+        FwdEegSphereModel::fwd_eeg_multi_spherepot(rd.col(j).data(),Q.col(j).data(),el.data(),neeg,V_table.col(j).data(),model_table);
+    qint64 iTable = timer.nsecsElapsed();
+
+    //The batch path looks the potentials up in the same table
+    timer.restart();
+    QCOMPARE(FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1_batch(rd_cols.data(),Q_cols.data(),ndip,els,V_batch_rows.data(),model_table), 0);
+    qint64 iBatch = timer.nsecsElapsed();
+
+    printf("Series %.1f ms, table %.1f ms (speedup %.1f), batch table %.1f ms (speedup %.1f)\n",
+           1e-6*iSeries,1e-6*iTable,double(iSeries)/iTable,1e-6*iBatch,double(iSeries)/iBatch);
+
+    //Compare each topography relative to its largest value
+    for (int j = 0; j < ndip; ++j) {
+        float fMax = V.col(j).cwiseAbs().maxCoeff();
+        QVERIFY((V_table.col(j) - V.col(j)).cwiseAbs().maxCoeff() <= 1e-5f*fMax);
+        QVERIFY((V_batch.row(j).transpose() - V.col(j)).cwiseAbs().maxCoeff() <= 1e-5f*fMax);
+    }
+
+    delete els;
+    delete model_table;
+    delete model;
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare EEG Sphere Model Table Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareLuInvert()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare LU Inversion >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    //A single block, and uneven blocks which are solved in parallel
+    QList<int> lDims;
+    lDims << 7 << 517;
+
+    srand(42);
+
+    for (int i = 0; i < lDims.size(); ++i) {
+        int dim = lDims.at(i);
+
+        MatrixXf mat = MatrixXf::Random(dim,dim) + 10.0f*MatrixXf::Identity(dim,dim);
+        MatrixXf inv_ref = mat.cast<double>().inverse().cast<float>();
+
+        //Inverted in place, the rows are contiguous as with mne_cmatrix
+        Matrix<float,Dynamic,Dynamic,RowMajor> mat_rows = mat;
+        QVector<float*> rows(dim);
+        for (int k = 0; k < dim; ++k)
+            rows[k] = mat_rows.data() + k*dim;
+
+        QVERIFY(FwdBemModel::fwd_bem_lu_invert(rows.data(),dim) == rows.data());
+
+        float fError = (MatrixXf(mat_rows) - inv_ref).cwiseAbs().maxCoeff() / inv_ref.cwiseAbs().maxCoeff();
+        printf("dim %d: relative deviation from Eigen::inverse %g\n",dim,fError);
+        QVERIFY(fError < 1e-4f);
+    }
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare LU Inversion Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareBemSolutionCache()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare BEM Solution Cache >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    //The cache of this test lives in the test location of QStandardPaths, not in the user's cache
+    QStandardPaths::setTestModeEnabled(true);
+    qputenv("MNE_CPP_CACHE", "1");
+
+    QString sBemName = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif";
+    FwdBemModel* model = FwdBemModel::fwd_bem_load_homog_surface(sBemName);
+    QVERIFY(model != NULL);
+
+    QString sCacheName = FwdBemModel::fwd_bem_solution_cache_name(model,FWD_BEM_LINEAR_COLL);
+    QVERIFY(!sCacheName.isEmpty());
+    QFile::remove(sCacheName);
+
+    //Computed and stored by the first call, the BEM file itself holds no solution
+    QCOMPARE(FwdBemModel::fwd_bem_load_recompute_solution(sBemName,FWD_BEM_UNKNOWN,0,model), 0);
+    QVERIFY(QFile::exists(sCacheName));
+
+    int nsol = model->nsol;
+    Matrix<float,Dynamic,Dynamic,RowMajor> solution(nsol,nsol);
+    for (int k = 0; k < nsol; ++k)
+        memcpy(solution.data() + k*nsol,model->solution[k],nsol*sizeof(float));
+
+    //The stored solution is reloaded bit by bit
+    QCOMPARE(FwdBemModel::fwd_bem_load_cached_solution(sCacheName,FWD_BEM_LINEAR_COLL,model), 0);
+    QCOMPARE(model->nsol, nsol);
+    for (int k = 0; k < nsol; ++k)
+        QVERIFY(memcmp(solution.data() + k*nsol,model->solution[k],nsol*sizeof(float)) == 0);
+
+    //The key depends on the conductivity and on the IP approach limit
+    float fSigma = model->sigma[0];
+    model->sigma[0] = 2.0f*fSigma;
+    QVERIFY(FwdBemModel::fwd_bem_solution_cache_name(model,FWD_BEM_LINEAR_COLL) != sCacheName);
+    model->sigma[0] = fSigma;
+
+    float fIpApproachLimit = model->ip_approach_limit;
+    model->ip_approach_limit = 2.0f*fIpApproachLimit + 0.1f;
+    QVERIFY(FwdBemModel::fwd_bem_solution_cache_name(model,FWD_BEM_LINEAR_COLL) != sCacheName);
+    model->ip_approach_limit = fIpApproachLimit;
+
+    QCOMPARE(FwdBemModel::fwd_bem_solution_cache_name(model,FWD_BEM_LINEAR_COLL), sCacheName);
+
+    //A scaled solution in the cache is found by the lookup
+    for (int k = 0; k < nsol; ++k)
+        for (int j = 0; j < nsol; ++j)
+            model->solution[k][j] *= 2.0f;
+    QCOMPARE(FwdBemModel::fwd_bem_save_cached_solution(sCacheName,model), 0);
+
+    QCOMPARE(FwdBemModel::fwd_bem_load_recompute_solution(sBemName,FWD_BEM_UNKNOWN,0,model), 0);
+    for (int k = 0; k < nsol; ++k)
+        for (int j = 0; j < nsol; ++j)
+            QVERIFY(model->solution[k][j] == 2.0f*solution(k,j));
+
+    //... and bypassed by force_recompute, which stores the new solution again
+    QCOMPARE(FwdBemModel::fwd_bem_load_recompute_solution(sBemName,FWD_BEM_UNKNOWN,1,model), 0);
+    float fError = 0.0f;
+    for (int k = 0; k < nsol; ++k)
+        fError = qMax(fError, (Map<RowVectorXf>(model->solution[k],nsol) - solution.row(k)).cwiseAbs().maxCoeff());
+    fError /= solution.cwiseAbs().maxCoeff();
+    printf("%d nodes: relative deviation of the recomputed solution %g\n",nsol,fError);
+    QVERIFY(fError < 1e-4f);
+
+    QCOMPARE(FwdBemModel::fwd_bem_load_cached_solution(sCacheName,FWD_BEM_LINEAR_COLL,model), 0);
+    fError = 0.0f;
+    for (int k = 0; k < nsol; ++k)
+        fError = qMax(fError, (Map<RowVectorXf>(model->solution[k],nsol) - solution.row(k)).cwiseAbs().maxCoeff());
+    QVERIFY(fError / solution.cwiseAbs().maxCoeff() < 1e-4f);
+
+    QFile::remove(sCacheName);
+    delete model;
+
+    qputenv("MNE_CPP_CACHE", "0");
+    QStandardPaths::setTestModeEnabled(false);
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare BEM Solution Cache Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareSphereFieldBatch()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare Sphere Model MEG Batch >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    float r0[3] = {0.0f,0.0f,0.04f};
+
+    srand(42);
+    FwdCoilSet* coils = createMegCoils(102,0.12f,"MEG");
+
+    //With the points collected on the fly and with the points set up in advance
+    compareBatch(FwdBemModel::fwd_sphere_field,FwdBemModel::fwd_sphere_field_batch,coils,r0,0.07f);
+    coils->fwd_setup_coil_points();
+    compareBatch(FwdBemModel::fwd_sphere_field,FwdBemModel::fwd_sphere_field_batch,coils,r0,0.07f);
+
+    delete coils;
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare Sphere Model MEG Batch Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareEegSpherePotBatch()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare EEG Sphere Model Batch >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    const int nlayer = 4;
+    const float rad = 0.09f;
+
+    VectorXf rads(nlayer), sigmas(nlayer);
+    rads << 0.90f,0.92f,0.97f,1.0f;
+    sigmas << 0.33f,1.0f,0.4e-2f,0.33f;
+
+    FwdEegSphereModel* model = FwdEegSphereModel::fwd_create_eeg_sphere_model("Default",nlayer,rads,sigmas);
+    QVERIFY(model->fwd_setup_eeg_sphere_model(rad,false,0));
+
+    srand(42);
+    FwdCoilSet* els = createEegEls(60,rad);
+
+    compareBatch(FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1,FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1_batch,els,model,0.995f*rads[0]*rad);
+    els->fwd_setup_coil_points(true);
+    compareBatch(FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1,FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1_batch,els,model,0.995f*rads[0]*rad);
+
+    delete els;
+    delete model;
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare EEG Sphere Model Batch Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareCompFieldBatch()
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compare Compensated MEG Batch >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    const int nmeg = 60;
+    const int nref = 20;
+    float r0[3] = {0.0f,0.0f,0.04f};
+
+    srand(42);
+    FwdCoilSet* coils = createMegCoils(nmeg,0.12f,"MEG");
+
+    //Reference coils further away, and a CTF-like compensation matrix. The matrix is laid out like the ones
+    //of mne_cmatrix, which MneNamedMatrix frees.
+    float** comp_data = static_cast<float**>(malloc(nmeg*sizeof(float*)));
+    comp_data[0] = static_cast<float*>(malloc(nmeg*nref*sizeof(float)));
+    for (int k = 1; k < nmeg; ++k)
+        comp_data[k] = comp_data[0] + k*nref;
+    Map<Matrix<float,Dynamic,Dynamic,RowMajor> >(comp_data[0],nmeg,nref) = 0.05f*MatrixXf::Random(nmeg,nref);
+
+    FwdCompData* comp = new FwdCompData();
+    comp->comp_coils    = createMegCoils(nref,0.2f,"REF");
+    comp->field         = FwdBemModel::fwd_sphere_field;
+    comp->batch_field   = FwdBemModel::fwd_sphere_field_batch;
+    comp->client        = r0;
+    comp->set           = new MneCTFCompDataSet();
+    comp->set->current  = new MneCTFCompData();
+    comp->set->current->data = MneNamedMatrix::build_named_matrix(nmeg,nref,QStringList(),QStringList(),comp_data);
+
+    compareBatch(FwdCompData::fwd_comp_field,FwdCompData::fwd_comp_field_batch,coils,comp,0.07f);
+    coils->fwd_setup_coil_points();
+    comp->comp_coils->fwd_setup_coil_points();
+    compareBatch(FwdCompData::fwd_comp_field,FwdCompData::fwd_comp_field_batch,coils,comp,0.07f);
+
+    delete comp;
+    delete coils;
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compare Compensated MEG Batch Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::setupSettings(ComputeFwdSettings& settings)
+{
+    //Following is equivalent to: --meg --accurate --src ./MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif
+    // --meas ./MNE-sample-data/MEG/sample/sample_audvis_raw.fif
+    // --mri ./MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif
+    // --bem ./MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif
+    // --mindist 5 --fwd ./MNE-sample-data/Result/sample_audvis-meg-oct-6-fwd.fif
+    settings.include_meg = true;
+    settings.accurate = true;
+    settings.srcname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif";
+    settings.measname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/MEG/sample/sample_audvis_raw.fif";
+    settings.mriname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif";
+    settings.mri_head_ident = false;
+    settings.transname.clear();
+    settings.bemname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif";
+    settings.mindist = 5.0f/1000.0f;
+    settings.solname = QDir::currentPath()+"./mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd.fif";
+}
+
+
 //*************************************************************************************************************
 
 void TestForwardSolution::compareForward()
@@ -209,10 +611,103 @@ void TestForwardSolution::compareForward()
 }
 
 
+//*************************************************************************************************************
+
+FwdCoilSet* TestForwardSolution::createMegCoils(int ncoil, float rad, const QString& sPrefix)
+{
+    //Magnetometers and two-point planar gradiometers on the upper half of a sphere
+    FwdCoilSet* coils = new FwdCoilSet();
+    coils->coils = static_cast<FwdCoil**>(malloc(ncoil*sizeof(FwdCoil*)));
+
+    for (int k = 0; k < ncoil; ++k) {
+        bool bPlanar = k % 3 != 0;
+        Vector3f dir = Vector3f::Random();
+        dir[2] = qAbs(dir[2]) + 0.2f;
+        dir.normalize();
+        Vector3f ex = dir.unitOrthogonal();
+
+        FwdCoil* coil = new FwdCoil(bPlanar ? 2 : 1);
+        coil->chname = QString("%1%2").arg(sPrefix).arg(k);
+        coil->coil_class = bPlanar ? FWD_COILC_PLANAR_GRAD : FWD_COILC_MAG;
+        for (int p = 0; p < coil->np; ++p) {
+            float fSign = p == 0 ? 1.0f : -1.0f;
+            Map<Vector3f>(coil->rmag[p]) = rad*dir;
+            if (bPlanar)
+                Map<Vector3f>(coil->rmag[p]) += fSign*0.0084f*ex;
+            Map<Vector3f>(coil->cosmag[p]) = dir;
+            coil->w[p] = bPlanar ? fSign/0.0168f : 1.0f;
+        }
+        coils->coils[coils->ncoil++] = coil;
+    }
+
+    return coils;
+}
+
+
+//*************************************************************************************************************
+
+FwdCoilSet* TestForwardSolution::createEegEls(int neeg, float rad)
+{
+    FwdCoilSet* els = new FwdCoilSet();
+    els->coils = static_cast<FwdCoil**>(malloc(neeg*sizeof(FwdCoil*)));
+
+    for (int k = 0; k < neeg; ++k) {
+        Vector3f dir = Vector3f::Random().normalized();
+
+        FwdCoil* el = new FwdCoil(1);
+        el->chname = QString("EEG%1").arg(k);
+        el->coil_class = FWD_COILC_EEG;
+        Map<Vector3f>(el->rmag[0]) = rad*dir;
+        Map<Vector3f>(el->cosmag[0]) = dir;
+        el->w[0] = 1.0f;
+        els->coils[els->ncoil++] = el;
+    }
+
+    return els;
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::compareBatch(fwdFieldFunc field, fwdBatchFieldFunc field_batch, FwdCoilSet* coils, void* client, float rad)
+{
+    const int ndip = 100;
+    int ncoil = coils->ncoil;
+
+    //Dipoles anywhere within the given radius, one per row as in the forward computation
+    Matrix<float,Dynamic,3,RowMajor> rd(ndip,3), Q(ndip,3);
+    for (int k = 0; k < ndip; ++k) {
+        rd.row(k) = rad*float(rand())/RAND_MAX*RowVector3f::Random().normalized();
+        Q.row(k) = RowVector3f::Random();
+    }
+
+    Matrix<float,Dynamic,Dynamic,RowMajor> B(ndip,ncoil), B_batch(ndip,ncoil);
+    QVector<float*> rd_rows(ndip), Q_rows(ndip), B_rows(ndip);
+    for (int k = 0; k < ndip; ++k) {
+        rd_rows[k] = rd.data() + 3*k;
+        Q_rows[k] = Q.data() + 3*k;
+        B_rows[k] = B_batch.data() + k*ncoil;
+        QCOMPARE(field(rd_rows[k],Q_rows[k],coils,B.data() + k*ncoil,client), 0);
+    }
+
+    QCOMPARE(field_batch(rd_rows.data(),Q_rows.data(),ndip,coils,B_rows.data(),client), 0);
+
+    //Compare each topography relative to its largest value
+    float fError = 0.0f;
+    for (int k = 0; k < ndip; ++k) {
+        float fMax = B.row(k).cwiseAbs().maxCoeff();
+        fError = qMax(fError, (B_batch.row(k) - B.row(k)).cwiseAbs().maxCoeff() / fMax);
+    }
+    printf("%d coils, %d dipoles: relative deviation of the batch computation %g\n",ncoil,ndip,fError);
+    QVERIFY(fError < 1e-4f);
+}
+
+
 //*************************************************************************************************************
 
 void TestForwardSolution::cleanupTestCase()
 {
+    QFile::remove(m_sScalingFwdName);
 }
 
 
@@ -0,0 +1,290 @@
+//=============================================================================================================
+/**
+* @file     test_kmeans.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the k-means clustering and the cluster cache
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/kmeans.h>
+#include <mne/mne_cluster_cache.h>
+#include <mne/mne_forwardsolution.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace MNELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestKMeans
+*
+* @brief The TestKMeans class compares the bounded k-means iterations with the exact ones and tests the cluster cache
+*
+*/
+class TestKMeans: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestKMeans();
+
+private slots:
+    void initTestCase();
+    void compareBoundedUpdate();
+    void comparePlusStart();
+    void compareClusterCache();
+    void cleanupTestCase();
+
+private:
+    void createBlobs(int nPoints, int nDims, int nBlobs, double dSpread, MatrixXd& matX, VectorXi& vecLabels) const;
+
+    double epsilon;
+};
+
+
+//*************************************************************************************************************
+
+TestKMeans::TestKMeans()
+: epsilon(0.00001)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::initTestCase()
+{
+    //Keep the cache files of the test apart from the ones of the user
+    QStandardPaths::setTestModeEnabled(true);
+    qputenv("MNE_CPP_CACHE", "1");
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::compareBoundedUpdate()
+{
+    const int k = 6;
+
+    QStringList lDistances;
+    lDistances << "sqeuclidean" << "cityblock";
+
+    for(int i = 0; i < lDistances.size(); ++i) {
+        std::srand(42);
+
+        //Overlapping clusters, so that points move between the clusters for a few iterations
+        MatrixXd matX;
+        VectorXi vecLabels;
+        createBlobs(600, 8, k, 1.5, matX, vecLabels);
+
+        MatrixXd matStart(k, matX.cols());
+        for(int j = 0; j < k; ++j) {
+            matStart.row(j) = matX.row(37*j);
+        }
+
+        //The same start with the bounded single precision and the exact double precision iterations
+        for(int iOnline = 0; iOnline < 2; ++iOnline) {
+            KMeans kMeansBounded(lDistances[i], "numeric", 1, "error", iOnline == 1, 100, 0, true);
+            KMeans kMeansExact(lDistances[i], "numeric", 1, "error", iOnline == 1, 100, 0, false);
+
+            VectorXi idxBounded, idxExact;
+            MatrixXd matCBounded = matStart, matCExact = matStart;
+            VectorXd sumDBounded, sumDExact;
+            MatrixXd matDBounded, matDExact;
+
+            QVERIFY(kMeansBounded.calculate(matX, k, idxBounded, matCBounded, sumDBounded, matDBounded));
+            QVERIFY(kMeansExact.calculate(matX, k, idxExact, matCExact, sumDExact, matDExact));
+
+            QVERIFY(idxBounded == idxExact);
+            QVERIFY((matCBounded - matCExact).cwiseAbs().maxCoeff() <= epsilon * matCExact.cwiseAbs().maxCoeff());
+            QVERIFY(std::fabs(sumDBounded.sum() - sumDExact.sum()) <= epsilon * sumDExact.sum());
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::comparePlusStart()
+{
+    const int k = 6;
+
+    std::srand(42);
+
+    //Well separated clusters, the k-means++ start with a few replicates finds all of them
+    MatrixXd matX;
+    VectorXi vecLabels;
+    createBlobs(600, 8, k, 0.5, matX, vecLabels);
+
+    KMeans kMeans("sqeuclidean", "plus", 3);
+
+    VectorXi idx;
+    MatrixXd matC;
+    VectorXd sumD;
+    MatrixXd matD;
+
+    QVERIFY(kMeans.calculate(matX, k, idx, matC, sumD, matD));
+    QCOMPARE(int(matC.rows()), k);
+
+    //One cluster per blob, the first k points belong to different blobs
+    for(int i = 0; i < matX.rows(); ++i) {
+        QCOMPARE(idx[i], idx[vecLabels[i]]);
+    }
+    for(int i = 0; i < k; ++i) {
+        for(int j = 0; j < i; ++j) {
+            QVERIFY(idx[i] != idx[j]);
+        }
+    }
+
+    //The distances belong to the assigned clusters
+    for(int i = 0; i < k; ++i) {
+        double dSum = 0.0;
+        for(int j = 0; j < matX.rows(); ++j) {
+            if(idx[j] == i) {
+                dSum += matD(j, i);
+            }
+        }
+        QVERIFY(std::fabs(dSum - sumD[i]) <= epsilon * sumD.sum());
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::compareClusterCache()
+{
+    std::srand(42);
+
+    QList<RegionDataOut> lRegions;
+    for(int i = 0; i < 3; ++i) {
+        RegionDataOut region;
+        region.roiIdx = VectorXi::LinSpaced(20 + i, 0, 4);
+        region.ctrs = MatrixXd::Random(5, 9);
+        region.sumd = VectorXd::Random(5);
+        region.D = MatrixXd::Random(20 + i, 5);
+        region.iLabelIdxOut = 100 + i;
+        lRegions.append(region);
+    }
+
+    MNEClusterCache cache("test");
+    cache.addData(QString("cityblock"));
+    cache.addData(lRegions[0].ctrs);
+    cache.addData(lRegions[0].roiIdx);
+    cache.addData(qint32(3));
+
+    //Round trip
+    MNEClusterCache::setEnabled(true);
+    QVERIFY(MNEClusterCache::clear());
+    QList<RegionDataOut> lLoaded;
+    QVERIFY(!cache.load(lLoaded));
+    QVERIFY(cache.save(lRegions));
+    QVERIFY(cache.load(lLoaded));
+
+    QCOMPARE(lLoaded.size(), lRegions.size());
+    for(int i = 0; i < lRegions.size(); ++i) {
+        QVERIFY(lLoaded[i].roiIdx == lRegions[i].roiIdx);
+        QVERIFY(lLoaded[i].ctrs == lRegions[i].ctrs);
+        QVERIFY(lLoaded[i].sumd == lRegions[i].sumd);
+        QVERIFY(lLoaded[i].D == lRegions[i].D);
+        QCOMPARE(lLoaded[i].iLabelIdxOut, lRegions[i].iLabelIdxOut);
+    }
+
+    //A different key misses
+    MNEClusterCache otherCache("test");
+    otherCache.addData(QString("sqeuclidean"));
+    QVERIFY(otherCache.fileName() != cache.fileName());
+    QVERIFY(!otherCache.load(lLoaded));
+
+    //Switched off, nothing is read or written
+    MNEClusterCache::setEnabled(false);
+    QVERIFY(!MNEClusterCache::isEnabled());
+    QVERIFY(cache.fileName().isEmpty());
+    QVERIFY(!cache.load(lLoaded));
+    QVERIFY(!otherCache.save(lRegions));
+    MNEClusterCache::setEnabled(true);
+    QVERIFY(!otherCache.load(lLoaded));
+
+    //Cleared, the results are clustered again
+    QVERIFY(MNEClusterCache::clear());
+    QVERIFY(!cache.load(lLoaded));
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::cleanupTestCase()
+{
+    MNEClusterCache::clear();
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::createBlobs(int nPoints, int nDims, int nBlobs, double dSpread, MatrixXd& matX, VectorXi& vecLabels) const
+{
+    MatrixXd matCenters = 4.0 * MatrixXd::Random(nBlobs, nDims);
+
+    matX.resize(nPoints, nDims);
+    vecLabels.resize(nPoints);
+
+    for(int i = 0; i < nPoints; ++i) {
+        vecLabels[i] = i % nBlobs;
+        matX.row(i) = matCenters.row(i % nBlobs) + dSpread * MatrixXd::Random(1, nDims);
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestKMeans)
+#include "test_kmeans.moc"
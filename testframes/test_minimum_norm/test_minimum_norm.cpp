@@ -0,0 +1,211 @@
+//=============================================================================================================
+/**
+* @file     test_minimum_norm.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the in-place application of the minimum norm inverse
+*
+*/
+
+//*************************************************************************************************************
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_cov.h>
+#include <fiff/fiff_evoked.h>
+#include <mne/mne_forwardsolution.h>
+#include <mne/mne_inverse_operator.h>
+#include <mne/mne_sourceestimate.h>
+#include <inverse/minimumNorm/minimumnorm.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestMinimumNorm
+*
+* @brief The TestMinimumNorm class verifies applyInverse against calculateInverse
+*
+*/
+class TestMinimumNorm: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMinimumNorm();
+
+private slots:
+    void initTestCase();
+    void compareApplyFixed();
+    void compareApplyFree();
+    void cleanupTestCase();
+
+private:
+    void compareApply(const MNEInverseOperator& invOp, const QString& sMethod);
+
+    double epsilon;
+    double epsilonSingle;
+    MNEInverseOperator m_invOpFixed;
+    MNEInverseOperator m_invOpFree;
+    qint32 m_iNave;
+};
+
+
+//*************************************************************************************************************
+
+TestMinimumNorm::TestMinimumNorm()
+: epsilon(0.0000000001)
+, epsilonSingle(0.0001)
+, m_iNave(1)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::initTestCase()
+{
+    std::srand(42);
+
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QFile t_fileCov(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif");
+    QFile t_fileEvoked(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif");
+    QVERIFY(t_fileFwd.exists());
+    QVERIFY(t_fileCov.exists());
+    QVERIFY(t_fileEvoked.exists());
+
+    FiffEvoked evoked(t_fileEvoked, 0, QPair<QVariant, QVariant>(QVariant(), 0));
+    QVERIFY(!evoked.isEmpty());
+    m_iNave = evoked.nave;
+
+    MNEForwardSolution t_forward(t_fileFwd, false, true);
+    QVERIFY(!t_forward.isEmpty());
+
+    FiffCov noise_cov(t_fileCov);
+    noise_cov = noise_cov.regularize(evoked.info, 0.05, 0.05, 0.1, true);
+
+    m_invOpFixed = MNEInverseOperator::make_inverse_operator(evoked.info, t_forward, noise_cov, 0.0f, 0.8f, true);
+    m_invOpFree = MNEInverseOperator::make_inverse_operator(evoked.info, t_forward, noise_cov, 0.2f, 0.8f, false);
+
+    QVERIFY(m_invOpFixed.source_ori == FIFFV_MNE_FIXED_ORI);
+    QVERIFY(m_invOpFree.source_ori == FIFFV_MNE_FREE_ORI);
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareApplyFixed()
+{
+    compareApply(m_invOpFixed, "MNE");
+    compareApply(m_invOpFixed, "dSPM");
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareApplyFree()
+{
+    compareApply(m_invOpFree, "MNE");
+    compareApply(m_invOpFree, "dSPM");
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareApply(const MNEInverseOperator& invOp, const QString& sMethod)
+{
+    MinimumNorm minimumNorm(invOp, 1.0f / 9.0f, sMethod);
+    minimumNorm.doInverseSetup(m_iNave, false);
+
+    MatrixXd matData = MatrixXd::Random(minimumNorm.getKernel().cols(), 200);
+
+    MNESourceEstimate sourceEstimate = minimumNorm.calculateInverse(matData, 0.0f, 0.001f);
+    QVERIFY(!sourceEstimate.isEmpty());
+
+    const double dScale = sourceEstimate.data.cwiseAbs().maxCoeff();
+    QVERIFY(dScale > 0.0);
+
+    //Run every option twice to check that the preallocated buffer is reused
+    MatrixXd matSol;
+    for(int i = 0; i < 4; ++i) {
+        const bool bPrecombineNoiseNorm = (i & 1) != 0;
+        const bool bSinglePrecision = (i & 2) != 0;
+        minimumNorm.setApplyOptions(bPrecombineNoiseNorm, bSinglePrecision);
+
+        for(int r = 0; r < 2; ++r) {
+            QVERIFY(minimumNorm.applyInverse(matData, matSol));
+
+            QCOMPARE(matSol.rows(), sourceEstimate.data.rows());
+            QCOMPARE(matSol.cols(), sourceEstimate.data.cols());
+
+            const double dError = (matSol - sourceEstimate.data).cwiseAbs().maxCoeff() / dScale;
+            QVERIFY2(dError < (bSinglePrecision ? epsilonSingle : epsilon),
+                     qPrintable(QString("%1 precombine %2 single %3: relative error %4").arg(sMethod).arg(bPrecombineNoiseNorm).arg(bSinglePrecision).arg(dError)));
+        }
+    }
+
+    //Data of the wrong channel count is rejected
+    QVERIFY(!minimumNorm.applyInverse(MatrixXd::Random(matData.rows() + 1, 10), matSol));
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestMinimumNorm)
+#include "test_minimum_norm.moc"
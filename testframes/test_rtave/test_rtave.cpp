@@ -0,0 +1,314 @@
+//=============================================================================================================
+/**
+* @file     test_rtave.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the running evoked accumulator RtAveAccumulator
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <realtime/rtProcessing/rtave.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace REALTIMELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtAve
+*
+* @brief The TestRtAve class verifies the running evoked accumulator against the statistics of the stored epochs
+*
+*/
+class TestRtAve: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtAve();
+
+private slots:
+    void initTestCase();
+    void compareRunningAverage();
+    void compareHeavyRejection();
+    void compareRejectionChange();
+    void compareWindowChange();
+    void compareCumulativeAverage();
+    void cleanupTestCase();
+
+private:
+    bool compareStatistics(const RtAveAccumulator& accumulator, const QList<int>& lEpochs) const;
+
+    double epsilon;
+    QList<MatrixXd> m_lEpochs;
+    QList<bool> m_lRejected;
+};
+
+
+//*************************************************************************************************************
+
+TestRtAve::TestRtAve()
+: epsilon(0.000001)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::initTestCase()
+{
+    std::srand(42);
+
+    //Epochs with a common evoked response and an offset, every fifth one is rejected
+    MatrixXd matEvoked = MatrixXd::Random(12, 50);
+
+    for(int i = 0; i < 60; ++i) {
+        m_lEpochs.append(matEvoked + 0.5 * MatrixXd::Random(12, 50) + MatrixXd::Constant(12, 50, 100.0));
+        m_lRejected.append(i % 5 == 2);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareRunningAverage()
+{
+    const int iNumAverages = 8;
+
+    RtAveAccumulator accumulator;
+    accumulator.setWindow(iNumAverages);
+
+    for(int i = 0; i < m_lEpochs.size(); ++i) {
+        accumulator.append(m_lEpochs.at(i), m_lRejected.at(i));
+
+        //The window holds the newest accepted epochs
+        QList<int> lExpected;
+        for(int j = i; j >= 0 && lExpected.size() < iNumAverages; --j) {
+            if(!m_lRejected.at(j)) {
+                lExpected.append(j);
+            }
+        }
+
+        QCOMPARE(accumulator.nave(), lExpected.size());
+        QVERIFY(compareStatistics(accumulator, lExpected));
+    }
+
+    accumulator.reset();
+    QCOMPARE(accumulator.nave(), 0);
+    QCOMPARE(accumulator.storedEpochs(), 0);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareHeavyRejection()
+{
+    const int iNumAverages = 8;
+
+    RtAveAccumulator accumulator;
+    accumulator.setWindow(iNumAverages);
+
+    //70% of the epochs are rejected, the rejected ones must not push accepted ones out of the window
+    QList<bool> lRejected;
+    for(int i = 0; i < m_lEpochs.size(); ++i) {
+        lRejected.append(i % 10 < 7);
+    }
+
+    for(int i = 0; i < m_lEpochs.size(); ++i) {
+        accumulator.append(m_lEpochs.at(i), lRejected.at(i));
+
+        QList<int> lExpected;
+        for(int j = i; j >= 0 && lExpected.size() < iNumAverages; --j) {
+            if(!lRejected.at(j)) {
+                lExpected.append(j);
+            }
+        }
+
+        QCOMPARE(accumulator.nave(), lExpected.size());
+        QVERIFY(compareStatistics(accumulator, lExpected));
+    }
+
+    QCOMPARE(accumulator.nave(), iNumAverages);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareRejectionChange()
+{
+    const int iNumAverages = 8;
+
+    RtAveAccumulator accumulator;
+    accumulator.setWindow(iNumAverages);
+
+    for(int i = 0; i < m_lEpochs.size(); ++i) {
+        accumulator.append(m_lEpochs.at(i), m_lRejected.at(i));
+    }
+
+    //Accept the rejected epochs, the newest ones are checked first
+    for(int i = accumulator.storedEpochs() - 1; i >= 0; --i) {
+        int iStored = accumulator.storedEpochs();
+        accumulator.setRejected(i, false);
+        i -= iStored - accumulator.storedEpochs();
+    }
+
+    QList<int> lExpected;
+    for(int j = m_lEpochs.size() - 1; lExpected.size() < iNumAverages; --j) {
+        lExpected.append(j);
+    }
+
+    QCOMPARE(accumulator.nave(), iNumAverages);
+    QVERIFY(compareStatistics(accumulator, lExpected));
+
+    //Reject the newest epoch again
+    QVERIFY(accumulator.setRejected(accumulator.storedEpochs() - 1, true));
+    QVERIFY(!accumulator.setRejected(accumulator.storedEpochs() - 1, true));
+
+    lExpected.removeFirst();
+
+    QCOMPARE(accumulator.nave(), iNumAverages - 1);
+    QVERIFY(compareStatistics(accumulator, lExpected));
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareWindowChange()
+{
+    RtAveAccumulator accumulator;
+    accumulator.setWindow(10);
+
+    for(int i = 0; i < m_lEpochs.size(); ++i) {
+        accumulator.append(m_lEpochs.at(i));
+    }
+
+    //A smaller window drops the oldest epochs, a larger one is filled by the following epochs
+    accumulator.setWindow(3);
+
+    QList<int> lExpected;
+    lExpected << m_lEpochs.size() - 1 << m_lEpochs.size() - 2 << m_lEpochs.size() - 3;
+
+    QCOMPARE(accumulator.nave(), 3);
+    QVERIFY(compareStatistics(accumulator, lExpected));
+
+    accumulator.setWindow(5);
+    accumulator.append(m_lEpochs.at(0));
+    lExpected.prepend(0);
+
+    QCOMPARE(accumulator.nave(), 4);
+    QVERIFY(compareStatistics(accumulator, lExpected));
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareCumulativeAverage()
+{
+    RtAveAccumulator accumulator;
+    accumulator.setWindow(1, true);
+
+    QList<int> lExpected;
+
+    for(int i = 0; i < m_lEpochs.size(); ++i) {
+        accumulator.append(m_lEpochs.at(i), m_lRejected.at(i));
+
+        if(!m_lRejected.at(i)) {
+            lExpected.append(i);
+        }
+    }
+
+    QCOMPARE(accumulator.nave(), lExpected.size());
+    QCOMPARE(accumulator.storedEpochs(), 0);
+    QVERIFY(compareStatistics(accumulator, lExpected));
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+bool TestRtAve::compareStatistics(const RtAveAccumulator& accumulator, const QList<int>& lEpochs) const
+{
+    MatrixXd matMean = MatrixXd::Zero(m_lEpochs.first().rows(), m_lEpochs.first().cols());
+    for(int i = 0; i < lEpochs.size(); ++i) {
+        matMean += m_lEpochs.at(lEpochs.at(i));
+    }
+    matMean /= lEpochs.size();
+
+    if((accumulator.mean() - matMean).cwiseAbs().maxCoeff() > epsilon) {
+        return false;
+    }
+
+    MatrixXd matStdErr;
+    if(!accumulator.standardError(matStdErr)) {
+        return lEpochs.size() < 2;
+    }
+
+    MatrixXd matVar = MatrixXd::Zero(matMean.rows(), matMean.cols());
+    for(int i = 0; i < lEpochs.size(); ++i) {
+        matVar.array() += (m_lEpochs.at(lEpochs.at(i)) - matMean).array().square();
+    }
+    matVar /= lEpochs.size() - 1;
+
+    MatrixXd matExpected = (matVar / lEpochs.size()).cwiseSqrt();
+
+    return (matStdErr - matExpected).cwiseAbs().maxCoeff() < epsilon;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtAve)
+#include "test_rtave.moc"
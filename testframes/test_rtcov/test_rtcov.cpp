@@ -0,0 +1,221 @@
+//=============================================================================================================
+/**
+* @file     test_rtcov.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the online covariance accumulator RtCovAccumulator
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <realtime/rtProcessing/rtcov.h>
+
+#include <cmath>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace REALTIMELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtCov
+*
+* @brief The TestRtCov class verifies the online covariance accumulator against the covariance of the raw data
+*
+*/
+class TestRtCov: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtCov();
+
+private slots:
+    void initTestCase();
+    void compareBlockCovariance();
+    void compareSlidingCovariance();
+    void compareExponentialCovariance();
+    void cleanupTestCase();
+
+private:
+    MatrixXd covariance(const MatrixXd& matData, const RowVectorXd& vecWeights) const;
+    void appendInBlocks(RtCovAccumulator& accumulator, const MatrixXd& matData) const;
+
+    double epsilon;
+    MatrixXd m_matData;
+    QVector<int> m_lBlockSizes;
+};
+
+
+//*************************************************************************************************************
+
+TestRtCov::TestRtCov()
+: epsilon(0.000001)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::initTestCase()
+{
+    std::srand(42);
+
+    //Correlated channels with an offset
+    MatrixXd matMixing = MatrixXd::Random(10, 10);
+    m_matData = matMixing * MatrixXd::Random(10, 3000);
+    m_matData.colwise() += VectorXd::LinSpaced(10, -5.0, 5.0);
+
+    m_lBlockSizes << 100 << 37 << 250 << 1 << 64;
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::compareBlockCovariance()
+{
+    RtCovAccumulator accumulator;
+    appendInBlocks(accumulator, m_matData);
+
+    QCOMPARE(accumulator.samples(), (double)m_matData.cols());
+
+    MatrixXd matCov;
+    QVERIFY(accumulator.covariance(matCov));
+
+    MatrixXd matExpected = covariance(m_matData, RowVectorXd::Ones(m_matData.cols()));
+    QVERIFY((matCov - matExpected).cwiseAbs().maxCoeff() < epsilon);
+
+    accumulator.reset();
+    QVERIFY(!accumulator.covariance(matCov));
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::compareSlidingCovariance()
+{
+    const int iWindow = 500;
+
+    RtCovAccumulator accumulator;
+    accumulator.setWindow(RtCovAccumulator::Sliding, iWindow);
+    appendInBlocks(accumulator, m_matData);
+
+    QCOMPARE(accumulator.samples(), (double)iWindow);
+
+    MatrixXd matCov;
+    QVERIFY(accumulator.covariance(matCov));
+
+    MatrixXd matExpected = covariance(m_matData.rightCols(iWindow), RowVectorXd::Ones(iWindow));
+    QVERIFY((matCov - matExpected).cwiseAbs().maxCoeff() < epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::compareExponentialCovariance()
+{
+    const double dForgettingFactor = 0.998;
+
+    RtCovAccumulator accumulator;
+    accumulator.setWindow(RtCovAccumulator::Exponential, 0, dForgettingFactor);
+    appendInBlocks(accumulator, m_matData);
+
+    //Sample j is weighted by the forgetting factor to the power of its age
+    RowVectorXd vecWeights(m_matData.cols());
+    for(int j = 0; j < m_matData.cols(); ++j) {
+        vecWeights(j) = std::pow(dForgettingFactor, m_matData.cols() - 1 - j);
+    }
+
+    QVERIFY(std::fabs(accumulator.samples() - vecWeights.sum()) < epsilon);
+
+    MatrixXd matCov;
+    QVERIFY(accumulator.covariance(matCov));
+
+    MatrixXd matExpected = covariance(m_matData, vecWeights);
+    QVERIFY((matCov - matExpected).cwiseAbs().maxCoeff() < epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestRtCov::covariance(const MatrixXd& matData, const RowVectorXd& vecWeights) const
+{
+    double dSamples = vecWeights.sum();
+    VectorXd mu = matData * vecWeights.transpose() / dSamples;
+
+    MatrixXd matCentered = matData.colwise() - mu;
+
+    return matCentered * vecWeights.asDiagonal() * matCentered.transpose() / (dSamples - 1.0);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::appendInBlocks(RtCovAccumulator& accumulator, const MatrixXd& matData) const
+{
+    int iPos = 0;
+    for(int b = 0; iPos < matData.cols(); ++b) {
+        int iCols = qMin(m_lBlockSizes.at(b % m_lBlockSizes.size()), (int)matData.cols() - iPos);
+        accumulator.append(matData.middleCols(iPos, iCols));
+        iPos += iCols;
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtCov)
+#include "test_rtcov.moc"
@@ -0,0 +1,387 @@
+//=============================================================================================================
+/**
+* @file     test_rtfilter.cpp
+* @author   Lorenz Esch <lorenz.esch@tu-ilmenau.de>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Lorenz Esch. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the streaming real-time filter RtFilter
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <realtime/rtProcessing/rtfilter.h>
+#include <utils/filterTools/filterdata.h>
+#include <utils/filterTools/iirfilter.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace REALTIMELIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtFilter
+*
+* @brief The TestRtFilter class verifies that RtFilter filters consecutive blocks as one continuous stream
+*
+*/
+class TestRtFilter: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtFilter();
+
+private slots:
+    void initTestCase();
+    void compareStreamedFir();
+    void compareCascadedFir();
+    void compareStreamedIir();
+    void compareIirDelay();
+    void benchmarkIirVsFir();
+    void cleanupTestCase();
+
+private:
+    MatrixXd filterInBlocks(RtFilter& rtFilter,
+                            const MatrixXd& matData,
+                            int iMaxFilterLength,
+                            const QVector<int>& lFilterChannelList,
+                            const QList<FilterData>& lFilterData) const;
+    RowVectorXd convolve(const RowVectorXd& vecData, const RowVectorXd& vecCoeffs) const;
+
+    double epsilon;
+    MatrixXd m_matData;
+    QVector<int> m_lFilterChannelList;
+    QVector<int> m_lBlockSizes;
+};
+
+
+//*************************************************************************************************************
+
+TestRtFilter::TestRtFilter()
+: epsilon(0.000001)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::initTestCase()
+{
+    std::srand(42);
+
+    m_matData = MatrixXd::Random(12, 5000);
+
+    //Filter every other channel
+    for(int i = 0; i < m_matData.rows(); i += 2) {
+        m_lFilterChannelList << i;
+    }
+
+    //Blocks of varying size, also shorter than the filter
+    m_lBlockSizes << 100 << 37 << 500 << 1000 << 7 << 200;
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::compareStreamedFir()
+{
+    FilterData filter;
+    filter.m_dCoeffA = RowVectorXd::Random(81);
+
+    QList<FilterData> lFilterData;
+    lFilterData << filter;
+
+    int iMaxFilterLength = filter.m_dCoeffA.cols();
+
+    RtFilter rtFilter;
+    MatrixXd matFiltered = filterInBlocks(rtFilter, m_matData, iMaxFilterLength, m_lFilterChannelList, lFilterData);
+
+    int iDelay = iMaxFilterLength/2;
+
+    for(int i = 0; i < m_matData.rows(); ++i) {
+        if(m_lFilterChannelList.contains(i)) {
+            RowVectorXd vecExpected = convolve(m_matData.row(i), filter.m_dCoeffA);
+            QVERIFY((matFiltered.row(i) - vecExpected).cwiseAbs().maxCoeff() < epsilon);
+        } else {
+            //Unfiltered channels are delayed by half of the filter length
+            QVERIFY(matFiltered.row(i).head(iDelay).isZero());
+            QVERIFY(matFiltered.row(i).tail(m_matData.cols() - iDelay) == m_matData.row(i).head(m_matData.cols() - iDelay));
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::compareCascadedFir()
+{
+    FilterData filterFirst, filterSecond;
+    filterFirst.m_dCoeffA = RowVectorXd::Random(64);
+    filterSecond.m_dCoeffA = RowVectorXd::Random(33);
+
+    QList<FilterData> lFilterData;
+    lFilterData << filterFirst << filterSecond;
+
+    RtFilter rtFilter;
+    MatrixXd matFiltered = filterInBlocks(rtFilter, m_matData, 64, m_lFilterChannelList, lFilterData);
+
+    for(int j = 0; j < m_lFilterChannelList.size(); ++j) {
+        int i = m_lFilterChannelList.at(j);
+        RowVectorXd vecExpected = convolve(convolve(m_matData.row(i), filterFirst.m_dCoeffA), filterSecond.m_dCoeffA);
+        QVERIFY((matFiltered.row(i) - vecExpected).cwiseAbs().maxCoeff() < epsilon);
+    }
+
+    //Changing the filters starts a new stream
+    lFilterData.removeLast();
+
+    MatrixXd matBlock = m_matData.leftCols(300);
+    rtFilter.filterChannelsInPlace(matBlock, 64, m_lFilterChannelList, lFilterData);
+
+    RowVectorXd vecExpected = convolve(m_matData.row(0).head(300), filterFirst.m_dCoeffA);
+    QVERIFY((matBlock.row(0) - vecExpected).cwiseAbs().maxCoeff() < epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::compareStreamedIir()
+{
+    //8-30 Hz band pass at 1 kHz, frequencies are normalized to the Nyquist frequency
+    FilterData filter("bp", FilterData::BPF, 512, 0.038, 0.044, 0.01, 1000, 4096, FilterData::Butterworth);
+    QVERIFY(filter.m_matSos.rows() > 0);
+
+    QList<FilterData> lFilterData;
+    lFilterData << filter;
+
+    RtFilter rtFilter;
+    MatrixXd matFiltered = filterInBlocks(rtFilter, m_matData, 0, m_lFilterChannelList, lFilterData);
+
+    IirFilter iirFilter(filter.m_matSos);
+
+    for(int i = 0; i < m_matData.rows(); ++i) {
+        if(m_lFilterChannelList.contains(i)) {
+            RowVectorXd vecExpected = iirFilter.applyFilter(m_matData.row(i));
+            QVERIFY((matFiltered.row(i) - vecExpected).cwiseAbs().maxCoeff() < epsilon);
+        } else {
+            QVERIFY(matFiltered.row(i) == m_matData.row(i));
+        }
+    }
+
+    //Mixing FIR and IIR filters applies both
+    FilterData filterFir;
+    filterFir.m_dCoeffA = RowVectorXd::Random(17);
+    lFilterData << filterFir;
+
+    rtFilter.reset();
+    matFiltered = filterInBlocks(rtFilter, m_matData, 17, m_lFilterChannelList, lFilterData);
+
+    RowVectorXd vecExpected = iirFilter.applyFilter(convolve(m_matData.row(0), filterFir.m_dCoeffA));
+    QVERIFY((matFiltered.row(0) - vecExpected).cwiseAbs().maxCoeff() < epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::compareIirDelay()
+{
+    //A Butterworth filter with a long truncated impulse response must not delay the unfiltered channels
+    FilterData filterIir("bp", FilterData::BPF, 512, 0.038, 0.044, 0.01, 1000, 4096, FilterData::Butterworth);
+
+    QList<FilterData> lFilterData;
+    lFilterData << filterIir;
+
+    QCOMPARE(filterIir.m_iFilterOrder, 512);
+    QCOMPARE(RtFilter::maxFirFilterLength(lFilterData), 0);
+
+    RtFilter rtFilter;
+    MatrixXd matFiltered = filterInBlocks(rtFilter, m_matData, RtFilter::maxFirFilterLength(lFilterData), m_lFilterChannelList, lFilterData);
+
+    for(int i = 0; i < m_matData.rows(); ++i) {
+        if(!m_lFilterChannelList.contains(i)) {
+            QVERIFY(matFiltered.row(i) == m_matData.row(i));
+        }
+    }
+
+    //With an additional FIR filter the unfiltered channels are delayed by half of the FIR length only
+    FilterData filterFir;
+    filterFir.m_dCoeffA = RowVectorXd::Random(41);
+    lFilterData << filterFir;
+
+    int iMaxFilterLength = RtFilter::maxFirFilterLength(lFilterData);
+    QCOMPARE(iMaxFilterLength, 41);
+
+    rtFilter.reset();
+    matFiltered = filterInBlocks(rtFilter, m_matData, iMaxFilterLength, m_lFilterChannelList, lFilterData);
+
+    int iDelay = iMaxFilterLength/2;
+    IirFilter iirFilter(filterIir.m_matSos);
+
+    for(int i = 0; i < m_matData.rows(); ++i) {
+        if(m_lFilterChannelList.contains(i)) {
+            RowVectorXd vecExpected = iirFilter.applyFilter(convolve(m_matData.row(i), filterFir.m_dCoeffA));
+            QVERIFY((matFiltered.row(i) - vecExpected).cwiseAbs().maxCoeff() < epsilon);
+        } else {
+            QVERIFY(matFiltered.row(i).head(iDelay).isZero());
+            QVERIFY(matFiltered.row(i).tail(m_matData.cols() - iDelay) == m_matData.row(i).head(m_matData.cols() - iDelay));
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::benchmarkIirVsFir()
+{
+    const double dSFreq = 1000.0;
+    const int iBlockSize = 100;
+    const int iBlocks = 50;
+
+    MatrixXd matData = MatrixXd::Random(64, iBlockSize);
+    QVector<int> lFilterChannelList;
+    for(int i = 0; i < matData.rows(); ++i) {
+        lFilterChannelList << i;
+    }
+
+    //The cost of the FIR path only depends on the number of taps
+    FilterData filterFir;
+    filterFir.m_dCoeffA = RowVectorXd::Random(4096);
+
+    FilterData filterIir("bp", FilterData::BPF, 512, 0.038, 0.044, 0.01, dSFreq, 4096, FilterData::Butterworth);
+
+    QList<FilterData> lFir, lIir;
+    lFir << filterFir;
+    lIir << filterIir;
+
+    RtFilter rtFir, rtIir;
+    QElapsedTimer timer;
+
+    MatrixXd matBlock = matData;
+    rtFir.filterChannelsInPlace(matBlock, 4096, lFilterChannelList, lFir);
+    timer.start();
+    for(int b = 0; b < iBlocks; ++b) {
+        matBlock = matData;
+        rtFir.filterChannelsInPlace(matBlock, 4096, lFilterChannelList, lFir);
+    }
+    double dFirMsecs = timer.nsecsElapsed() / 1e6 / iBlocks;
+
+    matBlock = matData;
+    rtIir.filterChannelsInPlace(matBlock, 0, lFilterChannelList, lIir);
+    timer.start();
+    for(int b = 0; b < iBlocks; ++b) {
+        matBlock = matData;
+        rtIir.filterChannelsInPlace(matBlock, 0, lFilterChannelList, lIir);
+    }
+    double dIirMsecs = timer.nsecsElapsed() / 1e6 / iBlocks;
+
+    //Linear phase FIR filters delay by half of their length, the IIR delay is taken at the passband center
+    double dFirLatency = (filterFir.m_dCoeffA.cols() - 1) / 2.0 / dSFreq * 1000.0;
+    double dIirLatency = IirFilter(filterIir.m_matSos).groupDelay(0.038) / dSFreq * 1000.0;
+
+    qDebug("%d channels, %d samples per block at %.0f Hz", (int)matData.rows(), iBlockSize, dSFreq);
+    qDebug("FIR 4096 taps:         %8.3f ms per block, latency %7.1f ms", dFirMsecs, dFirLatency);
+    qDebug("IIR Butterworth (8th): %8.3f ms per block, latency %7.1f ms", dIirMsecs, dIirLatency);
+
+    QVERIFY(dIirLatency < dFirLatency);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtFilter::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestRtFilter::filterInBlocks(RtFilter& rtFilter,
+                                      const MatrixXd& matData,
+                                      int iMaxFilterLength,
+                                      const QVector<int>& lFilterChannelList,
+                                      const QList<FilterData>& lFilterData) const
+{
+    MatrixXd matFiltered(matData.rows(), matData.cols());
+
+    int iPos = 0;
+    for(int b = 0; iPos < matData.cols(); ++b) {
+        int iCols = qMin(m_lBlockSizes.at(b % m_lBlockSizes.size()), (int)matData.cols() - iPos);
+
+        matFiltered.middleCols(iPos, iCols) = rtFilter.filterChannelsConcurrently(matData.middleCols(iPos, iCols),
+                                                                                  iMaxFilterLength,
+                                                                                  lFilterChannelList,
+                                                                                  lFilterData);
+        iPos += iCols;
+    }
+
+    return matFiltered;
+}
+
+
+//*************************************************************************************************************
+
+RowVectorXd TestRtFilter::convolve(const RowVectorXd& vecData, const RowVectorXd& vecCoeffs) const
+{
+    //Causal convolution, truncated to the length of the data
+    RowVectorXd vecResult = RowVectorXd::Zero(vecData.cols());
+
+    for(int n = 0; n < vecData.cols(); ++n) {
+        for(int k = 0; k < vecCoeffs.cols() && k <= n; ++k) {
+            vecResult(n) += vecCoeffs(k) * vecData(n - k);
+        }
+    }
+
+    return vecResult;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtFilter)
+#include "test_rtfilter.moc"
@@ -0,0 +1,257 @@
+//=============================================================================================================
+/**
+* @file     test_rtinvop.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the real-time inverse operator worker RtInvOpWorker
+*
+*/
+
+//*************************************************************************************************************
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <realtime/rtProcessing/rtinvop.h>
+#include <fiff/fiff_cov.h>
+#include <fiff/fiff_evoked.h>
+#include <mne/mne_forwardsolution.h>
+#include <mne/mne_inverse_operator.h>
+#include <mne/mne_sourceestimate.h>
+#include <inverse/minimumNorm/minimumnorm.h>
+
+#include <cmath>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace REALTIMELIB;
+using namespace FIFFLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Gives the test access to the two steps of RtInvOpWorker::doWork.
+*/
+class RtInvOpTestWorker : public RtInvOpWorker
+{
+public:
+    using RtInvOpWorker::updateCache;
+    using RtInvOpWorker::computeInverseOperator;
+};
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtInvOp
+*
+* @brief The TestRtInvOp class verifies the cached inverse operator of RtInvOpWorker against
+*        MNEInverseOperator::make_inverse_operator
+*
+*/
+class TestRtInvOp: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtInvOp();
+
+private slots:
+    void initTestCase();
+    void compareEigenFields();
+    void compareKernel();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    MNEInverseOperator m_invOpRt;
+    MNEInverseOperator m_invOpRef;
+};
+
+
+//*************************************************************************************************************
+
+TestRtInvOp::TestRtInvOp()
+: epsilon(0.000001)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtInvOp::initTestCase()
+{
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QFile t_fileCov(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif");
+    QFile t_fileEvoked(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif");
+    QVERIFY(t_fileFwd.exists());
+    QVERIFY(t_fileCov.exists());
+    QVERIFY(t_fileEvoked.exists());
+
+    FiffEvoked evoked(t_fileEvoked, 0, QPair<QVariant, QVariant>(QVariant(), 0));
+    QVERIFY(!evoked.isEmpty());
+
+    RtInvOpInput inputData;
+    inputData.pFiffInfo = QSharedPointer<FiffInfo>(new FiffInfo(evoked.info));
+    inputData.pFwd = QSharedPointer<MNEForwardSolution>(new MNEForwardSolution(t_fileFwd, false, true));
+    inputData.noiseCov = FiffCov(t_fileCov);
+    inputData.iSvdRank = 0;
+    QVERIFY(!inputData.pFwd->isEmpty());
+
+    //The channels as selected by RtInvOpWorker::doWork
+    QStringList lChNames;
+    for(int i = 0; i < inputData.pFiffInfo->chs.size(); ++i) {
+        const QString& sChName = inputData.pFiffInfo->chs.at(i).ch_name;
+        if(!inputData.pFiffInfo->bads.contains(sChName) && !inputData.noiseCov.bads.contains(sChName)) {
+            lChNames << sChName;
+        }
+    }
+
+    RtInvOpTestWorker worker;
+    QVERIFY(worker.updateCache(inputData, lChNames));
+    m_invOpRt = worker.computeInverseOperator(inputData);
+
+    //Same forward solution, loose and depth parameters as the worker
+    m_invOpRef = MNEInverseOperator::make_inverse_operator(*inputData.pFiffInfo,
+                                                          inputData.pFwd->pick_types(true, false),
+                                                          inputData.noiseCov,
+                                                          0.2f,
+                                                          0.8f);
+
+    QCOMPARE(m_invOpRt.source_ori, m_invOpRef.source_ori);
+    QCOMPARE(m_invOpRt.nsource, m_invOpRef.nsource);
+    QCOMPARE(m_invOpRt.eigen_fields->col_names, m_invOpRef.eigen_fields->col_names);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtInvOp::compareEigenFields()
+{
+    const VectorXd& vecSing = m_invOpRt.sing;
+    const VectorXd& vecSingRef = m_invOpRef.sing;
+    const MatrixXd& matFields = m_invOpRt.eigen_fields->data;
+    const MatrixXd& matFieldsRef = m_invOpRef.eigen_fields->data;
+
+    QVERIFY(vecSing.size() > 0);
+    QVERIFY(vecSing.size() <= vecSingRef.size());
+    QCOMPARE(matFields.rows(), vecSing.size());
+    QCOMPARE(matFields.cols(), matFieldsRef.cols());
+
+    //The singular values, the ones dropped by the worker are negligible
+    const double dSingMax = vecSingRef[0];
+    QVERIFY((vecSing - vecSingRef.head(vecSing.size())).cwiseAbs().maxCoeff() < epsilon * dSingMax);
+    QVERIFY(vecSing.size() == vecSingRef.size() || vecSingRef.tail(vecSingRef.size() - vecSing.size()).maxCoeff() < epsilon * dSingMax);
+
+    //The eigen-fields up to their sign. Components with nearly equal singular values may mix, they are skipped.
+    int iCompared = 0;
+    for(int i = 0; i < vecSing.size(); ++i) {
+        double dGap = INFINITY;
+        if(i > 0) {
+            dGap = qMin(dGap, vecSingRef[i-1] - vecSingRef[i]);
+        }
+        if(i < vecSingRef.size() - 1) {
+            dGap = qMin(dGap, vecSingRef[i] - vecSingRef[i+1]);
+        }
+        if(vecSingRef[i] < 0.01 * dSingMax || dGap < 0.01 * vecSingRef[i]) {
+            continue;
+        }
+
+        double dSign = matFields.row(i).dot(matFieldsRef.row(i)) < 0 ? -1.0 : 1.0;
+        double dError = (dSign * matFields.row(i) - matFieldsRef.row(i)).cwiseAbs().maxCoeff();
+        QVERIFY2(dError < epsilon, qPrintable(QString("Eigen-field %1: deviation %2").arg(i).arg(dError)));
+        ++iCompared;
+    }
+
+    printf("Compared %d of %d eigen-fields\n", iCompared, int(vecSing.size()));
+    QVERIFY(iCompared > 0);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtInvOp::compareKernel()
+{
+    MinimumNorm minimumNorm(m_invOpRt, 1.0f / 9.0f, "dSPM");
+    minimumNorm.doInverseSetup(1, false);
+
+    MinimumNorm minimumNormRef(m_invOpRef, 1.0f / 9.0f, "dSPM");
+    minimumNormRef.doInverseSetup(1, false);
+
+    const MatrixXd& matKernel = minimumNorm.getKernel();
+    const MatrixXd& matKernelRef = minimumNormRef.getKernel();
+
+    QCOMPARE(matKernel.rows(), matKernelRef.rows());
+    QCOMPARE(matKernel.cols(), matKernelRef.cols());
+
+    double dError = (matKernel - matKernelRef).cwiseAbs().maxCoeff() / matKernelRef.cwiseAbs().maxCoeff();
+    printf("Relative deviation of the kernel %g\n", dError);
+    QVERIFY(dError < epsilon);
+
+    //The noise normalized source estimates
+    MatrixXd matData = MatrixXd::Random(matKernelRef.cols(), 50);
+    MNESourceEstimate sourceEstimate = minimumNorm.calculateInverse(matData, 0.0f, 0.001f);
+    MNESourceEstimate sourceEstimateRef = minimumNormRef.calculateInverse(matData, 0.0f, 0.001f);
+    QVERIFY(!sourceEstimateRef.isEmpty());
+
+    dError = (sourceEstimate.data - sourceEstimateRef.data).cwiseAbs().maxCoeff() / sourceEstimateRef.data.cwiseAbs().maxCoeff();
+    printf("Relative deviation of the dSPM estimates %g\n", dError);
+    QVERIFY(dError < epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtInvOp::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtInvOp)
+#include "test_rtinvop.moc"
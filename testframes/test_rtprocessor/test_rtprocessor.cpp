@@ -0,0 +1,264 @@
+//=============================================================================================================
+/**
+* @file     test_rtprocessor.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the event-driven processing base RtProcessor
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <realtime/rtProcessing/rtprocessor.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace REALTIMELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Processor which sums up the first entry of each block.
+*/
+class SumProcessor : public RtProcessor
+{
+public:
+    SumProcessor()
+    : RtProcessor(16)
+    , m_iSettingsApplied(0)
+    , m_dSum(0.0)
+    , m_iBlocks(0)
+    {
+    }
+
+    ~SumProcessor()
+    {
+        stop();
+    }
+
+    bool append(const MatrixXd& matData)
+    {
+        return appendData(matData);
+    }
+
+    void changeSettings()
+    {
+        settingsChanged();
+    }
+
+    QAtomicInteger<int> m_iSettingsApplied;
+    double m_dSum;
+    QAtomicInteger<int> m_iBlocks;
+
+protected:
+    virtual void applySettings()
+    {
+        m_iSettingsApplied.fetchAndAddOrdered(1);
+    }
+
+    virtual void processData(const MatrixXd& matData)
+    {
+        m_dSum += matData(0,0);
+        m_iBlocks.fetchAndAddOrdered(1);
+    }
+};
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtProcessor
+*
+* @brief The TestRtProcessor class verifies that RtProcessor hands every queued block to the worker and stops promptly
+*
+*/
+class TestRtProcessor: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtProcessor();
+
+private slots:
+    void initTestCase();
+    void compareProcessedBlocks();
+    void compareSettingsSnapshots();
+    void compareStopLatency();
+    void cleanupTestCase();
+
+private:
+    bool waitForBlocks(SumProcessor& processor, int iBlocks) const;
+};
+
+
+//*************************************************************************************************************
+
+TestRtProcessor::TestRtProcessor()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtProcessor::initTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtProcessor::compareProcessedBlocks()
+{
+    SumProcessor processor;
+    QVERIFY(processor.start());
+
+    double dExpected = 0.0;
+    for(int i = 0; i < 200; ++i) {
+        MatrixXd matData = MatrixXd::Constant(4, 10, i);
+
+        //Wait for a free slot, the queue never blocks the producer
+        while(!processor.append(matData)) {
+            QThread::yieldCurrentThread();
+        }
+
+        dExpected += i;
+    }
+
+    QVERIFY(waitForBlocks(processor, 200));
+    QCOMPARE(processor.m_dSum, dExpected);
+
+    RtProcessorStats stats = processor.stats();
+    QCOMPARE(stats.iBlocksProcessed, (qint64)200);
+    QCOMPARE(stats.iBlocksQueued - stats.iBlocksDropped, (qint64)200);
+    QVERIFY(stats.iMaxQueueDepth <= 16);
+
+    QVERIFY(processor.stop());
+    QVERIFY(!processor.isRunning());
+
+    //Blocks are dropped while the processor is stopped
+    QVERIFY(!processor.append(MatrixXd::Zero(4, 10)));
+}
+
+
+//*************************************************************************************************************
+
+void TestRtProcessor::compareSettingsSnapshots()
+{
+    SumProcessor processor;
+    processor.start();
+
+    processor.append(MatrixXd::Zero(4, 10));
+    QVERIFY(waitForBlocks(processor, 1));
+    QCOMPARE(processor.m_iSettingsApplied.loadAcquire(), 1);
+
+    //Several changes between two blocks lead to one snapshot
+    processor.changeSettings();
+    processor.changeSettings();
+    processor.append(MatrixXd::Zero(4, 10));
+    QVERIFY(waitForBlocks(processor, 2));
+    QCOMPARE(processor.m_iSettingsApplied.loadAcquire(), 2);
+
+    processor.append(MatrixXd::Zero(4, 10));
+    QVERIFY(waitForBlocks(processor, 3));
+    QCOMPARE(processor.m_iSettingsApplied.loadAcquire(), 2);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtProcessor::compareStopLatency()
+{
+    SumProcessor processor;
+    processor.start();
+
+    //The worker sleeps on the empty queue, stop has to wake it up
+    QTest::qSleep(100);
+
+    QElapsedTimer timer;
+    timer.start();
+    processor.stop();
+
+    QVERIFY(timer.elapsed() < 100);
+    QVERIFY(!processor.QThread::isRunning());
+
+    //Stopping before the first block arrived works as well
+    processor.append(MatrixXd::Zero(4, 10));
+    QVERIFY(processor.start());
+    processor.append(MatrixXd::Zero(4, 10));
+    QVERIFY(waitForBlocks(processor, 1));
+}
+
+
+//*************************************************************************************************************
+
+void TestRtProcessor::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+bool TestRtProcessor::waitForBlocks(SumProcessor& processor, int iBlocks) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while(processor.m_iBlocks.loadAcquire() < iBlocks) {
+        if(timer.elapsed() > 5000) {
+            return false;
+        }
+        QThread::msleep(1);
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtProcessor)
+#include "test_rtprocessor.moc"
@@ -0,0 +1,180 @@
+//=============================================================================================================
+/**
+* @file     test_rtsss.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test for the robust regression of the real-time SSS
+*
+*/
+
+//*************************************************************************************************************
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <rtsssalgo.h>
+
+#include <fiff/fiff_raw_data.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtSss
+*
+* @brief The TestRtSss class verifies that the parallel robust regression of the real-time SSS matches the
+*        sample by sample solution
+*
+*/
+class TestRtSss: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtSss();
+
+private slots:
+    void initTestCase();
+    void compareRepeatedBlocks();
+    void compareChunkedToSerial();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    RtSssAlgo m_rtSss;
+    MatrixXd m_matEqnB;
+};
+
+
+//*************************************************************************************************************
+
+TestRtSss::TestRtSss()
+: epsilon(0.000001)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtSss::initTestCase()
+{
+    std::srand(42);
+
+    QFile t_fileIn(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis_raw_short.fif");
+    FiffRawData raw(t_fileIn);
+    FiffInfo::SPtr pFiffInfo = FiffInfo::SPtr(new FiffInfo(raw.info));
+
+    //Magnetometers without the bad channels, as in the rtsss plugin
+    RowVectorXi pickedChannels = pFiffInfo->pick_types(QString("mag"), false, false, QStringList(), pFiffInfo->bads);
+    QVERIFY(pickedChannels.cols() > 0);
+
+    m_rtSss.setMEGInfo(pFiffInfo, pickedChannels);
+
+    QList<int> expOrder;
+    expOrder << 4 << 3 << 6 << 3;
+    m_rtSss.setSSSParameter(expOrder);
+    m_rtSss.buildLinearEqn();
+
+    //Synthetic field of the expansion with sensor noise and a few coils with artifacts
+    MatrixXd matEqnA = m_rtSss.getLinEqn().at(3);
+    int iNSamples = 200;
+
+    m_matEqnB = matEqnA * MatrixXd::Random(matEqnA.cols(), iNSamples);
+    double dNoise = 0.01 * m_matEqnB.cwiseAbs().mean();
+    m_matEqnB += dNoise * MatrixXd::Random(m_matEqnB.rows(), iNSamples);
+    for(int i = 0; i < 3; ++i) {
+        m_matEqnB.row(std::rand() % m_matEqnB.rows()) += 50.0 * dNoise * RowVectorXd::Random(iNSamples);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRtSss::compareRepeatedBlocks()
+{
+    //Warm start is off by default, hence a block does not depend on the block before
+    MatrixXd matFirst = m_rtSss.getSSSRR(m_matEqnB);
+    MatrixXd matSecond = m_rtSss.getSSSRR(m_matEqnB);
+
+    QVERIFY(matFirst == matSecond);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtSss::compareChunkedToSerial()
+{
+    //The samples of a block are solved in chunks by several threads
+    m_rtSss.setWarmStart(false);
+    MatrixXd matSSSIn = m_rtSss.getSSSRR(m_matEqnB);
+
+    QCOMPARE(matSSSIn.cols(), m_matEqnB.cols());
+
+    //One sample at a time in a single chunk
+    MatrixXd matSSSInSerial(matSSSIn.rows(), m_matEqnB.cols());
+    for(int i = 0; i < m_matEqnB.cols(); ++i) {
+        matSSSInSerial.col(i) = m_rtSss.getSSSRR(m_matEqnB.col(i));
+    }
+
+    QCOMPARE(matSSSInSerial.rows(), matSSSIn.rows());
+    QVERIFY((matSSSIn - matSSSInSerial).norm() / matSSSInSerial.norm() < epsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtSss::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtSss)
+#include "test_rtsss.moc"
@@ -40,6 +40,7 @@
 //=============================================================================================================
 
 #include <utils/ioutils.h>
+#include <utils/spectral.h>
 #include "connectivity/metrics/coherence.h"
 #include "connectivity/metrics/imagcoherence.h"
 #include "connectivity/metrics/phaselockingvalue.h"
@@ -47,6 +48,10 @@
 #include "connectivity/metrics/unbiasedsquaredphaselagindex.h"
 #include "connectivity/metrics/weightedphaselagindex.h"
 #include "connectivity/metrics/debiasedsquaredweightedphaselagindex.h"
+#include "connectivity/metrics/spectralmetrics.h"
+#include "connectivity/network/network.h"
+#include "connectivity/network/networknode.h"
+#include "connectivity/network/networkedge.h"
 
 
 //*************************************************************************************************************
@@ -55,6 +60,7 @@
 //=============================================================================================================
 
 #include <QtTest>
+#include <QElapsedTimer>
 
 
 //*************************************************************************************************************
@@ -98,6 +104,9 @@ private slots:
     void spectralConnectivityPLI2();
     void spectralConnectivityWPLI();
     void spectralConnectivityWPLI2();
+    void spectralConnectivityMultiMetric();
+    void benchmarkCsd();
+    void networkDenseStorage();
     void cleanupTestCase();
 
 private:
@@ -376,6 +385,301 @@ void TestSpectralConnectivity::spectralConnectivityWPLI2()
 }
 
 
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::spectralConnectivityMultiMetric()
+{
+    //*********************************************************************************************************
+    // Load Data
+    //*********************************************************************************************************
+
+    QList<MatrixXd> matDataList = readConnectivityData();
+    int iNfft = matDataList.at(0).cols();
+    QString sWindowType = "hanning";
+
+    //*********************************************************************************************************
+    // Compute all spectral metrics in one pass
+    //*********************************************************************************************************
+
+    QMap<QString, QVector<MatrixXd> > mapMetrics = SpectralMetrics::computeSpectralMetrics(matDataList,
+                                                                                          SpectralMetrics::supportedMetrics(),
+                                                                                          iNfft,
+                                                                                          sWindowType);
+    QCOMPARE( mapMetrics.size(), SpectralMetrics::supportedMetrics().size() );
+
+    //*********************************************************************************************************
+    // Compute a pairwise reference from the tapered spectra of each epoch
+    //*********************************************************************************************************
+
+    QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iNfft, sWindowType);
+    int iNTrials = matDataList.size();
+    int iNRows = matDataList.at(0).rows();
+
+    QList<QPair<int,int> > lPairs;
+    lPairs << qMakePair(0, 1) << qMakePair(1, iNRows - 1);
+
+    for(int p = 0; p < lPairs.size(); ++p) {
+        int j = lPairs.at(p).first;
+        int k = lPairs.at(p).second;
+
+        RowVectorXd vecPsdSeed, vecPsdTarget, vecImagSign, vecImag, vecImagAbs, vecImagSquared;
+        RowVectorXcd vecCsd, vecCsdNorm;
+
+        for(int e = 0; e < iNTrials; ++e) {
+            MatrixXd matData = matDataList.at(e);
+            for(int i = 0; i < matData.rows(); ++i) {
+                matData.row(i).array() -= matData.row(i).mean();
+            }
+
+            QVector<MatrixXcd> vecTapSpectra = Spectral::computeTaperedSpectraMatrix(matData, tapers.first, iNfft, false);
+            RowVectorXd vecPsdSeedEpoch = Spectral::psdFromTaperedSpectra(vecTapSpectra.at(j), tapers.second, iNfft, 1.0);
+            RowVectorXd vecPsdTargetEpoch = Spectral::psdFromTaperedSpectra(vecTapSpectra.at(k), tapers.second, iNfft, 1.0);
+            RowVectorXcd vecCsdEpoch = Spectral::csdFromTaperedSpectra(vecTapSpectra.at(j), vecTapSpectra.at(k),
+                                                                       tapers.second, tapers.second, iNfft, 1.0);
+
+            if(e == 0) {
+                vecPsdSeed = RowVectorXd::Zero(vecCsdEpoch.cols());
+                vecPsdTarget = vecPsdSeed;
+                vecImagSign = vecPsdSeed;
+                vecImag = vecPsdSeed;
+                vecImagAbs = vecPsdSeed;
+                vecImagSquared = vecPsdSeed;
+                vecCsd = RowVectorXcd::Zero(vecCsdEpoch.cols());
+                vecCsdNorm = vecCsd;
+            }
+
+            vecPsdSeed += vecPsdSeedEpoch;
+            vecPsdTarget += vecPsdTargetEpoch;
+            vecCsd += vecCsdEpoch;
+            vecCsdNorm += vecCsdEpoch.cwiseQuotient(vecCsdEpoch.cwiseAbs().cast<std::complex<double> >());
+            vecImagSign += vecCsdEpoch.imag().cwiseSign();
+            vecImag += vecCsdEpoch.imag();
+            vecImagAbs += vecCsdEpoch.imag().cwiseAbs();
+            vecImagSquared += vecCsdEpoch.imag().cwiseAbs2();
+        }
+
+        RowVectorXcd vecCoherency = vecCsd.cwiseQuotient(vecPsdSeed.cwiseProduct(vecPsdTarget).cwiseSqrt().cast<std::complex<double> >());
+        RowVectorXd vecPLI = vecImagSign.cwiseAbs() / iNTrials;
+
+        QMap<QString, RowVectorXd> mapRef;
+        mapRef["COH"] = vecCoherency.cwiseAbs();
+        mapRef["IMAGCOH"] = vecCoherency.imag();
+        mapRef["PLV"] = vecCsdNorm.cwiseAbs() / iNTrials;
+        mapRef["PLI"] = vecPLI;
+        mapRef["USPLI"] = (double(iNTrials) * vecPLI.array().square() - 1.0) / double(iNTrials - 1);
+        mapRef["WPLI"] = vecImag.cwiseAbs().cwiseQuotient(vecImagAbs);
+        mapRef["DSWPLI"] = (vecImag.array().square() - vecImagSquared.array()) / (vecImagAbs.array().square() - vecImagSquared.array());
+
+        //*****************************************************************************************************
+        // Compare the seed/target pair of each metric
+        //*****************************************************************************************************
+
+        QMapIterator<QString, RowVectorXd> it(mapRef);
+        while(it.hasNext()) {
+            it.next();
+            printf("Metric %s, nodes %d and %d\n", it.key().toLatin1().constData(), j, k);
+            m_ConnectivityOutput = mapMetrics[it.key()].at(j).row(k);
+            m_RefConnectivityOutput = it.value();
+            compareConnectivity();
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::benchmarkCsd()
+{
+    //*********************************************************************************************************
+    // Compare the pairwise CSD to the blocked CSD of the stacked spectra for one epoch
+    //*********************************************************************************************************
+
+    //Sensor level up to source level networks
+    QList<int> lNodes;
+    lNodes << 64 << 306 << 5000;
+
+    for(int n = 0; n < lNodes.size(); ++n) {
+        int iNRows = lNodes.at(n);
+        int iNfft = 256;
+        int iNFreqs = iNfft / 2 + 1;
+
+        MatrixXd matData = MatrixXd::Random(iNRows, iNfft);
+        QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iNfft, "hanning");
+        QVector<MatrixXcd> vecTapSpectra = Spectral::computeTaperedSpectraMatrix(matData, tapers.first, iNfft, false);
+
+        QElapsedTimer timer;
+
+        //Pairwise reference on a few sampled seed rows only, which keeps the test bounded for large networks
+        QList<int> lSeeds;
+        for (int j = 0; j < iNRows; j += qMax(1, iNRows / 8)) {
+            lSeeds << j;
+        }
+        QVector<MatrixXcd> vecCsdRef;
+
+        timer.start();
+        for (int s = 0; s < lSeeds.size(); ++s) {
+            int j = lSeeds.at(s);
+            MatrixXcd matCsd = MatrixXcd(iNRows, iNFreqs);
+            for (int k = j; k < iNRows; ++k) {
+                matCsd.row(k) = Spectral::csdFromTaperedSpectra(vecTapSpectra.at(j), vecTapSpectra.at(k),
+                                                                tapers.second, tapers.second, iNfft, 1.0);
+            }
+            vecCsdRef.append(matCsd);
+        }
+        qint64 iPairwiseNsecs = timer.nsecsElapsed();
+
+        //Extrapolate the pairwise time to the full upper triangle
+        double dSeedPairs = 0.0;
+        for (int s = 0; s < lSeeds.size(); ++s) {
+            dSeedPairs += iNRows - lSeeds.at(s);
+        }
+        double dPairwiseMsecs = iPairwiseNsecs / 1e6 * (double(iNRows) * (iNRows + 1) / 2.0) / dSeedPairs;
+
+        //Blocked upper triangle of all pairs, one frequency at a time into the same buffer
+        MatrixXcd matCsd;
+        double dMaxError = 0.0;
+
+        timer.restart();
+        MatrixXcd matStacked = Spectral::stackTaperedSpectra(vecTapSpectra, tapers.second);
+        qint64 iBlockedNsecs = timer.nsecsElapsed();
+
+        for (int f = 0; f < iNFreqs; ++f) {
+            timer.restart();
+            Spectral::csdFromStackedSpectra(matStacked, tapers.second.rows(), f, iNfft, matCsd, 1.0);
+            iBlockedNsecs += timer.nsecsElapsed();
+
+            for (int s = 0; s < lSeeds.size(); ++s) {
+                int j = lSeeds.at(s);
+                for (int k = j; k < iNRows; ++k) {
+                    double dError = std::abs(matCsd(j,k) - vecCsdRef.at(s)(k,f)) / (std::abs(vecCsdRef.at(s)(k,f)) + 1e-12);
+                    dMaxError = qMax(dMaxError, dError);
+                }
+            }
+        }
+
+        printf("CSD %d nodes, %d frequencies: pairwise %.1f ms (extrapolated from %d seed rows), blocked %.1f ms, max. rel. error %g\n",
+               iNRows,
+               iNFreqs,
+               dPairwiseMsecs,
+               lSeeds.size(),
+               iBlockedNsecs / 1e6,
+               dMaxError);
+
+        QVERIFY( dMaxError < epsilon );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::networkDenseStorage()
+{
+    //*********************************************************************************************************
+    // Build the same network with single edges and with the dense weight buffer
+    //*********************************************************************************************************
+
+    int iNNodes = 60;
+    int iNBins = 9;
+
+    QVector<MatrixXd> vecWeights;
+    for(int i = 0; i < iNNodes; ++i) {
+        vecWeights.append(MatrixXd::Random(iNNodes, iNBins));
+    }
+
+    Network edgeNetwork("Test");
+    Network denseNetwork("Test");
+
+    for(int i = 0; i < iNNodes; ++i) {
+        RowVectorXf rowVert = RowVectorXf::Random(3);
+        edgeNetwork.append(NetworkNode::SPtr(new NetworkNode(i, rowVert)));
+        denseNetwork.append(NetworkNode::SPtr(new NetworkNode(i, rowVert)));
+    }
+
+    for(int i = 0; i < iNNodes; ++i) {
+        for(int j = i; j < iNNodes; ++j) {
+            MatrixXd matWeight = vecWeights.at(i).row(j).transpose();
+
+            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
+
+            edgeNetwork.getNodeAt(i)->append(pEdge);
+            edgeNetwork.getNodeAt(j)->append(pEdge);
+            edgeNetwork.append(pEdge);
+        }
+    }
+
+    denseNetwork.setDenseWeights(vecWeights);
+    QVERIFY( denseNetwork.isDense() );
+
+    //*********************************************************************************************************
+    // Compare thresholding, connectivity matrices and degrees
+    //*********************************************************************************************************
+
+    edgeNetwork.setFrequencyBins(2, 6);
+    denseNetwork.setFrequencyBins(2, 6);
+
+    QList<double> lThresholds;
+    lThresholds << 0.0 << 0.1 << 0.25;
+
+    //Nodes handed out before a threshold change stay the nodes of the network
+    NetworkNode::SPtr pDenseNode = denseNetwork.getNodeAt(0);
+
+    for(int t = 0; t < lThresholds.size(); ++t) {
+        edgeNetwork.setThreshold(lThresholds.at(t));
+        denseNetwork.setThreshold(lThresholds.at(t));
+
+        QVERIFY( (edgeNetwork.getFullConnectivityMatrix() - denseNetwork.getFullConnectivityMatrix()).cwiseAbs().maxCoeff() < epsilon );
+        QVERIFY( (edgeNetwork.getThresholdedConnectivityMatrix() - denseNetwork.getThresholdedConnectivityMatrix()).cwiseAbs().maxCoeff() < epsilon );
+
+        MatrixXd matSparse = MatrixXd(denseNetwork.getThresholdedSparseMatrix());
+        QVERIFY( (matSparse - edgeNetwork.getThresholdedConnectivityMatrix()).cwiseAbs().maxCoeff() < epsilon );
+
+        QCOMPARE( denseNetwork.getThresholdedEdges().size(), edgeNetwork.getThresholdedEdges().size() );
+        QCOMPARE( denseNetwork.getThresholdedDistribution(), edgeNetwork.getThresholdedDistribution() );
+        QVERIFY( denseNetwork.getThresholdedDegrees() == edgeNetwork.getThresholdedDegrees() );
+        QVERIFY( denseNetwork.getFullDegrees() == edgeNetwork.getFullDegrees() );
+        QCOMPARE( denseNetwork.getMinMaxThresholdedIndegrees().second, edgeNetwork.getMinMaxThresholdedIndegrees().second );
+        QCOMPARE( denseNetwork.getMinMaxThresholdedOutdegrees().second, edgeNetwork.getMinMaxThresholdedOutdegrees().second );
+
+        for(int i = 0; i < iNNodes; ++i) {
+            QCOMPARE( denseNetwork.getNodes().at(i)->getThresholdedDegree(), edgeNetwork.getNodes().at(i)->getThresholdedDegree() );
+        }
+
+        QVERIFY( denseNetwork.getNodes().at(0) == pDenseNode );
+        QCOMPARE( pDenseNode->getThresholdedDegree(), edgeNetwork.getNodes().at(0)->getThresholdedDegree() );
+    }
+
+    //*********************************************************************************************************
+    // Time thresholding of a large network
+    //*********************************************************************************************************
+
+    int iNLargeNodes = 2000;
+    MatrixXd matWeights = MatrixXd::Random(iNLargeNodes, iNLargeNodes);
+
+    Network largeNetwork("Test");
+    for(int i = 0; i < iNLargeNodes; ++i) {
+        largeNetwork.append(NetworkNode::SPtr(new NetworkNode(i, RowVectorXf::Zero(3))));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    largeNetwork.setDenseWeights(matWeights);
+    qint64 iSetNsecs = timer.nsecsElapsed();
+
+    timer.restart();
+    largeNetwork.setThreshold(0.99);
+    QPair<int,int> pairDegrees = largeNetwork.getMinMaxThresholdedDegrees();
+    Eigen::SparseMatrix<double, Eigen::RowMajor> matSparse = largeNetwork.getThresholdedSparseMatrix();
+    qint64 iThresholdNsecs = timer.nsecsElapsed();
+
+    printf("Dense network %d nodes: setting weights %.1f ms, thresholding with degrees and CSR export %.1f ms, %d edges, max. degree %d\n",
+           iNLargeNodes,
+           iSetNsecs / 1e6,
+           iThresholdNsecs / 1e6,
+           int(matSparse.nonZeros()),
+           pairDegrees.second);
+}
+
+
 //*************************************************************************************************************
 
 QList<MatrixXd> TestSpectralConnectivity::readConnectivityData()
@@ -0,0 +1,331 @@
+//=============================================================================================================
+/**
+* @file     test_spscmatrixbuffer.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test and benchmark for the lock-free matrix ring buffer SpscMatrixBuffer
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/circularmatrixbuffer.h>
+#include <utils/generics/spscmatrixbuffer.h>
+
+#include <algorithm>
+#include <vector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QThread>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace IOBUFFER;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Pushes numbered blocks to a CircularMatrixBuffer or a SpscMatrixBuffer. The first element of each block
+* holds the block number, the second one the time it was pushed, so the consumer can verify the order and
+* measure the latency.
+*/
+class BlockProducer : public QThread
+{
+public:
+    BlockProducer(const QElapsedTimer* pTimer, int iBlocks, qint64 iPauseNsecs)
+    : m_pTimer(pTimer)
+    , m_iBlocks(iBlocks)
+    , m_iPauseNsecs(iPauseNsecs)
+    {
+    }
+
+    CircularMatrixBuffer<double>::SPtr  m_pCircularBuffer;
+    SpscMatrixBuffer<double>::SPtr      m_pSpscBuffer;
+    MatrixXd                            m_matBlock;
+
+protected:
+    virtual void run()
+    {
+        for(int i = 0; i < m_iBlocks; ++i) {
+            if(m_iPauseNsecs > 0) {
+                qint64 iStart = m_pTimer->nsecsElapsed();
+                while(m_pTimer->nsecsElapsed() - iStart < m_iPauseNsecs) {
+                }
+            }
+
+            if(m_pSpscBuffer) {
+                //Write the block in place, like an acquisition plugin converting its device buffer
+                MatrixXd* pSlot = m_pSpscBuffer->beginPush();
+                if(!pSlot) {
+                    return;
+                }
+                *pSlot = m_matBlock;
+                (*pSlot)(0,0) = i;
+                (*pSlot)(1,0) = m_pTimer->nsecsElapsed();
+                m_pSpscBuffer->commitPush();
+            } else {
+                m_matBlock(0,0) = i;
+                m_matBlock(1,0) = m_pTimer->nsecsElapsed();
+                m_pCircularBuffer->push(&m_matBlock);
+            }
+        }
+    }
+
+private:
+    const QElapsedTimer*    m_pTimer;
+    int                     m_iBlocks;
+    qint64                  m_iPauseNsecs;
+};
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestSpscMatrixBuffer
+*
+* @brief The TestSpscMatrixBuffer class verifies the lock-free matrix ring buffer and compares it to the
+*        semaphore based CircularMatrixBuffer
+*
+*/
+class TestSpscMatrixBuffer: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestSpscMatrixBuffer();
+
+private slots:
+    void initTestCase();
+    void compareFifoOrder();
+    void compareBatches();
+    void benchmarkThroughput();
+    void benchmarkLatency();
+    void cleanupTestCase();
+
+private:
+    bool run(bool bSpsc, int iBlocks, qint64 iPauseNsecs, double& dSecs, std::vector<qint64>& vecLatencies) const;
+
+    int m_iRows;
+    int m_iCols;
+    int m_iSlots;
+};
+
+
+//*************************************************************************************************************
+
+TestSpscMatrixBuffer::TestSpscMatrixBuffer()
+: m_iRows(306)
+, m_iCols(100)
+, m_iSlots(8)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestSpscMatrixBuffer::initTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestSpscMatrixBuffer::compareFifoOrder()
+{
+    double dSecs;
+    std::vector<qint64> vecLatencies;
+
+    QVERIFY(run(true, 2000, 0, dSecs, vecLatencies));
+
+    //Stopping releases a waiting consumer
+    SpscMatrixBuffer<double> buffer(2, 3, 4);
+    buffer.stop();
+
+    MatrixXd matrix;
+    QVERIFY(!buffer.pop(matrix));
+
+    buffer.clear();
+    QVERIFY(buffer.push(MatrixXd::Ones(3, 4)));
+    QVERIFY(buffer.pop(matrix, false));
+    QVERIFY(matrix == MatrixXd::Ones(3, 4));
+    QVERIFY(!buffer.pop(matrix, false));
+}
+
+
+//*************************************************************************************************************
+
+void TestSpscMatrixBuffer::compareBatches()
+{
+    SpscMatrixBuffer<double> buffer(4, 2, 2, false);
+    QCOMPARE(buffer.size(), (quint32)4);
+
+    QList<MatrixXd> lIn;
+    for(int i = 0; i < 6; ++i) {
+        lIn.append(MatrixXd::Constant(2, 2, i));
+    }
+
+    //A non-blocking batch fills the free slots only
+    QCOMPARE(buffer.pushBatch(lIn, false), 4);
+    QCOMPARE(buffer.count(), (quint32)4);
+    QVERIFY(!buffer.push(lIn.at(4), false));
+
+    QList<MatrixXd> lOut;
+    QCOMPARE(buffer.popBatch(lOut, 3), 3);
+    QCOMPARE(buffer.popBatch(lOut, 3), 1);
+    QCOMPARE(buffer.popBatch(lOut, 3), 0);
+
+    for(int i = 0; i < lOut.size(); ++i) {
+        QVERIFY(lOut.at(i) == lIn.at(i));
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpscMatrixBuffer::benchmarkThroughput()
+{
+    const int iBlocks = 20000;
+    double dSecsCircular, dSecsSpsc;
+    std::vector<qint64> vecLatencies;
+
+    QVERIFY(run(false, iBlocks, 0, dSecsCircular, vecLatencies));
+    QVERIFY(run(true, iBlocks, 0, dSecsSpsc, vecLatencies));
+
+    qDebug("Throughput of %d x %d blocks:", m_iRows, m_iCols);
+    qDebug("CircularMatrixBuffer: %10.0f blocks/s", iBlocks / dSecsCircular);
+    qDebug("SpscMatrixBuffer:     %10.0f blocks/s", iBlocks / dSecsSpsc);
+}
+
+
+//*************************************************************************************************************
+
+void TestSpscMatrixBuffer::benchmarkLatency()
+{
+    //One block every 100 us, i.e. faster than any acquisition system, so the buffers do not fill up
+    const int iBlocks = 5000;
+    const qint64 iPauseNsecs = 100000;
+
+    QStringList lNames;
+    lNames << "CircularMatrixBuffer" << "SpscMatrixBuffer";
+
+    qDebug("Latency from push to pop in us (median / 99%% / 99.9%% / max):");
+
+    for(int k = 0; k < 2; ++k) {
+        double dSecs;
+        std::vector<qint64> vecLatencies;
+        QVERIFY(run(k == 1, iBlocks, iPauseNsecs, dSecs, vecLatencies));
+
+        std::sort(vecLatencies.begin(), vecLatencies.end());
+        const int n = vecLatencies.size();
+
+        qDebug("%-20s: %8.1f / %8.1f / %8.1f / %8.1f",
+               lNames.at(k).toLatin1().constData(),
+               vecLatencies[n / 2] / 1000.0,
+               vecLatencies[n * 99 / 100] / 1000.0,
+               vecLatencies[n * 999 / 1000] / 1000.0,
+               vecLatencies[n - 1] / 1000.0);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpscMatrixBuffer::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+bool TestSpscMatrixBuffer::run(bool bSpsc,
+                               int iBlocks,
+                               qint64 iPauseNsecs,
+                               double& dSecs,
+                               std::vector<qint64>& vecLatencies) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    BlockProducer producer(&timer, iBlocks, iPauseNsecs);
+    producer.m_matBlock = MatrixXd::Random(m_iRows, m_iCols);
+
+    if(bSpsc) {
+        producer.m_pSpscBuffer = SpscMatrixBuffer<double>::SPtr(new SpscMatrixBuffer<double>(m_iSlots, m_iRows, m_iCols));
+    } else {
+        producer.m_pCircularBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(m_iSlots, m_iRows, m_iCols));
+    }
+
+    vecLatencies.clear();
+    vecLatencies.reserve(iBlocks);
+
+    bool bInOrder = true;
+    MatrixXd matBlock(m_iRows, m_iCols);
+
+    qint64 iStart = timer.nsecsElapsed();
+    producer.start();
+
+    for(int i = 0; i < iBlocks; ++i) {
+        if(bSpsc) {
+            producer.m_pSpscBuffer->pop(matBlock);
+        } else {
+            matBlock = producer.m_pCircularBuffer->pop();
+        }
+
+        vecLatencies.push_back(timer.nsecsElapsed() - (qint64)matBlock(1,0));
+        bInOrder = bInOrder && matBlock(0,0) == i && matBlock(m_iRows - 1, m_iCols - 1) == producer.m_matBlock(m_iRows - 1, m_iCols - 1);
+    }
+
+    dSecs = (timer.nsecsElapsed() - iStart) / 1e9;
+    producer.wait();
+
+    return bInOrder;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestSpscMatrixBuffer)
+#include "test_spscmatrixbuffer.moc"
@@ -41,11 +41,22 @@ SUBDIRS += \
     test_codecov \
     test_dipole_fit \
     test_fiff_rwr \
+    test_fiff_raw_segment \
+    test_fiff_raw_writer \
+    test_rtfilter \
+    test_rtcov \
+    test_rtsss \
+    test_rtave \
+    test_rtprocessor \
+    test_rtinvop \
+    test_spscmatrixbuffer \
     test_fiff_mne_types_io \
     test_forward_solution \
     test_fiff_cov \
     test_fiff_digitizer \
     test_mne_msh_display_surface_set \
+    test_kmeans \
+    test_minimum_norm \
 
 !contains(MNECPP_CONFIG, minimalVersion) {
     qtHaveModule(charts) {